@@ -39,6 +39,9 @@ QT_BEGIN_NAMESPACE
   \brief The ChunkDevice class is a simple QIODevice representing a part of another QIODevice
 
   Used for chunked upload so that we can pass a QIODevice to QNetworkAccessManager.
+  Several chunks of one file are sent at once, so every read seeks the source
+  to the position of this chunk. The device has to be opened unbuffered, then
+  pos() is where the next read starts.
 
   \internal
 */
@@ -54,7 +57,11 @@ public:
         Q_ASSERT(source->isOpen());
         Q_ASSERT(source->isReadable());
         Q_ASSERT(!source->isSequential());
-        source->seek(startPos);
+    }
+
+    bool open(OpenMode mode) Q_DECL_OVERRIDE
+    {
+        return QIODevice::open(mode | QIODevice::Unbuffered);
     }
 
     bool isSequential() const Q_DECL_OVERRIDE
@@ -64,6 +71,12 @@ public:
 
     qint64 readData(char *data, qint64 maxlen) Q_DECL_OVERRIDE
     {
+        const qint64 position = pos();
+        maxlen = qMin(maxlen, size() - position);
+        if (maxlen <= 0)
+            return 0;
+        if (!_source->seek(_startPos + position))
+            return -1;
         return _source->read(data, maxlen);
     }
 
@@ -74,23 +87,7 @@ public:
 
     qint64 size() const Q_DECL_OVERRIDE
     {
-        return qMin(_source->size() - _startPos, _chunkSize);
-    }
-
-    qint64 pos() const Q_DECL_OVERRIDE
-    {
-        return _source->pos() - _startPos;
-    }
-
-    bool seek(qint64 pos) Q_DECL_OVERRIDE
-    {
-        QIODevice::seek(pos);
-        return _source->seek(pos + _startPos);
-    }
-
-    qint64 bytesAvailable() const Q_DECL_OVERRIDE
-    {
-        return qMin(_source->bytesAvailable(), _chunkSize + (_startPos - _source->pos()));
+        return qMax(Q_INT64_C(0), qMin(_source->size() - _startPos, _chunkSize));
     }
 
 private:
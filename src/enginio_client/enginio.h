@@ -50,6 +50,7 @@ namespace Enginio {
     Q_ENUMS(Operation)
     Q_ENUMS(ErrorType)
     Q_ENUMS(Role)
+    Q_ENUMS(RequestPriority)
 
 #ifndef Q_QDOC
 public:
@@ -92,12 +93,20 @@ public:
         NetworkError,
         BackendError
     };
+
+    enum RequestPriority {
+        InteractivePriority,
+        ModelWritePriority,
+        BackgroundPriority,
+        FileTransferPriority
+    };
 };
 
 Q_DECLARE_TYPEINFO(Enginio::Operation, Q_PRIMITIVE_TYPE);
 Q_DECLARE_TYPEINFO(Enginio::AuthenticationState, Q_PRIMITIVE_TYPE);
 Q_DECLARE_TYPEINFO(Enginio::Role, Q_PRIMITIVE_TYPE);
 Q_DECLARE_TYPEINFO(Enginio::ErrorType, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(Enginio::RequestPriority, Q_PRIMITIVE_TYPE);
 
 QT_END_NAMESPACE
 
@@ -105,5 +114,6 @@ Q_DECLARE_METATYPE(Enginio::Operation)
 Q_DECLARE_METATYPE(Enginio::AuthenticationState)
 Q_DECLARE_METATYPE(Enginio::Role)
 Q_DECLARE_METATYPE(Enginio::ErrorType)
+Q_DECLARE_METATYPE(Enginio::RequestPriority)
 
 #endif // ENGINIO_H
@@ -13,18 +13,34 @@ include(../src.pri)
 
 SOURCES += \
     enginiobackendconnection.cpp \
+    enginiobatch.cpp \
     enginioclient.cpp \
     enginioreply.cpp \
+    enginiorequestbuilder.cpp \
+    enginiochunkedupload.cpp \
+    enginiouploadjournal.cpp \
+    enginiorequestscheduler.cpp \
+    enginiosharedqueries.cpp \
+    enginioresponsecache.cpp \
     enginiomodel.cpp \
+    enginiomodelcolumns.cpp \
+    enginiomodelsnapshot.cpp \
+    enginionotificationhub.cpp \
     enginioidentity.cpp \
+    enginiojsonstreamreader.cpp \
     enginiofakereply.cpp \
     enginiodummyreply.cpp \
-    enginiostring.cpp
+    enginiostring.cpp \
+    enginiowebsocketdecoder.cpp \
+    enginiowebsocketinflater.cpp \
+    enginiowebsocketmask.cpp
 
 HEADERS += \
     chunkdevice_p.h \
     enginio.h \
     enginiobackendconnection_p.h \
+    enginiobatch.h \
+    enginiobatch_p.h \
     enginiobasemodel.h \
     enginiobasemodel_p.h \
     enginioclient.h\
@@ -32,16 +48,38 @@ HEADERS += \
     enginioclient_p.h \
     enginioreply.h \
     enginiomodel.h \
+    enginiomodelcolumns_p.h \
+    enginiomodelsnapshot_p.h \
+    enginionotificationhub_p.h \
     enginioidentity.h \
+    enginiojsonstreamreader_p.h \
     enginioobjectadaptor_p.h \
     enginioreply_p.h \
+    enginiorequestbuilder_p.h \
+    enginiorequestcontext_p.h \
+    enginiochunkedupload_p.h \
+    enginiouploadjournal_p.h \
+    enginiorequestscheduler_p.h \
+    enginiosharedqueries_p.h \
+    enginioresponsecache_p.h \
     enginiofakereply_p.h \
     enginiodummyreply_p.h \
     enginiostring_p.h \
+    enginiowebsocketdecoder_p.h \
+    enginiowebsocketinflater_p.h \
+    enginiowebsocketmask_p.h \
     enginioclientconnection.h \
     enginiooauth2authentication.h \
     enginioreplystate.h
 
+# permessage-deflate for the notification stream
+contains(QT_CONFIG, system-zlib) {
+    if(unix|mingw): LIBS_PRIVATE += -lz
+    else: LIBS += zdll.lib
+} else {
+    INCLUDEPATH += $$[QT_INSTALL_HEADERS/get]/QtZlib
+}
+
 DEFINES +=  "ENGINIO_VERSION=\\\"$$MODULE_VERSION\\\""
 
 load(qt_module)
@@ -32,6 +32,7 @@
 ****************************************************************************/
 
 #include <Enginio/private/enginiobackendconnection_p.h>
+#include <Enginio/private/enginiowebsocketmask_p.h>
 #include <Enginio/enginioclient.h>
 #include <Enginio/private/enginioclient_p.h>
 #include <Enginio/enginioreply.h>
@@ -48,19 +49,19 @@
 #include <QtNetwork/qtcpsocket.h>
 #include <QtCore/qdebug.h>
 
+#include <string.h>
+
 #define CRLF QLatin1String("\r\n")
 
 QT_BEGIN_NAMESPACE
 
-const static int NIL = 0x00;
 const static int FIN = 0x80;
-const static int MSB = 0x80;
 const static int MSK = 0x80;
-const static int OPC = 0x0F;
-const static int LEN = 0x7F;
 
 const static int ThirtySeconds = 30000;
 const static int TwoMinutes = 120000;
+const static int OneSecond = 1000;
+const static int OneMinute = 60000;
 const static quint64 DefaultHeaderLength = 2;
 const static quint64 LargePayloadHeaderLength = 8;
 const static quint64 MaskingKeyLength = 4;
@@ -74,15 +75,14 @@ const QString HttpResponseStatus(QStringLiteral("HTTP/1\\.1\\s([0-9]{3})\\s"));
 const QString SecWebSocketAcceptHeader(QStringLiteral("Sec-WebSocket-Accept:\\s(.{28})\r\n"));
 const QString UpgradeHeader(QStringLiteral("Upgrade:\\s(.+)\r\n"));
 const QString ConnectionHeader(QStringLiteral("Connection:\\s(.+)\r\n"));
+const QString SecWebSocketExtensionsHeader(QStringLiteral("Sec-WebSocket-Extensions:\\s(.+)\r\n"));
 
-QString gBase64EncodedSha1VerificationKey;
-
-void computeBase64EncodedSha1VerificationKey(const QByteArray &base64Key)
+QString computeBase64EncodedSha1VerificationKey(const QByteArray &base64Key)
 {
     // http://tools.ietf.org/html/rfc6455#section-4.2.2 §5./ 4.
     QByteArray webSocketMagicString(QByteArrayLiteral("258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
     webSocketMagicString.prepend(base64Key);
-    gBase64EncodedSha1VerificationKey = QString::fromUtf8(QCryptographicHash::hash(webSocketMagicString, QCryptographicHash::Sha1).toBase64());
+    return QString::fromUtf8(QCryptographicHash::hash(webSocketMagicString, QCryptographicHash::Sha1).toBase64());
 }
 
 const QByteArray generateBase64EncodedUniqueKey()
@@ -90,25 +90,13 @@ const QByteArray generateBase64EncodedUniqueKey()
     return QUuid::createUuid().toRfc4122().toBase64();
 }
 
-QByteArray generateMaskingKey()
+void generateMaskingKey(uchar *key)
 {
     // The masking key is a 32-bit value chosen at random by the client.
-    QByteArray uuid = QUuid::createUuid().toRfc4122();
-    QByteArray key = uuid.left(MaskingKeyLength);
-    for (int octet = MaskingKeyLength; octet < uuid.size(); ++octet) {
-        int index = octet % key.size();
-        key[index] = key[index] ^ uuid[octet];
-    }
-    return key;
-}
-
-void maskData(QByteArray &data, const QByteArray &maskingKey )
-{
-    // Client-to-Server Masking.
-    // http://tools.ietf.org/html/rfc6455#section-5.3
-
-    for (int octet = 0; octet < data.size(); ++octet)
-        data[octet] = data[octet] ^ maskingKey[octet % maskingKey.size()];
+    const QByteArray uuid = QUuid::createUuid().toRfc4122();
+    memcpy(key, uuid.constData(), MaskingKeyLength);
+    for (int octet = MaskingKeyLength; octet < uuid.size(); ++octet)
+        key[octet % MaskingKeyLength] ^= uuid[octet];
 }
 
 int extractResponseStatus(QString responseString)
@@ -129,7 +117,7 @@ const QString extractResponseHeader(QString pattern, QString responseString, boo
     return match.captured(1);
 }
 
-const QByteArray constructOpeningHandshake(const QUrl& url)
+const QByteArray constructOpeningHandshake(const QUrl& url, bool offerCompression, QString *verificationKey)
 {
     // http://tools.ietf.org/html/rfc6455#section-4.1 §2./ 7.
     // The request must include a header field with the name
@@ -139,7 +127,8 @@ const QByteArray constructOpeningHandshake(const QUrl& url)
     // The nonce must be selected randomly for each connection.
 
     const QByteArray secWebSocketKeyBase64 = generateBase64EncodedUniqueKey();
-    computeBase64EncodedSha1VerificationKey(secWebSocketKeyBase64);
+    // kept per connection, handshakes of several connections may overlap
+    *verificationKey = computeBase64EncodedSha1VerificationKey(secWebSocketKeyBase64);
 
     const QString request =  QLatin1String("GET ") % url.path(QUrl::FullyEncoded) % QChar::fromLatin1('?')
                                 % url.query(QUrl::FullyEncoded) % QLatin1String(" HTTP/1.1") % CRLF %
@@ -150,51 +139,14 @@ const QByteArray constructOpeningHandshake(const QUrl& url)
                              QLatin1String("Upgrade: websocket") % CRLF %
                              QLatin1String("Connection: upgrade") % CRLF %
                              QLatin1String("Sec-WebSocket-Key: ") % QString::fromUtf8(secWebSocketKeyBase64) % CRLF %
-                             QLatin1String("Sec-WebSocket-Version: 13") % CRLF % CRLF;
-
-    return request.toUtf8();
-}
-
-const QByteArray constructFrameHeader(bool isFinalFragment
-                                      , int opcode
-                                      , quint64 payloadLength
-                                      , const QByteArray &maskingKey
-                                      )
-{
-    QByteArray frameHeader(DefaultHeaderLength, 0);
-
-    // FIN, x, x, x, Opcode
-    frameHeader[0] = frameHeader[0] | (isFinalFragment ? FIN : NIL) | opcode;
-
-    // Masking bit
-    frameHeader[1] = frameHeader[1] | MSK;
-
-    // Payload length. Small payload.
-    if (payloadLength < NormalPayloadMarker)
-        frameHeader[1] = frameHeader[1] | payloadLength;
-    else {
-        if (payloadLength > NormalPayloadLengthLimit) {
-            frameHeader[1] = frameHeader[1] | LargePayloadMarker;
-            quint64 lengthBigEndian = qToBigEndian<quint64>(payloadLength);
-            QByteArray lengthBytesBigEndian(reinterpret_cast<char*>(&lengthBigEndian), LargePayloadHeaderLength);
-
-            if (lengthBytesBigEndian[0] & MSB) {
-                qDebug() << "\t ERROR: Payload too large!" << payloadLength;
-                return QByteArray();
-            }
-
-            frameHeader.append(lengthBytesBigEndian);
-        } else {
-            frameHeader[1] = frameHeader[1] | NormalPayloadMarker;
-            quint16 lengthBigEndian = qToBigEndian<quint16>(payloadLength);
-            frameHeader.append(reinterpret_cast<char*>(&lengthBigEndian), DefaultHeaderLength);
-        }
-    }
-
-    // Masking-key
-    frameHeader.append(maskingKey);
-
-    return frameHeader;
+                             QLatin1String("Sec-WebSocket-Version: 13") % CRLF;
+
+    // http://tools.ietf.org/html/rfc7692#section-7.1
+    // Context takeover is the default in both directions, we only
+    // ever send control frames, so there is nothing to say about ours.
+    if (offerCompression)
+        return request.toUtf8() + "Sec-WebSocket-Extensions: permessage-deflate\r\n\r\n";
+    return request.toUtf8() + "\r\n";
 }
 
 } // namespace
@@ -209,13 +161,16 @@ const QByteArray constructFrameHeader(bool isFinalFragment
 
 EnginioBackendConnection::EnginioBackendConnection(QObject *parent)
     : QObject(parent)
-    , _protocolOpcode(ContinuationFrameOp)
     , _protocolDecodeState(HandshakePending)
     , _sentCloseFrame(false)
-    , _isFinalFragment(false)
-    , _isPayloadMasked(false)
-    , _payloadLength(0)
+    , _offerCompression(true)
+    , _compressed(false)
     , _tcpSocket(new QTcpSocket(this))
+    , _reconnect(false)
+    , _wasConnected(false)
+    , _reconnectAttempt(0)
+    , _reconnectCount(0)
+    , _initialReconnectDelay(OneSecond)
 {
     _tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
     _tcpSocket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
@@ -238,6 +193,7 @@ void EnginioBackendConnection::onEnginioFinished(EnginioReply *reply)
         qDebug() << reply->errorString();
         reply->dumpDebugInfo();
         qDebug() << "\n###\n";
+        scheduleReconnect();
         return;
     }
 
@@ -245,6 +201,7 @@ void EnginioBackendConnection::onEnginioFinished(EnginioReply *reply)
 
     if (!urlValue.isString()) {
         qDebug() << "## Retrieving connection url failed.";
+        scheduleReconnect();
         return;
     }
 
@@ -257,10 +214,26 @@ void EnginioBackendConnection::onEnginioFinished(EnginioReply *reply)
 void EnginioBackendConnection::protocolError(const char* message, WebSocketCloseStatus status)
 {
     qWarning() << QLatin1Literal(message) << QStringLiteral("Closing socket.");
-    close(status);
+    sendCloseFrame(status);
     _tcpSocket->close();
 }
 
+/*!
+  \internal
+  Connects again after 1, 2, 4, ... seconds (at most a minute), each delay
+  is picked randomly from its upper half so that many clients losing the
+  same server do not come back all at once.
+*/
+void EnginioBackendConnection::scheduleReconnect()
+{
+    if (!_reconnect || _reconnectTimer.isActive())
+        return;
+    const int delay = qMin(OneMinute, _initialReconnectDelay << qMin(_reconnectAttempt, 16));
+    const int jitteredDelay = delay / 2 + qrand() % (delay / 2 + 1);
+    ++_reconnectAttempt;
+    _reconnectTimer.start(jitteredDelay, this);
+}
+
 void EnginioBackendConnection::timerEvent(QTimerEvent *event)
 {
 
@@ -272,11 +245,22 @@ void EnginioBackendConnection::timerEvent(QTimerEvent *event)
 
     if (event->timerId() == _pingTimeoutTimer.timerId()) {
         _pingTimeoutTimer.stop();
-        close();
+        // the server is gone, there is no point in waiting for its close frame
+        sendCloseFrame(GoingAwayCloseStatus);
+        _tcpSocket->abort();
         emit timeOut();
         return;
     }
 
+    if (event->timerId() == _reconnectTimer.timerId()) {
+        _reconnectTimer.stop();
+        if (!_client)
+            return;
+        _tcpSocket->abort();
+        connectToBackend(EnginioClientConnectionPrivate::get(_client.data()), _messageFilter);
+        return;
+    }
+
     QObject::timerEvent(event);
 }
 
@@ -295,15 +279,18 @@ void EnginioBackendConnection::onSocketStateChanged(QAbstractSocket::SocketState
         _sentCloseFrame = false;
         // The protocol handshake will appear to the HTTP server
         // to be a regular GET request with an Upgrade offer.
-        _tcpSocket->write(constructOpeningHandshake(_socketUrl));
+        _tcpSocket->write(constructOpeningHandshake(_socketUrl, _offerCompression, &_verificationKey));
         break;
     case QAbstractSocket::ClosingState:
         _protocolDecodeState = HandshakePending;
-        _applicationData.clear();
-        _payloadLength = 0;
+        _decoder.clear();
+        _inflater.reset();
         break;
     case QAbstractSocket::UnconnectedState:
+        _keepAliveTimer.stop();
+        _pingTimeoutTimer.stop();
         emit stateChanged(DisconnectedState);
+        scheduleReconnect();
         break;
     default:
         break;
@@ -312,190 +299,174 @@ void EnginioBackendConnection::onSocketStateChanged(QAbstractSocket::SocketState
 
 void EnginioBackendConnection::onSocketReadyRead()
 {
-    //     WebSocket Protocol (RFC6455)
-    //     Base Framing Protocol
-    //     http://tools.ietf.org/html/rfc6455#section-5.2
-    //
-    //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-    //     +-+-+-+-+-------+-+-------------+-------------------------------+
-    //     |F|R|R|R| opcode|M| Payload len |    Extended payload length    |
-    //     |I|S|S|S|  (4)  |A|     (7)     |             (16/64)           |
-    //     |N|V|V|V|       |S|             |   (if payload len==126/127)   |
-    //     | |1|2|3|       |K|             |                               |
-    //     +-+-+-+-+-------+-+-------------+ - - - - - - - - - - - - - - - +
-    //     |     Extended payload length continued, if payload len == 127  |
-    //     + - - - - - - - - - - - - - - - +-------------------------------+
-    //     |                               |Masking-key, if MASK set to 1  |
-    //     +-------------------------------+-------------------------------+
-    //     | Masking-key (continued)       |          Payload Data         |
-    //     +-------------------------------- - - - - - - - - - - - - - - - +
-    //     :                     Payload Data continued ...                :
-    //     + - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - +
-    //     |                     Payload Data continued ...                |
-    //     +---------------------------------------------------------------+
-
-    while (_tcpSocket->bytesAvailable()) {
-        switch (_protocolDecodeState) {
-        case HandshakePending: {
-            // The response is closed by a CRLF line on its own (e.g. ends with two newlines).
-            while (_handshakeReply.isEmpty()
-                   || (!_handshakeReply.endsWith(QString(CRLF % CRLF).toUtf8())
-                   // According to documentation QIODevice::readLine replaces newline characters on
-                   // Windows with '\n', so just to be on the safe side:
-                   && !_handshakeReply.endsWith(QByteArrayLiteral("\n\n")))) {
-
-                if (!_tcpSocket->bytesAvailable())
-                    return;
-
-                _handshakeReply.append(_tcpSocket->readLine());
-            }
-
-            QString response = QString::fromUtf8(_handshakeReply);
-            _handshakeReply.clear();
-
-            int statusCode = extractResponseStatus(response);
-            QString secWebSocketAccept = extractResponseHeader(SecWebSocketAcceptHeader, response, /* ignoreCase */ false);
-            bool hasValidKey = secWebSocketAccept == gBase64EncodedSha1VerificationKey;
-
-            if (statusCode != 101 || !hasValidKey
-                    || extractResponseHeader(UpgradeHeader, response) != QStringLiteral("websocket")
-                    || extractResponseHeader(ConnectionHeader, response) != QStringLiteral("upgrade")
-                    )
-                return protocolError("Handshake failed!");
-
-            _keepAliveTimer.start(TwoMinutes, this);
-            _protocolDecodeState = FrameHeaderPending;
-            emit stateChanged(ConnectedState);
-        } // Fall-through.
-
-        case FrameHeaderPending: {
-            if (quint64(_tcpSocket->bytesAvailable()) < DefaultHeaderLength)
-                return;
-
-            // Large payload.
-            if (_payloadLength == LargePayloadMarker) {
-                if (quint64(_tcpSocket->bytesAvailable()) < LargePayloadHeaderLength)
-                    return;
-
-                char data[LargePayloadHeaderLength];
-                if (quint64(_tcpSocket->read(data, LargePayloadHeaderLength)) != LargePayloadHeaderLength)
-                    return protocolError("Reading large payload length failed!");
-
-                if (data[0] & MSB)
-                    return protocolError("The most significant bit of a large payload length must be 0!", MessageTooBigCloseStatus);
-
-                // 8 bytes interpreted as a 64-bit unsigned integer
-                _payloadLength = qFromBigEndian<quint64>(reinterpret_cast<uchar*>(data));
-                _protocolDecodeState = PayloadDataPending;
-
-                break;
-            }
+    // Everything the socket has is read in one go, the decoder parses it in place.
+    const qint64 available = _tcpSocket->bytesAvailable();
+    if (available <= 0)
+        return;
+    if (available > EnginioWebSocketDecoder::MaximumMessageSize)
+        return protocolError("Too much data received at once!", MessageTooBigCloseStatus);
+    const qint64 read = _tcpSocket->read(_decoder.reserve(int(available)), available);
+    if (read < 0)
+        return protocolError("Reading from the socket failed!");
+    _decoder.commit(int(read));
+
+    if (_protocolDecodeState == HandshakePending) {
+        // The response is closed by a CRLF line on its own (e.g. ends with two newlines).
+        QByteArray handshakeReply;
+        if (!_decoder.takeHandshake(&handshakeReply))
+            return;
+
+        QString response = QString::fromUtf8(handshakeReply);
+        int statusCode = extractResponseStatus(response);
+        QString secWebSocketAccept = extractResponseHeader(SecWebSocketAcceptHeader, response, /* ignoreCase */ false);
+        bool hasValidKey = secWebSocketAccept == _verificationKey;
+
+        if (statusCode != 101 || !hasValidKey
+                || extractResponseHeader(UpgradeHeader, response) != QStringLiteral("websocket")
+                || extractResponseHeader(ConnectionHeader, response) != QStringLiteral("upgrade")
+                )
+            return protocolError("Handshake failed!");
+
+        if (!acceptExtensions(extractResponseHeader(SecWebSocketExtensionsHeader, response)))
+            return protocolError("Unexpected extension in the handshake!", MissingExtensionClientCloseStatus);
+
+        _keepAliveTimer.start(TwoMinutes, this);
+        _protocolDecodeState = FramesPending;
+        _reconnectAttempt = 0;
+        emit stateChanged(ConnectedState);
+        if (_wasConnected) {
+            ++_reconnectCount;
+            emit reconnected();
+        }
+        _wasConnected = true;
+    }
 
-            char data[DefaultHeaderLength];
-            if (quint64(_tcpSocket->read(data, DefaultHeaderLength)) != DefaultHeaderLength)
-                return protocolError("Reading header failed!");
-
-            if (!_payloadLength) {
-                // This is the initial frame header data.
-                _isFinalFragment = (data[0] & FIN);
-                _protocolOpcode = static_cast<WebSocketOpcode>(data[0] & OPC);
-                _isPayloadMasked = (data[1] & MSK);
-                _payloadLength = (data[1] & LEN);
-
-                if (_isPayloadMasked)
-                    return protocolError("Invalid masked frame received from server.");
-
-                // For data length 0-125 LEN is the payload length.
-                if (_payloadLength < NormalPayloadMarker)
-                    _protocolDecodeState = PayloadDataPending;
-
-            } else {
-                Q_ASSERT(_payloadLength == NormalPayloadMarker);
-                // Normal sized payload: 2 bytes interpreted as the payload
-                // length expressed in network byte order (e.g. big endian).
-                _payloadLength = qFromBigEndian<quint16>(reinterpret_cast<uchar*>(data));
-                _protocolDecodeState = PayloadDataPending;
+    EnginioWebSocketDecoder::Frame frame;
+    for (;;) {
+        switch (_decoder.next(&frame)) {
+        case EnginioWebSocketDecoder::NeedMoreData:
+            return;
+        case EnginioWebSocketDecoder::ProtocolError:
+            return protocolError("Invalid frame received from server.");
+        case EnginioWebSocketDecoder::MessageTooBig:
+            return protocolError("The message received from server is too large!", MessageTooBigCloseStatus);
+        case EnginioWebSocketDecoder::FrameDecoded:
+            if (frame.compressed) {
+                QByteArray message;
+                if (!_inflater.inflate(frame.payload, frame.size, &message))
+                    return protocolError("Could not inflate the message received from server!", InconsistentDataTypeCloseStatus);
+                frame.payload = message.constData();
+                frame.size = message.size();
+                frame.compressed = false;
             }
-
+            if (!handleFrame(frame))
+                return;
             break;
         }
+    }
+}
 
-        case PayloadDataPending: {
-            if (static_cast<quint64>(_tcpSocket->bytesAvailable()) < _payloadLength)
-                return;
-
-            if (_protocolOpcode == ConnectionCloseOp) {
-                WebSocketCloseStatus closeStatus = UnknownCloseStatus;
-                if (_payloadLength >= DefaultHeaderLength) {
-                    char data[DefaultHeaderLength];
-                    if (quint64(_tcpSocket->read(data, DefaultHeaderLength)) != DefaultHeaderLength)
-                        return protocolError("Reading connection close status failed!");
-
-                     closeStatus = static_cast<WebSocketCloseStatus>(qFromBigEndian<quint16>(reinterpret_cast<uchar*>(data)));
-
-                     // The body may contain UTF-8-encoded data with value /reason/,
-                     // the interpretation of this data is however not defined by the
-                     // specification. Further more the data is not guaranteed to be
-                     // human readable, thus it is safe for us to just discard the rest
-                     // of the message at this point.
-                }
-
-                qDebug() << "Connection closed by the server with status:" << closeStatus;
-
-                QJsonObject data;
-                data[EnginioString::messageType] = QStringLiteral("close");
-                data[EnginioString::status] = closeStatus;
-                emit dataReceived(data);
+/*!
+  \internal
+  Checks the extensions the server accepted in the handshake response and
+  configures the decoding for them. Only permessage-deflate is offered, if
+  the server agreed to it, it may still decline context takeover or use a
+  smaller window, both of which the inflater copes with.
+*/
+bool EnginioBackendConnection::acceptExtensions(const QString &extensions)
+{
+    _compressed = false;
+    _decoder.setCompressionEnabled(false);
+    _inflater.reset();
+    _inflater.setContextTakeover(true);
+
+    if (extensions.isEmpty())
+        return true;
+    if (!_offerCompression || extensions.contains(QLatin1Char(',')))
+        return false;
+
+    // http://tools.ietf.org/html/rfc7692#section-7.1
+    const QStringList parameters = extensions.split(QLatin1Char(';'));
+    if (parameters.first().trimmed() != QStringLiteral("permessage-deflate"))
+        return false;
+    for (int i = 1; i < parameters.count(); ++i) {
+        const QString parameter = parameters.at(i).trimmed();
+        if (parameter == QStringLiteral("server_no_context_takeover")) {
+            _inflater.setContextTakeover(false);
+        } else if (parameter.startsWith(QStringLiteral("server_max_window_bits="))) {
+            bool ok;
+            const int bits = parameter.mid(parameter.indexOf(QLatin1Char('=')) + 1).remove(QLatin1Char('"')).toInt(&ok);
+            if (!ok || bits < 8 || bits > 15)
+                return false;
+        } else if (parameter != QStringLiteral("client_no_context_takeover")) {
+            // client_max_window_bits was not offered, anything else is unknown
+            return false;
+        }
+    }
 
-                close(closeStatus);
+    _compressed = true;
+    _decoder.setCompressionEnabled(true);
+    return true;
+}
 
-                _tcpSocket->close();
-                return;
-            }
+/*!
+  \internal
+  Handles a complete message or control frame, returns false if the
+  connection was closed.
+*/
+bool EnginioBackendConnection::handleFrame(const EnginioWebSocketDecoder::Frame &frame)
+{
+    if (frame.opcode == EnginioWebSocketDecoder::ConnectionCloseOp) {
+        WebSocketCloseStatus closeStatus = UnknownCloseStatus;
+        if (frame.size >= int(DefaultHeaderLength)) {
+            closeStatus = static_cast<WebSocketCloseStatus>(qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(frame.payload)));
+
+            // The body may contain UTF-8-encoded data with value /reason/,
+            // the interpretation of this data is however not defined by the
+            // specification. Further more the data is not guaranteed to be
+            // human readable, thus it is safe for us to just discard the rest
+            // of the message at this point.
+        }
 
-            // We received data from the server so restart the timer.
-            _keepAliveTimer.start(TwoMinutes, this);
+        qDebug() << "Connection closed by the server with status:" << closeStatus;
 
-            _applicationData.append(_tcpSocket->read(_payloadLength));
-            _protocolDecodeState = FrameHeaderPending;
-            _payloadLength = 0;
+        QJsonObject data;
+        data[EnginioString::messageType] = QStringLiteral("close");
+        data[EnginioString::status] = closeStatus;
+        emit dataReceived(data);
 
-            if (!_isFinalFragment)
-                break;
+        // unless we asked for it, we connect again
+        sendCloseFrame(closeStatus);
 
-            switch (_protocolOpcode) {
-            case TextFrameOp: {
-                QJsonObject data = QJsonDocument::fromJson(_applicationData).object();
-                data[EnginioString::messageType] = QStringLiteral("data");
-                emit dataReceived(data);
-                break;
-            }
-            case PingOp:{
-                // We must send back identical application data as found in the message.
-                QByteArray payload = _applicationData;
-                QByteArray maskingKey = generateMaskingKey();
-                QByteArray message = constructFrameHeader(/*isFinalFragment*/ true, PongOp, payload.size(), maskingKey);
-                Q_ASSERT(!message.isEmpty());
-                maskData(payload, maskingKey);
-                message.append(payload);
-                _tcpSocket->write(message);
-                break;
-            }
-            case PongOp:
-                _pingTimeoutTimer.stop();
-                emit pong();
-                break;
-            default:
-                protocolError("WebSocketOpcode not yet supported.", UnsupportedDataTypeCloseStatus);
-                qWarning() << "\t\t->" << _protocolOpcode;
-            }
+        _tcpSocket->close();
+        return false;
+    }
 
-            _applicationData.clear();
+    // We received data from the server so restart the timer.
+    _keepAliveTimer.start(TwoMinutes, this);
 
-            break;
-        }
-        }
+    switch (frame.opcode) {
+    case EnginioWebSocketDecoder::TextFrameOp: {
+        // the payload is parsed where it was received
+        QJsonObject data = QJsonDocument::fromJson(frame.data()).object();
+        data[EnginioString::messageType] = QStringLiteral("data");
+        emit dataReceived(data);
+        break;
+    }
+    case EnginioWebSocketDecoder::PingOp:
+        // We must send back identical application data as found in the message.
+        sendFrame(EnginioWebSocketDecoder::PongOp, frame.payload, frame.size);
+        break;
+    case EnginioWebSocketDecoder::PongOp:
+        _pingTimeoutTimer.stop();
+        emit pong();
+        break;
+    default:
+        protocolError("WebSocketOpcode not yet supported.", UnsupportedDataTypeCloseStatus);
+        qWarning() << "\t\t->" << frame.opcode;
+        return false;
     }
+    return true;
 }
 
 /*!
@@ -521,6 +492,10 @@ void EnginioBackendConnection::connectToBackend(EnginioClientConnectionPrivate*
     Q_ASSERT(client);
     Q_ASSERT(!client->_backendId.isEmpty());
 
+    _client = static_cast<EnginioClientConnection*>(client->q_ptr);
+    _messageFilter = messageFilter;
+    _reconnect = true;
+
     QUrl url(client->_serviceUrl);
     url.setPath(QStringLiteral("/v1/stream_url"));
 
@@ -544,25 +519,28 @@ void EnginioBackendConnection::connectToBackend(EnginioClient *client, const QJs
     connectToBackend(EnginioClientConnectionPrivate::get(client), messageFilter);
 }
 
+/*!
+  \internal
+  Closes the connection, it is not established again.
+*/
 void EnginioBackendConnection::close(WebSocketCloseStatus closeStatus)
 {
-    if (_sentCloseFrame)
+    _reconnect = false;
+    _reconnectTimer.stop();
+    sendCloseFrame(closeStatus);
+}
+
+void EnginioBackendConnection::sendCloseFrame(WebSocketCloseStatus closeStatus)
+{
+    if (_sentCloseFrame || _tcpSocket->state() != QAbstractSocket::ConnectedState)
         return;
 
     _sentCloseFrame = true;
     _keepAliveTimer.stop();
 
-    QByteArray payload;
-    quint16 closeStatusBigEndian = qToBigEndian<quint16>(closeStatus);
-    payload.append(reinterpret_cast<char*>(&closeStatusBigEndian), DefaultHeaderLength);
-
-    QByteArray maskingKey = generateMaskingKey();
-    QByteArray message = constructFrameHeader(/*isFinalFragment*/ true, ConnectionCloseOp, payload.size(), maskingKey);
-    Q_ASSERT(!message.isEmpty());
-
-    maskData(payload, maskingKey);
-    message.append(payload);
-    _tcpSocket->write(message);
+    uchar payload[2];
+    qToBigEndian<quint16>(closeStatus, payload);
+    sendFrame(EnginioWebSocketDecoder::ConnectionCloseOp, reinterpret_cast<const char*>(payload), sizeof(payload));
 }
 
 void EnginioBackendConnection::ping()
@@ -572,15 +550,56 @@ void EnginioBackendConnection::ping()
 
     // The WebSocket server should accept ping frames without payload according to
     // the specification, but ours does not, so let's add a dummy payload.
-    QByteArray dummy;
-    dummy.append(QStringLiteral("Ping.").toUtf8());
-    QByteArray maskingKey = generateMaskingKey();
-    QByteArray message = constructFrameHeader(/*isFinalFragment*/ true, PingOp, dummy.size(), maskingKey);
-    Q_ASSERT(!message.isEmpty());
-
-    maskData(dummy, maskingKey);
-    message.append(dummy);
-    _tcpSocket->write(message);
+    static const char dummy[] = "Ping.";
+    sendFrame(EnginioWebSocketDecoder::PingOp, dummy, sizeof(dummy) - 1);
+}
+
+/*!
+  \internal
+  Sends \a message as a text frame, e.g. to change the filter of the
+  stream. Returns false if the connection is not established.
+*/
+bool EnginioBackendConnection::sendMessage(const QJsonObject &message)
+{
+    if (!isConnected() || _sentCloseFrame)
+        return false;
+    const QByteArray data = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    sendFrame(EnginioWebSocketDecoder::TextFrameOp, data.constData(), data.size());
+    return true;
+}
+
+/*!
+  \internal
+  Writes one final, masked frame. The header, including the masking key, is
+  built on the stack and written separately from the payload, which is
+  masked into a buffer kept for the lifetime of the connection.
+*/
+void EnginioBackendConnection::sendFrame(int opcode, const char *payload, int size)
+{
+    uchar header[DefaultHeaderLength + LargePayloadHeaderLength + MaskingKeyLength];
+    int headerLength = DefaultHeaderLength;
+    header[0] = FIN | opcode;
+    if (size < int(NormalPayloadMarker)) {
+        header[1] = MSK | size;
+    } else if (size <= int(NormalPayloadLengthLimit)) {
+        header[1] = MSK | NormalPayloadMarker;
+        qToBigEndian<quint16>(size, header + headerLength);
+        headerLength += 2;
+    } else {
+        header[1] = MSK | LargePayloadMarker;
+        qToBigEndian<quint64>(size, header + headerLength);
+        headerLength += LargePayloadHeaderLength;
+    }
+    uchar *maskingKey = header + headerLength;
+    generateMaskingKey(maskingKey);
+    headerLength += MaskingKeyLength;
+
+    if (_maskedPayload.size() < size)
+        _maskedPayload.resize(size);
+    enginioMaskWebSocketData(_maskedPayload.data(), payload, size, maskingKey);
+
+    _tcpSocket->write(reinterpret_cast<const char*>(header), headerLength);
+    _tcpSocket->write(_maskedPayload.constData(), size);
 }
 
 QT_END_NAMESPACE
@@ -36,11 +36,15 @@
 
 #include <QtCore/qbasictimer.h>
 #include <QtCore/qjsonobject.h>
+#include <QtCore/qpointer.h>
 #include <QtCore/qstringlist.h>
 #include <QtCore/qurl.h>
 #include <QtNetwork/qabstractsocket.h>
 
 #include <Enginio/enginioclient_global.h>
+#include <Enginio/enginioclientconnection.h>
+#include <Enginio/private/enginiowebsocketdecoder_p.h>
+#include <Enginio/private/enginiowebsocketinflater_p.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -53,37 +57,36 @@ class ENGINIOCLIENT_EXPORT EnginioBackendConnection : public QObject
 {
     Q_OBJECT
 
-    enum WebSocketOpcode
-    {
-        ContinuationFrameOp = 0x0,
-        TextFrameOp = 0x1,
-        BinaryFrameOp = 0x2,
-        // %x3-7 are reserved for further non-control frames
-        ConnectionCloseOp = 0x8,
-        PingOp = 0x9,
-        PongOp = 0xA
-        // %xB-F are reserved for further control frames
-    } _protocolOpcode;
-
     enum ProtocolDecodeState
     {
         HandshakePending,
-        FrameHeaderPending,
-        PayloadDataPending
+        FramesPending
     } _protocolDecodeState;
 
     bool _sentCloseFrame;
-    bool _isFinalFragment;
-    bool _isPayloadMasked;
-    quint64 _payloadLength;
-    QByteArray _applicationData;
+    bool _offerCompression;
+    bool _compressed;
+    EnginioWebSocketDecoder _decoder;
+    EnginioWebSocketInflater _inflater;
+    QByteArray _maskedPayload; // reused for every outgoing frame
 
     QUrl _socketUrl;
-    QByteArray _handshakeReply;
+    QString _verificationKey; // expected Sec-WebSocket-Accept
     QTcpSocket *_tcpSocket;
     QBasicTimer _keepAliveTimer;
     QBasicTimer _pingTimeoutTimer;
 
+    // Unless close() was called, a lost connection is established again
+    // after a jittered, exponentially growing delay.
+    QPointer<EnginioClientConnection> _client;
+    QJsonObject _messageFilter;
+    QBasicTimer _reconnectTimer;
+    bool _reconnect;
+    bool _wasConnected;
+    int _reconnectAttempt;
+    int _reconnectCount;
+    int _initialReconnectDelay;
+
 public:
     enum WebSocketCloseStatus
     {
@@ -112,17 +115,23 @@ public:
     explicit EnginioBackendConnection(QObject *parent = 0);
 
     bool isConnected() { return _protocolDecodeState > HandshakePending; }
+    bool isCompressed() const { return _compressed; }
+    void setCompressionEnabled(bool enabled) { _offerCompression = enabled; }
+    int reconnectCount() const { return _reconnectCount; }
+    void setInitialReconnectDelay(int msecs) { _initialReconnectDelay = msecs; }
     void connectToBackend(EnginioClientConnectionPrivate *client, const QJsonObject& messageFilter = QJsonObject());
     void connectToBackend(EnginioClient *client, const QJsonObject& messageFilter = QJsonObject());
 
     void close(WebSocketCloseStatus closeStatus = NormalCloseStatus);
     void ping();
+    bool sendMessage(const QJsonObject &message);
 
 signals:
     void stateChanged(ConnectionState state);
     void dataReceived(QJsonObject data);
     void timeOut();
     void pong();
+    void reconnected();
 
 private slots:
     void onEnginioFinished(EnginioReply *);
@@ -132,6 +141,11 @@ private slots:
 
 private:
     void timerEvent(QTimerEvent *event);
+    void scheduleReconnect();
+    void sendCloseFrame(WebSocketCloseStatus closeStatus);
+    void sendFrame(int opcode, const char *payload, int size);
+    bool acceptExtensions(const QString &extensions);
+    bool handleFrame(const EnginioWebSocketDecoder::Frame &frame);
     void protocolError(const char* message, WebSocketCloseStatus status = ProtocolErrorCloseStatus);
 };
 
@@ -39,18 +39,27 @@
 #include <Enginio/enginioreply.h>
 #include <Enginio/private/enginioclient_p.h>
 #include <Enginio/private/enginiofakereply_p.h>
+#include <Enginio/private/enginioreply_p.h>
+#include <Enginio/private/enginiojsonstreamreader_p.h>
 #include <Enginio/private/enginiodummyreply_p.h>
 #include <Enginio/enginioreplystate.h>
 #include <Enginio/private/enginiobackendconnection_p.h>
 #include <Enginio/enginiobasemodel.h>
 #include <Enginio/private/enginiobasemodel_p.h>
+#include <Enginio/private/enginiomodelcolumns_p.h>
+#include <Enginio/private/enginiomodelsnapshot_p.h>
 
 #include <QtCore/qdatetime.h>
 #include <QtCore/qdebug.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtCore/qhash.h>
 #include <QtCore/qjsonobject.h>
 #include <QtCore/qjsonarray.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qset.h>
 #include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
 #include <QtCore/quuid.h>
 #include <QtCore/qvector.h>
 
@@ -64,6 +73,12 @@ enum {
     InvalidRow = NoHintRow
 };
 
+enum {
+    MinimalPrefetchPageSize = 10,
+    InitialPrefetchPageSize = 50, // until the model measured the views and the backend
+    MaximalPrefetchPageSize = 1000
+};
+
 struct EnginioModelPrivateAttachedData
 {
     uint ref;
@@ -86,13 +101,22 @@ QDebug operator<<(QDebug dbg, const EnginioModelPrivateAttachedData &a);
 class AttachedDataContainer
 {
     typedef int Row;
+    typedef int Slot;
     typedef int StorageIndex;
     typedef QString ObjectId;
     typedef QString RequestId;
     typedef EnginioModelPrivateAttachedData AttachedData;
 
-    typedef QHash<Row, StorageIndex> RowIndex;
-    RowIndex _rowIndex;
+    // Rows are not stored in the attached data. Every row that was ever inserted
+    // gets a slot, slots are only appended and never reordered, and a Fenwick tree
+    // counts the slots that are still alive. Converting a slot to a row or a row
+    // to a slot is a prefix sum or a descent in that tree and removing a row only
+    // clears its slot, so both are O(log n) instead of renumbering every row.
+    typedef QVector<int> SlotTree;
+    SlotTree _slotTree; // 1 based, _slotTree[0] is unused
+    QVector<StorageIndex> _slotStorage; // the data attached last to a slot, InvalidStorageIndex for removed rows
+    QVector<Slot> _storageSlot; // parallel to _storage, InvalidSlot if the data is not bound to a row
+    int _rowCount;
 
     typedef QHash<ObjectId, StorageIndex> ObjectIdIndex;
     ObjectIdIndex _objectIdIndex;
@@ -100,21 +124,175 @@ class AttachedDataContainer
     typedef QHash<RequestId, QPair<int /*ref*/, StorageIndex> > RequestIdIndex;
     RequestIdIndex _requestIdIndex;
 
-    typedef QHash<StorageIndex, AttachedData> Storage;
     QVector<AttachedData> _storage; // TODO replace by something smarter so we can use pointers instead of index.
 
-    enum { InvalidStorageIndex = InvalidRow };
+    enum { InvalidStorageIndex = InvalidRow, InvalidSlot = -1, MinimalRemovedSlotsToCompact = 1024 };
+
+    int liveSlotsUpTo(Slot slot) const
+    {
+        int sum = 0;
+        for (int i = slot + 1; i > 0; i -= i & -i)
+            sum += _slotTree[i];
+        return sum;
+    }
+
+    void addToSlot(Slot slot, int delta)
+    {
+        for (int i = slot + 1; i < _slotTree.count(); i += i & -i)
+            _slotTree[i] += delta;
+    }
+
+    Slot slotFromRow(Row row) const
+    {
+        Q_ASSERT(row >= 0 && row < _rowCount);
+        const int size = _slotTree.count() - 1;
+        int step = 1;
+        while (step * 2 <= size)
+            step *= 2;
+        int position = 0;
+        int remaining = row + 1;
+        for (; step; step /= 2) {
+            const int next = position + step;
+            if (next <= size && _slotTree[next] < remaining) {
+                position = next;
+                remaining -= _slotTree[next];
+            }
+        }
+        return position; // the tree is 1 based, so this is the slot of the row
+    }
+
+    Row rowFromSlot(Slot slot) const
+    {
+        Q_ASSERT(slot != InvalidSlot);
+        if (_slotStorage[slot] == InvalidStorageIndex)
+            return DeletedRow;
+        return liveSlotsUpTo(slot) - 1;
+    }
+
+    Slot appendSlot(StorageIndex idx)
+    {
+        const Slot slot = _slotStorage.count();
+        _slotStorage.append(idx);
+        // a new node covers (i - lowbit(i), i], all of it except the new slot is already in the tree
+        const int i = slot + 1;
+        int value = 1;
+        for (int j = i - 1, first = i - (i & -i); j > first; j -= j & -j)
+            value += _slotTree[j];
+        _slotTree.append(value);
+        ++_rowCount;
+        return slot;
+    }
+
+    void buildSlotTree()
+    {
+        const int size = _slotStorage.count();
+        _slotTree.fill(0, size + 1);
+        for (int i = 1; i <= size; ++i) {
+            _slotTree[i] += _slotStorage[i - 1] != InvalidStorageIndex;
+            const int parent = i + (i & -i);
+            if (parent <= size)
+                _slotTree[parent] += _slotTree[i];
+        }
+    }
+
+    QVector<Slot> liveSlots() const
+    {
+        QVector<Slot> slots;
+        slots.reserve(_rowCount);
+        for (Slot slot = 0; slot < _slotStorage.count(); ++slot) {
+            if (_slotStorage[slot] != InvalidStorageIndex)
+                slots.append(slot);
+        }
+        return slots;
+    }
+
+    /*!
+      \internal
+      Renumbers the slots so that \a rows, the slots of all rows in their new
+      order, become 0, 1, 2... Data attached to slots which are not in \a rows
+      gets DeletedRow. O(n).
+    */
+    void relayout(const QVector<Slot> &rows)
+    {
+        QVector<Slot> newSlots(_slotStorage.count(), InvalidSlot);
+        QVector<StorageIndex> slotStorage;
+        slotStorage.reserve(rows.count());
+        foreach (Slot slot, rows) {
+            newSlots[slot] = slotStorage.count();
+            slotStorage.append(_slotStorage[slot]);
+        }
+        for (StorageIndex idx = 0; idx < _storage.count(); ++idx) {
+            Slot &slot = _storageSlot[idx];
+            if (slot == InvalidSlot)
+                continue;
+            slot = newSlots[slot];
+            if (slot == InvalidSlot)
+                _storage[idx].row = DeletedRow;
+        }
+        _slotStorage.swap(slotStorage);
+        _rowCount = rows.count();
+        buildSlotTree();
+    }
+
+    void compactIfNeeded()
+    {
+        // Removed rows keep their slot, drop them once they are the majority.
+        const int removed = _slotStorage.count() - _rowCount;
+        if (removed < MinimalRemovedSlotsToCompact || removed < _rowCount)
+            return;
+        relayout(liveSlots());
+    }
+
+    void bind(StorageIndex idx, Row row)
+    {
+        Slot slot = InvalidSlot;
+        if (row == _rowCount)
+            slot = appendSlot(idx);
+        else if (row >= 0 && row < _rowCount) {
+            slot = slotFromRow(row);
+            _slotStorage[slot] = idx;
+        }
+        _storageSlot[idx] = slot;
+    }
+
+    AttachedData &refresh(StorageIndex idx)
+    {
+        AttachedData &data = _storage[idx];
+        const Slot slot = _storageSlot[idx];
+        if (slot != InvalidSlot)
+            data.row = rowFromSlot(slot);
+        return data;
+    }
+
+    StorageIndex storageIndexFromRow(Row row) const
+    {
+        if (row < 0 || row >= _rowCount)
+            return InvalidStorageIndex;
+        return _slotStorage[slotFromRow(row)];
+    }
 
     StorageIndex append(const AttachedData &data)
     {
         _storage.append(data);
+        _storageSlot.append(InvalidSlot);
         StorageIndex idx = _storage.count() - 1;
-        _rowIndex.insert(data.row, idx);
-        _objectIdIndex.insert(data.id, idx);
+        bind(idx, data.row);
+        if (!data.id.isEmpty()) // placeholder rows are not bound to an object
+            _objectIdIndex.insert(data.id, idx);
         return idx;
     }
 
 public:
+    AttachedDataContainer()
+        : _slotTree(1)
+        , _rowCount()
+    {}
+
+    int rowCount() const
+    {
+        return _rowCount;
+    }
+
     bool contains(const ObjectId &id) const
     {
         return _objectIdIndex.contains(id);
@@ -124,31 +302,102 @@ public:
     {
         Q_ASSERT(contains(id));
         StorageIndex idx = _objectIdIndex.value(id, InvalidStorageIndex);
-        return idx == InvalidStorageIndex ? InvalidRow : _storage[idx].row;
+        if (idx == InvalidStorageIndex)
+            return InvalidRow;
+        const Slot slot = _storageSlot[idx];
+        return slot == InvalidSlot ? _storage[idx].row : rowFromSlot(slot);
     }
 
     Row rowFromRequestId(const RequestId &id) const
     {
         StorageIndex idx = _requestIdIndex.value(id, qMakePair(0, static_cast<int>(InvalidStorageIndex))).second;
-        return idx == InvalidStorageIndex ? InvalidRow : _storage[idx].row;
+        if (idx == InvalidStorageIndex)
+            return InvalidRow;
+        const Slot slot = _storageSlot[idx];
+        return slot == InvalidSlot ? _storage[idx].row : rowFromSlot(slot);
     }
 
     bool isSynced(Row row) const
     {
-        return _storage[_rowIndex.value(row)].ref == 0;
+        return _storage[storageIndexFromRow(row)].ref == 0;
     }
 
-    void updateAllDataAfterRowRemoval(const int row) {
-        _rowIndex.clear();
-        _rowIndex.reserve(_storage.count());
-        for (StorageIndex i = 0; i < _storage.count() ; ++i) {
-            AttachedData &data = _storage[i];
-            if (data.row > row)
-                --data.row;
-            else if (data.row == row)
-                data.row = DeletedRow;
-            _rowIndex.insert(data.row, i);
+    /*!
+      \internal
+      Removes \a count rows starting at \a first, data attached to them
+      gets DeletedRow and the rows below move up. O(count log n).
+    */
+    void removeRows(Row first, int count)
+    {
+        Q_ASSERT(first >= 0 && count >= 0 && first + count <= _rowCount);
+        // from the last one, so the earlier rows keep their position
+        for (Row row = first + count - 1; row >= first; --row) {
+            const Slot slot = slotFromRow(row);
+            addToSlot(slot, -1);
+            _slotStorage[slot] = InvalidStorageIndex;
+            --_rowCount;
         }
+        compactIfNeeded();
+    }
+
+    void removeRow(Row row)
+    {
+        removeRows(row, 1);
+    }
+
+    /*!
+      \internal
+      Inserts rows for the objects \a ids before \a first, the rows from
+      \a first on move down. Unlike removals this renumbers all slots, O(n).
+    */
+    void insertRows(Row first, const QVector<ObjectId> &ids)
+    {
+        Q_ASSERT(first >= 0 && first <= _rowCount);
+        QVector<Slot> rows = liveSlots();
+        QVector<Slot> inserted;
+        inserted.reserve(ids.count());
+        foreach (const ObjectId &id, ids) {
+            const StorageIndex idx = _storage.count();
+            _storage.append(AttachedData(first + inserted.count(), id));
+            _storageSlot.append(_slotStorage.count());
+            _objectIdIndex.insert(id, idx);
+            inserted.append(_slotStorage.count());
+            _slotStorage.append(idx);
+        }
+        rows.insert(first, inserted.count(), InvalidSlot);
+        for (int i = 0; i < inserted.count(); ++i)
+            rows[first + i] = inserted[i];
+        relayout(rows);
+    }
+
+    /*!
+      \internal
+      Moves the row \a from so that it becomes the row \a to, like
+      QList::move(). O(n).
+    */
+    void moveRow(Row from, Row to)
+    {
+        Q_ASSERT(from >= 0 && from < _rowCount && to >= 0 && to < _rowCount);
+        QVector<Slot> rows = liveSlots();
+        const Slot slot = rows.takeAt(from);
+        rows.insert(to, slot);
+        relayout(rows);
+    }
+
+    /*!
+      \internal
+      Reorders the rows so that row \c r becomes what row \c order[r] was,
+      all at once instead of one moveRow() per row. O(n).
+    */
+    void permuteRows(const QVector<Row> &order)
+    {
+        Q_ASSERT(order.count() == _rowCount);
+        const QVector<Slot> slots = liveSlots();
+        QVector<Slot> rows;
+        rows.reserve(order.count());
+        foreach (Row row, order)
+            rows.append(slots.at(row));
+        relayout(rows);
     }
 
     AttachedData &ref(const ObjectId &id, Row row)
@@ -158,18 +407,22 @@ public:
             AttachedData data(row, id);
             idx = append(data);
         }
-        AttachedData &data = _storage[idx];
+        AttachedData &data = refresh(idx);
         ++data.ref;
-        Q_ASSERT(_storage[idx].ref == 1 || _storage[idx].row == row);
+        Q_ASSERT(data.ref == 1 || data.row == row);
+        if (data.row != row) {
+            Q_ASSERT(row >= 0 && row < _rowCount);
+            _storageSlot[idx] = slotFromRow(row);
+        }
         data.row = row;
         return data;
     }
 
     AttachedData &ref(Row row)
     {
-        StorageIndex idx = _rowIndex.value(row, InvalidStorageIndex);
+        StorageIndex idx = storageIndexFromRow(row);
         Q_ASSERT(idx != InvalidStorageIndex);
-        AttachedData &data = _storage[idx];
+        AttachedData &data = refresh(idx);
         ++data.ref;
         return data;
     }
@@ -178,24 +431,43 @@ public:
     {
         StorageIndex idx = _objectIdIndex.value(id, InvalidStorageIndex);
         Q_ASSERT(idx != InvalidStorageIndex);
-        AttachedData &attachedData = _storage[idx];
+        AttachedData &attachedData = refresh(idx);
         if (!--attachedData.ref && id[0] == 't') {
             // TODO it is last ref to a tmp id we should remove it
         }
         return attachedData;
     }
 
+    /*!
+      \internal
+      Attaches \a data to its row, if the row is the one past the last
+      one it is appended.
+    */
     void insert(const AttachedData &data)
     {
-        _storage.append(data);
-        StorageIndex idx = _storage.count() - 1;
-        _rowIndex.insert(data.row, idx);
-        _objectIdIndex.insert(data.id, idx);
+        append(data);
+    }
+
+    /*!
+      \internal
+      Binds \a row to the object \a id instead of the one it had, an empty
+      \a id turns it into a placeholder.
+    */
+    void setObjectId(Row row, const ObjectId &id)
+    {
+        const StorageIndex idx = storageIndexFromRow(row);
+        Q_ASSERT(idx != InvalidStorageIndex);
+        AttachedData &data = _storage[idx];
+        if (!data.id.isEmpty() && _objectIdIndex.value(data.id, InvalidStorageIndex) == idx)
+            _objectIdIndex.remove(data.id);
+        data.id = id;
+        if (!id.isEmpty())
+            _objectIdIndex.insert(id, idx);
     }
 
     void insertRequestId(const RequestId &id, Row row)
     {
-        StorageIndex idx = _rowIndex.value(row, InvalidStorageIndex);
+        StorageIndex idx = storageIndexFromRow(row);
         Q_ASSERT(idx != InvalidStorageIndex);
         _requestIdIndex.insert(id, qMakePair(2, idx));
     }
@@ -222,11 +494,13 @@ public:
     {
         const int count = array.count();
         _storage.clear();
-        _rowIndex.clear();
+        _storageSlot.clear();
+        _slotStorage.clear();
         _objectIdIndex.clear();
 
         _storage.reserve(count);
-        _rowIndex.reserve(count);
+        _storageSlot.reserve(count);
+        _slotStorage.reserve(count);
         _objectIdIndex.reserve(count);
 
         for (int row = 0; row < count; ++row) {
@@ -234,9 +508,12 @@ public:
             Q_ASSERT(!id.isEmpty());
             AttachedData data(row, id);
             _storage.append(data);
-            _rowIndex.insert(row, row);
+            _storageSlot.append(row);
+            _slotStorage.append(row);
             _objectIdIndex.insert(id, row);
         }
+        _rowCount = count;
+        buildSlotTree();
     }
 };
 
@@ -252,74 +529,207 @@ protected:
     const static int IncrementalModelUpdate;
     typedef EnginioModelPrivateAttachedData AttachedData;
     AttachedDataContainer _attachedData;
-    int _latestRequestedOffset;
     bool _canFetchMore;
 
+    // fetchMore() keeps up to _prefetch.pages requests ahead of the rows in
+    // the model and sizes them from how fast the views ask for rows and how
+    // fast the backend answers, see prefetchPageSize().
+    struct Prefetch
+    {
+        struct Page
+        {
+            int limit;
+            QJsonArray rows;
+        };
+
+        int pages; // kept in flight, 0 disables fetchMore()
+        int firstPage; // the limit of the full query
+        int fetchedEnd; // offset behind the rows merged into the model
+        int requestedEnd; // offset behind the rows requested so far
+        int end; // the number of objects matching the query, -1 while unknown
+        QHash<int, qint64> inFlight; // offset -> when it was requested
+        QMap<int, Page> arrived; // by offset, waiting for an earlier page
+        QList<QPair<int, int> > failed; // offset and limit, requested again by the next fetchMore()
+        QElapsedTimer clock;
+        qreal latency; // ms, moving average, 0 until measured
+        qreal throughput; // rows per ms, moving average
+        qreal demand; // rows per ms taken by the views, moving average
+        qint64 lastFetchTime; // of the previous fetchMore(), -1 if none
+        int lastFetchRows;
+    };
+    Prefetch _prefetch;
+
     unsigned _rolesCounter;
     QHash<int, QString> _roles;
 
     QJsonArray _data;
+    EnginioModelColumns _columns; // only used with _columnStorage
+    bool _columnStorage;
+
+    QString _snapshotDirectory;
+    bool _fullQueryPending;
+    bool _showingSnapshot;
+    qreal _resetThreshold; // share of the rows a new result may differ in without a reset
+
+    // With a "pageSize" in the query the model has a row for every object
+    // matching it, but only the pages around the rows a view asks for are
+    // loaded, the others hold placeholders, see touchRow().
+    int _pageSize;
+    int _maximalLoadedPages;
+    int _viewportFirstPage; // the pages views asked for in the last event loop pass
+    int _viewportLastPage;
+    mutable int _touchedFirstRow; // rows asked for since then, -1 if none
+    mutable int _touchedLastRow;
+    mutable QTimer _viewportTimer;
+    QSet<int> _loadedPages;
+    QSet<int> _requestedPages;
+
+    // With _deltaSync a refresh of the query whose complete result is in _data
+    // (identified by _syncedKey) only asks for what changed, see refreshDelta().
+    bool _deltaSync;
+    bool _fieldsIgnored; // the backend sent whole objects for the ids listing
+    QByteArray _syncedKey;
+    QString _latestUpdatedAt; // newest updatedAt the rows were seen with
+    struct DeltaRefresh
+    {
+        const EnginioReplyState *changes; // objects updated since "since"
+        const EnginioReplyState *ids; // ids of all objects matching the query
+        const EnginioReplyState *missing; // objects we have never seen
+        QString since;
+        QJsonArray changed;
+        QSet<QString> known;
+        int pending;
+    };
+    DeltaRefresh _deltaRefresh;
 
-    class NotificationObject {
-        // connection object it can be:
-        // - null if not yet created
-        // - -1 if notifications where disabled with EnginioModel::disableNotifications()
-        // - valid pointer to connection object
-        EnginioBackendConnection *_connection;
+    // The result of the latest full query, read while it is downloaded
+    struct FullQueryStream
+    {
+        enum Mode {
+            Undecided,
+            Progressive, // rows are inserted into the model as they arrive
+            Collecting // the model is reset with all rows at the end
+        };
 
-        struct NotificationReceived
-        {
-            EnginioBaseModelPrivate *model;
+        const EnginioReplyState *reply;
+        QNetworkReply *networkReply;
+        EnginioJsonStreamReader reader;
+        QJsonArray rows; // only used when collecting
+        int consumed; // bytes of the body given to the reader
+        int insertedRows;
+        Mode mode;
+
+        FullQueryStream(const EnginioReplyState *ereply, QNetworkReply *nreply)
+            : reply(ereply)
+            , networkReply(nreply)
+            , reader(EnginioString::results)
+            , consumed(0)
+            , insertedRows(0)
+            , mode(Undecided)
+        {}
+    };
+    QScopedPointer<FullQueryStream> _fullQueryStream;
 
-            void operator ()(QJsonObject data)
-            {
-                model->receivedNotification(data);
-            }
-        };
-        void removeConnection()
+    enum FullQueryStreamResult {
+        NotStreamed,
+        StreamCollected,
+        StreamInserted
+    };
+
+    class NotificationObject : public EnginioNotificationSubscriber {
+        EnginioBaseModelPrivate *_model;
+        // the stream is shared by all models of the client, it goes away with it
+        QPointer<EnginioNotificationHub> _hub;
+        // set by EnginioModel::disableNotifications()
+        bool _disabled;
+
+        void removeSubscription()
         {
-            if (*this) {
-                _connection->close();
-                delete _connection;
-            }
+            if (_hub)
+                _hub->unsubscribe(this);
+            _hub = 0;
         }
 
     public:
-        NotificationObject()
-            : _connection()
+        NotificationObject(EnginioBaseModelPrivate *model)
+            : _model(model)
+            , _disabled(false)
         {}
 
         ~NotificationObject()
         {
-            removeConnection();
+            removeSubscription();
         }
 
-        operator EnginioBackendConnection*()
+        virtual void notificationReceived(const QJsonObject &data) Q_DECL_OVERRIDE
         {
-            return qintptr(_connection) != -1 ? _connection : 0;
+            _model->queueNotification(data);
+        }
+
+        virtual void streamReconnected() Q_DECL_OVERRIDE
+        {
+            _model->catchUp();
         }
 
         void disable()
         {
-            removeConnection();
-            _connection = (EnginioBackendConnection*)-1;
+            removeSubscription();
+            _disabled = true;
         }
 
-        void connectToBackend(EnginioBaseModelPrivate *model, EnginioClientConnectionPrivate *enginio, const QJsonObject &filter)
+        void connectToBackend(EnginioClientConnectionPrivate *enginio, const QString &objectType)
         {
-            if (qintptr(_connection) == -1)
+            if (_disabled)
                 return;
-            Q_ASSERT(model && enginio);
+            Q_ASSERT(enginio);
             if (enginio->_serviceUrl != EnginioString::stagingEnginIo)
                 return;  // TODO it allows to use notification only on staging
-            removeConnection(); // TODO reuse the connecton object
-            _connection = new EnginioBackendConnection;
-            NotificationReceived receiver = { model };
-            QObject::connect(_connection, &EnginioBackendConnection::dataReceived, receiver);
-            _connection->connectToBackend(enginio, filter);
+            EnginioNotificationHub *hub = enginio->notificationHub();
+            if (_hub != hub)
+                removeSubscription();
+            _hub = hub;
+            hub->subscribe(this, objectType);
         }
     } _notifications;
 
+public:
+    // What was missed while the notification stream was down
+    struct GapStatistics
+    {
+        int reconnects;
+        int filledGaps;
+        int filledObjects; // in all gaps
+        int lastGap;
+        int reloadedGaps; // the catch up could not tell every change, the model was reloaded
+    };
+
+protected:
+    GapStatistics _gapStatistics;
+
+    // Notifications are collected for _notificationInterval milliseconds (by
+    // default until the next event loop pass) and applied together.
+    QVector<QJsonObject> _pendingNotifications;
+    QTimer _notificationTimer;
+    int _notificationInterval;
+
+    struct ApplyPendingNotifications
+    {
+        EnginioBaseModelPrivate *model;
+        void operator ()()
+        {
+            model->applyPendingNotifications();
+        }
+    };
+
+    struct UpdateViewport
+    {
+        EnginioBaseModelPrivate *model;
+        void operator ()()
+        {
+            model->updateViewport();
+        }
+    };
+
     struct FinishedRemoveRequest
     {
         EnginioBaseModelPrivate *model;
@@ -358,9 +768,42 @@ protected:
     {
         EnginioBaseModelPrivate *model;
         EnginioReplyState *reply;
+        const QJsonObject query;
         void operator ()()
         {
-            model->finishedFullQueryRequest(reply);
+            model->finishedFullQueryRequest(reply, query);
+        }
+    };
+
+    struct FinishedPageRequest
+    {
+        EnginioBaseModelPrivate *model;
+        EnginioReplyState *reply;
+        int page;
+        void operator ()()
+        {
+            model->finishedPageRequest(reply, page);
+        }
+    };
+
+    struct FinishedCatchUpRequest
+    {
+        EnginioBaseModelPrivate *model;
+        EnginioReplyState *reply;
+        QString since;
+        void operator ()()
+        {
+            model->finishedCatchUpRequest(reply, since);
+        }
+    };
+
+    struct FinishedDeltaRequest
+    {
+        EnginioBaseModelPrivate *model;
+        EnginioReplyState *reply;
+        void operator ()()
+        {
+            model->finishedDeltaRequest(reply);
         }
     };
 
@@ -375,6 +818,16 @@ protected:
         }
     };
 
+    struct FullQueryDataReceived
+    {
+        EnginioBaseModelPrivate *model;
+        const EnginioReplyState *reply;
+        void operator ()()
+        {
+            model->receivedFullQueryData(reply);
+        }
+    };
+
     class QueryChanged
     {
         EnginioBaseModelPrivate *model;
@@ -417,10 +870,35 @@ public:
         , _operation()
         , q(q_ptr)
         , _replyConnectionConntext(new QObject())
-        , _latestRequestedOffset(0)
         , _canFetchMore(false)
         , _rolesCounter(Enginio::SyncedRole)
+        , _columnStorage(false)
+        , _fullQueryPending(false)
+        , _showingSnapshot(false)
+        , _resetThreshold(0.25)
+        , _pageSize(0)
+        , _maximalLoadedPages(8)
+        , _viewportFirstPage(0)
+        , _viewportLastPage(0)
+        , _touchedFirstRow(-1)
+        , _touchedLastRow(-1)
+        , _deltaSync(false)
+        , _fieldsIgnored(false)
+        , _notifications(this)
+        , _notificationInterval(0)
     {
+        GapStatistics gapStatistics = { 0, 0, 0, 0, 0 };
+        _gapStatistics = gapStatistics;
+        _prefetch.pages = 0;
+        _prefetch.clock.start();
+        resetPrefetch(InitialPrefetchPageSize);
+        cancelDeltaRefresh();
+        _notificationTimer.setSingleShot(true);
+        ApplyPendingNotifications apply = { this };
+        QObject::connect(&_notificationTimer, &QTimer::timeout, apply);
+        _viewportTimer.setSingleShot(true);
+        UpdateViewport updateViewport = { this };
+        QObject::connect(&_viewportTimer, &QTimer::timeout, updateViewport);
     }
 
     virtual ~EnginioBaseModelPrivate();
@@ -430,9 +908,59 @@ public:
         _notifications.disable();
     }
 
+    int notificationInterval() const Q_REQUIRED_RESULT
+    {
+        return _notificationInterval;
+    }
+
+    void setNotificationInterval(int interval)
+    {
+        _notificationInterval = interval;
+        if (interval < 0)
+            applyPendingNotifications();
+    }
+
+    bool deltaSync() const Q_REQUIRED_RESULT
+    {
+        return _deltaSync;
+    }
+
+    void setDeltaSync(bool enabled)
+    {
+        _deltaSync = enabled;
+    }
+
+    int existingRow(const QString &id) const Q_REQUIRED_RESULT
+    {
+        return _attachedData.contains(id) ? _attachedData.rowFromObjectId(id) : DeletedRow;
+    }
+
+    void queueNotification(const QJsonObject &data);
+    QJsonObject restrictedQuery(const QJsonObject &condition) const Q_REQUIRED_RESULT;
+    QJsonObject changedSinceQuery(const QString &since) const Q_REQUIRED_RESULT;
+    bool canRefreshDelta() const Q_REQUIRED_RESULT;
+    void refreshDelta();
+    EnginioReplyState *sendDeltaRequest(const QJsonObject &query);
+    void finishedDeltaRequest(const EnginioReplyState *reply);
+    void applyDeltaRefresh();
+    void cancelDeltaRefresh();
+    void catchUp();
+    void finishedCatchUpRequest(const EnginioReplyState *reply, const QString &since);
+    void reloadAfterGap();
+    bool holdsCompleteResult() const Q_REQUIRED_RESULT;
+    QString lastUpdatedAt() const Q_REQUIRED_RESULT { return _latestUpdatedAt; }
+    void noteUpdatedAt(const QJsonValue &value);
+    void resetLatestUpdatedAt();
+    GapStatistics gapStatistics() const Q_REQUIRED_RESULT { return _gapStatistics; }
+    void applyPendingNotifications();
     void receivedNotification(const QJsonObject &data);
     void receivedRemoveNotification(const QJsonObject &object, int rowHint = NoHintRow);
+    void removeRows(int first, int count);
+    void removeRows(QVector<int> rows);
+    void emitDataChanged(const QVector<int> &sortedRows);
     void receivedUpdateNotification(const QJsonObject &object, const QString &idHint = QString(), int row = NoHintRow);
+    bool isNewerThanRow(const QJsonObject &object, int row) const;
+    void replaceRowObject(const QJsonObject &object, int row);
     void receivedCreateNotification(const QJsonObject &object);
 
     EnginioReplyState *append(const QJsonObject &value)
@@ -453,13 +981,13 @@ public:
         if (!row) { // the first item need to update roles
             q->beginResetModel();
             _attachedData.insert(data);
-            _data.append(value);
+            appendRow(value);
             syncRoles();
             q->endResetModel();
         } else {
             q->beginInsertRows(QModelIndex(), _data.count(), _data.count());
             _attachedData.insert(data);
-            _data.append(value);
+            appendRow(value);
             q->endInsertRows();
         }
         _attachedData.insertRequestId(ereply->requestId(), row);
@@ -590,17 +1118,22 @@ public:
     {
         if (!_enginio || _enginio->_backendId.isEmpty())
             return;
+        cancelDeltaRefresh();
         if (!queryIsEmpty()) {
             // setup notifications
-            QJsonObject filter;
-            QJsonObject objectType;
-            objectType.insert(EnginioString::objectType, queryData(EnginioString::objectType));
-            filter.insert(EnginioString::data, objectType);
-            _notifications.connectToBackend(this, _enginio, filter);
+            _notifications.connectToBackend(_enginio, queryData(EnginioString::objectType).toString());
+
+            if (canRefreshDelta()) {
+                refreshDelta();
+                return;
+            }
 
+            // show the rows we had last time until the real answer arrives
+            loadSnapshot();
             EnginioReplyState *ereply = reload();
             QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
         } else {
+            _syncedKey.clear();
             fullQueryReset(QJsonArray());
         }
     }
@@ -609,43 +1142,169 @@ public:
     {
         // send full query
         QJsonObject query = queryAsJson();
+        _pageSize = qMax(0, query[EnginioString::pageSize].toInt());
+        _loadedPages.clear();
+        _requestedPages.clear();
+        _canFetchMore = false;
+        if (_pageSize) {
+            if (query.contains(EnginioString::limit) || query.contains(EnginioString::offset))
+                qWarning() << "EnginioModel::reload()" << "'limit' and 'offset' parameters can not be used together with model paging feature, the values will be ignored";
+            query = pageQuery(0);
+        } else if (_prefetch.pages) {
+            // the rest is loaded by fetchMore(), without a limit the first
+            // page is as large as the pages fetchMore() would ask for now
+            if (!query[EnginioString::limit].toInt()) {
+                _prefetch.firstPage = InitialPrefetchPageSize;
+                query[EnginioString::limit] = prefetchPageSize();
+            }
+            resetPrefetch(query[EnginioString::limit].toInt());
+        }
         ObjectAdaptor<QJsonObject> aQuery(query);
         QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation));
         EnginioReplyState *ereply = _enginio->createReply(nreply);
-        if (_canFetchMore)
-            _latestRequestedOffset = query[EnginioString::limit].toDouble();
-        FinishedFullQueryRequest finshedRequest = { this, ereply };
+        cancelDeltaRefresh();
+        _fullQueryPending = true;
+        FinishedFullQueryRequest finshedRequest = { this, ereply, query };
         QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finshedRequest);
+        if (_pageSize) {
+            // the first page is small, the rest of the rows are placeholders
+            _fullQueryStream.reset();
+            return ereply;
+        }
+        _fullQueryStream.reset(new FullQueryStream(ereply, nreply));
+        FullQueryDataReceived dataReceived = { this, ereply };
+        QObject::connect(nreply, &QNetworkReply::readyRead, _replyConnectionConntext, dataReceived);
         return ereply;
     }
 
-    void finishedIncrementalUpdateRequest(const EnginioReplyState *reply, const QJsonObject &query)
+    // the key of query under the session of the client now
+    QByteArray snapshotKey(const QJsonObject &query) const
     {
-        Q_ASSERT(_canFetchMore);
-        QJsonArray data(replyData(reply)[EnginioString::results].toArray());
-        int offset = query[EnginioString::offset].toDouble();
-        int limit = query[EnginioString::limit].toDouble();
-        int dataCount = data.count();
+        return snapshotKey(_enginio->_request, query);
+    }
 
-        int startingOffset = qMax(offset, _data.count());
+    QByteArray snapshotKey(const QNetworkRequest &request, const QJsonObject &query) const
+    {
+        return EnginioModelSnapshot::key(request, _operation, query);
+    }
+
+    bool loadSnapshot()
+    {
+        if (_snapshotDirectory.isEmpty() || !_enginio || queryIsEmpty())
+            return false;
+        QJsonArray rows;
+        if (!EnginioModelSnapshot::read(_snapshotDirectory, snapshotKey(queryAsJson()), &rows))
+            return false;
+        // replies of the pending full query are kept, they will replace the snapshot
+        resetData(rows);
+        _showingSnapshot = true;
+        return true;
+    }
+
+    QString snapshotDirectory() const Q_REQUIRED_RESULT
+    {
+        return _snapshotDirectory;
+    }
 
-        q->beginInsertRows(QModelIndex(), startingOffset, startingOffset + dataCount -1);
-        for (int i = 0; i < dataCount; ++i) {
-            _data.append(data[i]);
+    void setSnapshotDirectory(const QString &directory)
+    {
+        _snapshotDirectory = directory;
+        // The directory may be set after the query was sent (the order in which
+        // QML assigns properties is undefined), the snapshot is still useful then.
+        if (_fullQueryPending && _data.isEmpty())
+            loadSnapshot();
+    }
+
+    void finishedIncrementalUpdateRequest(const EnginioReplyState *reply, const QJsonObject &query);
+
+    void finishedFullQueryRequest(const EnginioReplyState *reply, const QJsonObject &query)
+    {
+        _fullQueryPending = false;
+        if (_showingSnapshot) {
+            _showingSnapshot = false;
+            // being offline is not a reason to throw away the last known rows
+            if (reply->isError()) {
+                _fullQueryStream.reset();
+                return;
+            }
+        }
+        QJsonArray results;
+        switch (finishFullQueryStream(reply, &results)) {
+        case StreamInserted:
+            // the rows are in the model already
+            delete _replyConnectionConntext;
+            _replyConnectionConntext = new QObject();
+            updateCanFetchMore();
+            results = _data;
+            break;
+        case StreamCollected:
+            fullQueryReset(results);
+            break;
+        case NotStreamed:
+            results = replyData(reply)[EnginioString::results].toArray();
+            fullQueryReset(results);
+            break;
         }
+        if (_pageSize) {
+            // a page is not worth a snapshot and can not be patched by a delta refresh
+            _syncedKey.clear();
+            if (!reply->isError())
+                appendPlaceholders(replyData(reply)[EnginioString::count].toInt());
+            return;
+        }
+        if (reply->isError()) {
+            _syncedKey.clear();
+            return;
+        }
+        // the session may have changed while the query was running, the rows belong to the one it was sent with
+        _syncedKey = snapshotKey(EnginioReplyStatePrivate::get(reply)->_nreply->request(), query);
+        if (!_snapshotDirectory.isEmpty())
+            EnginioModelSnapshot::write(_snapshotDirectory, _syncedKey, results);
+    }
+
+    QJsonObject pageQuery(int page) const Q_REQUIRED_RESULT;
+    void appendPlaceholders(int total);
+    void touchRow(int row) const;
+    void updateViewport();
+    int viewportDistance(int page) const Q_REQUIRED_RESULT;
+    void requestPage(int page);
+    void finishedPageRequest(const EnginioReplyState *reply, int page);
+    void evictPages();
+
+    int maximalLoadedPages() const Q_REQUIRED_RESULT
+    {
+        return _maximalLoadedPages;
+    }
 
-        _canFetchMore = limit <= dataCount;
-        q->endInsertRows();
+    void setMaximalLoadedPages(int pages)
+    {
+        _maximalLoadedPages = qMax(3, pages); // the viewport page and its neighbours
+        evictPages();
     }
 
-    void finishedFullQueryRequest(const EnginioReplyState *reply)
+    QSet<int> loadedPages() const Q_REQUIRED_RESULT
     {
-        delete _replyConnectionConntext;
-        _replyConnectionConntext = new QObject();
-        fullQueryReset(replyData(reply)[EnginioString::results].toArray());
+        return _loadedPages;
     }
 
     void fullQueryReset(const QJsonArray &data);
+    bool applyDiff(const QJsonArray &data);
+    void resetData(const QJsonArray &data);
+
+    qreal resetThreshold() const Q_REQUIRED_RESULT
+    {
+        return _resetThreshold;
+    }
+
+    void setResetThreshold(qreal threshold)
+    {
+        _resetThreshold = threshold;
+    }
+    void updateCanFetchMore();
+
+    void receivedFullQueryData(const EnginioReplyState *reply);
+    FullQueryStreamResult finishFullQueryStream(const EnginioReplyState *reply, QJsonArray *rows);
+    void appendStreamedRows(const QJsonArray &rows);
 
     void finishedCreateRequest(const EnginioReplyState *reply, const QString &tmpId)
     {
@@ -741,7 +1400,7 @@ public:
             } else {
                 // Try to rollback the change.
                 // TODO it is not perfect https://github.com/enginio/enginio-qt/issues/200
-                _data.replace(row, oldValue);
+                replaceRow(row, oldValue);
                 emit q->dataChanged(q->index(row), q->index(row));
             }
             return;
@@ -845,7 +1504,7 @@ public:
         FinishedUpdateRequest finished = { this, id, oldObject, ereply };
         QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finished);
         _attachedData.ref(id, row);
-        _data.replace(row, newObject);
+        replaceRow(row, newObject);
         _attachedData.insertRequestId(ereply->requestId(), row);
         emit q->dataChanged(q->index(row), q->index(row));
         return ereply;
@@ -853,6 +1512,56 @@ public:
 
     void syncRoles();
 
+    void appendRow(const QJsonValue &value)
+    {
+        _data.append(value);
+        noteUpdatedAt(value);
+        if (_columnStorage)
+            _columns.append(value.toObject());
+    }
+
+    void replaceRow(int row, const QJsonValue &value)
+    {
+        _data.replace(row, value);
+        noteUpdatedAt(value);
+        if (_columnStorage)
+            _columns.replace(row, value.toObject());
+    }
+
+    void insertRow(int row, const QJsonValue &value)
+    {
+        _data.insert(row, value);
+        noteUpdatedAt(value);
+        if (_columnStorage)
+            _columns.insert(row, value.toObject());
+    }
+
+    // row r gets the row order[r], the attached data follows
+    void permuteRows(const QVector<int> &order)
+    {
+        QJsonArray rows;
+        foreach (int row, order)
+            rows.append(_data.at(row));
+        _data = rows;
+        if (_columnStorage)
+            _columns.permute(order);
+        _attachedData.permuteRows(order);
+    }
+
+    bool columnStorage() const Q_REQUIRED_RESULT
+    {
+        return _columnStorage;
+    }
+
+    void setColumnStorage(bool enabled)
+    {
+        _columnStorage = enabled;
+        if (enabled)
+            _columns.reset(_data, _roles);
+        else
+            _columns.clear();
+    }
+
     QHash<int, QByteArray> roleNames() const Q_REQUIRED_RESULT
     {
         QHash<int, QByteArray> roles;
@@ -872,10 +1581,18 @@ public:
 
     QVariant data(unsigned row, int role) const Q_REQUIRED_RESULT
     {
+        if (_pageSize)
+            touchRow(row);
+
         if (role == Enginio::SyncedRole) {
             return _attachedData.isSynced(row);
         }
 
+        if (_columnStorage && role != Qt::DisplayRole && role != Enginio::JsonObjectRole) {
+            const QVariant *value = _columns.value(row, role);
+            return value ? *value : QVariant();
+        }
+
         const QJsonObject object = _data.at(row).toObject();
         if (!object.isEmpty()) {
             if (role == Qt::DisplayRole || role == Enginio::JsonObjectRole)
@@ -893,28 +1610,20 @@ public:
         return _canFetchMore;
     }
 
-    void fetchMore(int row)
-    {
-        int currentOffset = _data.count();
-        if (!_canFetchMore || currentOffset < _latestRequestedOffset)
-            return; // we do not want to spam the server, lets wait for the last fetch
-
-        QJsonObject query(queryAsJson());
+    void fetchMore(int row);
+    void sendPrefetchRequest(int offset, int limit);
+    int prefetchPageSize() const Q_REQUIRED_RESULT;
+    void resetPrefetch(int firstPage);
+    void receivedPage(int offset, int limit, const QJsonArray &rows);
 
-        int limit = query[EnginioString::limit].toDouble();
-        limit = qMax(row - currentOffset, limit); // check if default limit is not too small
-
-        query[EnginioString::offset] = currentOffset;
-        query[EnginioString::limit] = limit;
+    int prefetchPages() const Q_REQUIRED_RESULT
+    {
+        return _prefetch.pages;
+    }
 
-        qDebug() << Q_FUNC_INFO << query;
-        _latestRequestedOffset += limit;
-        ObjectAdaptor<QJsonObject> aQuery(query);
-        QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation));
-        EnginioReplyState *ereply = _enginio->createReply(nreply);
-        QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
-        FinishedIncrementalUpdateRequest finishedRequest = { this, query, ereply };
-        QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finishedRequest);
+    void setPrefetchPages(int pages)
+    {
+        _prefetch.pages = qMax(0, pages);
     }
 
     virtual QJsonObject replyData(const EnginioReplyState *reply) const = 0;
@@ -997,25 +1706,6 @@ struct EnginioModelPrivateT : public EnginioBaseModelPrivate
     {
         _query = query;
 
-        // TODO Enable together with pageing support
-//        if (_query.contains(EnginioString::pageSize)) {
-//            const int pageSize = _query[EnginioString::pageSize].toDouble();
-//            const QString limitString(EnginioString::limit);
-//            const QString offsetString(EnginioString::offset);
-//            const unsigned limit = _query[limitString].toDouble();
-//            const unsigned offset = _query[offsetString].toDouble();
-//            if (limit)
-//                qWarning() << "EnginioModel::setQuery()" << "'limit' parameter can not be used together with model pagining feature, the value will be ignored";
-
-//            if (offset) {
-//                qWarning() << "EnginioModel::setQuery()" << "'offset' parameter can not be used together with model pagining feature, the value will be ignored";
-//                _query.remove(offsetString);
-//            }
-//            _query[limitString] = pageSize;
-//            _canFetchMore = true;
-//        } else {
-//            _canFetchMore = false;
-//        }
         emit q()->queryChanged(query);
     }
 
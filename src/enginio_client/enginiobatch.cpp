@@ -0,0 +1,481 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/enginiobatch.h>
+#include <Enginio/private/enginiobatch_p.h>
+#include <Enginio/enginioclient.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginiostring_p.h>
+
+#include <QtCore/qbuffer.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qmetaobject.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \class EnginioBatch
+  \since 5.3
+  \inmodule enginio-qt
+  \ingroup enginio-client
+  \brief EnginioBatch collects many create, update and remove operations and sends them together.
+
+  Every operation added to the batch gets an index, which identifies its result in
+  the reply returned by send(). The batch is sent to the server in as few requests
+  as possible. If the server does not provide the batch endpoint, the operations are
+  sent as separate requests, at most as many of them at the same time as the
+  client sends model writes at once. All requests of a batch are model writes
+  for the client, so they wait behind queries the user waits for.
+
+  \code
+    EnginioBatch batch(client);
+    foreach (const QJsonObject &todo, todos)
+        batch.create(todo);
+    EnginioReply *reply = batch.send();
+  \endcode
+
+  When the reply is finished its data contains one entry per operation:
+  \code
+  {
+    "results": [
+      { "index": 0, "status": 201, "data": { "id": "...", "objectType": "objects.todos", ... } },
+      { "index": 1, "status": 400, "data": { "errors": [ ... ] } }
+    ]
+  }
+  \endcode
+
+  The reply itself does not report an error if some of the operations failed,
+  the status of each result has to be checked instead. Operations of one batch are
+  independent of each other; they may be executed in any order.
+
+  \sa EnginioClient
+*/
+
+/*!
+  \brief Creates an empty batch for \a client.
+*/
+EnginioBatch::EnginioBatch(EnginioClient *client)
+    : d_ptr(new EnginioBatchPrivate(EnginioClientConnectionPrivate::get(client)))
+{
+}
+
+/*!
+  \brief Destroys the batch, operations which were not sent are discarded.
+*/
+EnginioBatch::~EnginioBatch()
+{}
+
+/*!
+  \brief Adds the creation of \a object for the given \a operation to the batch.
+  \return the index of the operation in the results.
+  \sa EnginioClient::create()
+*/
+int EnginioBatch::create(const QJsonObject &object, const Enginio::Operation operation)
+{
+    Q_D(EnginioBatch);
+    return d->append<QJsonObject>(object, operation, QNetworkAccessManager::PostOperation, EnginioString::Post);
+}
+
+/*!
+  \brief Adds the update of \a object for the given \a operation to the batch.
+  \return the index of the operation in the results.
+  \sa EnginioClient::update()
+*/
+int EnginioBatch::update(const QJsonObject &object, const Enginio::Operation operation)
+{
+    Q_D(EnginioBatch);
+    return d->append<QJsonObject>(object, operation, QNetworkAccessManager::PutOperation, EnginioString::Put);
+}
+
+/*!
+  \brief Adds the removal of \a object for the given \a operation to the batch.
+  \return the index of the operation in the results.
+  \sa EnginioClient::remove()
+*/
+int EnginioBatch::remove(const QJsonObject &object, const Enginio::Operation operation)
+{
+    Q_D(EnginioBatch);
+    return d->append<QJsonObject>(object, operation, QNetworkAccessManager::DeleteOperation, EnginioString::Delete);
+}
+
+/*!
+  \brief Returns the number of operations which were not sent yet.
+*/
+int EnginioBatch::count() const
+{
+    Q_D(const EnginioBatch);
+    return d->_operations.count();
+}
+
+/*!
+  \brief Returns true if no operation was added since the last send().
+*/
+bool EnginioBatch::isEmpty() const
+{
+    Q_D(const EnginioBatch);
+    return d->_operations.isEmpty();
+}
+
+/*!
+  \brief Discards all operations which were not sent yet.
+*/
+void EnginioBatch::clear()
+{
+    Q_D(EnginioBatch);
+    d->_operations.clear();
+}
+
+/*!
+  \brief Sends all collected operations and empties the batch.
+
+  The indices of operations added after this call start from zero again.
+  \return an EnginioReply containing the results of all operations once they are finished.
+*/
+EnginioReply *EnginioBatch::send()
+{
+    Q_D(EnginioBatch);
+    QNetworkReply *nreply = new EnginioBatchReply(d->_client, d->_operations);
+    d->_operations.clear();
+    return new EnginioReply(d->_client, nreply);
+}
+
+namespace {
+
+struct BatchRequestFinishedFunctor
+{
+    EnginioBatchReply *_batch;
+    QNetworkReply *_nreply;
+    void operator ()()
+    {
+        _batch->requestFinished(_nreply);
+    }
+};
+
+struct BatchFinishedFunctor
+{
+    QNetworkAccessManager *_qnam;
+    EnginioBatchReply *_reply;
+    void operator ()()
+    {
+        _qnam->finished(_reply);
+    }
+};
+
+bool isBatchEndpointMissing(int status)
+{
+    return status == 404 || status == 405 || status == 501;
+}
+
+QJsonObject errorObject(const QString &message)
+{
+    QJsonObject error;
+    error[EnginioString::message] = message;
+    QJsonObject result;
+    result[EnginioString::errors] = QJsonArray() << error;
+    return result;
+}
+
+} // namespace
+
+EnginioBatchReply::EnginioBatchReply(EnginioClientConnectionPrivate *client, const QVector<EnginioBatchOperation> &operations)
+    : QNetworkReply(client->q_ptr)
+    , _client(client)
+    , _operations(operations)
+    , _results(operations.count())
+    , _remaining(operations.count())
+{
+    QUrl url(_client->_serviceUrl);
+    url.setPath(EnginioString::v1_batch);
+    setRequest(_client->prepareRequest(url));
+    setUrl(url);
+    setOperation(QNetworkAccessManager::PostOperation);
+    QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    QVector<int> valid;
+    valid.reserve(_operations.count());
+    for (int i = 0; i < _operations.count(); ++i) {
+        const EnginioBatchOperation &operation = _operations.at(i);
+        if (operation.errorMsg.isEmpty())
+            valid.append(i);
+        else
+            setResult(i, 400, QJsonDocument::fromJson(operation.errorMsg).object());
+    }
+
+    if (!_client->_batchEndpointAvailable) {
+        foreach (int index, valid)
+            _pendingOperations.enqueue(index);
+        sendPendingOperations();
+    } else {
+        for (int first = 0; first < valid.count(); first += MaxOperationsPerRequest)
+            sendBatchRequest(valid.mid(first, MaxOperationsPerRequest));
+    }
+    finishIfDone();
+}
+
+EnginioBatchReply::~EnginioBatchReply()
+{
+    releaseRequests();
+}
+
+/*!
+  \internal
+  Forgets the requests which still wait in the scheduler, it drops them then.
+*/
+void EnginioBatchReply::releaseRequests()
+{
+    foreach (QNetworkReply *nreply, _batchRequests.keys() + _singleRequests.keys())
+        _client->releaseRequestContext(nreply);
+}
+
+void EnginioBatchReply::sendBatchRequest(const QVector<int> &indices)
+{
+    QByteArray payload;
+    payload.reserve(64 * indices.count());
+    payload.append("{\"requests\":[");
+    foreach (int index, indices) {
+        const EnginioBatchOperation &operation = _operations.at(index);
+        QJsonObject header;
+        header[EnginioString::method] = QString::fromLatin1(operation.method);
+        header[EnginioString::path] = operation.path;
+        QByteArray entry = QJsonDocument(header).toJson(QJsonDocument::Compact);
+        if (!operation.data.isEmpty()) {
+            // The payload is already serialized, splice it in instead of parsing it again.
+            entry.chop(1);
+            entry.append(",\"data\":");
+            entry.append(operation.data);
+            entry.append('}');
+        }
+        if (index != indices.first())
+            payload.append(',');
+        payload.append(entry);
+    }
+    payload.append("]}");
+
+    QNetworkRequest req = _client->prepareRequest(url());
+    _client->_sharedQueries->invalidate();
+    QNetworkReply *nreply = _client->ownRequest(_client->_scheduler->post(req, payload, Enginio::ModelWritePriority), this);
+    _batchRequests.insert(nreply, indices);
+    watch(nreply);
+}
+
+/*!
+  \internal
+  The number of operations sent as separate requests at once. The scheduler
+  does not send more model writes at once anyway, the rest waits here rather
+  than in its queue.
+*/
+int EnginioBatchReply::parallelRequests() const
+{
+    return qMax(1, _client->_scheduler->concurrencyLimit(Enginio::ModelWritePriority));
+}
+
+void EnginioBatchReply::sendPendingOperations()
+{
+    const int parallel = parallelRequests();
+    while (!_pendingOperations.isEmpty() && _singleRequests.count() < parallel) {
+        const int index = _pendingOperations.dequeue();
+        const EnginioBatchOperation &operation = _operations.at(index);
+        QUrl url(_client->_serviceUrl);
+        url.setPath(operation.path);
+        QNetworkRequest req = _client->prepareRequest(url);
+
+        QBuffer *buffer = 0;
+        if (!operation.data.isEmpty()) {
+            buffer = new QBuffer();
+            buffer->setData(operation.data);
+            buffer->open(QIODevice::ReadOnly);
+        }
+        if (operation.method != EnginioString::Get)
+            _client->_sharedQueries->invalidate();
+        QNetworkReply *nreply = _client->ownRequest(_client->_scheduler->sendCustomRequest(req, operation.method, buffer, Enginio::ModelWritePriority), this);
+        if (buffer)
+            buffer->setParent(nreply);
+        _singleRequests.insert(nreply, index);
+        watch(nreply);
+    }
+}
+
+void EnginioBatchReply::requestSent(QNetworkReply *queued, QNetworkReply *nreply)
+{
+    if (_batchRequests.contains(queued))
+        _batchRequests.insert(nreply, _batchRequests.take(queued));
+    else
+        _singleRequests.insert(nreply, _singleRequests.take(queued));
+    QObject::disconnect(queued, &QNetworkReply::finished, 0, 0);
+    queued->deleteLater();
+    watch(nreply);
+}
+
+void EnginioBatchReply::watch(QNetworkReply *nreply)
+{
+    nreply->setParent(this);
+    BatchRequestFinishedFunctor functor = {this, nreply};
+    QObject::connect(nreply, &QNetworkReply::finished, functor);
+}
+
+void EnginioBatchReply::requestFinished(QNetworkReply *nreply)
+{
+    nreply->deleteLater();
+    if (_batchRequests.contains(nreply))
+        batchRequestFinished(nreply, _batchRequests.take(nreply));
+    else if (_singleRequests.contains(nreply))
+        singleRequestFinished(nreply, _singleRequests.take(nreply));
+    finishIfDone();
+}
+
+void EnginioBatchReply::batchRequestFinished(QNetworkReply *nreply, const QVector<int> &indices)
+{
+    const int status = nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).value<int>();
+    if (isBatchEndpointMissing(status)) {
+        // Remember it for the client, so that next batches do not try again.
+        _client->_batchEndpointAvailable = false;
+        foreach (int index, indices)
+            _pendingOperations.enqueue(index);
+        sendPendingOperations();
+        return;
+    }
+
+    const QByteArray body = nreply->readAll();
+    if (nreply->error() == QNetworkReply::NoError) {
+        const QJsonArray results = QJsonDocument::fromJson(body).object()[EnginioString::results].toArray();
+        if (results.count() == indices.count()) {
+            for (int i = 0; i < indices.count(); ++i) {
+                const QJsonObject result = results.at(i).toObject();
+                setResult(indices.at(i), result[EnginioString::status].toInt(), result[EnginioString::data].toObject());
+            }
+            return;
+        }
+    }
+
+    // The whole request failed, every operation in it gets the same error.
+    QJsonObject error = QJsonDocument::fromJson(body).object();
+    if (error.isEmpty())
+        error = errorObject(nreply->error() == QNetworkReply::NoError ? QStringLiteral("Invalid batch response") : nreply->errorString());
+    foreach (int index, indices)
+        setResult(index, status, error);
+}
+
+void EnginioBatchReply::singleRequestFinished(QNetworkReply *nreply, int index)
+{
+    const QByteArray body = nreply->readAll();
+    QJsonObject data = QJsonDocument::fromJson(body).object();
+    if (data.isEmpty() && nreply->error() != QNetworkReply::NoError)
+        data = errorObject(nreply->errorString());
+    setResult(index, nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).value<int>(), data);
+    sendPendingOperations();
+}
+
+void EnginioBatchReply::setResult(int index, int status, const QJsonObject &data)
+{
+    QJsonObject result;
+    result[EnginioString::index] = index;
+    result[EnginioString::status] = status;
+    result[EnginioString::data] = data;
+    _results[index] = result;
+    --_remaining;
+}
+
+void EnginioBatchReply::finishIfDone()
+{
+    if (!_remaining && !isFinished())
+        finish();
+}
+
+void EnginioBatchReply::finish()
+{
+    QJsonArray results;
+    foreach (const QJsonObject &result, _results)
+        results.append(result);
+    QJsonObject data;
+    data[EnginioString::results] = results;
+    _data = QJsonDocument(data).toJson(QJsonDocument::Compact);
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    setFinished(true);
+    BatchFinishedFunctor fin = {_client->networkManager(), this};
+    QObject::connect(this, &EnginioBatchReply::finished, fin);
+    QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+void EnginioBatchReply::abort()
+{
+    if (isFinished())
+        return;
+
+    QList<QNetworkReply*> requests = _batchRequests.keys() + _singleRequests.keys();
+    releaseRequests(); // the waiting ones are not sent any more
+    _batchRequests.clear();
+    _singleRequests.clear();
+    _pendingOperations.clear();
+    foreach (QNetworkReply *nreply, requests) {
+        QObject::disconnect(nreply, &QNetworkReply::finished, 0, 0);
+        nreply->abort();
+    }
+
+    const QJsonObject error = errorObject(tr("Operation canceled"));
+    for (int i = 0; i < _results.count(); ++i) {
+        if (_results.at(i).isEmpty())
+            setResult(i, 0, error);
+    }
+    setError(OperationCanceledError, tr("Operation canceled"));
+    finish();
+}
+
+bool EnginioBatchReply::isSequential() const
+{
+    return false;
+}
+
+qint64 EnginioBatchReply::size() const
+{
+    return _data.size();
+}
+
+qint64 EnginioBatchReply::readData(char *dest, qint64 n)
+{
+    if (pos() >= _data.size())
+        return -1;
+    const qint64 size = qMin(qint64(_data.size() - pos()), n);
+    memcpy(dest, _data.constData() + pos(), size);
+    return size;
+}
+
+qint64 EnginioBatchReply::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOBATCH_P_H
+#define ENGINIOBATCH_P_H
+
+#include <Enginio/enginioclient_global.h>
+#include <Enginio/enginiobatch.h>
+#include <Enginio/private/enginioclient_p.h>
+
+#include <QtNetwork/qnetworkreply.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_NAMESPACE
+
+struct EnginioBatchOperation
+{
+    QByteArray method;
+    QString path;
+    QByteArray data;
+    QByteArray errorMsg; // not empty if the operation could not be prepared
+};
+
+Q_DECLARE_TYPEINFO(EnginioBatchOperation, Q_MOVABLE_TYPE);
+
+class EnginioBatchPrivate
+{
+public:
+    EnginioClientConnectionPrivate *_client;
+    QVector<EnginioBatchOperation> _operations;
+
+    explicit EnginioBatchPrivate(EnginioClientConnectionPrivate *client)
+        : _client(client)
+    {
+        Q_ASSERT(client);
+    }
+
+    template<class T>
+    int append(const ObjectAdaptor<T> &object, const Enginio::Operation operation, QNetworkAccessManager::Operation httpOperation, const QByteArray &method)
+    {
+        EnginioBatchOperation batchOperation;
+        batchOperation.method = method;
+        if (!_client->prepareBatchOperation(object, operation, httpOperation, &batchOperation.path, &batchOperation.data, &batchOperation.errorMsg))
+            batchOperation.path.clear();
+        _operations.append(batchOperation);
+        return _operations.count() - 1;
+    }
+};
+
+class ENGINIOCLIENT_EXPORT EnginioBatchReply : public QNetworkReply, public EnginioRequestOwner
+{
+    Q_OBJECT
+public:
+    enum {
+        MaxOperationsPerRequest = 100
+    };
+
+    EnginioBatchReply(EnginioClientConnectionPrivate *client, const QVector<EnginioBatchOperation> &operations);
+    ~EnginioBatchReply();
+
+    virtual void abort() Q_DECL_OVERRIDE;
+    virtual bool isSequential() const Q_DECL_OVERRIDE;
+    virtual qint64 size() const Q_DECL_OVERRIDE;
+    virtual qint64 readData(char *dest, qint64 n) Q_DECL_OVERRIDE;
+    virtual qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+    void requestFinished(QNetworkReply *nreply);
+    virtual void requestSent(QNetworkReply *queued, QNetworkReply *nreply) Q_DECL_OVERRIDE;
+
+private:
+    EnginioClientConnectionPrivate *_client;
+    QVector<EnginioBatchOperation> _operations;
+    QVector<QJsonObject> _results;
+    QHash<QNetworkReply*, QVector<int> > _batchRequests; // indices of the sent operations
+    QHash<QNetworkReply*, int> _singleRequests;
+    QQueue<int> _pendingOperations;
+    int _remaining;
+    QByteArray _data;
+
+    void sendBatchRequest(const QVector<int> &indices);
+    void sendPendingOperations();
+    int parallelRequests() const Q_REQUIRED_RESULT;
+    void releaseRequests();
+    void batchRequestFinished(QNetworkReply *nreply, const QVector<int> &indices);
+    void singleRequestFinished(QNetworkReply *nreply, int index);
+    void setResult(int index, int status, const QJsonObject &data);
+    void finishIfDone();
+    void finish();
+    void watch(QNetworkReply *nreply);
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOBATCH_P_H
@@ -0,0 +1,217 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiochunkedupload_p.h>
+
+#include <QtCore/qiodevice.h>
+
+QT_BEGIN_NAMESPACE
+
+EnginioChunkedUpload::EnginioChunkedUpload(QNetworkReply *standIn, QIODevice *device, const QUrl &chunkUrl, qint64 chunkSize)
+    : _standIn(standIn)
+    , _device(device)
+    , _chunkUrl(chunkUrl)
+    , _size(device->size())
+    , _chunkSize(chunkSize)
+    , _next(0)
+    , _confirmed(0)
+    , _acknowledged(0)
+    , _reported(0)
+{
+    Q_ASSERT(standIn);
+    Q_ASSERT(chunkSize > 0);
+    _statistics.chunks = 0;
+    _statistics.retries = 0;
+    _statistics.chunkSize = chunkSize;
+    _statistics.smallestChunkSize = chunkSize;
+    _statistics.largestChunkSize = chunkSize;
+    _clock.start();
+}
+
+EnginioChunkedUpload::~EnginioChunkedUpload()
+{
+    delete _device;
+}
+
+/*!
+  \internal
+  Bytes acknowledged together with the ones of the chunks in flight.
+*/
+qint64 EnginioChunkedUpload::progress() const
+{
+    qint64 progress = _acknowledged;
+    foreach (const Chunk &chunk, _inFlight)
+        progress += chunk.sent;
+    return qMin(progress, _size);
+}
+
+void EnginioChunkedUpload::setChunkSize(qint64 chunkSize)
+{
+    Q_ASSERT(chunkSize > 0);
+    _chunkSize = chunkSize;
+}
+
+/*!
+  \internal
+  Continues an upload of which the first \a offset bytes were acknowledged
+  before. Has to be called before the first chunk is taken.
+*/
+void EnginioChunkedUpload::resumeAt(qint64 offset)
+{
+    Q_ASSERT(!_next && _inFlight.isEmpty());
+    Q_ASSERT(offset >= 0 && offset <= _size);
+    _next = _confirmed = _acknowledged = _reported = offset;
+}
+
+bool EnginioChunkedUpload::advanceReportedProgress(qint64 progress)
+{
+    if (progress <= _reported)
+        return false;
+    _reported = progress;
+    return true;
+}
+
+EnginioChunkedUpload::Chunk EnginioChunkedUpload::takeChunk()
+{
+    Q_ASSERT(hasPendingChunk());
+    if (!_retries.isEmpty())
+        return _retries.takeFirst();
+    Chunk chunk;
+    chunk.start = _next;
+    chunk.end = qMin(_next + _chunkSize, _size);
+    chunk.attempts = 0;
+    chunk.sent = 0;
+    chunk.startedAt = 0;
+    chunk.sentAt = -1;
+    _next = chunk.end;
+    _statistics.chunkSize = _chunkSize;
+    _statistics.smallestChunkSize = qMin(_statistics.smallestChunkSize, _chunkSize);
+    _statistics.largestChunkSize = qMax(_statistics.largestChunkSize, _chunkSize);
+    return chunk;
+}
+
+void EnginioChunkedUpload::retry(const Chunk &chunk)
+{
+    Chunk again = chunk;
+    again.sent = 0;
+    ++_statistics.retries;
+    // the oldest gap first, it holds back confirmed()
+    QList<Chunk>::iterator i = _retries.begin();
+    while (i != _retries.end() && i->start < again.start)
+        ++i;
+    _retries.insert(i, again);
+}
+
+void EnginioChunkedUpload::acknowledge(const Chunk &chunk)
+{
+    _acknowledged += chunk.end - chunk.start;
+    ++_statistics.chunks;
+    if (chunk.start != _confirmed) {
+        _ranges.insert(chunk.start, chunk.end);
+        return;
+    }
+    _confirmed = chunk.end;
+    // chunks which finished earlier may continue the prefix now
+    while (!_ranges.isEmpty() && _ranges.firstKey() == _confirmed)
+        _confirmed = _ranges.take(_confirmed);
+}
+
+void EnginioChunkedUpload::started(QNetworkReply *reply, const Chunk &chunk)
+{
+    Chunk started = chunk;
+    started.startedAt = _clock.elapsed(); // again if the chunk waited in the scheduler
+    started.sentAt = -1;
+    _inFlight.insert(reply, started);
+}
+
+void EnginioChunkedUpload::setSent(QNetworkReply *reply, qint64 bytes)
+{
+    QHash<QNetworkReply*, Chunk>::iterator i = _inFlight.find(reply);
+    if (i == _inFlight.end())
+        return;
+    i->sent = bytes;
+    if (bytes >= i->end - i->start && i->sentAt < 0)
+        i->sentAt = _clock.elapsed();
+}
+
+EnginioChunkedUpload::Chunk EnginioChunkedUpload::finished(QNetworkReply *reply)
+{
+    Q_ASSERT(_inFlight.contains(reply));
+    return _inFlight.take(reply);
+}
+
+EnginioUploadTuner::EnginioUploadTuner()
+    : _chunkSize(DefaultChunkSize)
+    , _minimalChunkSize(MinimalChunkSize)
+    , _maximalChunkSize(MaximalChunkSize)
+    , _throughput(0)
+    , _roundTripTime(0)
+    , _roundTripMeasured(false)
+{
+}
+
+void EnginioUploadTuner::setChunkSizeLimits(qint64 minimal, qint64 maximal)
+{
+    Q_ASSERT(minimal > 0 && minimal <= maximal);
+    _minimalChunkSize = minimal;
+    _maximalChunkSize = maximal;
+    _chunkSize = qBound(_minimalChunkSize, _chunkSize, _maximalChunkSize);
+}
+
+/*!
+  \internal
+  Takes the measurements of a chunk of \a bytes which was answered
+  \a roundTrip after its request started, and \a responseTime after its
+  body was sent, or -1 if that moment is not known.
+*/
+void EnginioUploadTuner::chunkSent(qint64 bytes, qint64 roundTrip, qint64 responseTime)
+{
+    // a moving average, a single slow chunk should not halve the size
+    const double throughput = bytes * 1000.0 / qMax(Q_INT64_C(1), roundTrip);
+    _throughput = _throughput > 0 ? 0.7 * _throughput + 0.3 * throughput : throughput;
+    if (responseTime >= 0) {
+        _roundTripTime = _roundTripMeasured ? 0.7 * _roundTripTime + 0.3 * responseTime : responseTime;
+        _roundTripMeasured = true;
+    }
+
+    const double duration = qMax(double(TargetChunkDuration), RoundTripsPerChunk * _roundTripTime);
+    const qint64 chunkSize = qint64(_throughput * duration / 1000);
+    _chunkSize = qBound(_minimalChunkSize, qMin(chunkSize, 2 * _chunkSize), _maximalChunkSize);
+}
+
+void EnginioUploadTuner::chunkFailed()
+{
+    _chunkSize = qMax(_minimalChunkSize, _chunkSize / 2);
+}
+
+QT_END_NAMESPACE
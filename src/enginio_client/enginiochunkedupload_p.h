@@ -0,0 +1,203 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOCHUNKEDUPLOAD_P_H
+#define ENGINIOCHUNKEDUPLOAD_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qurl.h>
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+class QNetworkReply;
+
+/*!
+  \internal
+  The state of one chunked file upload.
+
+  Up to a window of chunks is in flight at once, each with its own
+  Content-Range, so the backend may receive them in any order. The upload
+  keeps track of which bytes were acknowledged, confirmed() is the end of
+  the acknowledged prefix of the file. A chunk that failed is sent again,
+  before any chunk that was not sent yet.
+
+  The reply the user has waits on a stand-in network reply until the last
+  chunk is acknowledged. The upload owns the device it reads from.
+
+  Chunks are timed from the start of the request to the response, and from
+  the moment their body was sent to the response, EnginioUploadTuner turns
+  that into the size of the next chunks.
+
+  An upload which is recorded in the EnginioUploadJournal knows the id of
+  its file object. A resumed upload starts at the offset the journal
+  recorded as confirmed.
+*/
+class ENGINIOCLIENT_EXPORT EnginioChunkedUpload
+{
+public:
+    enum {
+        DefaultWindow = 4,
+        MaximalAttempts = 3
+    };
+
+    struct Chunk
+    {
+        qint64 start;
+        qint64 end; // exclusive, like in the Content-Range header
+        int attempts; // failed attempts so far
+        qint64 sent; // bytes of the current attempt
+        qint64 startedAt; // ms since the upload started
+        qint64 sentAt; // when the whole body was sent, -1 before
+    };
+
+    struct Statistics
+    {
+        int chunks; // acknowledged ones
+        int retries;
+        qint64 chunkSize; // of the chunks sent now
+        qint64 smallestChunkSize;
+        qint64 largestChunkSize;
+    };
+
+    EnginioChunkedUpload(QNetworkReply *standIn, QIODevice *device, const QUrl &chunkUrl, qint64 chunkSize);
+    ~EnginioChunkedUpload();
+
+    QNetworkReply *standIn() const Q_REQUIRED_RESULT { return _standIn; }
+    QIODevice *device() const Q_REQUIRED_RESULT { return _device; }
+    QUrl chunkUrl() const Q_REQUIRED_RESULT { return _chunkUrl; }
+    qint64 size() const Q_REQUIRED_RESULT { return _size; }
+    qint64 confirmed() const Q_REQUIRED_RESULT { return _confirmed; }
+    bool isComplete() const Q_REQUIRED_RESULT { return _confirmed == _size; }
+    qint64 progress() const Q_REQUIRED_RESULT;
+    qint64 elapsed() const Q_REQUIRED_RESULT { return _clock.elapsed(); }
+    void setChunkSize(qint64 chunkSize);
+    void resumeAt(qint64 offset);
+    QString journaledFileId() const Q_REQUIRED_RESULT { return _journaledFileId; }
+    void setJournaledFileId(const QString &fileId) { _journaledFileId = fileId; }
+    Statistics statistics() const Q_REQUIRED_RESULT { return _statistics; }
+    bool advanceReportedProgress(qint64 progress);
+
+    bool hasPendingChunk() const Q_REQUIRED_RESULT { return !_retries.isEmpty() || _next < _size; }
+    Chunk takeChunk();
+    void retry(const Chunk &chunk);
+    void acknowledge(const Chunk &chunk);
+
+    int inFlightCount() const Q_REQUIRED_RESULT { return _inFlight.count(); }
+    QList<QNetworkReply*> inFlightReplies() const Q_REQUIRED_RESULT { return _inFlight.keys(); }
+    void started(QNetworkReply *reply, const Chunk &chunk);
+    void setSent(QNetworkReply *reply, qint64 bytes);
+    Chunk finished(QNetworkReply *reply);
+
+private:
+    QNetworkReply *_standIn;
+    QIODevice *_device;
+    QUrl _chunkUrl; // computed once from the file id
+    QString _journaledFileId; // empty if the upload is not in the journal
+    qint64 _size;
+    qint64 _chunkSize;
+    qint64 _next; // start of the first chunk never sent
+    qint64 _confirmed;
+    qint64 _acknowledged; // bytes, including the ones after a gap
+    qint64 _reported; // the progress reported last, a retried chunk may set it back
+    QMap<qint64, qint64> _ranges; // acknowledged start -> end after confirmed()
+    QList<Chunk> _retries;
+    QHash<QNetworkReply*, Chunk> _inFlight;
+    QElapsedTimer _clock;
+    Statistics _statistics;
+
+    Q_DISABLE_COPY(EnginioChunkedUpload)
+};
+
+/*!
+  \internal
+  Picks the size of upload chunks from what the chunks sent before measured.
+
+  The throughput is what one chunk gets over its whole round trip, from the
+  start of the request to the response, so it includes the time the backend
+  takes to answer and the data that was only buffered locally when the body
+  counted as sent. The round trip time is taken from the wait between the
+  body being sent and the response alone.
+
+  A chunk should take about TargetChunkDuration from request to response at
+  that throughput, but at least RoundTripsPerChunk round trips, so that
+  waiting for the response is a small part of it. Few round trips pay off
+  on a fast link, while small chunks are cheap to send again on a lossy
+  one. A failed chunk halves the size, and the size grows at most twofold
+  per chunk. The size stays between a floor and a ceiling.
+
+  The chunk size also decides if a file is uploaded in chunks at all,
+  smaller files are sent in one multipart request.
+*/
+class ENGINIOCLIENT_EXPORT EnginioUploadTuner
+{
+public:
+    enum {
+        MinimalChunkSize = 64 * 1024,
+        DefaultChunkSize = 512 * 1024,
+        MaximalChunkSize = 8 * 1024 * 1024,
+        TargetChunkDuration = 2000, // ms
+        RoundTripsPerChunk = 8
+    };
+
+    EnginioUploadTuner();
+
+    qint64 chunkSize() const Q_REQUIRED_RESULT { return _chunkSize; }
+    qint64 minimalChunkSize() const Q_REQUIRED_RESULT { return _minimalChunkSize; }
+    qint64 maximalChunkSize() const Q_REQUIRED_RESULT { return _maximalChunkSize; }
+    void setChunkSizeLimits(qint64 minimal, qint64 maximal);
+
+    qint64 throughput() const Q_REQUIRED_RESULT { return qRound64(_throughput); } // bytes per second, 0 before the first chunk
+    qint64 roundTripTime() const Q_REQUIRED_RESULT { return qRound64(_roundTripTime); } // ms
+
+    void chunkSent(qint64 bytes, qint64 roundTrip, qint64 responseTime);
+    void chunkFailed();
+
+private:
+    qint64 _chunkSize;
+    qint64 _minimalChunkSize;
+    qint64 _maximalChunkSize;
+    double _throughput;
+    double _roundTripTime;
+    bool _roundTripMeasured;
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOCHUNKEDUPLOAD_P_H
@@ -237,21 +237,9 @@ ENGINIOCLIENT_EXPORT bool gEnableEnginioDebugInfo = !qEnvironmentVariableIsSet("
 
 QNetworkRequest EnginioClientConnectionPrivate::prepareRequest(const QUrl &url)
 {
-    QByteArray requestId = QUuid::createUuid().toByteArray();
-
-    // Remove unneeded pretty-formatting.
-    // before: "{xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx}"
-    // after:  "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
-    requestId.chop(1);      // }
-    requestId.remove(0, 1); // {
-    requestId.remove(23, 1);
-    requestId.remove(18, 1);
-    requestId.remove(13, 1);
-    requestId.remove(8, 1);
-
     QNetworkRequest req(_request);
     req.setUrl(url);
-    req.setRawHeader(EnginioString::X_Request_Id, requestId);
+    req.setRawHeader(EnginioString::X_Request_Id, EnginioRequestBuilder::createRequestId());
     return req;
 }
 
@@ -274,7 +262,12 @@ EnginioClientConnectionPrivate::EnginioClientConnectionPrivate() :
     _identity(),
     _serviceUrl(EnginioString::apiEnginIo),
     _networkManager(),
-    _uploadChunkSize(512 * 1024),
+    _uploadWindow(EnginioChunkedUpload::DefaultWindow),
+    _batchEndpointAvailable(true),
+    _scheduler(new EnginioRequestScheduler(this)),
+    _queryPriority(Enginio::InteractivePriority),
+    _writePriority(Enginio::ModelWritePriority),
+    _sharedQueries(new EnginioSharedQueries(this)),
     _authenticationState(Enginio::NotAuthenticated)
 {
     assignNetworkManager();
@@ -300,32 +293,48 @@ void EnginioClientConnectionPrivate::init()
 
 void EnginioClientConnectionPrivate::replyFinished(QNetworkReply *nreply)
 {
-    EnginioReplyState *ereply = _replyReplyMap.take(nreply);
+    EnginioRequestContext *context = findRequestContext(nreply);
+    if (context && context->chunkedUpload) {
+        if (!chunkFinished(nreply, context))
+            return;
+        context = findRequestContext(nreply);
+    }
+    if (!context || !context->reply) {
+        _sharedQueries->finish(nreply, 0); // the requests waiting for it are sent after all
+        if (EnginioChunkedUpload *upload = _chunkedUploads.take(nreply))
+            cancelChunkedUpload(upload); // nobody waits for the upload any more
+        return;
+    }
+
+    EnginioReplyState *ereply = context->reply;
+    context->reply = 0;
 
-    if (!ereply)
+    if (_responseCache && nreply->error() == QNetworkReply::NoError
+            && nreply->request().attribute(EnginioResponseCache::CacheableAttribute).toBool()
+            && !updateResponseCache(nreply, ereply))
         return;
 
+    _sharedQueries->finish(nreply, ereply);
+
+    QIODevice *uploadDevice = context->uploadDevice;
+    context->uploadDevice = 0;
+
     if (nreply->error() != QNetworkReply::NoError) {
-        QPair<QIODevice *, qint64> deviceState = _chunkedUploads.take(nreply);
-        delete deviceState.first;
+        delete uploadDevice;
         emitError(ereply);
     }
 
     // continue chunked upload
-    else if (_chunkedUploads.contains(nreply)) {
-        QPair<QIODevice *, qint64> deviceState = _chunkedUploads.take(nreply);
+    else if (uploadDevice) {
         QString status = ereply->data().value(EnginioString::status).toString();
         if (status == EnginioString::empty || status == EnginioString::incomplete) {
             Q_ASSERT(ereply->data().value(EnginioString::objectType).toString() == EnginioString::files);
-            uploadChunk(ereply, deviceState.first, deviceState.second);
+            startChunkedUpload(ereply, uploadDevice); // releases the context
             return;
         }
         // should never get here unless upload was successful
         Q_ASSERT(status == EnginioString::complete);
-        delete deviceState.first;
-        if (_connections.count() * 2 > _chunkedUploads.count()) {
-            _connections.removeAll(QMetaObject::Connection());
-        }
+        delete uploadDevice;
     }
 
     if (Q_UNLIKELY(ereply->delayFinishedSignal())) {
@@ -335,8 +344,7 @@ void EnginioClientConnectionPrivate::replyFinished(QNetworkReply *nreply)
         ereply->dataChanged();
         EnginioReplyStatePrivate::get(ereply)->emitFinished();
         emitFinished(ereply);
-        if (gEnableEnginioDebugInfo)
-            _requestData.remove(nreply);
+        releaseRequestContext(nreply);
     }
 
     if (Q_UNLIKELY(_delayedReplies.count())) {
@@ -344,6 +352,74 @@ void EnginioClientConnectionPrivate::replyFinished(QNetworkReply *nreply)
     }
 }
 
+/*!
+  \internal
+  Stores a fresh response in the cache, or serves a 304 response from it.
+  Returns false if the request had to be sent again, because the cached
+  response disappeared in the meantime.
+*/
+bool EnginioClientConnectionPrivate::updateResponseCache(QNetworkReply *nreply, EnginioReplyState *ereply)
+{
+    EnginioReplyStatePrivate *ereplyPrivate = EnginioReplyStatePrivate::get(ereply);
+    const QNetworkRequest request = nreply->request();
+    const int status = ereplyPrivate->backendStatus();
+
+    if (status == 304) {
+        QByteArray body;
+        if (_responseCache->notModified(request, &body)) {
+            ereplyPrivate->setRawData(body);
+            ereplyPrivate->_servedFromCache = true;
+            return true;
+        }
+        QNetworkRequest unconditional(request);
+        unconditional.setRawHeader(QByteArrayLiteral("If-None-Match"), QByteArray());
+        unconditional.setRawHeader(QByteArrayLiteral("If-Modified-Since"), QByteArray());
+        // like the query it replaces, the queries sharing it move over with setNetworkReply()
+        ereply->setNetworkReply(_scheduler->get(unconditional, _scheduler->priority(nreply)));
+        return false;
+    }
+
+    if (status == 200)
+        _responseCache->store(request, nreply, ereplyPrivate->pData());
+    return true;
+}
+
+/*!
+  \internal
+  Gives \a nreply, the request EnginioRequestScheduler held back, to the
+  reply which waited for it and moves what was recorded for the request
+  from the stand-in \a queued over to it.
+*/
+void EnginioClientConnectionPrivate::replaceQueuedReply(QNetworkReply *queued, QNetworkReply *nreply)
+{
+    EnginioRequestContext *context = findRequestContext(queued);
+    Q_ASSERT(context && (context->reply || context->chunkedUpload || context->owner));
+    if (EnginioRequestOwner *owner = context->owner) {
+        releaseRequestContext(queued);
+        owner->requestSent(queued, nreply);
+        return;
+    }
+    if (EnginioChunkedUpload *upload = context->chunkedUpload) {
+        const EnginioChunkedUpload::Chunk chunk = upload->finished(queued);
+        releaseRequestContext(queued);
+        queued->deleteLater();
+        registerChunk(upload, nreply, chunk);
+        return;
+    }
+
+    const QByteArray requestData = context->requestData;
+    QIODevice *uploadDevice = context->uploadDevice;
+    const bool trackProgress = context->progressConnection;
+
+    context->reply->setNetworkReply(nreply); // releases the context of queued
+
+    EnginioRequestContext *replyContext = requestContext(nreply);
+    replyContext->requestData = requestData;
+    replyContext->uploadDevice = uploadDevice;
+    if (trackProgress)
+        trackUploadProgress(nreply);
+}
+
 bool EnginioClientConnectionPrivate::finishDelayedReplies()
 {
     // search if we can trigger an old finished signal.
@@ -355,8 +431,7 @@ bool EnginioClientConnectionPrivate::finishDelayedReplies()
                 reply->dataChanged();
                 EnginioReplyStatePrivate::get(reply)->emitFinished();
                 emitFinished(reply);
-                if (gEnableEnginioDebugInfo)
-                    _requestData.remove(reply->d_func()->_nreply); // FIXME it is ugly, and breaks encapsulation
+                releaseRequestContext(reply->d_func()->_nreply); // FIXME it is ugly, and breaks encapsulation
                 _delayedReplies.remove(reply);
                 needToReevaluate = true;
             }
@@ -369,9 +444,10 @@ EnginioClientConnectionPrivate::~EnginioClientConnectionPrivate()
 {
     foreach (const QMetaObject::Connection &identityConnection, _identityConnections)
         QObject::disconnect(identityConnection);
-    foreach (const QMetaObject::Connection &connection, _connections)
-        QObject::disconnect(connection);
+    foreach (EnginioRequestContext *context, _requests)
+        QObject::disconnect(context->progressConnection);
     QObject::disconnect(_networkManagerConnection);
+    qDeleteAll(_chunkedUploads);
 }
 
 class EnginioClientPrivate: public EnginioClientConnectionPrivate {
@@ -450,6 +526,58 @@ void EnginioClientConnection::setServiceUrl(const QUrl &serviceUrl)
     }
 }
 
+/*!
+  \property EnginioClientConnection::queryPriority
+  \brief The priority of the queries made with this client
+  \since 1.8
+
+  Queries and full text searches are sent with this
+  Enginio::RequestPriority. A request is sent right away while there is room
+  for its class, otherwise it waits and the most urgent waiting requests are
+  sent first. The priority of a single request can still be changed through
+  EnginioReply::priority while it waits.
+
+  The default is Enginio::InteractivePriority.
+  \sa writePriority
+*/
+Enginio::RequestPriority EnginioClientConnection::queryPriority() const
+{
+    Q_D(const EnginioClientConnection);
+    return d->_queryPriority;
+}
+
+void EnginioClientConnection::setQueryPriority(Enginio::RequestPriority priority)
+{
+    Q_D(EnginioClientConnection);
+    if (d->_queryPriority != priority) {
+        d->_queryPriority = priority;
+        emit queryPriorityChanged(priority);
+    }
+}
+
+/*!
+  \property EnginioClientConnection::writePriority
+  \brief The priority of creating, updating and removing objects with this client
+  \since 1.8
+
+  The default is Enginio::ModelWritePriority.
+  \sa queryPriority
+*/
+Enginio::RequestPriority EnginioClientConnection::writePriority() const
+{
+    Q_D(const EnginioClientConnection);
+    return d->_writePriority;
+}
+
+void EnginioClientConnection::setWritePriority(Enginio::RequestPriority priority)
+{
+    Q_D(EnginioClientConnection);
+    if (d->_writePriority != priority) {
+        d->_writePriority = priority;
+        emit writePriorityChanged(priority);
+    }
+}
+
 /*!
   \brief Get the QNetworkAccessManager used by the Enginio library.
 
@@ -501,7 +629,7 @@ EnginioReply *EnginioClient::fullTextSearch(const QJsonObject &query)
 {
     Q_D(EnginioClient);
 
-    QNetworkReply *nreply = d->query<QJsonObject>(query, Enginio::SearchOperation);
+    QNetworkReply *nreply = d->query<QJsonObject>(query, Enginio::SearchOperation, d->_queryPriority);
     EnginioReply *ereply = new EnginioReply(d, nreply);
     return ereply;
 }
@@ -518,7 +646,7 @@ EnginioReply* EnginioClient::query(const QJsonObject &query, const Enginio::Oper
 {
     Q_D(EnginioClient);
 
-    QNetworkReply *nreply = d->query<QJsonObject>(query, operation);
+    QNetworkReply *nreply = d->query<QJsonObject>(query, operation, d->_queryPriority);
     EnginioReply *ereply = new EnginioReply(d, nreply);
 
     return ereply;
@@ -545,7 +673,7 @@ EnginioReply* EnginioClient::create(const QJsonObject &object, const Enginio::Op
 {
     Q_D(EnginioClient);
 
-    QNetworkReply *nreply = d->create<QJsonObject>(object, operation);
+    QNetworkReply *nreply = d->create<QJsonObject>(object, operation, d->_writePriority);
     EnginioReply *ereply = new EnginioReply(d, nreply);
 
     return ereply;
@@ -563,7 +691,7 @@ EnginioReply* EnginioClient::update(const QJsonObject &object, const Enginio::Op
 {
     Q_D(EnginioClient);
 
-    QNetworkReply *nreply = d->update<QJsonObject>(object, operation);
+    QNetworkReply *nreply = d->update<QJsonObject>(object, operation, d->_writePriority);
     EnginioReply *ereply = new EnginioReply(d, nreply);
 
     return ereply;
@@ -581,7 +709,7 @@ EnginioReply* EnginioClient::remove(const QJsonObject &object, const Enginio::Op
 {
     Q_D(EnginioClient);
 
-    QNetworkReply *nreply = d->remove<QJsonObject>(object, operation);
+    QNetworkReply *nreply = d->remove<QJsonObject>(object, operation, d->_writePriority);
     EnginioReply *ereply = new EnginioReply(d, nreply);
 
     return ereply;
@@ -641,6 +769,145 @@ EnginioReply* EnginioClient::uploadFile(const QJsonObject &object, const QUrl &f
     return ereply;
 }
 
+/*!
+  \property EnginioClient::responseCacheSize
+  \brief The number of bytes of responses the client keeps to revalidate them
+
+  When the size is larger than zero, the responses of query() and
+  downloadUrl() which carry an ETag or a Last-Modified header are kept, up to
+  this many bytes of response bodies. The same request is then still sent,
+  but as a conditional one, and if the backend answers that nothing changed
+  the reply is served from the kept response.
+
+  By default the size is 0 and no responses are kept.
+  \sa responseCacheDirectory
+*/
+qint64 EnginioClient::responseCacheSize() const
+{
+    Q_D(const EnginioClient);
+    return d->responseCacheSize();
+}
+
+void EnginioClient::setResponseCacheSize(qint64 size)
+{
+    Q_D(EnginioClient);
+    size = qMax(Q_INT64_C(0), size);
+    if (size == d->responseCacheSize())
+        return;
+    d->setResponseCacheSize(size);
+    emit responseCacheSizeChanged(size);
+}
+
+/*!
+  \property EnginioClient::responseCacheDirectory
+  \brief The directory where responses which do not fit into the memory are kept
+
+  Responses which are evicted from the memory, because the
+  \l responseCacheSize was exceeded, are written to this directory, and used
+  by the next clients with the same directory. The responses are not
+  encrypted, applications showing user specific data should use a directory
+  per user.
+
+  By default the property is empty and responses are kept in the memory only.
+  It has no effect as long as the responseCacheSize is 0.
+*/
+QString EnginioClient::responseCacheDirectory() const
+{
+    Q_D(const EnginioClient);
+    return d->_responseCacheDirectory;
+}
+
+void EnginioClient::setResponseCacheDirectory(const QString &directory)
+{
+    Q_D(EnginioClient);
+    if (directory == d->_responseCacheDirectory)
+        return;
+    d->setResponseCacheDirectory(directory);
+    emit responseCacheDirectoryChanged(directory);
+}
+
+/*!
+  \property EnginioClient::uploadJournal
+  \brief The file in which the client records the uploads that did not finish
+
+  When set, every file sent by uploadFile() in chunks is recorded in this file
+  together with the number of bytes the backend acknowledged so far. The entry
+  is removed once the upload is complete or failed for good. Uploads which
+  were interrupted, for example because the application was closed or the
+  network was lost, can be continued with resumeUploads(), also after the next
+  start of the application.
+
+  Small files, which are sent in a single request, are not recorded. A journal
+  file should be used by one client at a time.
+  By default the property is empty and no journal is kept.
+  \sa resumeUploads()
+*/
+QString EnginioClient::uploadJournal() const
+{
+    Q_D(const EnginioClient);
+    return d->uploadJournal();
+}
+
+void EnginioClient::setUploadJournal(const QString &fileName)
+{
+    Q_D(EnginioClient);
+    if (fileName == d->uploadJournal())
+        return;
+    d->setUploadJournal(fileName);
+    emit uploadJournalChanged(fileName);
+}
+
+/*!
+  \brief Continues the uploads recorded in the \l uploadJournal
+
+  Every upload to the current backend that is recorded in the journal, and
+  is not running already, is continued from the last chunk the backend
+  acknowledged, instead of sending the whole file again. An upload is only
+  continued if the local file still has the size and modification time it
+  had when the upload started, otherwise it is removed from the journal.
+
+  \return the replies of the continued uploads. They finish like the replies
+  of uploadFile(), with the file object as their data.
+  \sa uploadJournal
+*/
+QList<EnginioReply *> EnginioClient::resumeUploads()
+{
+    Q_D(EnginioClient);
+    QList<EnginioReply *> replies;
+    foreach (QNetworkReply *nreply, d->resumeUploads())
+        replies.append(new EnginioReply(d, nreply));
+    return replies;
+}
+
+/*!
+  \property EnginioClient::uploadWindow
+  \brief The number of chunks of one upload which are sent at the same time
+
+  Files which are larger than a chunk are sent by uploadFile() in several
+  requests. Up to this many of them are in flight at once, which hides the
+  round trip time of the network. A window of 1 sends the chunks one after
+  the other. The client sends no more file transfer requests at once than the
+  window allows, also when several files are uploaded.
+
+  The smallest window is 1, by default it is 4.
+  \sa uploadFile()
+*/
+int EnginioClient::uploadWindow() const
+{
+    Q_D(const EnginioClient);
+    return d->_uploadWindow;
+}
+
+void EnginioClient::setUploadWindow(int chunks)
+{
+    Q_D(EnginioClient);
+    chunks = qMax(1, chunks);
+    if (chunks == d->_uploadWindow)
+        return;
+    d->setUploadWindow(chunks);
+    emit uploadWindowChanged(chunks);
+}
+
 /*!
   \brief Get a temporary URL for a file stored in Enginio
 
@@ -765,40 +1032,274 @@ EnginioReplyState *EnginioClientConnectionPrivate::createReply(QNetworkReply *nr
     return new EnginioReply(this, nreply);
 }
 
-void EnginioClientConnectionPrivate::uploadChunk(EnginioReplyState *ereply, QIODevice *device, qint64 startPos)
+/*!
+  \internal
+  Continues the upload of \a device, after its file object was created, by
+  sending the content in chunks. \a ereply waits on a stand-in until the
+  last chunk is acknowledged.
+*/
+void EnginioClientConnectionPrivate::startChunkedUpload(EnginioReplyState *ereply, QIODevice *device)
 {
-    QUrl serviceUrl = _serviceUrl;
+    QUrl chunkUrl = _serviceUrl;
     {
         QString path;
         QByteArray errorMsg;
         if (!getPath(ereply->data(), Enginio::FileChunkUploadOperation, &path, &errorMsg).successful())
             Q_UNREACHABLE(); // sequential upload can not have an invalid path!
-        serviceUrl.setPath(path);
+        chunkUrl.setPath(path);
     }
 
-    QNetworkRequest req = prepareRequest(serviceUrl);
+    const QString fileId = ereply->data()[EnginioString::id].toString();
+    QNetworkReply *standIn = new EnginioQueuedReply(EnginioReplyStatePrivate::get(ereply)->_nreply->request(), QNetworkAccessManager::PutOperation);
+    ereply->setNetworkReply(standIn); // releases the context of the file object request
+    EnginioChunkedUpload *upload = new EnginioChunkedUpload(standIn, device, chunkUrl, _uploadTuner.chunkSize());
+    _chunkedUploads.insert(standIn, upload);
+    journalUpload(upload, fileId);
+    sendChunks(upload);
+}
+
+void EnginioClientConnectionPrivate::sendChunks(EnginioChunkedUpload *upload)
+{
+    while (upload->inFlightCount() < _uploadWindow && upload->hasPendingChunk())
+        sendChunk(upload, upload->takeChunk());
+}
+
+void EnginioClientConnectionPrivate::sendChunk(EnginioChunkedUpload *upload, const EnginioChunkedUpload::Chunk &chunk)
+{
+    QNetworkRequest req = prepareRequest(upload->chunkUrl());
     req.setHeader(QNetworkRequest::ContentTypeHeader, EnginioString::Application_octet_stream);
 
     // Content-Range: bytes {chunkStart}-{chunkEnd}/{totalFileSize}
-    qint64 size = device->size();
-    qint64 endPos = qMin(startPos + _uploadChunkSize, size);
     req.setRawHeader(EnginioString::Content_Range,
-                     QByteArray::number(startPos) + EnginioString::Minus
-                     + QByteArray::number(endPos) + EnginioString::Div
-                     + QByteArray::number(size));
-
-    // qDebug() << "Uploading chunk from " << startPos << " to " << endPos << " of " << size;
+                     QByteArray::number(chunk.start) + EnginioString::Minus
+                     + QByteArray::number(chunk.end) + EnginioString::Div
+                     + QByteArray::number(upload->size()));
 
-    Q_ASSERT(device->isOpen());
+    Q_ASSERT(upload->device()->isOpen());
 
-    ChunkDevice *chunkDevice = new ChunkDevice(device, startPos, _uploadChunkSize);
+    ChunkDevice *chunkDevice = new ChunkDevice(upload->device(), chunk.start, chunk.end - chunk.start);
     chunkDevice->open(QIODevice::ReadOnly);
 
-    QNetworkReply *reply = networkManager()->put(req, chunkDevice);
+    QNetworkReply *reply = _scheduler->put(req, chunkDevice, Enginio::FileTransferPriority);
     chunkDevice->setParent(reply);
-    _chunkedUploads.insert(reply, qMakePair(device, endPos));
-    ereply->setNetworkReply(reply);
-    _connections.append(QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(this, reply)));
+    registerChunk(upload, reply, chunk);
+}
+
+void EnginioClientConnectionPrivate::registerChunk(EnginioChunkedUpload *upload, QNetworkReply *reply, const EnginioChunkedUpload::Chunk &chunk)
+{
+    upload->started(reply, chunk);
+    EnginioRequestContext *context = requestContext(reply);
+    context->chunkedUpload = upload;
+    context->progressConnection = QObject::connect(reply, &QNetworkReply::uploadProgress, ChunkProgressFunctor(this, upload, reply));
+}
+
+/*!
+  \internal
+  Acknowledges the chunk sent by \a nreply, or sends it again if it failed
+  for a reason that may go away. Returns true if the upload is over, then
+  \a nreply belongs to the reply of the upload, which finishes with it.
+*/
+bool EnginioClientConnectionPrivate::chunkFinished(QNetworkReply *nreply, EnginioRequestContext *context)
+{
+    EnginioChunkedUpload *upload = context->chunkedUpload;
+    EnginioChunkedUpload::Chunk chunk = upload->finished(nreply);
+    releaseRequestContext(nreply);
+
+    const EnginioRequestContext *standInContext = findRequestContext(upload->standIn());
+    if (!standInContext || !standInContext->reply) {
+        // the reply was deleted, the stand-in did not finish yet
+        _chunkedUploads.remove(upload->standIn());
+        nreply->deleteLater();
+        cancelChunkedUpload(upload);
+        return false;
+    }
+
+    EnginioReplyStatePrivate *ereply = EnginioReplyStatePrivate::get(standInContext->reply);
+    if (nreply->error() != QNetworkReply::NoError) {
+        const int status = nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const bool transient = nreply->error() != QNetworkReply::OperationCanceledError && (!status || status >= 500);
+        if (!transient || ++chunk.attempts >= EnginioChunkedUpload::MaximalAttempts) {
+            // an upload that gave up on a transient error may be resumed later
+            updateUploadJournal(upload, transient);
+            ereply->_uploadStatistics = upload->statistics();
+            finishChunkedUpload(upload, nreply);
+            return true;
+        }
+        _uploadTuner.chunkFailed();
+        upload->retry(chunk);
+    } else {
+        const qint64 now = upload->elapsed();
+        _uploadTuner.chunkSent(chunk.end - chunk.start, now - chunk.startedAt, chunk.sentAt >= 0 ? now - chunk.sentAt : -1);
+        upload->acknowledge(chunk);
+        updateUploadJournal(upload, !upload->isComplete());
+        if (upload->isComplete()) {
+            ereply->_uploadStatistics = upload->statistics();
+            finishChunkedUpload(upload, nreply);
+            return true;
+        }
+    }
+    upload->setChunkSize(_uploadTuner.chunkSize());
+    ereply->_uploadStatistics = upload->statistics();
+
+    nreply->deleteLater();
+    sendChunks(upload);
+    return false;
+}
+
+/*!
+  \internal
+  Ends \a upload, the reply which waited for it finishes with \a nreply.
+  Chunks that are still in flight are aborted.
+*/
+void EnginioClientConnectionPrivate::finishChunkedUpload(EnginioChunkedUpload *upload, QNetworkReply *nreply)
+{
+    QNetworkReply *standIn = upload->standIn();
+    EnginioReplyState *ereply = findRequestContext(standIn)->reply;
+    Q_ASSERT(ereply);
+    _chunkedUploads.remove(standIn);
+    cancelChunkedUpload(upload);
+    ereply->setNetworkReply(nreply); // aborts the stand-in
+}
+
+void EnginioClientConnectionPrivate::cancelChunkedUpload(EnginioChunkedUpload *upload)
+{
+    foreach (QNetworkReply *reply, upload->inFlightReplies()) {
+        releaseRequestContext(reply);
+        reply->abort();
+        reply->deleteLater();
+    }
+    delete upload;
+}
+
+/*!
+  \internal
+  Records \a upload of the file object \a fileId in the upload journal, if
+  there is one and the upload reads from a local file.
+*/
+void EnginioClientConnectionPrivate::journalUpload(EnginioChunkedUpload *upload, const QString &fileId)
+{
+    QFile *file = qobject_cast<QFile*>(upload->device());
+    if (!_uploadJournal || !file || fileId.isEmpty())
+        return;
+    EnginioUploadJournal::Entry entry;
+    if (!EnginioUploadJournal::describe(file->fileName(), &entry) || entry.size != upload->size())
+        return;
+    entry.backendId = _backendId;
+    entry.fileId = fileId;
+    entry.confirmed = upload->confirmed();
+    if (_uploadJournal->record(entry))
+        upload->setJournaledFileId(fileId);
+}
+
+/*!
+  \internal
+  Writes the confirmed offset of \a upload to the journal, or removes its
+  entry if the upload is not \a pending any more.
+*/
+void EnginioClientConnectionPrivate::updateUploadJournal(EnginioChunkedUpload *upload, bool pending)
+{
+    const QString fileId = upload->journaledFileId();
+    if (!_uploadJournal || fileId.isEmpty())
+        return;
+    if (pending)
+        _uploadJournal->setConfirmed(fileId, upload->confirmed());
+    else
+        _uploadJournal->remove(fileId);
+}
+
+qint64 EnginioClientConnectionPrivate::responseCacheSize() const
+{
+    return _responseCache ? _responseCache->maximumSize() : 0;
+}
+
+void EnginioClientConnectionPrivate::setResponseCacheSize(qint64 size)
+{
+    if (size <= 0) {
+        _responseCache.reset();
+        return;
+    }
+    if (_responseCache) {
+        _responseCache->setMaximumSize(size);
+        return;
+    }
+    _responseCache.reset(new EnginioResponseCache(size));
+    _responseCache->setDirectory(_responseCacheDirectory);
+}
+
+void EnginioClientConnectionPrivate::setResponseCacheDirectory(const QString &directory)
+{
+    _responseCacheDirectory = directory;
+    if (_responseCache)
+        _responseCache->setDirectory(directory);
+}
+
+QString EnginioClientConnectionPrivate::uploadJournal() const
+{
+    return _uploadJournal ? _uploadJournal->fileName() : QString();
+}
+
+void EnginioClientConnectionPrivate::setUploadJournal(const QString &fileName)
+{
+    // uploads recorded in the old journal stay there, they are simply not updated any more
+    foreach (EnginioChunkedUpload *upload, _chunkedUploads)
+        upload->setJournaledFileId(QString());
+    _uploadJournal.reset(fileName.isEmpty() ? 0 : new EnginioUploadJournal(fileName));
+}
+
+void EnginioClientConnectionPrivate::setUploadWindow(int chunks)
+{
+    _uploadWindow = chunks;
+    // the file transfer class is as wide as one upload window
+    _scheduler->setConcurrencyLimit(Enginio::FileTransferPriority, chunks);
+    foreach (EnginioChunkedUpload *upload, _chunkedUploads)
+        sendChunks(upload);
+}
+
+/*!
+  \internal
+  Continues the uploads of the current backend recorded in the journal
+  which are not running already, from the offset the backend acknowledged
+  last. Entries of local files which changed or disappeared are dropped.
+  Returns the stand-ins the replies of the uploads have to wait on.
+*/
+QList<QNetworkReply*> EnginioClientConnectionPrivate::resumeUploads()
+{
+    QList<QNetworkReply*> standIns;
+    if (!_uploadJournal)
+        return standIns;
+
+    QSet<QString> running;
+    foreach (EnginioChunkedUpload *upload, _chunkedUploads)
+        running.insert(upload->journaledFileId());
+
+    foreach (const EnginioUploadJournal::Entry &entry, _uploadJournal->entries()) {
+        if (entry.backendId != _backendId || running.contains(entry.fileId))
+            continue;
+        QFile *file = new QFile(entry.path);
+        if (!EnginioUploadJournal::matches(entry) || !file->open(QFile::ReadOnly)) {
+            delete file;
+            _uploadJournal->remove(entry.fileId);
+            continue;
+        }
+
+        QJsonObject object;
+        object[EnginioString::id] = entry.fileId;
+        QString path;
+        QByteArray errorMsg;
+        if (!getPath(object, Enginio::FileChunkUploadOperation, &path, &errorMsg).successful())
+            Q_UNREACHABLE(); // the journal has no entries without a file id
+        QUrl chunkUrl = _serviceUrl;
+        chunkUrl.setPath(path);
+
+        QNetworkReply *standIn = new EnginioQueuedReply(prepareRequest(chunkUrl), QNetworkAccessManager::PutOperation);
+        EnginioChunkedUpload *upload = new EnginioChunkedUpload(standIn, file, chunkUrl, _uploadTuner.chunkSize());
+        upload->resumeAt(entry.confirmed);
+        upload->setJournaledFileId(entry.fileId);
+        _chunkedUploads.insert(standIn, upload);
+        sendChunks(upload); // the chunks finish asynchronously, after the reply was created
+        standIns.append(standIn);
+    }
+    return standIns;
 }
 
 QByteArray EnginioClientConnectionPrivate::constructErrorMessage(const QByteArray &msg)
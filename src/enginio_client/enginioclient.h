@@ -37,6 +37,7 @@
 #include <Enginio/enginioclient_global.h>
 #include <Enginio/enginioclientconnection.h>
 #include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -51,6 +52,11 @@ class ENGINIOCLIENT_EXPORT EnginioClient : public EnginioClientConnection
     Q_ENUMS(Enginio::Operation) // TODO remove me QTBUG-33577
     Q_ENUMS(Enginio::AuthenticationState) // TODO remove me QTBUG-33577
 
+    Q_PROPERTY(qint64 responseCacheSize READ responseCacheSize WRITE setResponseCacheSize NOTIFY responseCacheSizeChanged FINAL)
+    Q_PROPERTY(QString responseCacheDirectory READ responseCacheDirectory WRITE setResponseCacheDirectory NOTIFY responseCacheDirectoryChanged FINAL)
+    Q_PROPERTY(QString uploadJournal READ uploadJournal WRITE setUploadJournal NOTIFY uploadJournalChanged FINAL)
+    Q_PROPERTY(int uploadWindow READ uploadWindow WRITE setUploadWindow NOTIFY uploadWindowChanged FINAL)
+
     Q_DECLARE_PRIVATE(EnginioClient)
 public:
     explicit EnginioClient(QObject *parent = nullptr);
@@ -66,12 +72,27 @@ public:
     Q_INVOKABLE EnginioReply *uploadFile(const QJsonObject &associatedObject, const QUrl &file);
     Q_INVOKABLE EnginioReply *downloadUrl(const QJsonObject &object);
 
+    qint64 responseCacheSize() const Q_REQUIRED_RESULT;
+    void setResponseCacheSize(qint64 size);
+    QString responseCacheDirectory() const Q_REQUIRED_RESULT;
+    void setResponseCacheDirectory(const QString &directory);
+
+    QString uploadJournal() const Q_REQUIRED_RESULT;
+    void setUploadJournal(const QString &fileName);
+    QList<EnginioReply *> resumeUploads();
+    int uploadWindow() const Q_REQUIRED_RESULT;
+    void setUploadWindow(int chunks);
+
 Q_SIGNALS:
     void sessionAuthenticated(EnginioReply *reply) const;
     void sessionAuthenticationError(EnginioReply *reply) const;
     void sessionTerminated() const;
     void finished(EnginioReply *reply);
     void error(EnginioReply *reply);
+    void responseCacheSizeChanged(qint64 size);
+    void responseCacheDirectoryChanged(const QString &directory);
+    void uploadJournalChanged(const QString &fileName);
+    void uploadWindowChanged(int chunks);
 };
 
 QT_END_NAMESPACE
@@ -36,9 +36,17 @@
 
 #include <Enginio/enginioclient.h>
 #include <Enginio/enginioreply.h>
+#include <Enginio/private/enginiochunkedupload_p.h>
+#include <Enginio/private/enginiouploadjournal_p.h>
 #include <Enginio/private/enginiofakereply_p.h>
 #include <Enginio/enginioidentity.h>
+#include <Enginio/private/enginionotificationhub_p.h>
 #include <Enginio/private/enginioobjectadaptor_p.h>
+#include <Enginio/private/enginiorequestbuilder_p.h>
+#include <Enginio/private/enginiorequestcontext_p.h>
+#include <Enginio/private/enginiorequestscheduler_p.h>
+#include <Enginio/private/enginioresponsecache_p.h>
+#include <Enginio/private/enginiosharedqueries_p.h>
 #include <Enginio/private/enginiostring_p.h>
 
 #include <QtNetwork/qnetworkaccessmanager.h>
@@ -53,7 +61,7 @@
 #include <QtCore/qmimedatabase.h>
 #include <QtCore/qjsonarray.h>
 #include <QtCore/qbuffer.h>
-#include <QtCore/qlinkedlist.h>
+#include <QtCore/qhash.h>
 #include <QtCore/quuid.h>
 #include <QtCore/qset.h>
 #include <QtCore/qlogging.h>
@@ -105,9 +113,10 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnectionPrivate : public QObjectPrivat
         enum {Failed = false};
         QByteArray &msg = *errorMsg;
 
+        // Start from a cached, implicitly shared prefix; only appending an id
+        // or a suffix detaches it.
         QString &result = *path;
-        result.reserve(96);
-        result.append(QStringLiteral("/v1/"));
+        result = EnginioRequestBuilder::operationPath(operation);
         QString id = object[EnginioString::id].toString();
 
         switch (operation) {
@@ -117,7 +126,7 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnectionPrivate : public QObjectPrivat
                 msg = constructErrorMessage(EnginioString::Requested_object_operation_requires_non_empty_objectType_value);
                 return GetPathReturnValue(Failed);
             }
-            result.append(objectType.replace('.', '/'));
+            result = EnginioRequestBuilder::objectTypePath(objectType);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
@@ -129,7 +138,7 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnectionPrivate : public QObjectPrivat
                 msg = constructErrorMessage(EnginioString::Requested_object_acl_operation_requires_non_empty_objectType_value);
                 return GetPathReturnValue(Failed);
             }
-            result.append(objectType.replace('.', '/'));
+            result = EnginioRequestBuilder::objectTypePath(objectType);
             if (!appendIdToPathIfPossible(path, id, errorMsg, RequireIdInPath, EnginioString::Requested_object_acl_operation_requires_non_empty_id_value))
                 return GetPathReturnValue(Failed);
             result.append('/');
@@ -137,13 +146,11 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnectionPrivate : public QObjectPrivat
             return GetPathReturnValue(true, EnginioString::access);
         }
         case Enginio::FileOperation: {
-            result.append(EnginioString::files);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
         }
         case Enginio::FileGetDownloadUrlOperation: {
-            result.append(EnginioString::files);
             if (!appendIdToPathIfPossible(path, id, errorMsg, RequireIdInPath, EnginioString::Download_operation_requires_non_empty_fileId_value))
                 return GetPathReturnValue(Failed);
             result.append(QStringLiteral("/download_url"));
@@ -151,35 +158,29 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnectionPrivate : public QObjectPrivat
         }
         case Enginio::FileChunkUploadOperation: {
             Q_ASSERT(!id.isEmpty());
-            result.append(EnginioString::files);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             result.append(QStringLiteral("/chunk"));
             break;
         }
         case Enginio::SearchOperation:
-            result.append(EnginioString::search);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
         case Enginio::SessionOperation:
-            result.append(EnginioString::session);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
         case Enginio::UserOperation:
-            result.append(EnginioString::users);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
         case Enginio::UsergroupOperation:
-            result.append(EnginioString::usergroups);
             if (!appendIdToPathIfPossible(path, id, errorMsg, flags))
                 return GetPathReturnValue(Failed);
             break;
         case Enginio::UsergroupMembersOperation:
         {
-            result.append(EnginioString::usergroups);
             if (!appendIdToPathIfPossible(path, id, errorMsg, RequireIdInPath, EnginioString::Requested_usergroup_member_operation_requires_non_empty_id_value))
                 return GetPathReturnValue(Failed);
             result.append('/');
@@ -290,18 +291,25 @@ public:
     QByteArray _backendId;
     EnginioIdentity *_identity;
 
-    QLinkedList<QMetaObject::Connection> _connections;
     QVarLengthArray<QMetaObject::Connection, 4> _identityConnections;
     QUrl _serviceUrl;
     QSharedPointer<QNetworkAccessManager> _networkManager;
     QMetaObject::Connection _networkManagerConnection;
     QNetworkRequest _request;
-    QMap<QNetworkReply*, EnginioReplyState*> _replyReplyMap;
-    QMap<QNetworkReply*, QByteArray> _requestData;
-
-    // device and last position
-    QMap<QNetworkReply*, QPair<QIODevice*, qint64> > _chunkedUploads;
-    qint64 _uploadChunkSize;
+    QHash<QNetworkReply*, EnginioRequestContext*> _requests;
+    EnginioRequestContextPool _requestContextPool;
+    EnginioUploadTuner _uploadTuner;
+    int _uploadWindow; // chunks of one upload in flight at once
+    QHash<QNetworkReply*, EnginioChunkedUpload*> _chunkedUploads; // by the stand-in of the reply
+    QScopedPointer<EnginioUploadJournal> _uploadJournal;
+    bool _batchEndpointAvailable;
+    QScopedPointer<EnginioResponseCache> _responseCache; // null unless a size was set
+    QString _responseCacheDirectory;
+    QScopedPointer<EnginioRequestScheduler> _scheduler;
+    Enginio::RequestPriority _queryPriority; // of the queries made through the public API
+    Enginio::RequestPriority _writePriority; // likewise for creating, updating and removing
+    QScopedPointer<EnginioSharedQueries> _sharedQueries;
+    QScopedPointer<EnginioNotificationHub> _notificationHub;
     QJsonObject _identityToken;
     Enginio::AuthenticationState _authenticationState;
 
@@ -311,6 +319,17 @@ public:
 
     void replyFinished(QNetworkReply *nreply);
     bool finishDelayedReplies();
+    bool updateResponseCache(QNetworkReply *nreply, EnginioReplyState *ereply);
+    void replaceQueuedReply(QNetworkReply *queued, QNetworkReply *nreply);
+
+    qint64 responseCacheSize() const Q_REQUIRED_RESULT;
+    void setResponseCacheSize(qint64 size);
+    void setResponseCacheDirectory(const QString &directory);
+
+    QString uploadJournal() const Q_REQUIRED_RESULT;
+    void setUploadJournal(const QString &fileName);
+    QList<QNetworkReply*> resumeUploads();
+    void setUploadWindow(int chunks);
 
     void setAuthenticationState(const Enginio::AuthenticationState state)
     {
@@ -333,15 +352,54 @@ public:
 
     QNetworkRequest prepareRequest(const QUrl &url);
 
+    // all models of this client share one notification stream
+    EnginioNotificationHub *notificationHub()
+    {
+        if (!_notificationHub)
+            _notificationHub.reset(new EnginioNotificationHub(this));
+        return _notificationHub.data();
+    }
+
+    EnginioRequestContext *requestContext(QNetworkReply *nreply)
+    {
+        EnginioRequestContext *&context = _requests[nreply];
+        if (!context)
+            context = _requestContextPool.acquire();
+        return context;
+    }
+
+    EnginioRequestContext *findRequestContext(QNetworkReply *nreply) const Q_REQUIRED_RESULT
+    {
+        return _requests.value(nreply);
+    }
+
+    void releaseRequestContext(QNetworkReply *nreply)
+    {
+        EnginioRequestContext *context = _requests.take(nreply);
+        if (!context)
+            return;
+        QObject::disconnect(context->progressConnection);
+        _requestContextPool.release(context);
+    }
+
     void registerReply(QNetworkReply *nreply, EnginioReplyState *ereply)
     {
         nreply->setParent(ereply);
-        _replyReplyMap[nreply] = ereply;
+        requestContext(nreply)->reply = ereply;
+    }
+
+    // a request without a reply of its own, the owner takes over its stand-in if it has to wait
+    QNetworkReply *ownRequest(QNetworkReply *nreply, EnginioRequestOwner *owner)
+    {
+        if (_scheduler->isQueued(nreply))
+            requestContext(nreply)->owner = owner;
+        return nreply;
     }
 
     void unregisterReply(QNetworkReply *nreply)
     {
-        _replyReplyMap.remove(nreply);
+        if (EnginioRequestContext *context = findRequestContext(nreply))
+            context->reply = 0;
     }
 
     EnginioIdentity *identity() const Q_REQUIRED_RESULT
@@ -403,10 +461,11 @@ public:
             buffer->open(QIODevice::ReadOnly);
         }
 
-        QNetworkReply *reply = networkManager()->sendCustomRequest(req, httpOperation, buffer);
+        const Enginio::RequestPriority priority = httpOperation == EnginioString::Get ? _queryPriority : _writePriority;
+        QNetworkReply *reply = _scheduler->sendCustomRequest(req, httpOperation, buffer, priority);
 
         if (gEnableEnginioDebugInfo && !payload.isEmpty())
-            _requestData.insert(reply, payload);
+            requestContext(reply)->requestData = payload;
 
         if (buffer)
             buffer->setParent(reply);
@@ -415,7 +474,7 @@ public:
     }
 
     template<class T>
-    QNetworkReply *update(const ObjectAdaptor<T> &object, const Enginio::Operation operation)
+    QNetworkReply *update(const ObjectAdaptor<T> &object, const Enginio::Operation operation, Enginio::RequestPriority priority = Enginio::ModelWritePriority)
     {
         QUrl url(_serviceUrl);
         CHECK_AND_SET_PATH_WITH_ID(url, object, operation);
@@ -424,16 +483,16 @@ public:
 
         QByteArray data = dataPropertyName.isEmpty() ? object.toJson() : object[dataPropertyName].toJson();
 
-        QNetworkReply *reply = networkManager()->put(req, data);
+        QNetworkReply *reply = _scheduler->put(req, data, priority);
 
         if (gEnableEnginioDebugInfo)
-            _requestData.insert(reply, data);
+            requestContext(reply)->requestData = data;
 
         return reply;
     }
 
     template<class T>
-    QNetworkReply *remove(const ObjectAdaptor<T> &object, const Enginio::Operation operation)
+    QNetworkReply *remove(const ObjectAdaptor<T> &object, const Enginio::Operation operation, Enginio::RequestPriority priority = Enginio::ModelWritePriority)
     {
         QUrl url(_serviceUrl);
         CHECK_AND_SET_PATH_WITH_ID(url, object, operation);
@@ -444,13 +503,13 @@ public:
         QByteArray data;
 #if 1 // QT_VERSION < QT_VERSION_CHECK(5, 4, 0) ?
         if (operation != Enginio::AccessControlOperation)
-            reply = networkManager()->deleteResource(req);
+            reply = _scheduler->deleteResource(req, priority);
         else {
             data = object[dataPropertyName].toJson();
             QBuffer *buffer = new QBuffer();
             buffer->setData(data);
             buffer->open(QIODevice::ReadOnly);
-            reply = networkManager()->sendCustomRequest(req, EnginioString::Delete, buffer);
+            reply = _scheduler->sendCustomRequest(req, EnginioString::Delete, buffer, priority);
             buffer->setParent(reply);
         }
 #else
@@ -462,13 +521,13 @@ public:
         Q_ASSERT(reply);
 
         if (gEnableEnginioDebugInfo && !data.isEmpty())
-            _requestData.insert(reply, data);
+            requestContext(reply)->requestData = data;
 
         return reply;
     }
 
     template<class T>
-    QNetworkReply *create(const ObjectAdaptor<T> &object, const Enginio::Operation operation)
+    QNetworkReply *create(const ObjectAdaptor<T> &object, const Enginio::Operation operation, Enginio::RequestPriority priority = Enginio::ModelWritePriority)
     {
         QUrl url(_serviceUrl);
 
@@ -478,16 +537,16 @@ public:
 
         QByteArray data = dataPropertyName.isEmpty() ? object.toJson() : object[dataPropertyName].toJson();
 
-        QNetworkReply *reply = networkManager()->post(req, data);
+        QNetworkReply *reply = _scheduler->post(req, data, priority);
 
         if (gEnableEnginioDebugInfo)
-            _requestData.insert(reply, data);
+            requestContext(reply)->requestData = data;
 
         return reply;
     }
 
     template<class T>
-    QNetworkReply *query(const ObjectAdaptor<T> &object, const Enginio::Operation operation)
+    QNetworkReply *query(const ObjectAdaptor<T> &object, const Enginio::Operation operation, Enginio::RequestPriority priority = Enginio::InteractivePriority)
     {
         QUrl url(_serviceUrl);
         CHECK_AND_SET_PATH(url, object, operation);
@@ -513,6 +572,11 @@ public:
             urlQuery.addQueryItem(EnginioString::sort,
                 QString::fromUtf8(sort.toJson()));
         }
+        ValueAdaptor<T> fields = object[EnginioString::fields];
+        if (fields.isComposedType()) {
+            urlQuery.addQueryItem(EnginioString::fields,
+                QString::fromUtf8(fields.toJson()));
+        }
         if (operation == Enginio::SearchOperation) {
             ValueAdaptor<T> search = object[EnginioString::search];
             ArrayAdaptor<T> objectTypes = object[EnginioString::objectTypes].toArray();
@@ -535,7 +599,31 @@ public:
         url.setQuery(urlQuery);
 
         QNetworkRequest req = prepareRequest(url);
-        return networkManager()->get(req);
+        if (_responseCache)
+            _responseCache->prepareRequest(&req);
+        const QByteArray key = EnginioSharedQueries::key(req);
+        if (QNetworkReply *shared = _sharedQueries->join(key, req, priority))
+            return shared;
+        QNetworkReply *reply = _scheduler->get(req, priority);
+        _sharedQueries->add(key, reply);
+        return reply;
+    }
+
+    template<class T>
+    bool prepareBatchOperation(const ObjectAdaptor<T> &object, const Enginio::Operation operation, QNetworkAccessManager::Operation httpOperation, QString *path, QByteArray *data, QByteArray *errorMsg)
+    {
+        // Mirrors create(), update() and remove(), but only computes the path and the payload
+        // so that the operation can be sent later as a part of a batch.
+        PathOptions flags = httpOperation == QNetworkAccessManager::PostOperation ? Default : RequireIdInPath;
+        GetPathReturnValue ret = getPath(object, operation, path, errorMsg, flags);
+        if (!ret.successful())
+            return false;
+
+        QString dataPropertyName = ret;
+        if (httpOperation == QNetworkAccessManager::DeleteOperation && operation != Enginio::AccessControlOperation)
+            return true;
+        *data = dataPropertyName.isEmpty() ? object.toJson() : object[dataPropertyName].toJson();
+        return true;
     }
 
     template<class T>
@@ -551,8 +639,10 @@ public:
         }
 
         QNetworkRequest req = prepareRequest(url);
+        if (_responseCache)
+            _responseCache->prepareRequest(&req);
 
-        QNetworkReply *reply = networkManager()->get(req);
+        QNetworkReply *reply = _scheduler->get(req, Enginio::InteractivePriority);
         return reply;
     }
 
@@ -586,15 +676,13 @@ public:
     QNetworkReply *upload(const ObjectAdaptor<T> &object, QIODevice *device, const QString &mimeType)
     {
         QNetworkReply *reply = 0;
-        if (!device->isSequential() && device->size() < _uploadChunkSize)
+        if (!device->isSequential() && device->size() < _uploadTuner.chunkSize())
             reply = uploadAsHttpMultiPart(object, device, mimeType);
         else
             reply = uploadChunked(object, device);
 
-        if (gEnableEnginioDebugInfo) {
-            QByteArray data = object.toJson();
-            _requestData.insert(reply, data);
-        }
+        if (gEnableEnginioDebugInfo)
+            requestContext(reply)->requestData = object.toJson();
 
         return reply;
     }
@@ -610,32 +698,61 @@ public:
     class UploadProgressFunctor
     {
     public:
-        UploadProgressFunctor(EnginioClientConnectionPrivate *client, QNetworkReply *reply)
-            : _client(client), _reply(reply)
+        // The connection is part of the context and is dropped together with it
+        UploadProgressFunctor(EnginioRequestContext *context)
+            : _context(context)
         {
-            Q_ASSERT(_client);
-            Q_ASSERT(_reply);
+            Q_ASSERT(_context);
         }
 
         void operator ()(qint64 progress, qint64 total)
         {
             if (!progress || !total) // TODO sometimes we get garbage as progress, it seems like a bug of Qt or Enginio web engine
                 return;
-            EnginioReplyState *ereply = _client->_replyReplyMap.value(_reply);
-            if (_client->_chunkedUploads.contains(_reply)) {
-                QPair<QIODevice*, qint64> chunkData = _client->_chunkedUploads.value(_reply);
-                total = chunkData.first->size();
-                progress += chunkData.second;
+            EnginioReplyState *ereply = _context->reply;
+            if (!ereply)
+                return;
+            if (_context->uploadDevice) {
+                total = _context->uploadDevice->size();
                 if (progress > total)  // TODO assert?!
                     return;
             }
             emit ereply->progress(progress, total);
         }
+    private:
+        EnginioRequestContext *_context;
+    };
+
+    class ChunkProgressFunctor
+    {
+    public:
+        // The connection is part of the context of the chunk and is dropped together with it
+        ChunkProgressFunctor(EnginioClientConnectionPrivate *client, EnginioChunkedUpload *upload, QNetworkReply *reply)
+            : _client(client)
+            , _upload(upload)
+            , _reply(reply)
+        {}
+
+        void operator ()(qint64 progress, qint64 total)
+        {
+            Q_UNUSED(total);
+            _upload->setSent(_reply, progress);
+            EnginioRequestContext *context = _client->findRequestContext(_upload->standIn());
+            if (context && context->reply && _upload->advanceReportedProgress(_upload->progress()))
+                emit context->reply->progress(_upload->progress(), _upload->size());
+        }
     private:
         EnginioClientConnectionPrivate *_client;
+        EnginioChunkedUpload *_upload;
         QNetworkReply *_reply;
     };
 
+    void trackUploadProgress(QNetworkReply *reply)
+    {
+        EnginioRequestContext *context = requestContext(reply);
+        context->progressConnection = QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(context));
+    }
+
     virtual void emitSessionTerminated() const;
     virtual void emitSessionAuthenticated(EnginioReplyState *reply);
     virtual void emitSessionAuthenticationError(EnginioReplyState *reply);
@@ -655,10 +772,10 @@ private:
         req.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray());
 
         QHttpMultiPart *multiPart = createHttpMultiPart(object, device, mimeType);
-        QNetworkReply *reply = networkManager()->post(req, multiPart);
+        QNetworkReply *reply = _scheduler->post(req, multiPart, Enginio::FileTransferPriority);
         multiPart->setParent(reply);
         device->setParent(multiPart);
-        _connections.append(QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(this, reply)));
+        trackUploadProgress(reply);
         return reply;
     }
 
@@ -699,13 +816,21 @@ private:
 
         QNetworkRequest req = prepareRequest(serviceUrl);
 
-        QNetworkReply *reply = networkManager()->post(req, object.toJson());
-        _chunkedUploads.insert(reply, qMakePair(device, static_cast<qint64>(0)));
-        _connections.append(QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(this, reply)));
+        QNetworkReply *reply = _scheduler->post(req, object.toJson(), Enginio::FileTransferPriority);
+        requestContext(reply)->uploadDevice = device;
+        trackUploadProgress(reply);
         return reply;
     }
 
-    void uploadChunk(EnginioReplyState *ereply, QIODevice *device, qint64 startPos);
+    void startChunkedUpload(EnginioReplyState *ereply, QIODevice *device);
+    void sendChunks(EnginioChunkedUpload *upload);
+    void sendChunk(EnginioChunkedUpload *upload, const EnginioChunkedUpload::Chunk &chunk);
+    void registerChunk(EnginioChunkedUpload *upload, QNetworkReply *reply, const EnginioChunkedUpload::Chunk &chunk);
+    bool chunkFinished(QNetworkReply *nreply, EnginioRequestContext *context);
+    void finishChunkedUpload(EnginioChunkedUpload *upload, QNetworkReply *nreply);
+    void cancelChunkedUpload(EnginioChunkedUpload *upload);
+    void journalUpload(EnginioChunkedUpload *upload, const QString &fileId);
+    void updateUploadJournal(EnginioChunkedUpload *upload, bool pending);
 };
 
 #undef CHECK_AND_SET_URL_PATH_IMPL
@@ -56,6 +56,8 @@ class ENGINIOCLIENT_EXPORT EnginioClientConnection : public QObject
     Q_PROPERTY(QUrl serviceUrl READ serviceUrl WRITE setServiceUrl NOTIFY serviceUrlChanged FINAL)
     Q_PROPERTY(EnginioIdentity *identity READ identity WRITE setIdentity NOTIFY identityChanged FINAL)
     Q_PROPERTY(Enginio::AuthenticationState authenticationState READ authenticationState NOTIFY authenticationStateChanged FINAL)
+    Q_PROPERTY(Enginio::RequestPriority queryPriority READ queryPriority WRITE setQueryPriority NOTIFY queryPriorityChanged FINAL)
+    Q_PROPERTY(Enginio::RequestPriority writePriority READ writePriority WRITE setWritePriority NOTIFY writePriorityChanged FINAL)
 
     Q_ENUMS(Enginio::Operation) // TODO remove me QTBUG-33577
     Q_ENUMS(Enginio::AuthenticationState) // TODO remove me QTBUG-33577
@@ -74,6 +76,11 @@ public:
     void setServiceUrl(const QUrl &serviceUrl);
     QNetworkAccessManager *networkManager() const Q_REQUIRED_RESULT;
 
+    Enginio::RequestPriority queryPriority() const Q_REQUIRED_RESULT;
+    void setQueryPriority(Enginio::RequestPriority priority);
+    Enginio::RequestPriority writePriority() const Q_REQUIRED_RESULT;
+    void setWritePriority(Enginio::RequestPriority priority);
+
     bool finishDelayedReplies();
 
 Q_SIGNALS:
@@ -81,6 +88,8 @@ Q_SIGNALS:
     void serviceUrlChanged(const QUrl& url);
     void authenticationStateChanged(Enginio::AuthenticationState state);
     void identityChanged(EnginioIdentity *identity);
+    void queryPriorityChanged(Enginio::RequestPriority priority);
+    void writePriorityChanged(Enginio::RequestPriority priority);
 
 protected:
     explicit EnginioClientConnection(EnginioClientConnectionPrivate &dd, QObject *parent);
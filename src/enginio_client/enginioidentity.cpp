@@ -97,7 +97,7 @@ struct DisconnectConnection
     inline void operator ()() const;
 };
 
-class EnginioUserPassAuthenticationPrivate : public EnginioIdentityPrivate
+class EnginioUserPassAuthenticationPrivate : public EnginioIdentityPrivate, public EnginioRequestOwner
 {
     template<typename T>
     class SessionSetterFunctor
@@ -124,6 +124,7 @@ class EnginioUserPassAuthenticationPrivate : public EnginioIdentityPrivate
     };
 
     QPointer<QNetworkReply> _reply;
+    EnginioClientConnectionPrivate *_enginio; // the token was asked for, valid while _reply is set
     QMetaObject::Connection _replyFinished;
     QMetaObject::Connection _enginioDestroyed;
 
@@ -131,6 +132,9 @@ public:
     QString _user;
     QString _pass;
 
+    EnginioUserPassAuthenticationPrivate()
+        : _enginio(0)
+    {}
     ~EnginioUserPassAuthenticationPrivate();
 
     template<class Derived>
@@ -139,6 +143,8 @@ public:
     void cleanupConnections()
     {
         if (_reply) {
+            // a token request that still waits in the scheduler is dropped
+            _enginio->releaseRequestContext(_reply.data());
             QObject::disconnect(_replyFinished);
             QObject::disconnect(_enginioDestroyed);
             QObject::connect(_reply.data(), &QNetworkReply::finished, _reply.data(), &QNetworkReply::deleteLater);
@@ -151,12 +157,23 @@ public:
     {
         cleanupConnections();
 
-        _reply = thisAs<Derived>()->makeRequest(enginio);
+        _enginio = enginio;
+        _reply = enginio->ownRequest(thisAs<Derived>()->makeRequest(enginio), this);
         enginio->setAuthenticationState(Enginio::Authenticating);
         _replyFinished = QObject::connect(_reply.data(), &QNetworkReply::finished, SessionSetterFunctor<Derived>(enginio, _reply.data(), this));
         _enginioDestroyed = QObject::connect(enginio->q_ptr, &EnginioClient::destroyed, DisconnectConnection(this));
     }
 
+    // the token request waited in the scheduler and is sent now
+    template<typename Derived>
+    void tokenRequestSent(QNetworkReply *queued, QNetworkReply *nreply)
+    {
+        QObject::disconnect(_replyFinished);
+        queued->deleteLater();
+        _reply = nreply;
+        _replyFinished = QObject::connect(nreply, &QNetworkReply::finished, SessionSetterFunctor<Derived>(_enginio, nreply, this));
+    }
+
     template<typename Derived>
     void removeSessionToken(EnginioClientConnectionPrivate *enginio)
     {
@@ -188,7 +205,13 @@ public:
         request.setHeader(QNetworkRequest::ContentTypeHeader, EnginioString::Application_x_www_form_urlencoded);
         request.setRawHeader(EnginioString::Accept, EnginioString::Application_json);
 
-        return enginio->networkManager()->post(request, data);
+        // somebody waits for the login
+        return enginio->_scheduler->post(request, data, Enginio::InteractivePriority);
+    }
+
+    virtual void requestSent(QNetworkReply *queued, QNetworkReply *nreply) Q_DECL_OVERRIDE
+    {
+        tokenRequestSent<EnginioOAuth2AuthenticationPrivate>(queued, nreply);
     }
 
     void proccessToken(EnginioClientConnectionPrivate *enginio, EnginioReplyState *ereply)
@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiojsonstreamreader_p.h>
+
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qjsonobject.h>
+
+QT_BEGIN_NAMESPACE
+
+EnginioJsonStreamReader::EnginioJsonStreamReader(const QString &arrayName)
+    : _arrayName('"' + arrayName.toUtf8() + '"')
+    , _state(BeforeDocument)
+    , _position(0)
+    , _depth(0)
+    , _arrayDepth(0)
+    , _elementStart(-1)
+    , _stringStart(-1)
+    , _objectCount(0)
+    , _inString(false)
+    , _escape(false)
+    , _afterColon(false)
+    , _keyMatches(false)
+{
+}
+
+void EnginioJsonStreamReader::addData(const QByteArray &data)
+{
+    if (_state == Finished || _state == Error || data.isEmpty())
+        return;
+    _buffer.append(data);
+    scan();
+}
+
+/*!
+  \internal
+  Returns the objects completed since the last call.
+*/
+QJsonArray EnginioJsonStreamReader::takeObjects()
+{
+    QJsonArray objects;
+    qSwap(objects, _objects);
+    return objects;
+}
+
+void EnginioJsonStreamReader::scan()
+{
+    const char *data = _buffer.constData();
+    const int size = _buffer.size();
+    int i = _position;
+    for (; i < size; ++i) {
+        const char c = data[i];
+        if (_inString) {
+            if (_escape) {
+                _escape = false;
+            } else if (c == '\\') {
+                _escape = true;
+            } else if (c == '"') {
+                _inString = false;
+                if (_stringStart >= 0) {
+                    const int length = i + 1 - _stringStart;
+                    _keyMatches = length == _arrayName.size()
+                            && !memcmp(data + _stringStart, _arrayName.constData(), length);
+                    _stringStart = -1;
+                }
+            }
+            continue;
+        }
+
+        switch (c) {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            continue;
+        case '"':
+            if (Q_UNLIKELY(_state == BeforeDocument)) {
+                _state = Error;
+                return;
+            }
+            _inString = true;
+            if (_depth == 1)
+                _stringStart = i;
+            break;
+        case '{':
+        case '[':
+            if (_state == BeforeDocument) {
+                if (c != '{') {
+                    _state = Error;
+                    return;
+                }
+                _state = InDocument;
+            }
+            ++_depth;
+            if (_arrayDepth) {
+                if (_depth == _arrayDepth + 1)
+                    _elementStart = i;
+            } else if (c == '[' && _depth == 2 && _afterColon && _keyMatches) {
+                _arrayDepth = _depth;
+            }
+            break;
+        case '}':
+        case ']':
+            --_depth;
+            if (Q_UNLIKELY(_depth < 0)) {
+                _state = Error;
+                return;
+            }
+            if (_arrayDepth) {
+                if (_depth == _arrayDepth && _elementStart >= 0) {
+                    parseElement(i + 1);
+                    if (_state == Error)
+                        return;
+                    _elementStart = -1;
+                } else if (_depth < _arrayDepth) {
+                    // the rest of the document is of no interest
+                    _state = Finished;
+                    _buffer.clear();
+                    _position = 0;
+                    return;
+                }
+            }
+            break;
+        default:
+            if (Q_UNLIKELY(_state == BeforeDocument)) {
+                _state = Error;
+                return;
+            }
+            break;
+        }
+        _afterColon = c == ':';
+    }
+
+    // drop everything that was handled, only a partial element or key is kept
+    int keep = i;
+    if (_elementStart >= 0)
+        keep = _elementStart;
+    else if (_stringStart >= 0)
+        keep = _stringStart;
+    if (keep) {
+        _buffer.remove(0, keep);
+        if (_elementStart >= 0)
+            _elementStart -= keep;
+        if (_stringStart >= 0)
+            _stringStart -= keep;
+    }
+    _position = i - keep;
+}
+
+void EnginioJsonStreamReader::parseElement(int end)
+{
+    const QByteArray element = QByteArray::fromRawData(_buffer.constData() + _elementStart, end - _elementStart);
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(element, &error);
+    if (Q_UNLIKELY(error.error != QJsonParseError::NoError)) {
+        _state = Error;
+        return;
+    }
+    if (document.isObject()) {
+        _objects.append(document.object());
+        ++_objectCount;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,98 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOJSONSTREAMREADER_P_H
+#define ENGINIOJSONSTREAMREADER_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  Incremental reader for the objects of one array in a JSON document.
+
+  The reader is fed with the document in arbitrary pieces through addData().
+  It scans the bytes only for structure (strings, nesting) and looks for the
+  array stored under \a arrayName in the top level object. Each complete
+  object of that array is parsed on its own and can be collected with
+  takeObjects(), so a large query result can be consumed while it is still
+  being downloaded. Bytes that were already handled are dropped, the reader
+  never keeps more than the object currently being received.
+*/
+class ENGINIOCLIENT_EXPORT EnginioJsonStreamReader
+{
+public:
+    explicit EnginioJsonStreamReader(const QString &arrayName);
+
+    void addData(const QByteArray &data);
+    QJsonArray takeObjects();
+
+    bool atEnd() const Q_REQUIRED_RESULT { return _state == Finished; }
+    bool hasError() const Q_REQUIRED_RESULT { return _state == Error; }
+    int objectCount() const Q_REQUIRED_RESULT { return _objectCount; }
+
+private:
+    enum State {
+        BeforeDocument,
+        InDocument,
+        Finished,
+        Error
+    };
+
+    void scan();
+    void parseElement(int end);
+
+    QByteArray _arrayName; // quoted, as it appears in the document
+    QByteArray _buffer;
+    QJsonArray _objects;
+    State _state;
+    int _position; // next byte of _buffer to scan
+    int _depth;
+    int _arrayDepth; // depth of the array we read, 0 until it was found
+    int _elementStart; // start of the current element in _buffer, -1 outside
+    int _stringStart; // start of the current string at depth 1 in _buffer, -1 outside
+    int _objectCount;
+    bool _inString;
+    bool _escape;
+    bool _afterColon;
+    bool _keyMatches; // the last string at depth 1 was the array name
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOJSONSTREAMREADER_P_H
@@ -44,6 +44,10 @@
 #include <QtCore/qvector.h>
 #include <QtCore/qjsonobject.h>
 #include <QtCore/qjsonarray.h>
+#include <QtCore/qmath.h>
+
+#include <algorithm>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 
@@ -153,6 +157,456 @@ EnginioBaseModelPrivate::~EnginioBaseModelPrivate()
     delete _replyConnectionConntext;
 }
 
+void EnginioBaseModelPrivate::queueNotification(const QJsonObject &data)
+{
+    if (_notificationInterval < 0) {
+        receivedNotification(data);
+        return;
+    }
+    _pendingNotifications.append(data);
+    if (!_notificationTimer.isActive())
+        _notificationTimer.start(_notificationInterval);
+}
+
+/*!
+  \internal
+  Keeps the latest updatedAt the rows were seen with, so that catching up
+  and delta refreshes do not need to scan all rows. The timestamps are ISO
+  8601 strings in UTC so they can be compared as strings. Removing a row
+  does not lower it, the model has seen that state anyway.
+*/
+void EnginioBaseModelPrivate::noteUpdatedAt(const QJsonValue &value)
+{
+    const QString updatedAt = value.toObject()[EnginioString::updatedAt].toString();
+    if (updatedAt > _latestUpdatedAt)
+        _latestUpdatedAt = updatedAt;
+}
+
+/*!
+  \internal
+  Recomputes the latest updatedAt after _data was replaced as a whole.
+*/
+void EnginioBaseModelPrivate::resetLatestUpdatedAt()
+{
+    _latestUpdatedAt.clear();
+    for (int row = 0; row < _data.count(); ++row)
+        noteUpdatedAt(_data.at(row));
+}
+
+/*!
+  \internal
+  The notification stream was down for a while. Instead of reloading
+  everything only objects changed since the latest update we know about are
+  queried, and applied like notifications. Objects removed in the meantime
+  cannot be found this way, they stay until the next full query.
+
+  Changed objects the model has no row for are only added if they were
+  created during the gap and the model holds the complete result of its
+  query. A model showing a part of the result, because of a limit, an
+  offset, paging or rows not fetched yet, can not tell where a new object
+  belongs, so it is reloaded instead. Other unknown objects are skipped,
+  like updates of unknown objects are when they arrive as notifications.
+
+  The catch up asks for the count of changes, when the backend answered
+  with fewer of them (it caps the page size) the model is reloaded as well,
+  the changes left out would be lost otherwise.
+*/
+void EnginioBaseModelPrivate::catchUp()
+{
+    ++_gapStatistics.reconnects;
+    if (!_enginio || queryIsEmpty() || _fullQueryPending)
+        return; // the answer to the full query is still to come
+
+    const QString since = lastUpdatedAt();
+    if (since.isEmpty()) {
+        EnginioReplyState *ereply = reload();
+        QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+        return;
+    }
+
+    QJsonObject query = changedSinceQuery(since);
+    query[EnginioString::count] = true; // to know whether the listing is complete
+    ObjectAdaptor<QJsonObject> aQuery(query);
+    QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation), Enginio::BackgroundPriority);
+    EnginioReplyState *ereply = _enginio->createReply(nreply);
+    FinishedCatchUpRequest finishedRequest = { this, ereply, since };
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finishedRequest);
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+}
+
+/*!
+  \internal
+  The current query with \a condition as an additional requirement,
+  without paging.
+*/
+QJsonObject EnginioBaseModelPrivate::restrictedQuery(const QJsonObject &condition) const
+{
+    QJsonObject query = queryAsJson();
+    const QJsonObject original = query[EnginioString::query].toObject();
+    if (original.isEmpty()) {
+        query[EnginioString::query] = condition;
+    } else {
+        QJsonArray both;
+        both.append(original);
+        both.append(condition);
+        QJsonObject conjunction;
+        conjunction[QStringLiteral("$and")] = both;
+        query[EnginioString::query] = conjunction;
+    }
+    // every match is wanted, not a page of them
+    query.remove(EnginioString::offset);
+    query.remove(EnginioString::limit);
+    return query;
+}
+
+/*!
+  \internal
+  The current query restricted to objects updated at or after \a since.
+*/
+QJsonObject EnginioBaseModelPrivate::changedSinceQuery(const QString &since) const
+{
+    QJsonObject changedSince;
+    // the same timestamp may be shared by several changes, seen ones are filtered later
+    changedSince[QStringLiteral("$gte")] = since;
+    QJsonObject changed;
+    changed[EnginioString::updatedAt] = changedSince;
+    return restrictedQuery(changed);
+}
+
+/*!
+  \internal
+  Returns true if the rows are all the objects matching the query, not a
+  window or a page of them.
+*/
+bool EnginioBaseModelPrivate::holdsCompleteResult() const
+{
+    const QJsonObject query = queryAsJson();
+    return !query[EnginioString::limit].toDouble() && !query[EnginioString::offset].toDouble()
+            && !_pageSize && !(_prefetch.pages && _canFetchMore);
+}
+
+void EnginioBaseModelPrivate::finishedCatchUpRequest(const EnginioReplyState *reply, const QString &since)
+{
+    if (reply->isError() || _fullQueryPending)
+        return; // a failed catch up is repeated on the next reconnect, a full query brings everything
+
+    const QJsonObject data = replyData(reply);
+    const QJsonArray results = data[EnginioString::results].toArray();
+    if (!data.contains(EnginioString::count) || results.count() < data[EnginioString::count].toDouble()) {
+        reloadAfterGap();
+        return;
+    }
+
+    const bool complete = holdsCompleteResult();
+    QVector<QJsonObject> notifications;
+    foreach (const QJsonValue &value, results) {
+        const QJsonObject object = value.toObject();
+        QJsonObject notification;
+        if (_attachedData.contains(object[EnginioString::id].toString())) {
+            notification[EnginioString::event] = EnginioString::update;
+        } else if (object[EnginioString::createdAt].toString() >= since) {
+            if (!complete) {
+                // only the backend knows where the new object belongs
+                reloadAfterGap();
+                return;
+            }
+            notification[EnginioString::event] = EnginioString::create;
+        } else {
+            continue; // outside of the rows we show, or not visible to us before
+        }
+        notification[EnginioString::data] = object;
+        notifications.append(notification);
+    }
+    _pendingNotifications += notifications;
+    applyPendingNotifications();
+
+    ++_gapStatistics.filledGaps;
+    _gapStatistics.filledObjects += results.count();
+    _gapStatistics.lastGap = results.count();
+}
+
+void EnginioBaseModelPrivate::reloadAfterGap()
+{
+    ++_gapStatistics.reloadedGaps;
+    EnginioReplyState *ereply = reload();
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+}
+
+bool EnginioBaseModelPrivate::canRefreshDelta() const
+{
+    // only a complete result can be patched, a page may gain or lose rows at its edges
+    const QJsonObject query = queryAsJson();
+    return _deltaSync && !_fieldsIgnored && !_fullQueryPending
+            && !query[EnginioString::limit].toDouble() && !query[EnginioString::offset].toDouble()
+            && !query[EnginioString::pageSize].toDouble()
+            && _syncedKey == snapshotKey(query);
+}
+
+/*!
+  \internal
+  Brings the rows of an unchanged query up to date without downloading all
+  of them again. One request asks for the objects updated since the newest
+  updatedAt in the model, another one only for the ids of all objects
+  matching the query, which tells which rows were removed and whether some
+  objects became visible without being changed (after a login for example).
+  Those are fetched by id before everything is applied at once, like a burst
+  of notifications.
+
+  The listings are only trusted when they are known to be complete: every
+  request asks for the count of matches, and a reply with fewer results than
+  that (a backend capping the page size) makes the model reload instead. A
+  backend ignoring "fields" answers the ids listing with whole objects, which
+  saves nothing, so delta refreshes are turned off for the model then.
+*/
+void EnginioBaseModelPrivate::refreshDelta()
+{
+    const QString since = lastUpdatedAt();
+    if (since.isEmpty()) {
+        EnginioReplyState *ereply = reload();
+        QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+        return;
+    }
+
+    QJsonObject ids = queryAsJson();
+    ids.remove(EnginioString::include);
+    ids.remove(EnginioString::sort);
+    ids.remove(EnginioString::offset);
+    ids.remove(EnginioString::limit);
+    QJsonArray fields;
+    fields.append(EnginioString::id);
+    ids[EnginioString::fields] = fields;
+
+    _deltaRefresh.since = since;
+    _deltaRefresh.pending = 2;
+    _deltaRefresh.changes = sendDeltaRequest(changedSinceQuery(since));
+    _deltaRefresh.ids = sendDeltaRequest(ids);
+}
+
+EnginioReplyState *EnginioBaseModelPrivate::sendDeltaRequest(const QJsonObject &query)
+{
+    QJsonObject counted = query;
+    counted[EnginioString::count] = true; // to know whether the listing is complete
+    ObjectAdaptor<QJsonObject> aQuery(counted);
+    // the rows are shown already, a newer state of them can wait
+    QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation), Enginio::BackgroundPriority);
+    EnginioReplyState *ereply = _enginio->createReply(nreply);
+    FinishedDeltaRequest finishedRequest = { this, ereply };
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finishedRequest);
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+    return ereply;
+}
+
+void EnginioBaseModelPrivate::finishedDeltaRequest(const EnginioReplyState *reply)
+{
+    DeltaRefresh &delta = _deltaRefresh;
+    if (!delta.pending || (reply != delta.changes && reply != delta.ids && reply != delta.missing))
+        return; // the refresh was replaced by a newer one
+
+    const QJsonObject data = replyData(reply);
+    const QJsonArray results = data[EnginioString::results].toArray();
+    if (reply == delta.ids && !results.isEmpty()) {
+        QJsonObject extra = results.first().toObject();
+        extra.remove(EnginioString::id);
+        extra.remove(EnginioString::objectType);
+        _fieldsIgnored = !extra.isEmpty();
+    }
+
+    // the full query decides what happens to the rows, for example after a
+    // logout, or when a listing was cut short and can not tell what is gone
+    if (reply->isError() || _fieldsIgnored
+            || !data.contains(EnginioString::count) || results.count() < data[EnginioString::count].toDouble()) {
+        EnginioReplyState *ereply = reload();
+        QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+        return;
+    }
+
+    if (reply == delta.ids) {
+        foreach (const QJsonValue &value, results)
+            delta.known.insert(value.toObject()[EnginioString::id].toString());
+    } else {
+        foreach (const QJsonValue &value, results)
+            delta.changed.append(value);
+    }
+    if (--delta.pending)
+        return;
+
+    if (!delta.missing) {
+        QSet<QString> changedIds;
+        foreach (const QJsonValue &value, delta.changed)
+            changedIds.insert(value.toObject()[EnginioString::id].toString());
+        QJsonArray missing;
+        foreach (const QString &id, delta.known) {
+            if (!changedIds.contains(id) && existingRow(id) < 0)
+                missing.append(id);
+        }
+        if (!missing.isEmpty()) {
+            QJsonObject in;
+            in[QStringLiteral("$in")] = missing;
+            QJsonObject byId;
+            byId[EnginioString::id] = in;
+            delta.pending = 1;
+            delta.missing = sendDeltaRequest(restrictedQuery(byId));
+            return;
+        }
+    }
+    applyDeltaRefresh();
+}
+
+void EnginioBaseModelPrivate::applyDeltaRefresh()
+{
+    DeltaRefresh &delta = _deltaRefresh;
+    foreach (const QJsonValue &value, delta.changed) {
+        const QJsonObject object = value.toObject();
+        const QString id = object[EnginioString::id].toString();
+        delta.known.insert(id);
+        const int row = existingRow(id);
+        if (row >= 0 && _data.at(row).toObject() == object)
+            continue; // seen already, it shares the timestamp the refresh started from
+        QJsonObject notification;
+        notification[EnginioString::event] = row >= 0 ? EnginioString::update : EnginioString::create;
+        notification[EnginioString::data] = object;
+        _pendingNotifications.append(notification);
+    }
+
+    for (int row = 0; row < _data.count(); ++row) {
+        if (!_attachedData.isSynced(row))
+            continue; // our own request will tell what happened to it
+        const QJsonObject object = _data.at(row).toObject();
+        const QString id = object[EnginioString::id].toString();
+        // rows changed after "since" came with notifications sent after the ids were listed
+        if (delta.known.contains(id) || object[EnginioString::updatedAt].toString() > delta.since)
+            continue;
+        QJsonObject removed;
+        removed[EnginioString::id] = id;
+        QJsonObject notification;
+        notification[EnginioString::event] = EnginioString::_delete;
+        notification[EnginioString::data] = removed;
+        _pendingNotifications.append(notification);
+    }
+
+    cancelDeltaRefresh();
+    applyPendingNotifications();
+}
+
+void EnginioBaseModelPrivate::cancelDeltaRefresh()
+{
+    DeltaRefresh none = { 0, 0, 0, QString(), QJsonArray(), QSet<QString>(), 0 };
+    _deltaRefresh = none;
+}
+
+namespace {
+struct CoalescedChange
+{
+    QJsonObject object;
+    bool removed;
+    bool created;
+};
+}
+
+/*!
+  \internal
+  Applies the queued notifications. Changes of the same object are merged into
+  one and the model is changed with as few signals as possible: one
+  beginRemoveRows() per run of removed rows, one dataChanged() per run of
+  updated rows and one beginInsertRows() for all created objects.
+*/
+void EnginioBaseModelPrivate::applyPendingNotifications()
+{
+    _notificationTimer.stop();
+    if (_pendingNotifications.count() < 2) {
+        if (!_pendingNotifications.isEmpty())
+            receivedNotification(_pendingNotifications.takeFirst());
+        return;
+    }
+
+    QVector<QJsonObject> notifications;
+    notifications.swap(_pendingNotifications);
+
+    QVector<QString> ids; // in the order of arrival
+    QHash<QString, CoalescedChange> changes;
+    foreach (const QJsonObject &data, notifications) {
+        const QJsonObject origin = data[EnginioString::origin].toObject();
+        const QString requestId = origin[EnginioString::apiRequestId].toString();
+        if (_attachedData.markRequestIdAsHandled(requestId))
+            continue; // request was handled
+
+        const QJsonObject object = data[EnginioString::data].toObject();
+        const QString event = data[EnginioString::event].toString();
+        if (event == EnginioString::create) {
+            const int rowHint = _attachedData.rowFromRequestId(requestId);
+            if (rowHint != NoHintRow) {
+                // our own create, the dummy row gets the real object right away
+                receivedUpdateNotification(object, QString(), rowHint);
+                continue;
+            }
+        } else if (event != EnginioString::update && event != EnginioString::_delete) {
+            continue;
+        }
+
+        const QString id = object[EnginioString::id].toString();
+        QHash<QString, CoalescedChange>::iterator change = changes.find(id);
+        if (change == changes.end()) {
+            CoalescedChange initial = { QJsonObject(), false, false };
+            change = changes.insert(id, initial);
+            ids.append(id);
+        }
+        change->object = object;
+        change->removed = event == EnginioString::_delete;
+        change->created = change->created || event == EnginioString::create;
+    }
+
+    QVector<int> removedRows;
+    QVector<QString> updatedIds;
+    QJsonArray created;
+    foreach (const QString &id, ids) {
+        const CoalescedChange &change = changes[id];
+        const int row = existingRow(id);
+        if (row < 0) {
+            // objects without a row need no change at all, unless they are (again) created
+            if (change.created && !change.removed)
+                created.append(change.object);
+            continue;
+        }
+        if (change.removed)
+            removedRows.append(row);
+        else
+            updatedIds.append(id);
+    }
+
+    if (!removedRows.isEmpty())
+        removeRows(removedRows);
+
+    if (_data.count() == 1) {
+        // updating the only row resets the model, nothing to coalesce
+        foreach (const QString &id, updatedIds)
+            receivedUpdateNotification(changes[id].object, id);
+        updatedIds.clear();
+    }
+    QVector<int> updatedRows;
+    updatedRows.reserve(updatedIds.count());
+    foreach (const QString &id, updatedIds) {
+        const int row = _attachedData.rowFromObjectId(id);
+        const QJsonObject &object = changes[id].object;
+        if (row < 0 || !isNewerThanRow(object, row))
+            continue;
+        replaceRowObject(object, row);
+        updatedRows.append(row);
+    }
+    std::sort(updatedRows.begin(), updatedRows.end());
+    emitDataChanged(updatedRows);
+
+    if (!created.isEmpty()) {
+        const int first = _data.count();
+        q->beginInsertRows(QModelIndex(), first, first + created.count() - 1);
+        for (int i = 0; i < created.count(); ++i) {
+            const QJsonValue object = created.at(i);
+            _attachedData.insert(AttachedData(first + i, object.toObject()[EnginioString::id].toString()));
+            appendRow(object);
+        }
+        q->endInsertRows();
+    }
+}
+
 void EnginioBaseModelPrivate::receivedNotification(const QJsonObject &data)
 {
     const QJsonObject origin = data[EnginioString::origin].toObject();
@@ -189,20 +643,47 @@ void EnginioBaseModelPrivate::receivedRemoveNotification(const QJsonObject &obje
     if (Q_UNLIKELY(row == DeletedRow))
         return;
 
-    q->beginRemoveRows(QModelIndex(), row, row);
-    _data.removeAt(row);
-    // we need to updates rows in _attachedData
-    _attachedData.updateAllDataAfterRowRemoval(row);
+    removeRows(row, 1);
+}
+
+void EnginioBaseModelPrivate::removeRows(int first, int count)
+{
+    Q_ASSERT(count > 0 && first >= 0 && first + count <= _data.count());
+    q->beginRemoveRows(QModelIndex(), first, first + count - 1);
+    for (int row = first + count - 1; row >= first; --row)
+        _data.removeAt(row);
+    if (_columnStorage)
+        _columns.remove(first, count);
+    _attachedData.removeRows(first, count);
     q->endRemoveRows();
 }
 
+/*!
+  \internal
+  Removes \a rows, one beginRemoveRows() and endRemoveRows() pair per
+  run of adjacent rows.
+*/
+void EnginioBaseModelPrivate::removeRows(QVector<int> rows)
+{
+    // from the bottom, so the rows above keep their position
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    for (int i = 0; i < rows.count();) {
+        const int last = rows[i];
+        int first = last;
+        while (++i < rows.count() && rows[i] == first - 1)
+            first = rows[i];
+        removeRows(first, last - first + 1);
+    }
+}
+
 void EnginioBaseModelPrivate::receivedUpdateNotification(const QJsonObject &object, const QString &idHint, int row)
 {
     // update an existing object
     if (row == NoHintRow) {
         QString id = idHint.isEmpty() ? object[EnginioString::id].toString() : idHint;
-        Q_ASSERT(_attachedData.contains(id));
-        row = _attachedData.rowFromObjectId(id);
+        row = existingRow(id);
+
     }
     if (Q_UNLIKELY(row == DeletedRow))
         return;
@@ -211,14 +692,34 @@ void EnginioBaseModelPrivate::receivedUpdateNotification(const QJsonObject &obje
     // we should create a createNotification.
     if (Q_UNLIKELY(row < 0))
         return;
+    if (_pageSize && _data.at(row).isNull())
+        return; // an evicted row, its page brings the object when it is loaded again
 
-    QJsonObject current = _data[row].toObject();
-    QDateTime currentUpdateAt = QDateTime::fromString(current[EnginioString::updatedAt].toString(), Qt::ISODate);
-    QDateTime newUpdateAt = QDateTime::fromString(object[EnginioString::updatedAt].toString(), Qt::ISODate);
-    if (newUpdateAt < currentUpdateAt) {
+    if (!isNewerThanRow(object, row)) {
         // we already have a newer version
         return;
     }
+    if (_data.count() == 1) {
+        q->beginResetModel();
+        replaceRowObject(object, row);
+        syncRoles();
+        q->endResetModel();
+    } else {
+        replaceRowObject(object, row);
+        emit q->dataChanged(q->index(row), q->index(row));
+    }
+}
+
+bool EnginioBaseModelPrivate::isNewerThanRow(const QJsonObject &object, int row) const
+{
+    QJsonObject current = _data[row].toObject();
+    QDateTime currentUpdateAt = QDateTime::fromString(current[EnginioString::updatedAt].toString(), Qt::ISODate);
+    QDateTime newUpdateAt = QDateTime::fromString(object[EnginioString::updatedAt].toString(), Qt::ISODate);
+    return !(newUpdateAt < currentUpdateAt);
+}
+
+void EnginioBaseModelPrivate::replaceRowObject(const QJsonObject &object, int row)
+{
     if (_data[row].toObject()[EnginioString::id].toString().isEmpty()) {
         // Create and update may go through the same code path because
         // the model already have a dummy item. No id means that it
@@ -227,14 +728,18 @@ void EnginioBaseModelPrivate::receivedUpdateNotification(const QJsonObject &obje
         AttachedData newData(row, newId);
         _attachedData.insert(newData);
     }
-    if (_data.count() == 1) {
-        q->beginResetModel();
-        _data.replace(row, object);
-        syncRoles();
-        q->endResetModel();
-    } else {
-        _data.replace(row, object);
-        emit q->dataChanged(q->index(row), q->index(row));
+    replaceRow(row, object);
+}
+
+void EnginioBaseModelPrivate::emitDataChanged(const QVector<int> &sortedRows)
+{
+    // one signal per range of adjacent rows
+    for (int i = 0; i < sortedRows.count();) {
+        const int first = sortedRows[i];
+        int last = first;
+        while (++i < sortedRows.count() && sortedRows[i] <= last + 1)
+            last = sortedRows[i];
+        emit q->dataChanged(q->index(first), q->index(last));
     }
 }
 
@@ -242,25 +747,576 @@ void EnginioBaseModelPrivate::fullQueryReset(const QJsonArray &data)
 {
     delete _replyConnectionConntext;
     _replyConnectionConntext = new QObject();
+    _fullQueryStream.reset();
+    _requestedPages.clear(); // their replies went with the connection context
+    // rows of a paged model are mostly placeholders, there is nothing to match
+    if (_pageSize || !applyDiff(data))
+        resetData(data);
+}
+
+/*!
+  \internal
+  Turns the rows into \a data matching the objects by id: rows of vanished
+  objects are removed, the remaining rows are put into the new order with a
+  single layout change, new objects are inserted and changed rows get
+  dataChanged, so views keep their delegates, selection and scroll position.
+  Matching the ids and reordering are O(n); counting the rows that are out
+  of place, with a longest increasing subsequence, is O(n log n).
+
+  Returns false, without touching the rows, if a reset is the better choice:
+  when there were no rows, when \a data brings new roles or when more than
+  _resetThreshold of the rows would be removed, inserted or moved.
+*/
+bool EnginioBaseModelPrivate::applyDiff(const QJsonArray &data)
+{
+    // keep the request id bookkeeping of queued notifications in order
+    applyPendingNotifications();
+
+    const int oldCount = _data.count();
+    const int newCount = data.count();
+    if (!oldCount || !newCount || _resetThreshold <= 0)
+        return false;
+
+    const QJsonObject firstObject = data.first().toObject();
+    const QSet<QString> roles = _roles.values().toSet();
+    for (QJsonObject::const_iterator i = firstObject.constBegin(); i != firstObject.constEnd(); ++i) {
+        if (!roles.contains(i.key()))
+            return false; // only a reset announces new roles
+    }
+
+    QHash<QString, int> targets; // object id -> row in data
+    targets.reserve(newCount);
+    for (int row = 0; row < newCount; ++row) {
+        const QString id = data.at(row).toObject()[EnginioString::id].toString();
+        if (id.isEmpty() || targets.contains(id))
+            return false;
+        targets.insert(id, row);
+    }
+
+    QVector<int> removedRows;
+    QVector<int> kept; // the target of every row that stays, in the current order
+    QVector<bool> isKept(newCount, false);
+    kept.reserve(qMin(oldCount, newCount));
+    for (int row = 0; row < oldCount; ++row) {
+        const int target = targets.value(_data.at(row).toObject()[EnginioString::id].toString(), -1);
+        if (target < 0 || isKept[target]) {
+            removedRows.append(row);
+        } else {
+            isKept[target] = true;
+            kept.append(target);
+        }
+    }
+
+    // rows in the longest increasing run of targets keep their place, the others move
+    QVector<int> tails; // tails[n]: the smallest last target of an increasing run of length n + 1
+    foreach (int target, kept) {
+        int low = 0;
+        int high = tails.count();
+        while (low < high) {
+            const int middle = (low + high) / 2;
+            if (tails[middle] < target)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low == tails.count())
+            tails.append(target);
+        else
+            tails[low] = target;
+    }
+
+    const int moved = kept.count() - tails.count();
+    const int inserted = newCount - kept.count();
+    if (removedRows.count() + inserted + moved > _resetThreshold * qMax(oldCount, newCount))
+        return false;
+
+    if (!removedRows.isEmpty())
+        removeRows(removedRows);
+
+    if (moved) {
+        QVector<int> rowOfTarget(newCount, -1);
+        for (int row = 0; row < kept.count(); ++row)
+            rowOfTarget[kept[row]] = row;
+        QVector<int> order; // new row -> current row
+        QVector<int> newRows(kept.count()); // current row -> new row
+        order.reserve(kept.count());
+        for (int target = 0; target < newCount; ++target) {
+            if (!isKept[target])
+                continue;
+            newRows[rowOfTarget[target]] = order.count();
+            order.append(rowOfTarget[target]);
+        }
+
+        emit q->layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+        const QModelIndexList from = q->persistentIndexList();
+        QModelIndexList to;
+        to.reserve(from.count());
+        foreach (const QModelIndex &index, from)
+            to.append(q->index(newRows[index.row()]));
+        permuteRows(order);
+        q->changePersistentIndexList(from, to);
+        emit q->layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    }
+
+    // the kept rows are in the order of data now, new objects fill the gaps
+    for (int first = 0; first < newCount;) {
+        if (isKept[first]) {
+            ++first;
+            continue;
+        }
+        int last = first;
+        while (last + 1 < newCount && !isKept[last + 1])
+            ++last;
+        QVector<QString> ids;
+        ids.reserve(last - first + 1);
+        q->beginInsertRows(QModelIndex(), first, last);
+        for (int row = first; row <= last; ++row) {
+            insertRow(row, data.at(row));
+            ids.append(data.at(row).toObject()[EnginioString::id].toString());
+        }
+        _attachedData.insertRows(first, ids);
+        q->endInsertRows();
+        first = last + 1;
+    }
+
+    QVector<int> changedRows;
+    for (int row = 0; row < newCount; ++row) {
+        if (isKept[row] && _data.at(row) != data.at(row)) {
+            replaceRow(row, data.at(row));
+            changedRows.append(row);
+        }
+    }
+    emitDataChanged(changedRows);
+
+    updateCanFetchMore();
+    return true;
+}
+
+void EnginioBaseModelPrivate::resetData(const QJsonArray &data)
+{
+    // keep the request id bookkeeping of queued notifications in order
+    applyPendingNotifications();
     q->beginResetModel();
     _data = data;
+    resetLatestUpdatedAt();
     _attachedData.initFromArray(_data);
     syncRoles();
-    _canFetchMore = _canFetchMore && _data.count() && (queryData(EnginioString::limit).toDouble() <= _data.count());
+    updateCanFetchMore();
     q->endResetModel();
 }
 
+void EnginioBaseModelPrivate::updateCanFetchMore()
+{
+    // a first page that is not full is all there is
+    _canFetchMore = _canFetchMore && _data.count() && _prefetch.firstPage <= _data.count();
+}
+
+void EnginioBaseModelPrivate::resetPrefetch(int firstPage)
+{
+    _prefetch.firstPage = firstPage;
+    _prefetch.fetchedEnd = firstPage;
+    _prefetch.requestedEnd = firstPage;
+    _prefetch.end = -1;
+    _prefetch.inFlight.clear();
+    _prefetch.arrived.clear();
+    _prefetch.failed.clear();
+    _prefetch.latency = 0;
+    _prefetch.throughput = 0;
+    _prefetch.demand = 0;
+    _prefetch.lastFetchTime = -1;
+    _prefetch.lastFetchRows = 0;
+    _canFetchMore = _prefetch.pages > 0;
+}
+
+/*!
+  \internal
+  Keeps _prefetch.pages requests ahead of the rows in the model. Views call
+  this when they get close to the last row, the time between the calls and
+  the rows added meanwhile tell how fast rows are taken.
+*/
+void EnginioBaseModelPrivate::fetchMore(int row)
+{
+    Q_UNUSED(row); // the parent of a list row, not a row of the list
+    if (!_canFetchMore || _fullQueryPending || !_enginio)
+        return;
+
+    const qint64 now = _prefetch.clock.elapsed();
+    const int rows = _data.count();
+    if (_prefetch.lastFetchTime >= 0 && now > _prefetch.lastFetchTime && rows > _prefetch.lastFetchRows) {
+        const qreal demand = qreal(rows - _prefetch.lastFetchRows) / (now - _prefetch.lastFetchTime);
+        _prefetch.demand = _prefetch.demand ? 0.7 * _prefetch.demand + 0.3 * demand : demand;
+    }
+    _prefetch.lastFetchTime = now;
+    _prefetch.lastFetchRows = rows;
+
+    while (_prefetch.inFlight.count() < _prefetch.pages) {
+        if (!_prefetch.failed.isEmpty()) {
+            const QPair<int, int> page = _prefetch.failed.takeFirst();
+            sendPrefetchRequest(page.first, page.second);
+            continue;
+        }
+        if (_prefetch.end >= 0 && _prefetch.requestedEnd >= _prefetch.end)
+            break;
+        const int limit = prefetchPageSize();
+        sendPrefetchRequest(_prefetch.requestedEnd, limit);
+        _prefetch.requestedEnd += limit;
+    }
+}
+
+void EnginioBaseModelPrivate::sendPrefetchRequest(int offset, int limit)
+{
+    QJsonObject query(queryAsJson());
+    query[EnginioString::offset] = offset;
+    query[EnginioString::limit] = limit;
+    _prefetch.inFlight.insert(offset, _prefetch.clock.elapsed());
+
+    ObjectAdaptor<QJsonObject> aQuery(query);
+    QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation));
+    EnginioReplyState *ereply = _enginio->createReply(nreply);
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+    FinishedIncrementalUpdateRequest finishedRequest = { this, query, ereply };
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finishedRequest);
+}
+
+/*!
+  \internal
+  The limit of the next fetchMore() request. While a request is on its way
+  the views take demand * latency rows, spread over the pages in flight,
+  with some headroom. When the views take rows faster than the backend
+  delivers them, fewer and larger requests save the per request overhead.
+  Until anything was measured it is the size of the first page.
+*/
+int EnginioBaseModelPrivate::prefetchPageSize() const
+{
+    int size = _prefetch.firstPage;
+    if (_prefetch.latency > 0 && _prefetch.demand > 0) {
+        size = qCeil(1.5 * _prefetch.demand * _prefetch.latency / _prefetch.pages);
+        if (_prefetch.demand > _prefetch.throughput * _prefetch.pages)
+            size *= 2;
+    }
+    return qBound(int(MinimalPrefetchPageSize), size, int(MaximalPrefetchPageSize));
+}
+
+void EnginioBaseModelPrivate::finishedIncrementalUpdateRequest(const EnginioReplyState *reply, const QJsonObject &query)
+{
+    const int offset = query[EnginioString::offset].toInt();
+    const int limit = query[EnginioString::limit].toInt();
+    if (!_prefetch.inFlight.contains(offset))
+        return; // sent before the last reload
+    const qint64 elapsed = qMax(Q_INT64_C(1), _prefetch.clock.elapsed() - _prefetch.inFlight.take(offset));
+    if (reply->isError()) {
+        _prefetch.failed.append(qMakePair(offset, limit));
+        return;
+    }
+
+    const QJsonArray rows = replyData(reply)[EnginioString::results].toArray();
+    _prefetch.latency = _prefetch.latency ? 0.7 * _prefetch.latency + 0.3 * elapsed : elapsed;
+    const qreal throughput = qreal(rows.count()) / elapsed;
+    _prefetch.throughput = _prefetch.throughput ? 0.7 * _prefetch.throughput + 0.3 * throughput : throughput;
+    receivedPage(offset, limit, rows);
+}
+
+/*!
+  \internal
+  Appends the page at \a offset, and the ones that arrived before it and
+  were waiting for it, once all earlier pages are in the model. A page
+  with fewer than \a limit rows is the last one.
+*/
+void EnginioBaseModelPrivate::receivedPage(int offset, int limit, const QJsonArray &rows)
+{
+    if (rows.count() < limit) {
+        const int end = offset + rows.count();
+        _prefetch.end = _prefetch.end < 0 ? end : qMin(_prefetch.end, end);
+    }
+    Prefetch::Page page = { limit, rows };
+    _prefetch.arrived.insert(offset, page);
+
+    while (!_prefetch.arrived.isEmpty() && _prefetch.arrived.firstKey() <= _prefetch.fetchedEnd
+           && (_prefetch.end < 0 || _prefetch.fetchedEnd < _prefetch.end)) {
+        const int pageOffset = _prefetch.arrived.firstKey();
+        page = _prefetch.arrived.take(pageOffset);
+        // objects created meanwhile may be in the model already
+        QJsonArray fresh;
+        for (int i = _prefetch.fetchedEnd - pageOffset; i < page.rows.count(); ++i) {
+            const QJsonValue value = page.rows.at(i);
+            if (existingRow(value.toObject()[EnginioString::id].toString()) < 0)
+                fresh.append(value);
+        }
+        if (!fresh.isEmpty()) {
+            const int first = _data.count();
+            q->beginInsertRows(QModelIndex(), first, first + fresh.count() - 1);
+            for (int i = 0; i < fresh.count(); ++i) {
+                const QJsonValue value = fresh.at(i);
+                appendRow(value);
+                _attachedData.insert(AttachedData(first + i, value.toObject()[EnginioString::id].toString()));
+            }
+            q->endInsertRows();
+        }
+        _prefetch.fetchedEnd = qMax(_prefetch.fetchedEnd, pageOffset + page.limit);
+    }
+
+    if (_prefetch.end >= 0 && _prefetch.fetchedEnd >= _prefetch.end) {
+        _prefetch.arrived.clear();
+        _prefetch.failed.clear();
+        _canFetchMore = false;
+    }
+}
+
+QJsonObject EnginioBaseModelPrivate::pageQuery(int page) const
+{
+    QJsonObject query = queryAsJson();
+    query.remove(EnginioString::pageSize);
+    query[EnginioString::offset] = page * _pageSize;
+    query[EnginioString::limit] = _pageSize;
+    if (!page)
+        query[EnginioString::count] = true; // the size of the whole model
+    return query;
+}
+
+/*!
+  \internal
+  Extends the first page, which is in the model already, to \a total rows.
+  The added rows are placeholders without an object, data() returns an
+  invalid QVariant for them until their page is loaded.
+*/
+void EnginioBaseModelPrivate::appendPlaceholders(int total)
+{
+    _loadedPages.clear();
+    _loadedPages.insert(0);
+    _viewportFirstPage = _viewportLastPage = 0;
+    const int first = _data.count();
+    if (total <= first)
+        return;
+    q->beginInsertRows(QModelIndex(), first, total - 1);
+    for (int row = first; row < total; ++row) {
+        appendRow(QJsonValue());
+        _attachedData.insert(AttachedData(row));
+    }
+    q->endInsertRows();
+}
+
+/*!
+  \internal
+  Called by data() for every row a view asks for, so it only remembers the
+  first and the last of them. The pages are requested and evicted once per
+  event loop pass, see updateViewport().
+*/
+void EnginioBaseModelPrivate::touchRow(int row) const
+{
+    if (_touchedFirstRow < 0) {
+        _touchedFirstRow = _touchedLastRow = row;
+        _viewportTimer.start();
+        return;
+    }
+    _touchedFirstRow = qMin(_touchedFirstRow, row);
+    _touchedLastRow = qMax(_touchedLastRow, row);
+}
+
+/*!
+  \internal
+  The pages of the rows touched since the last call become the viewport,
+  they and their neighbours are requested if they are not loaded yet.
+  Memory stays bounded because the pages farthest from the viewport are
+  evicted, see evictPages().
+*/
+void EnginioBaseModelPrivate::updateViewport()
+{
+    const int firstRow = _touchedFirstRow;
+    const int lastRow = _touchedLastRow;
+    _touchedFirstRow = _touchedLastRow = -1;
+    if (!_pageSize || firstRow < 0)
+        return; // the query changed in the meantime
+    _viewportFirstPage = firstRow / _pageSize;
+    _viewportLastPage = lastRow / _pageSize;
+    for (int page = _viewportFirstPage; page <= _viewportLastPage; ++page)
+        requestPage(page);
+    requestPage(_viewportLastPage + 1);
+    requestPage(_viewportFirstPage - 1);
+    evictPages();
+}
+
+int EnginioBaseModelPrivate::viewportDistance(int page) const
+{
+    if (page < _viewportFirstPage)
+        return _viewportFirstPage - page;
+    return qMax(0, page - _viewportLastPage);
+}
+
+void EnginioBaseModelPrivate::requestPage(int page)
+{
+    if (page < 0 || page * _pageSize >= _data.count()
+            || _loadedPages.contains(page) || _requestedPages.contains(page)
+            || !_enginio || _fullQueryPending)
+        return;
+    _requestedPages.insert(page);
+    QJsonObject query = pageQuery(page);
+    ObjectAdaptor<QJsonObject> aQuery(query);
+    QNetworkReply *nreply = _enginio->query(aQuery, static_cast<Enginio::Operation>(_operation));
+    EnginioReplyState *ereply = _enginio->createReply(nreply);
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, ereply, &EnginioReplyState::deleteLater);
+    FinishedPageRequest finishedRequest = { this, ereply, page };
+    QObject::connect(ereply, &EnginioReplyState::dataChanged, _replyConnectionConntext, finishedRequest);
+}
+
+void EnginioBaseModelPrivate::finishedPageRequest(const EnginioReplyState *reply, int page)
+{
+    _requestedPages.remove(page);
+    if (reply->isError())
+        return; // a later updateViewport() asks again
+    const QJsonArray results = replyData(reply)[EnginioString::results].toArray();
+    const int first = page * _pageSize;
+    // the collection may have changed since the count was taken
+    const int count = qMin(results.count(), _data.count() - first);
+    for (int i = 0; i < count; ++i) {
+        const int row = first + i;
+        if (!_attachedData.isSynced(row))
+            continue; // a local change is on its way, the notification brings the object
+        const QJsonObject object = results[i].toObject();
+        _attachedData.setObjectId(row, object[EnginioString::id].toString());
+        replaceRow(row, object);
+    }
+    _loadedPages.insert(page);
+    if (count > 0)
+        emit q->dataChanged(q->index(first), q->index(first + count - 1));
+    evictPages();
+}
+
+/*!
+  \internal
+  Turns the rows of the pages farthest from the viewport back into
+  placeholders while more than _maximalLoadedPages are loaded. The
+  viewport pages and their neighbours are never evicted.
+
+  Evicted rows keep the id of their object, so a remote removal still
+  removes the row. Remote updates of them are not applied, the page brings
+  the current objects when it is loaded again.
+*/
+void EnginioBaseModelPrivate::evictPages()
+{
+    while (_loadedPages.count() > _maximalLoadedPages) {
+        int farthest = _viewportFirstPage;
+        foreach (int page, _loadedPages) {
+            if (viewportDistance(page) > viewportDistance(farthest))
+                farthest = page;
+        }
+        if (viewportDistance(farthest) <= 1)
+            return;
+        _loadedPages.remove(farthest);
+        const int first = farthest * _pageSize;
+        const int last = qMin(first + _pageSize, _data.count()) - 1;
+        for (int row = first; row <= last; ++row) {
+            if (_attachedData.isSynced(row))
+                replaceRow(row, QJsonValue());
+        }
+        if (first <= last)
+            emit q->dataChanged(q->index(first), q->index(last));
+    }
+}
+
+/*!
+  \internal
+  Gives the part of the full query result received so far to the stream
+  reader. If the model was empty when the first objects arrived, they are
+  inserted right away, otherwise they are kept for a single reset once the
+  whole result is there.
+*/
+void EnginioBaseModelPrivate::receivedFullQueryData(const EnginioReplyState *reply)
+{
+    FullQueryStream *stream = _fullQueryStream.data();
+    if (!stream || stream->reply != reply)
+        return;
+
+    EnginioReplyStatePrivate *replyPrivate = EnginioReplyStatePrivate::get(const_cast<EnginioReplyState*>(reply));
+    if (replyPrivate->_nreply != stream->networkReply) {
+        // the request was sent again, the result is read at the end
+        _fullQueryStream.reset();
+        return;
+    }
+
+    const QByteArray &body = replyPrivate->readAvailableData();
+    if (body.size() > stream->consumed) {
+        stream->reader.addData(QByteArray::fromRawData(body.constData() + stream->consumed, body.size() - stream->consumed));
+        stream->consumed = body.size();
+    }
+    if (stream->reader.hasError()) {
+        _fullQueryStream.reset();
+        return;
+    }
+
+    const QJsonArray objects = stream->reader.takeObjects();
+    if (objects.isEmpty())
+        return;
+
+    if (stream->mode == FullQueryStream::Undecided)
+        stream->mode = _data.isEmpty() ? FullQueryStream::Progressive : FullQueryStream::Collecting;
+
+    if (stream->mode == FullQueryStream::Collecting) {
+        foreach (const QJsonValue &object, objects)
+            stream->rows.append(object);
+        return;
+    }
+
+    if (Q_UNLIKELY(_data.count() != stream->insertedRows)) {
+        // The model was changed in the meantime (an append or a notification),
+        // the whole result will be applied at once.
+        _fullQueryStream.reset();
+        return;
+    }
+    appendStreamedRows(objects);
+    stream->insertedRows = _data.count();
+}
+
+EnginioBaseModelPrivate::FullQueryStreamResult EnginioBaseModelPrivate::finishFullQueryStream(const EnginioReplyState *reply, QJsonArray *rows)
+{
+    if (!_fullQueryStream || _fullQueryStream->reply != reply || reply->isError()) {
+        _fullQueryStream.reset();
+        return NotStreamed;
+    }
+
+    receivedFullQueryData(reply); // the rest of the body
+    QScopedPointer<FullQueryStream> stream(_fullQueryStream.take());
+    if (!stream || !stream->reader.atEnd())
+        return NotStreamed;
+    if (stream->mode == FullQueryStream::Progressive)
+        return _data.count() == stream->insertedRows ? StreamInserted : NotStreamed;
+    *rows = stream->rows;
+    return StreamCollected;
+}
+
+void EnginioBaseModelPrivate::appendStreamedRows(const QJsonArray &rows)
+{
+    const int first = _data.count();
+    if (!first) {
+        // the first rows define the roles
+        q->beginResetModel();
+        _data = rows;
+        resetLatestUpdatedAt();
+        _attachedData.initFromArray(_data);
+        syncRoles();
+        q->endResetModel();
+        return;
+    }
+
+    q->beginInsertRows(QModelIndex(), first, first + rows.count() - 1);
+    for (int i = 0; i < rows.count(); ++i) {
+        const QJsonValue object = rows.at(i);
+        _attachedData.insert(AttachedData(first + i, object.toObject()[EnginioString::id].toString()));
+        appendRow(object);
+    }
+    q->endInsertRows();
+}
+
 void EnginioBaseModelPrivate::receivedCreateNotification(const QJsonObject &object)
 {
     // create a new object
     QString id = object[EnginioString::id].toString();
-    Q_ASSERT(!_attachedData.contains(id));
+    Q_ASSERT(existingRow(id) < 0);
     AttachedData data;
     data.row = _data.count();
     data.id = id;
     q->beginInsertRows(QModelIndex(), _data.count(), _data.count());
     _attachedData.insert(data);
-    _data.append(object);
+    appendRow(object);
     q->endInsertRows();
 }
 
@@ -303,6 +1359,10 @@ void EnginioBaseModelPrivate::syncRoles()
             _roles[_rolesCounter++] = i.key();
         }
     }
+
+    // roles may have been added, so the columns are rebuilt
+    if (_columnStorage)
+        _columns.reset(_data, _roles);
 }
 
 #ifndef QT_NO_DEBUG_STREAM
@@ -452,6 +1512,218 @@ void EnginioModel::setQuery(const QJsonObject &query)
     return d->setQuery(query);
 }
 
+/*!
+  \property EnginioModel::snapshotDirectory
+  \brief The directory where the model keeps a snapshot of its rows
+
+  When set, the result of every full query is written to a snapshot file in
+  this directory, keyed by the backend, the \l operation and the \l query. The
+  next time the same query is executed, for example on the next start of the
+  application, the rows are shown from the snapshot right away and replaced
+  once the backend answers. If the query fails, the rows of the snapshot are
+  kept.
+
+  The snapshot is not encrypted and does not depend on the logged in user,
+  applications showing user specific data should use a directory per user.
+  By default the property is empty and no snapshots are used.
+*/
+QString EnginioModel::snapshotDirectory() const
+{
+    Q_D(const EnginioModel);
+    return d->snapshotDirectory();
+}
+
+void EnginioModel::setSnapshotDirectory(const QString &directory)
+{
+    Q_D(EnginioModel);
+    if (directory == d->snapshotDirectory())
+        return;
+    d->setSnapshotDirectory(directory);
+    emit snapshotDirectoryChanged(directory);
+}
+
+/*!
+  \property EnginioModel::columnStorage
+  \brief Whether the model keeps the value of every role in a separate column
+
+  By default data() looks the requested property up in the JSON object of the
+  row every time it is called. With this property set, the values of all roles
+  are extracted once, when the rows arrive or change, and data() only needs an
+  array access. This speeds up views showing many roles of many rows, at the
+  cost of memory for one QVariant per role and row. The values returned by
+  data() are the same in both modes.
+
+  By default the property is false.
+*/
+bool EnginioModel::columnStorage() const
+{
+    Q_D(const EnginioModel);
+    return d->columnStorage();
+}
+
+void EnginioModel::setColumnStorage(bool enabled)
+{
+    Q_D(EnginioModel);
+    if (enabled == d->columnStorage())
+        return;
+    d->setColumnStorage(enabled);
+    emit columnStorageChanged(enabled);
+}
+
+/*!
+  \property EnginioModel::notificationInterval
+  \brief How long, in milliseconds, backend notifications are collected before they are applied
+
+  Notifications about objects created, updated or removed by other clients
+  are not applied one by one. They are collected, changes of the same object
+  are merged, and the model emits one signal per range of adjacent rows, so
+  views relayout once for a whole burst of changes.
+
+  The default value 0 collects the notifications arriving within one pass of
+  the event loop. A larger value trades latency for fewer updates, a negative
+  value applies every notification as soon as it arrives.
+*/
+int EnginioModel::notificationInterval() const
+{
+    Q_D(const EnginioModel);
+    return d->notificationInterval();
+}
+
+void EnginioModel::setNotificationInterval(int interval)
+{
+    Q_D(EnginioModel);
+    if (interval == d->notificationInterval())
+        return;
+    d->setNotificationInterval(interval);
+    emit notificationIntervalChanged(interval);
+}
+
+/*!
+  \property EnginioModel::deltaSync
+  \brief Whether a refresh of an unchanged query only fetches what changed
+
+  The model executes its query again when the query, the client, its backend
+  or the authentication state change. Normally all rows are downloaded again
+  and the model is reset. With this property set, and if the rows of the very
+  same query are already in the model, only objects updated since the newest
+  one in the model are requested, together with the ids of all matching
+  objects, which reveal the removed ones. The rows are updated in place, so a
+  refresh of a large, slowly changing collection costs little bandwidth and
+  views keep their state.
+
+  Queries with a limit or an offset are always executed in full.
+
+  By default the property is false.
+*/
+bool EnginioModel::deltaSync() const
+{
+    Q_D(const EnginioModel);
+    return d->deltaSync();
+}
+
+void EnginioModel::setDeltaSync(bool enabled)
+{
+    Q_D(EnginioModel);
+    if (enabled == d->deltaSync())
+        return;
+    d->setDeltaSync(enabled);
+    emit deltaSyncChanged(enabled);
+}
+
+/*!
+  \property EnginioModel::resetThreshold
+  \brief How much a new query result may differ before the model is reset
+
+  When the answer to a query replaces rows the model already shows, the old
+  and new rows are matched by object id. Rows are removed, inserted and moved
+  and changed rows emit dataChanged(), so views keep their delegates, current
+  item and scroll position. If more than this share of the rows would be
+  removed, inserted or moved, the model is reset instead, which is cheaper
+  for results that have little in common.
+
+  The default value is 0.25, 0 always resets the model.
+*/
+qreal EnginioModel::resetThreshold() const
+{
+    Q_D(const EnginioModel);
+    return d->resetThreshold();
+}
+
+void EnginioModel::setResetThreshold(qreal threshold)
+{
+    Q_D(EnginioModel);
+    if (threshold == d->resetThreshold())
+        return;
+    d->setResetThreshold(threshold);
+    emit resetThresholdChanged(threshold);
+}
+
+/*!
+  \property EnginioModel::prefetchPages
+  \brief The number of requests fetchMore() keeps on their way
+
+  If this is not 0 the query only asks for its "limit" and views load the
+  rest through fetchMore() while they scroll towards the end of the rows.
+  Up to this many requests are sent ahead of the last row. Their size
+  follows how fast rows are taken and how fast the backend answers, and
+  pages arriving out of order are appended in the right order.
+
+  A query without a "limit" asks for 50 objects first. When the model
+  executes it again, the first page is as large as the requests sent by
+  fetchMore() were at that time.
+
+  The default value is 0, the whole result of the query is loaded at once.
+  It is used by the next query, a \c pageSize in the query takes precedence.
+*/
+int EnginioModel::prefetchPages() const
+{
+    Q_D(const EnginioModel);
+    return d->prefetchPages();
+}
+
+void EnginioModel::setPrefetchPages(int pages)
+{
+    Q_D(EnginioModel);
+    if (pages == d->prefetchPages())
+        return;
+    d->setPrefetchPages(pages);
+    emit prefetchPagesChanged(pages);
+}
+
+/*!
+  \property EnginioModel::maximalLoadedPages
+  \brief The number of pages a model with a \c pageSize keeps loaded
+
+  With a \c pageSize in the query the model has a row for every matching
+  object, but only loads the pages of the rows views ask for and their
+  neighbours. The other rows are placeholders, data() returns an invalid
+  QVariant for them. Once more than this many pages are loaded, the ones
+  farthest from the rows in view become placeholders again, so the memory
+  used by the model stays bounded however far views scroll.
+
+  Placeholder rows keep the id of their object, so they are removed when
+  the object is removed on the backend. Updates of their objects are not
+  applied, the page is loaded with the current objects when views come
+  back to it.
+
+  The default value is 8, values below 3 are raised to 3, which are the
+  pages in view and their neighbours.
+*/
+int EnginioModel::maximalLoadedPages() const
+{
+    Q_D(const EnginioModel);
+    return d->maximalLoadedPages();
+}
+
+void EnginioModel::setMaximalLoadedPages(int pages)
+{
+    Q_D(EnginioModel);
+    const int previous = d->maximalLoadedPages();
+    d->setMaximalLoadedPages(pages);
+    if (d->maximalLoadedPages() != previous)
+        emit maximalLoadedPagesChanged(d->maximalLoadedPages());
+}
+
 /*!
   \property EnginioModel::operation
   \brief The operation type of the query
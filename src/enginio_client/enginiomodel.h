@@ -55,6 +55,13 @@ class ENGINIOCLIENT_EXPORT EnginioModel
     Q_PROPERTY(Enginio::Operation operation READ operation WRITE setOperation NOTIFY operationChanged)
     Q_PROPERTY(EnginioClient *client READ client WRITE setClient NOTIFY clientChanged)
     Q_PROPERTY(QJsonObject query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(QString snapshotDirectory READ snapshotDirectory WRITE setSnapshotDirectory NOTIFY snapshotDirectoryChanged)
+    Q_PROPERTY(bool columnStorage READ columnStorage WRITE setColumnStorage NOTIFY columnStorageChanged)
+    Q_PROPERTY(int notificationInterval READ notificationInterval WRITE setNotificationInterval NOTIFY notificationIntervalChanged)
+    Q_PROPERTY(bool deltaSync READ deltaSync WRITE setDeltaSync NOTIFY deltaSyncChanged)
+    Q_PROPERTY(qreal resetThreshold READ resetThreshold WRITE setResetThreshold NOTIFY resetThresholdChanged)
+    Q_PROPERTY(int prefetchPages READ prefetchPages WRITE setPrefetchPages NOTIFY prefetchPagesChanged)
+    Q_PROPERTY(int maximalLoadedPages READ maximalLoadedPages WRITE setMaximalLoadedPages NOTIFY maximalLoadedPagesChanged)
 
 public:
     explicit EnginioModel(QObject *parent = nullptr);
@@ -69,6 +76,27 @@ public:
     Enginio::Operation operation() const Q_REQUIRED_RESULT;
     void setOperation(Enginio::Operation operation);
 
+    QString snapshotDirectory() const Q_REQUIRED_RESULT;
+    void setSnapshotDirectory(const QString &directory);
+
+    bool columnStorage() const Q_REQUIRED_RESULT;
+    void setColumnStorage(bool enabled);
+
+    int notificationInterval() const Q_REQUIRED_RESULT;
+    void setNotificationInterval(int interval);
+
+    bool deltaSync() const Q_REQUIRED_RESULT;
+    void setDeltaSync(bool enabled);
+
+    qreal resetThreshold() const Q_REQUIRED_RESULT;
+    void setResetThreshold(qreal threshold);
+
+    int prefetchPages() const Q_REQUIRED_RESULT;
+    void setPrefetchPages(int pages);
+
+    int maximalLoadedPages() const Q_REQUIRED_RESULT;
+    void setMaximalLoadedPages(int pages);
+
     Q_INVOKABLE EnginioReply *append(const QJsonObject &value);
     Q_INVOKABLE EnginioReply *remove(int row);
     Q_INVOKABLE EnginioReply *setData(int row, const QVariant &value, const QString &role);
@@ -81,6 +109,13 @@ Q_SIGNALS:
     void queryChanged(const QJsonObject &query);
     void clientChanged(EnginioClient *client);
     void operationChanged(Enginio::Operation operation);
+    void snapshotDirectoryChanged(const QString &directory);
+    void columnStorageChanged(bool enabled);
+    void notificationIntervalChanged(int interval);
+    void deltaSyncChanged(bool enabled);
+    void resetThresholdChanged(qreal threshold);
+    void prefetchPagesChanged(int pages);
+    void maximalLoadedPagesChanged(int pages);
 
 private:
     Q_DISABLE_COPY(EnginioModel)
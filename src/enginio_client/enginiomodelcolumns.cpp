@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiomodelcolumns_p.h>
+#include <Enginio/enginio.h>
+
+QT_BEGIN_NAMESPACE
+
+void EnginioModelColumns::clear()
+{
+    _roleColumns.clear();
+    _names.clear();
+    _columns.clear();
+}
+
+/*!
+  \internal
+  Rebuilds all columns, this is needed whenever the roles change.
+*/
+void EnginioModelColumns::reset(const QJsonArray &rows, const QHash<int, QString> &roles)
+{
+    clear();
+    _roleColumns.reserve(roles.count());
+    for (QHash<int, QString>::const_iterator i = roles.constBegin(); i != roles.constEnd(); ++i) {
+        if (i.key() == Enginio::SyncedRole)
+            continue; // not a part of the object
+        _roleColumns.insert(i.key(), _names.count());
+        _names.append(i.value());
+    }
+
+    const int rowCount = rows.count();
+    _columns.resize(_names.count());
+    for (int column = 0; column < _columns.count(); ++column)
+        _columns[column].reserve(rowCount);
+    for (int row = 0; row < rowCount; ++row)
+        append(rows.at(row).toObject());
+}
+
+void EnginioModelColumns::append(const QJsonObject &object)
+{
+    for (int column = 0; column < _columns.count(); ++column)
+        _columns[column].append(cell(object, _names.at(column)));
+}
+
+void EnginioModelColumns::replace(int row, const QJsonObject &object)
+{
+    for (int column = 0; column < _columns.count(); ++column)
+        _columns[column][row] = cell(object, _names.at(column));
+}
+
+void EnginioModelColumns::remove(int first, int count)
+{
+    for (int column = 0; column < _columns.count(); ++column)
+        _columns[column].remove(first, count);
+}
+
+void EnginioModelColumns::insert(int row, const QJsonObject &object)
+{
+    for (int column = 0; column < _columns.count(); ++column)
+        _columns[column].insert(row, cell(object, _names.at(column)));
+}
+
+void EnginioModelColumns::permute(const QVector<int> &order)
+{
+    for (int column = 0; column < _columns.count(); ++column) {
+        const QVector<QVariant> &values = _columns.at(column);
+        QVector<QVariant> permuted;
+        permuted.reserve(order.count());
+        foreach (int row, order)
+            permuted.append(values.at(row));
+        _columns[column].swap(permuted);
+    }
+}
+
+QT_END_NAMESPACE
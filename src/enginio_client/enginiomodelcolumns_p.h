@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOMODELCOLUMNS_P_H
+#define ENGINIOMODELCOLUMNS_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  Role values of an EnginioModel stored column by column.
+
+  Every role gets a vector with one QVariant per row, holding exactly what
+  EnginioBaseModelPrivate::data() would compute from the row object, so a
+  view request is an integer hash lookup and a vector access. Whole objects
+  (Enginio::JsonObjectRole) are not copied, they stay in the model rows.
+*/
+class ENGINIOCLIENT_EXPORT EnginioModelColumns
+{
+    QHash<int, int> _roleColumns; // role -> index in _columns
+    QVector<QString> _names;
+    QVector<QVector<QVariant> > _columns;
+
+    static QVariant cell(const QJsonObject &object, const QString &name)
+    {
+        return object.isEmpty() ? QVariant() : QVariant(object[name]);
+    }
+
+public:
+    void clear();
+    void reset(const QJsonArray &rows, const QHash<int, QString> &roles);
+
+    void append(const QJsonObject &object);
+    void replace(int row, const QJsonObject &object);
+    void remove(int first, int count);
+    void insert(int row, const QJsonObject &object);
+    void permute(const QVector<int> &order); // row r gets the values of row order[r]
+
+    const QVariant *value(int row, int role) const
+    {
+        QHash<int, int>::const_iterator column = _roleColumns.constFind(role);
+        if (column == _roleColumns.constEnd())
+            return 0;
+        return &_columns.at(*column).at(row);
+    }
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOMODELCOLUMNS_P_H
@@ -0,0 +1,157 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiomodelsnapshot_p.h>
+#include <Enginio/private/enginiostring_p.h>
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qsavefile.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+const quint32 SnapshotMagic = 0x45534e50; // "ESNP"
+const int KeySize = 20; // SHA-1
+
+struct SnapshotHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 payloadSize;
+    quint32 rowCount;
+    char key[KeySize];
+};
+
+} // namespace
+
+/*!
+  \internal
+  The key of the rows of \a query with \a operation, sent with the headers of
+  \a request. Like in EnginioResponseCache::key() the headers selecting the
+  backend and the identity are part of it.
+*/
+QByteArray EnginioModelSnapshot::key(const QNetworkRequest &request, int operation, const QJsonObject &query)
+{
+    // QJsonObject keeps its keys sorted, so equal queries give equal documents
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(request.rawHeader(QByteArrayLiteral("Enginio-Backend-Id")));
+    hash.addData("\n", 1);
+    hash.addData(request.rawHeader(EnginioString::Authorization));
+    hash.addData("\n", 1);
+    hash.addData(request.rawHeader(EnginioString::Enginio_Backend_Session));
+    hash.addData("\n", 1);
+    hash.addData(QByteArray::number(operation));
+    hash.addData(QJsonDocument(query).toJson(QJsonDocument::Compact));
+    return hash.result();
+}
+
+QString EnginioModelSnapshot::filePath(const QString &directory, const QByteArray &key)
+{
+    return QDir(directory).filePath(QString::fromLatin1(key.toHex()) + QStringLiteral(".snapshot"));
+}
+
+/*!
+  \internal
+  Reads the snapshot stored for \a key into \a rows. Returns false if there is
+  no usable snapshot, in which case \a rows is not modified.
+
+  The payload is copied out of the mapping by QJsonDocument::fromBinaryData,
+  values given away by the model can outlive the mapping.
+*/
+bool EnginioModelSnapshot::read(const QString &directory, const QByteArray &key, QJsonArray *rows)
+{
+    Q_ASSERT(rows);
+    Q_ASSERT(key.size() == KeySize);
+    QFile file(filePath(directory, key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(SnapshotHeader)))
+        return false;
+
+    const uchar *mapped = file.map(0, size);
+    if (!mapped)
+        return false;
+
+    SnapshotHeader header;
+    memcpy(&header, mapped, sizeof(SnapshotHeader));
+    if (header.magic != SnapshotMagic
+            || header.version != Version
+            || qint64(header.payloadSize) != size - qint64(sizeof(SnapshotHeader))
+            || memcmp(header.key, key.constData(), KeySize)) {
+        file.unmap(const_cast<uchar*>(mapped));
+        return false;
+    }
+
+    const QByteArray payload = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped) + sizeof(SnapshotHeader), header.payloadSize);
+    const QJsonDocument document = QJsonDocument::fromBinaryData(payload, QJsonDocument::Validate);
+    file.unmap(const_cast<uchar*>(mapped));
+
+    if (!document.isArray() || uint(document.array().count()) != header.rowCount)
+        return false;
+    *rows = document.array();
+    return true;
+}
+
+/*!
+  \internal
+  Atomically replaces the snapshot stored for \a key by \a rows.
+*/
+bool EnginioModelSnapshot::write(const QString &directory, const QByteArray &key, const QJsonArray &rows)
+{
+    Q_ASSERT(key.size() == KeySize);
+    if (!QDir().mkpath(directory))
+        return false;
+
+    const QByteArray payload = QJsonDocument(rows).toBinaryData();
+    SnapshotHeader header;
+    header.magic = SnapshotMagic;
+    header.version = Version;
+    header.payloadSize = payload.size();
+    header.rowCount = rows.count();
+    memcpy(header.key, key.constData(), KeySize);
+
+    QSaveFile file(filePath(directory, key));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+    file.write(payload);
+    return file.commit();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOMODELSNAPSHOT_P_H
+#define ENGINIOMODELSNAPSHOT_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qstring.h>
+
+#include <QtNetwork/qnetworkrequest.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  On disk snapshot of the rows of an EnginioModel.
+
+  A snapshot is a small fixed header followed by the binary representation
+  of the result array (QJsonDocument::toBinaryData), so loading it needs no
+  JSON parsing: the file is memory mapped, the header validated and the
+  payload handed to QJsonDocument. Snapshots are keyed by the backend id and
+  the session of the request, the operation and the query, one file per key,
+  so users sharing a directory never see each others rows. Any mismatch in the header (an
+  other format version, an other byte order, a truncated file) makes the
+  snapshot be ignored.
+*/
+class ENGINIOCLIENT_EXPORT EnginioModelSnapshot
+{
+public:
+    enum { Version = 1 };
+
+    static QByteArray key(const QNetworkRequest &request, int operation, const QJsonObject &query);
+    static QString filePath(const QString &directory, const QByteArray &key);
+
+    static bool read(const QString &directory, const QByteArray &key, QJsonArray *rows);
+    static bool write(const QString &directory, const QByteArray &key, const QJsonArray &rows);
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOMODELSNAPSHOT_P_H
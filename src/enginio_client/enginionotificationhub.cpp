@@ -0,0 +1,211 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginionotificationhub_p.h>
+#include <Enginio/private/enginiobackendconnection_p.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginiostring_p.h>
+
+#include <QtCore/qjsonarray.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+EnginioNotificationHub::EnginioNotificationHub(EnginioClientConnectionPrivate *client)
+    : _client(client)
+    , _connection(0)
+{
+    Q_ASSERT(client);
+    _updateTimer.setSingleShot(true);
+    UpdateConnection update = { this };
+    QObject::connect(&_updateTimer, &QTimer::timeout, update);
+
+    EnginioClientConnection *q = static_cast<EnginioClientConnection*>(client->q_ptr);
+    SessionChanged sessionChanged = { this };
+    QObject::connect(q, &EnginioClientConnection::backendIdChanged, this, sessionChanged);
+    QObject::connect(q, &EnginioClientConnection::serviceUrlChanged, this, sessionChanged);
+    QObject::connect(q, &EnginioClientConnection::identityChanged, this, sessionChanged);
+    QObject::connect(q, &EnginioClientConnection::authenticationStateChanged, this, sessionChanged);
+}
+
+EnginioNotificationHub::~EnginioNotificationHub()
+{
+    removeConnection();
+}
+
+void EnginioNotificationHub::subscribe(EnginioNotificationSubscriber *subscriber, const QString &objectType)
+{
+    Q_ASSERT(subscriber);
+    if (_objectTypes.contains(subscriber)) {
+        if (_objectTypes.value(subscriber) == objectType)
+            return;
+        unsubscribe(subscriber);
+    }
+    _objectTypes.insert(subscriber, objectType);
+    _subscribers[objectType].append(subscriber);
+    if (!_connectedTypes.contains(objectType))
+        scheduleUpdate();
+}
+
+void EnginioNotificationHub::unsubscribe(EnginioNotificationSubscriber *subscriber)
+{
+    QHash<EnginioNotificationSubscriber*, QString>::iterator i = _objectTypes.find(subscriber);
+    if (i == _objectTypes.end())
+        return;
+    QHash<QString, QVector<EnginioNotificationSubscriber*> >::iterator subscribers = _subscribers.find(i.value());
+    Q_ASSERT(subscribers != _subscribers.end());
+    subscribers->remove(subscribers->indexOf(subscriber));
+    if (subscribers->isEmpty())
+        _subscribers.erase(subscribers);
+    _objectTypes.erase(i);
+    if (_subscribers.isEmpty())
+        scheduleUpdate(); // the last one closes the connection
+}
+
+/*!
+  \internal
+  Returns the filter matching every subscribed object type.
+*/
+QJsonObject EnginioNotificationHub::filter() const
+{
+    QStringList types = _subscribers.keys();
+    std::sort(types.begin(), types.end());
+
+    QJsonObject data;
+    if (types.count() == 1) {
+        data[EnginioString::objectType] = types.first();
+    } else {
+        QJsonObject in;
+        in[QStringLiteral("$in")] = QJsonArray::fromStringList(types);
+        data[EnginioString::objectType] = in;
+    }
+    QJsonObject filter;
+    filter[EnginioString::data] = data;
+    return filter;
+}
+
+void EnginioNotificationHub::scheduleUpdate()
+{
+    if (!_updateTimer.isActive())
+        _updateTimer.start(0);
+}
+
+void EnginioNotificationHub::updateConnection()
+{
+    if (_subscribers.isEmpty()) {
+        removeConnection();
+        return;
+    }
+
+    bool covered = _connection != 0;
+    for (QHash<QString, QVector<EnginioNotificationSubscriber*> >::const_iterator i = _subscribers.constBegin(); covered && i != _subscribers.constEnd(); ++i)
+        covered = _connectedTypes.contains(i.key());
+    if (covered)
+        return;
+
+    // the subscribers of the old connection miss messages until the new one is up
+    const QStringList replacedTypes = _connection && _connection->isConnected() ? _connectedTypes : QStringList();
+    removeConnection();
+    _replacedTypes = replacedTypes;
+    _connectedTypes = _subscribers.keys();
+    _connection = new EnginioBackendConnection(this);
+    MessageReceived receiver = { this };
+    QObject::connect(_connection, &EnginioBackendConnection::dataReceived, receiver);
+    Reconnected reconnected = { this };
+    QObject::connect(_connection, &EnginioBackendConnection::reconnected, reconnected);
+    ConnectionStateChanged stateChanged = { this };
+    QObject::connect(_connection, &EnginioBackendConnection::stateChanged, stateChanged);
+    _connection->connectToBackend(_client, filter());
+}
+
+void EnginioNotificationHub::removeConnection()
+{
+    if (!_connection)
+        return;
+    _connection->close();
+    delete _connection;
+    _connection = 0;
+    _connectedTypes.clear();
+    _replacedTypes.clear();
+}
+
+/*!
+  \internal
+  Drops the connection, which was opened for the backend and the session
+  the client had before, the next update opens a new one.
+*/
+void EnginioNotificationHub::sessionChanged()
+{
+    if (!_connection)
+        return;
+    removeConnection();
+    scheduleUpdate();
+}
+
+void EnginioNotificationHub::connectionStateChanged(int state)
+{
+    if (state != EnginioBackendConnection::ConnectedState || _replacedTypes.isEmpty())
+        return;
+    QStringList replacedTypes;
+    replacedTypes.swap(_replacedTypes);
+    notifyReconnected(replacedTypes);
+}
+
+void EnginioNotificationHub::notifyReconnected(const QStringList &objectTypes)
+{
+    foreach (const QString &objectType, objectTypes) {
+        // a subscriber may change its subscription while it catches up
+        const QVector<EnginioNotificationSubscriber*> subscribers = _subscribers.value(objectType);
+        foreach (EnginioNotificationSubscriber *subscriber, subscribers) {
+            if (_objectTypes.value(subscriber) == objectType)
+                subscriber->streamReconnected();
+        }
+    }
+}
+
+void EnginioNotificationHub::dispatch(const QJsonObject &message)
+{
+    const QString objectType = message[EnginioString::data].toObject()[EnginioString::objectType].toString();
+    QHash<QString, QVector<EnginioNotificationSubscriber*> >::const_iterator i = _subscribers.constFind(objectType);
+    if (i == _subscribers.constEnd())
+        return;
+    // a subscriber may unsubscribe while it handles the message
+    const QVector<EnginioNotificationSubscriber*> subscribers = i.value();
+    foreach (EnginioNotificationSubscriber *subscriber, subscribers) {
+        if (_objectTypes.value(subscriber) == objectType)
+            subscriber->notificationReceived(message);
+    }
+}
+
+QT_END_NAMESPACE
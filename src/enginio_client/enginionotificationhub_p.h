@@ -0,0 +1,162 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIONOTIFICATIONHUB_P_H
+#define ENGINIONOTIFICATIONHUB_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_NAMESPACE
+
+class EnginioBackendConnection;
+class EnginioClientConnectionPrivate;
+
+class EnginioNotificationSubscriber
+{
+public:
+    virtual ~EnginioNotificationSubscriber() {}
+    virtual void notificationReceived(const QJsonObject &data) = 0;
+    // messages may have been missed, called once the stream is back
+    virtual void streamReconnected() {}
+};
+
+/*!
+  \internal
+  Shares one notification stream between all models of a client.
+
+  Subscribers register for an object type, the hub connects a single
+  EnginioBackendConnection with a filter covering all subscribed types and
+  hands every message to the subscribers of the object type it is about.
+  Changes of the subscriptions are collected until the next event loop
+  pass, so models created together cause one connection only. The
+  connection is only replaced when a new object type is added; after an
+  unsubscription the server may still send messages for the type, they are
+  dropped here.
+
+  Subscribers are told when they may have missed messages: after the
+  connection was established again, and after it was replaced by one with
+  a wider filter.
+
+  The stream belongs to the backend and the session it was opened for.
+  When the client changes its backend id, service url, identity or
+  authentication state, the connection is dropped and a new one is opened
+  on the next event loop pass. The models query again on these changes
+  themselves, so the subscribers are not asked to catch up.
+*/
+class ENGINIOCLIENT_EXPORT EnginioNotificationHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EnginioNotificationHub(EnginioClientConnectionPrivate *client);
+    ~EnginioNotificationHub();
+
+    void subscribe(EnginioNotificationSubscriber *subscriber, const QString &objectType);
+    void unsubscribe(EnginioNotificationSubscriber *subscriber);
+
+    QJsonObject filter() const Q_REQUIRED_RESULT;
+    EnginioBackendConnection *connection() const Q_REQUIRED_RESULT { return _connection; }
+
+private:
+    struct UpdateConnection
+    {
+        EnginioNotificationHub *hub;
+        void operator ()()
+        {
+            hub->updateConnection();
+        }
+    };
+
+    struct MessageReceived
+    {
+        EnginioNotificationHub *hub;
+        void operator ()(QJsonObject data)
+        {
+            hub->dispatch(data);
+        }
+    };
+
+    struct Reconnected
+    {
+        EnginioNotificationHub *hub;
+        void operator ()()
+        {
+            hub->notifyReconnected(hub->_subscribers.keys());
+        }
+    };
+
+    struct SessionChanged
+    {
+        EnginioNotificationHub *hub;
+        void operator ()()
+        {
+            hub->sessionChanged();
+        }
+    };
+
+    struct ConnectionStateChanged
+    {
+        EnginioNotificationHub *hub;
+        void operator ()(int state)
+        {
+            hub->connectionStateChanged(state);
+        }
+    };
+
+    EnginioClientConnectionPrivate *_client;
+    EnginioBackendConnection *_connection;
+    QHash<QString, QVector<EnginioNotificationSubscriber*> > _subscribers; // by object type
+    QHash<EnginioNotificationSubscriber*, QString> _objectTypes;
+    QStringList _connectedTypes; // covered by the filter of _connection
+    QStringList _replacedTypes; // covered by the previous connection, until the new one is up
+    QTimer _updateTimer;
+
+    void scheduleUpdate();
+    void updateConnection();
+    void removeConnection();
+    void sessionChanged();
+    void dispatch(const QJsonObject &message);
+    void connectionStateChanged(int state);
+    void notifyReconnected(const QStringList &objectTypes);
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIONOTIFICATIONHUB_P_H
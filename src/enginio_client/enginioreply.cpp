@@ -82,6 +82,17 @@ QT_BEGIN_NAMESPACE
   \value BackendError The backend did not accept the query
 */
 
+/*!
+  \enum Enginio::RequestPriority
+  Describes how urgent a request is. A client sends only a few requests at
+  once, the others wait and the most urgent ones are sent first. A request
+  moves up one class for every two seconds it waits.
+  \value InteractivePriority A query the user waits for, the default for queries
+  \value ModelWritePriority Creating, updating or removing an object
+  \value BackgroundPriority Work nobody waits for, like synchronizing a model
+  \value FileTransferPriority Uploading a file
+*/
+
 /*!
   \fn EnginioReply::finished(EnginioReply *reply)
   This signal is emitted when the EnginioReply \a reply is finished.
@@ -95,6 +106,12 @@ QT_BEGIN_NAMESPACE
   The \a bytesSent is the current progress relative to the total \a bytesTotal.
 */
 
+/*!
+  \fn EnginioReply::priorityChanged(Enginio::RequestPriority priority)
+  \since 1.8
+  This signal is emitted when the \a priority of the request was changed.
+*/
+
 class EnginioReplyPrivate: public EnginioReplyStatePrivate {
     Q_DECLARE_PUBLIC(EnginioReply)
 public:
@@ -194,10 +211,8 @@ void EnginioReplyState::setNetworkReply(QNetworkReply *reply)
 void EnginioReplyStatePrivate::setNetworkReply(QNetworkReply *reply)
 {
     Q_Q(EnginioReplyState);
-    _client->unregisterReply(_nreply);
-
-    if (gEnableEnginioDebugInfo)
-        _client->_requestData.remove(_nreply);
+    _client->_sharedQueries->replace(_nreply, reply);
+    _client->releaseRequestContext(_nreply);
 
     if (!_nreply->isFinished()) {
         _nreply->setParent(_nreply->manager());
@@ -207,7 +222,8 @@ void EnginioReplyStatePrivate::setNetworkReply(QNetworkReply *reply)
         _nreply->deleteLater();
     }
     _nreply = reply;
-    _data = QByteArray();
+    resetData();
+    _servedFromCache = false;
 
     _client->registerReply(reply, q);
 }
@@ -229,7 +245,9 @@ void EnginioReplyStatePrivate::swapNetworkReply(EnginioReplyStatePrivate *other)
     _client->unregisterReply(other->_nreply);
 
     qSwap(_nreply, other->_nreply);
-    _data = other->_data = QByteArray();
+    resetData();
+    other->resetData();
+    _servedFromCache = other->_servedFromCache = false;
 
     _client->registerReply(_nreply, q);
     _client->registerReply(other->_nreply, other->q_func());
@@ -316,6 +334,36 @@ Enginio::ErrorType EnginioReplyState::errorType() const
     return d->errorType();
 }
 
+/*!
+  \property EnginioReply::priority
+  \brief The class of the request when the client decides what to send next
+  \since 1.8
+
+  The default depends on the operation: queries use the
+  \l{EnginioClientConnection::queryPriority}{queryPriority} of the client,
+  other operations on objects its
+  \l{EnginioClientConnection::writePriority}{writePriority}, and file
+  uploads are file transfers. A request is sent right away when there is
+  room for its class, so changing the priority only has an effect on a
+  request that is still waiting.
+  \sa Enginio::RequestPriority
+*/
+
+Enginio::RequestPriority EnginioReplyState::priority() const
+{
+    Q_D(const EnginioReplyState);
+    return d->_client->_scheduler->priority(d->_nreply);
+}
+
+void EnginioReplyState::setPriority(Enginio::RequestPriority priority)
+{
+    Q_D(EnginioReplyState);
+    if (priority == this->priority())
+        return;
+    d->_client->_scheduler->setPriority(d->_nreply, priority);
+    emit priorityChanged(priority);
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug d, const EnginioReply *reply)
 {
@@ -351,7 +399,7 @@ EnginioReplyState::~EnginioReplyState()
     Q_ASSERT(d->_nreply->parent() == this);
     if (Q_UNLIKELY(!d->isFinished())) {
         QObject::connect(d->_nreply, &QNetworkReply::finished, d->_nreply, &QNetworkReply::deleteLater);
-        d->_client->unregisterReply(d->_nreply);
+        d->_client->releaseRequestContext(d->_nreply);
         d->_nreply->setParent(d->_nreply->manager());
         d->_nreply->abort();
     }
@@ -366,5 +414,33 @@ QJsonObject EnginioReplyState::data() const
     return d->data();
 }
 
+/*!
+  \fn QJsonObject EnginioReply::uploadStatistics() const
+  \since 1.8
+  \brief Describes how a file upload was sent in chunks
+
+  The object has the number of acknowledged \c chunks, the number of
+  \c retries of failed chunks, the \c chunkSize in bytes the upload sends
+  now, and the \c smallestChunkSize and \c largestChunkSize it used. The
+  chunk size adapts to the throughput and the round trip time measured on
+  the chunks sent before.
+
+  All values are 0 unless the reply uploads a file in chunks, files smaller
+  than a chunk are sent in a single request.
+  \sa EnginioClient::uploadFile()
+*/
+QJsonObject EnginioReplyState::uploadStatistics() const
+{
+    Q_D(const EnginioReplyState);
+    const EnginioChunkedUpload::Statistics &statistics = d->_uploadStatistics;
+    QJsonObject result;
+    result[QStringLiteral("chunks")] = statistics.chunks;
+    result[QStringLiteral("retries")] = statistics.retries;
+    result[QStringLiteral("chunkSize")] = double(statistics.chunkSize);
+    result[QStringLiteral("smallestChunkSize")] = double(statistics.smallestChunkSize);
+    result[QStringLiteral("largestChunkSize")] = double(statistics.largestChunkSize);
+    return result;
+}
+
 QT_END_NAMESPACE
 
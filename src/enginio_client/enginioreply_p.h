@@ -55,20 +55,40 @@ public:
     EnginioClientConnectionPrivate *_client;
     QNetworkReply *_nreply;
     mutable QByteArray _data;
+    mutable bool _dataComplete; // _data holds the whole body
+    mutable QJsonObject _parsedData;
+    mutable bool _parsed;
+    mutable int _parseCount; // number of times the body was parsed, for tests and benchmarks
     bool _delay;
+    bool _servedFromCache; // a 304 answer, _data was taken from EnginioResponseCache
+    EnginioChunkedUpload::Statistics _uploadStatistics; // all zero unless the reply uploaded a file in chunks
 
     static EnginioReplyStatePrivate *get(EnginioReplyState *p)
     {
         return p->d_func();
     }
 
+    static const EnginioReplyStatePrivate *get(const EnginioReplyState *p)
+    {
+        return p->d_func();
+    }
+
 
     EnginioReplyStatePrivate(EnginioClientConnectionPrivate *p, QNetworkReply *reply)
         : _client(p)
         , _nreply(reply)
+        , _dataComplete(false)
+        , _parsed(false)
+        , _parseCount(0)
         , _delay(false)
+        , _servedFromCache(false)
     {
         Q_ASSERT(reply);
+        _uploadStatistics.chunks = 0;
+        _uploadStatistics.retries = 0;
+        _uploadStatistics.chunkSize = 0;
+        _uploadStatistics.smallestChunkSize = 0;
+        _uploadStatistics.largestChunkSize = 0;
     }
 
     bool isFinished() const Q_REQUIRED_RESULT
@@ -83,6 +103,8 @@ public:
 
     int backendStatus() const Q_REQUIRED_RESULT
     {
+        if (_servedFromCache)
+            return 200;
         return _nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).value<int>();
     }
 
@@ -109,13 +131,53 @@ public:
 
     QJsonObject data() const Q_REQUIRED_RESULT
     {
-        return QJsonDocument::fromJson(pData()).object();
+        // The body is parsed once, later calls share the same implicitly shared object
+        if (!_parsed) {
+            const QByteArray body = pData();
+            if (!_dataComplete)
+                return QJsonObject();
+            _parsedData = QJsonDocument::fromJson(body).object();
+            _parsed = true;
+            ++_parseCount;
+        }
+        return _parsedData;
     }
 
-    QByteArray pData() const Q_REQUIRED_RESULT
+    void setRawData(const QByteArray &data)
     {
-        if (_data.isEmpty() && _nreply->isFinished())
-            _data = _nreply->readAll();
+        _data = data;
+        _dataComplete = true;
+        _parsedData = QJsonObject();
+        _parsed = false;
+    }
+
+    void resetData()
+    {
+        setRawData(QByteArray());
+        _dataComplete = false;
+    }
+
+    /*!
+      \internal
+      Returns the part of the body received so far, it is the whole
+      body once the reply is finished.
+    */
+    const QByteArray &readAvailableData()
+    {
+        if (!_dataComplete) {
+            if (_nreply->isFinished())
+                return pData();
+            _data += _nreply->readAll();
+        }
+        return _data;
+    }
+
+    const QByteArray &pData() const Q_REQUIRED_RESULT
+    {
+        if (!_dataComplete && _nreply->isFinished()) {
+            _data += _nreply->readAll();
+            _dataComplete = true;
+        }
         return _data;
     }
 
@@ -140,7 +202,8 @@ public:
         qDebug() << "  RawHeaders[Content-Type]:" << request.rawHeader(EnginioString::Content_Type);
         qDebug() << "  RawHeaders[X_Request_Id]:" << request.rawHeader(EnginioString::X_Request_Id);
 
-        QByteArray json = _client->_requestData.value(_nreply);
+        const EnginioRequestContext *context = _client->findRequestContext(_nreply);
+        const QByteArray json = context ? context->requestData : QByteArray();
         if (!json.isEmpty()) {
             if (request.url().toString(QUrl::None).endsWith(QString::fromUtf8("account/auth/identity")))
                 qDebug() << "Request Data hidden because it contains password";
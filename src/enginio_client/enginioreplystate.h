@@ -59,6 +59,7 @@ class ENGINIOCLIENT_EXPORT EnginioReplyState: public QObject
     Q_PROPERTY(QString errorString READ errorString NOTIFY dataChanged)
     Q_PROPERTY(int backendStatus READ backendStatus NOTIFY dataChanged)
     Q_PROPERTY(QString requestId READ requestId CONSTANT)
+    Q_PROPERTY(Enginio::RequestPriority priority READ priority WRITE setPriority NOTIFY priorityChanged)
 
     Q_DECLARE_PRIVATE(EnginioReplyState)
 
@@ -71,6 +72,8 @@ public:
     QString errorString() const Q_REQUIRED_RESULT;
     QString requestId() const Q_REQUIRED_RESULT;
     int backendStatus() const Q_REQUIRED_RESULT;
+    Enginio::RequestPriority priority() const Q_REQUIRED_RESULT;
+    void setPriority(Enginio::RequestPriority priority);
 
     bool isError() const Q_REQUIRED_RESULT;
     bool isFinished() const Q_REQUIRED_RESULT;
@@ -82,6 +85,7 @@ public:
     void setNetworkReply(QNetworkReply *reply);
 
     QJsonObject data() const Q_REQUIRED_RESULT;
+    Q_INVOKABLE QJsonObject uploadStatistics() const Q_REQUIRED_RESULT;
 
 public Q_SLOTS:
     void dumpDebugInfo() const;
@@ -89,6 +93,7 @@ public Q_SLOTS:
 Q_SIGNALS:
     void dataChanged();
     void progress(qint64 bytesSent, qint64 bytesTotal);
+    void priorityChanged(Enginio::RequestPriority priority);
 
 protected:
     EnginioReplyState(EnginioClientConnectionPrivate *parent, QNetworkReply *reply, EnginioReplyStatePrivate *priv);
@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiorequestbuilder_p.h>
+#include <Enginio/enginio.h>
+#include <Enginio/private/enginiostring_p.h>
+
+#include <QtCore/qhash.h>
+#include <QtCore/qthreadstorage.h>
+#include <QtCore/quuid.h>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct OperationPaths
+{
+    const QString root;
+    const QString files;
+    const QString search;
+    const QString session;
+    const QString users;
+    const QString usergroups;
+
+    OperationPaths()
+        : root(QStringLiteral("/v1/"))
+        , files(root + EnginioString::files)
+        , search(root + EnginioString::search)
+        , session(root + EnginioString::session)
+        , users(root + EnginioString::users)
+        , usergroups(root + EnginioString::usergroups)
+    {}
+};
+
+struct RequestBuilderThreadData
+{
+    QHash<QString, QString> objectTypePaths;
+    quint64 state[2];
+
+    RequestBuilderThreadData()
+    {
+        const QByteArray seed = QUuid::createUuid().toRfc4122();
+        Q_ASSERT(seed.size() == int(sizeof(state)));
+        memcpy(state, seed.constData(), sizeof(state));
+        if (!state[0] && !state[1])
+            state[0] = Q_UINT64_C(0x9e3779b97f4a7c15);
+    }
+
+    quint64 next()
+    {
+        // xorshift128+
+        quint64 s1 = state[0];
+        const quint64 s0 = state[1];
+        state[0] = s0;
+        s1 ^= s1 << 23;
+        state[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+        return state[1] + s0;
+    }
+};
+
+} // namespace
+
+Q_GLOBAL_STATIC(OperationPaths, gOperationPaths)
+Q_GLOBAL_STATIC(QThreadStorage<RequestBuilderThreadData*>, gThreadData)
+
+static RequestBuilderThreadData *threadData()
+{
+    QThreadStorage<RequestBuilderThreadData*> *storage = gThreadData();
+    if (!storage->hasLocalData())
+        storage->setLocalData(new RequestBuilderThreadData);
+    return storage->localData();
+}
+
+/*!
+  \internal
+  Returns the path prefix of \a operation, without the object id. Object and
+  access control operations return only the "/v1/" root, the object type part
+  comes from objectTypePath().
+*/
+QString EnginioRequestBuilder::operationPath(int operation)
+{
+    const OperationPaths *paths = gOperationPaths();
+    switch (operation) {
+    case Enginio::FileOperation:
+    case Enginio::FileGetDownloadUrlOperation:
+    case Enginio::FileChunkUploadOperation:
+        return paths->files;
+    case Enginio::SearchOperation:
+        return paths->search;
+    case Enginio::SessionOperation:
+        return paths->session;
+    case Enginio::UserOperation:
+        return paths->users;
+    case Enginio::UsergroupOperation:
+    case Enginio::UsergroupMembersOperation:
+        return paths->usergroups;
+    }
+    return paths->root;
+}
+
+/*!
+  \internal
+  Returns "/v1/" followed by \a objectType with dots replaced by slashes.
+  The result is cached per thread; the cache is dropped once it holds
+  MaxCachedObjectTypes entries, applications rarely use more than a handful.
+*/
+QString EnginioRequestBuilder::objectTypePath(const QString &objectType)
+{
+    QHash<QString, QString> &cache = threadData()->objectTypePaths;
+    QHash<QString, QString>::const_iterator i = cache.constFind(objectType);
+    if (i != cache.constEnd())
+        return i.value();
+
+    QString path = gOperationPaths()->root + objectType;
+    path.replace(QLatin1Char('.'), QLatin1Char('/'));
+    if (cache.size() >= MaxCachedObjectTypes)
+        cache.clear();
+    cache.insert(objectType, path);
+    return path;
+}
+
+/*!
+  \internal
+  Returns a new random request id, RequestIdSize lower case hex digits. The
+  only allocation is the returned byte array itself.
+*/
+QByteArray EnginioRequestBuilder::createRequestId()
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    RequestBuilderThreadData *data = threadData();
+
+    QByteArray result(RequestIdSize, Qt::Uninitialized);
+    char *out = result.data();
+    for (int word = 0; word < RequestIdSize / 16; ++word) {
+        quint64 value = data->next();
+        for (int i = 0; i < 16; ++i) {
+            *out++ = hexDigits[value & 0xf];
+            value >>= 4;
+        }
+    }
+    return result;
+}
+
+QT_END_NAMESPACE
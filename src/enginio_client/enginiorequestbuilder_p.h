@@ -0,0 +1,66 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOREQUESTBUILDER_P_H
+#define ENGINIOREQUESTBUILDER_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  Building blocks for the requests sent by EnginioClientConnectionPrivate.
+
+  Path prefixes ("/v1/files", "/v1/objects/todos", ...) are computed once and
+  then handed out as implicitly shared strings, so a path that does not carry
+  an object id costs no allocation at all. Request ids come from a per thread
+  xorshift128+ generator seeded from QUuid, which is much cheaper than creating
+  and reformatting a new QUuid for every request.
+*/
+class ENGINIOCLIENT_EXPORT EnginioRequestBuilder
+{
+public:
+    enum { RequestIdSize = 32, MaxCachedObjectTypes = 256 };
+
+    static QString operationPath(int operation);
+    static QString objectTypePath(const QString &objectType);
+    static QByteArray createRequestId();
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOREQUESTBUILDER_P_H
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOREQUESTCONTEXT_P_H
+#define ENGINIOREQUESTCONTEXT_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_NAMESPACE
+
+class EnginioChunkedUpload;
+class EnginioReplyState;
+class QIODevice;
+class QNetworkReply;
+
+/*!
+  \internal
+  Sends requests which have no reply of their own, like the ones of a batch.
+  When such a request waited in EnginioRequestScheduler, the owner is told
+  which network reply it was sent as, and takes over the stand-in \a queued.
+*/
+class EnginioRequestOwner
+{
+public:
+    virtual ~EnginioRequestOwner() {}
+    virtual void requestSent(QNetworkReply *queued, QNetworkReply *nreply) = 0;
+};
+
+/*!
+  \internal
+  Everything EnginioClientConnectionPrivate tracks about one network request.
+*/
+struct EnginioRequestContext
+{
+    EnginioReplyState *reply; // null until registered and after the reply finished
+    QByteArray requestData; // only filled if debug info is enabled
+    QIODevice *uploadDevice; // the whole file of a chunked upload, until the chunks are sent
+    EnginioChunkedUpload *chunkedUpload; // set for a chunk, which has no reply of its own
+    EnginioRequestOwner *owner; // set for a waiting request that is neither a reply nor a chunk
+    QMetaObject::Connection progressConnection;
+
+    EnginioRequestContext()
+        : reply(0)
+        , uploadDevice(0)
+        , chunkedUpload(0)
+        , owner(0)
+    {}
+};
+
+/*!
+  \internal
+  Free list of request contexts, allocated in blocks so that starting a request
+  does not need a separate allocation for its bookkeeping.
+*/
+class EnginioRequestContextPool
+{
+    Q_DISABLE_COPY(EnginioRequestContextPool)
+
+    enum { BlockSize = 64 };
+    QVector<EnginioRequestContext*> _blocks;
+    QVector<EnginioRequestContext*> _free;
+
+public:
+    EnginioRequestContextPool()
+    {}
+
+    ~EnginioRequestContextPool()
+    {
+        foreach (EnginioRequestContext *block, _blocks)
+            delete[] block;
+    }
+
+    EnginioRequestContext *acquire()
+    {
+        if (_free.isEmpty()) {
+            EnginioRequestContext *block = new EnginioRequestContext[BlockSize];
+            _blocks.append(block);
+            _free.reserve(_blocks.count() * BlockSize);
+            for (int i = BlockSize - 1; i >= 0; --i)
+                _free.append(block + i);
+        }
+        return _free.takeLast();
+    }
+
+    void release(EnginioRequestContext *context)
+    {
+        *context = EnginioRequestContext();
+        _free.append(context);
+    }
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOREQUESTCONTEXT_P_H
@@ -0,0 +1,366 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiorequestscheduler_p.h>
+#include <Enginio/private/enginioclient_p.h>
+
+#include <QtNetwork/qhttpmultipart.h>
+#include <QtNetwork/qnetworkreply.h>
+
+QT_BEGIN_NAMESPACE
+
+EnginioQueuedReply::EnginioQueuedReply(const QNetworkRequest &request, QNetworkAccessManager::Operation operation)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(operation);
+    open(QIODevice::ReadOnly);
+}
+
+EnginioRequestScheduler::EnginioRequestScheduler(EnginioClientConnectionPrivate *client)
+    : _client(client)
+    , _maximalConcurrency(DefaultMaximalConcurrency)
+    , _promotionInterval(DefaultPromotionInterval)
+{
+    Q_ASSERT(client);
+    // a query that fills the screen may use every connection, the others leave some room
+    _limits[Enginio::InteractivePriority] = DefaultMaximalConcurrency;
+    _limits[Enginio::ModelWritePriority] = 4;
+    _limits[Enginio::BackgroundPriority] = 2;
+    _limits[Enginio::FileTransferPriority] = EnginioChunkedUpload::DefaultWindow;
+    for (int i = 0; i < PriorityCount; ++i) {
+        _runningInClass[i] = 0;
+        _statistics.started[i] = 0;
+    }
+    _statistics.queued = 0;
+    _statistics.promoted = 0;
+    _statistics.maximalRunning = 0;
+    _clock.start();
+    _pumpTimer.setSingleShot(true);
+    _pumpTimer.setInterval(0);
+    Pump pump = { this };
+    QObject::connect(&_pumpTimer, &QTimer::timeout, pump);
+    _promotionTimer.setSingleShot(true);
+    QObject::connect(&_promotionTimer, &QTimer::timeout, &_pumpTimer, pump);
+}
+
+EnginioRequestScheduler::~EnginioRequestScheduler()
+{
+}
+
+QNetworkReply *EnginioRequestScheduler::get(const QNetworkRequest &request, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::GetOperation;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::post(const QNetworkRequest &request, const QByteArray &data, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::PostOperation;
+    r.data = data;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::post(const QNetworkRequest &request, QHttpMultiPart *multiPart, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::PostOperation;
+    r.multiPart = multiPart;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::put(const QNetworkRequest &request, const QByteArray &data, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::PutOperation;
+    r.data = data;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::put(const QNetworkRequest &request, QIODevice *device, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::PutOperation;
+    r.device = device;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::deleteResource(const QNetworkRequest &request, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::DeleteOperation;
+    r.priority = priority;
+    return schedule(r);
+}
+
+QNetworkReply *EnginioRequestScheduler::sendCustomRequest(const QNetworkRequest &request, const QByteArray &verb, QIODevice *device, Enginio::RequestPriority priority)
+{
+    Request r;
+    r.request = request;
+    r.operation = QNetworkAccessManager::CustomOperation;
+    r.verb = verb;
+    r.device = device;
+    r.priority = priority;
+    return schedule(r);
+}
+
+Enginio::RequestPriority EnginioRequestScheduler::priority(QNetworkReply *reply) const
+{
+    return _priorities.value(reply, Enginio::InteractivePriority);
+}
+
+/*!
+  \internal
+  Moves a waiting request to another class, a request that was sent
+  already keeps the slot it has.
+*/
+void EnginioRequestScheduler::setPriority(QNetworkReply *reply, Enginio::RequestPriority priority)
+{
+    if (!_priorities.contains(reply))
+        return;
+    _priorities.insert(reply, priority);
+    for (int i = 0; i < _queue.count(); ++i) {
+        if (_queue.at(i).placeholder == reply) {
+            _queue[i].priority = priority;
+            schedulePump();
+            break;
+        }
+    }
+}
+
+/*!
+  \internal
+  Returns true if \a reply stands in for a request that was not sent yet.
+*/
+bool EnginioRequestScheduler::isQueued(QNetworkReply *reply) const
+{
+    foreach (const Request &request, _queue) {
+        if (request.placeholder == reply)
+            return true;
+    }
+    return false;
+}
+
+void EnginioRequestScheduler::setMaximalConcurrency(int requests)
+{
+    _maximalConcurrency = qMax(0, requests); // 0 holds back every request
+    schedulePump();
+}
+
+void EnginioRequestScheduler::setConcurrencyLimit(Enginio::RequestPriority priority, int requests)
+{
+    _limits[priority] = qMax(0, requests);
+    schedulePump();
+}
+
+void EnginioRequestScheduler::setPromotionInterval(int msecs)
+{
+    _promotionInterval = qMax(0, msecs); // 0 never promotes
+    schedulePump();
+}
+
+QNetworkReply *EnginioRequestScheduler::schedule(Request &request)
+{
+    request.queuedAt = _clock.elapsed();
+    if (request.operation != QNetworkAccessManager::GetOperation)
+        _client->_sharedQueries->invalidate(); // a query sent later must see the write
+    // a pending pump may give the room to a request that waits already
+    if (!_pumpTimer.isActive() && canStart(request.priority))
+        return start(request, request.priority);
+
+    EnginioQueuedReply *placeholder = new EnginioQueuedReply(request.request, request.operation);
+    request.placeholder = placeholder;
+    track(placeholder, request.priority);
+    _queue.append(request);
+    ++_statistics.queued;
+    schedulePump();
+    return placeholder;
+}
+
+bool EnginioRequestScheduler::canStart(int priority) const
+{
+    return _running.count() < _maximalConcurrency && _runningInClass[priority] < _limits[priority];
+}
+
+int EnginioRequestScheduler::effectivePriority(const Request &request, qint64 now) const
+{
+    if (!_promotionInterval)
+        return request.priority;
+    return qMax(0, int(request.priority - (now - request.queuedAt) / _promotionInterval));
+}
+
+QNetworkReply *EnginioRequestScheduler::start(const Request &request, int priority)
+{
+    QNetworkAccessManager *manager = _client->networkManager();
+    QNetworkReply *reply = 0;
+    switch (request.operation) {
+    case QNetworkAccessManager::GetOperation:
+        reply = manager->get(request.request);
+        break;
+    case QNetworkAccessManager::PostOperation:
+        reply = request.multiPart ? manager->post(request.request, request.multiPart.data()) : manager->post(request.request, request.data);
+        break;
+    case QNetworkAccessManager::PutOperation:
+        reply = request.device ? manager->put(request.request, request.device.data()) : manager->put(request.request, request.data);
+        break;
+    case QNetworkAccessManager::DeleteOperation:
+        reply = manager->deleteResource(request.request);
+        break;
+    default:
+        reply = manager->sendCustomRequest(request.request, request.verb, request.device.data());
+        break;
+    }
+
+    _running.insert(reply, priority);
+    ++_runningInClass[priority];
+    ++_statistics.started[request.priority];
+    if (priority < request.priority)
+        ++_statistics.promoted;
+    _statistics.maximalRunning = qMax(_statistics.maximalRunning, _running.count());
+    track(reply, request.priority);
+    ReplyGone finished = { this, reply, false };
+    QObject::connect(reply, &QNetworkReply::finished, &_pumpTimer, finished);
+    return reply;
+}
+
+void EnginioRequestScheduler::track(QNetworkReply *reply, Enginio::RequestPriority priority)
+{
+    _priorities.insert(reply, priority);
+    ReplyGone destroyed = { this, reply, true };
+    QObject::connect(reply, &QObject::destroyed, &_pumpTimer, destroyed);
+}
+
+void EnginioRequestScheduler::replyGone(QNetworkReply *reply, bool destroyed)
+{
+    // a sent reply comes here when it finishes and again when it is destroyed,
+    // it must not be dereferenced
+    if (destroyed)
+        _priorities.remove(reply);
+    QHash<QNetworkReply*, int>::iterator i = _running.find(reply);
+    if (i == _running.end())
+        return;
+    --_runningInClass[i.value()];
+    _running.erase(i);
+    schedulePump();
+}
+
+void EnginioRequestScheduler::schedulePump()
+{
+    if (!_queue.isEmpty() && !_pumpTimer.isActive())
+        _pumpTimer.start();
+}
+
+/*!
+  \internal
+  Starts the promotion timer for the waiting request that moves up a class
+  next, if none is waiting for a promotion it is stopped.
+*/
+void EnginioRequestScheduler::schedulePromotion(qint64 now)
+{
+    qint64 next = -1;
+    if (_promotionInterval) {
+        foreach (const Request &request, _queue) {
+            if (!request.placeholder || !effectivePriority(request, now))
+                continue;
+            const qint64 due = _promotionInterval - (now - request.queuedAt) % _promotionInterval;
+            if (next < 0 || due < next)
+                next = due;
+        }
+    }
+    if (next < 0)
+        _promotionTimer.stop();
+    else
+        _promotionTimer.start(int(next));
+}
+
+/*!
+  \internal
+  Sends waiting requests while there is room, the one of the highest class
+  after promotion first and among those the oldest one. If requests still
+  wait because their class is full, the next promotion is scheduled.
+*/
+void EnginioRequestScheduler::pump()
+{
+    _promotionTimer.stop(); // with every slot taken the next finished reply pumps again
+    while (!_queue.isEmpty() && _running.count() < _maximalConcurrency) {
+        const qint64 now = _clock.elapsed();
+        int next = -1;
+        int nextPriority = PriorityCount;
+        for (int i = 0; i < _queue.count(); ++i) {
+            const Request &request = _queue.at(i);
+            if (!request.placeholder) {
+                _queue.removeAt(i--); // nobody waits for it any more
+                continue;
+            }
+            const int priority = effectivePriority(request, now);
+            if (priority < nextPriority && canStart(priority)) {
+                next = i;
+                nextPriority = priority;
+            }
+        }
+        if (next < 0) {
+            schedulePromotion(now);
+            return;
+        }
+
+        const Request request = _queue.takeAt(next);
+        QNetworkReply *placeholder = request.placeholder.data();
+        EnginioRequestContext *context = _client->findRequestContext(placeholder);
+        if (!context || (!context->reply && !context->chunkedUpload && !context->owner)) {
+            placeholder->deleteLater();
+            continue;
+        }
+        QNetworkReply *reply = start(request, nextPriority);
+        // the body belonged to the placeholder, which goes away now
+        if (request.device)
+            request.device->setParent(reply);
+        if (request.multiPart)
+            request.multiPart->setParent(reply);
+        _client->replaceQueuedReply(placeholder, reply);
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,191 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOREQUESTSCHEDULER_P_H
+#define ENGINIOREQUESTSCHEDULER_P_H
+
+#include <Enginio/enginio.h>
+#include <Enginio/private/enginiodummyreply_p.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qtimer.h>
+#include <QtNetwork/qnetworkaccessmanager.h>
+#include <QtNetwork/qnetworkrequest.h>
+
+QT_BEGIN_NAMESPACE
+
+class EnginioClientConnectionPrivate;
+class QHttpMultiPart;
+class QIODevice;
+
+/*!
+  \internal
+  Stands in for a request that waits in EnginioRequestScheduler. It carries
+  the request, so the request id is known right away, and is replaced by the
+  real reply once the request is sent. A chunked upload uses it the same way
+  while its chunks are in flight.
+*/
+class ENGINIOCLIENT_EXPORT EnginioQueuedReply : public EnginioDummyReply
+{
+public:
+    EnginioQueuedReply(const QNetworkRequest &request, QNetworkAccessManager::Operation operation);
+};
+
+/*!
+  \internal
+  Decides when the requests of a client are given to QNetworkAccessManager.
+
+  Every request belongs to one of the Enginio::RequestPriority classes. At
+  most maximalConcurrency() requests run at once, which by default matches
+  the connections QNetworkAccessManager opens to one host, so a waiting
+  request queues here, where its class is known, and not behind a file
+  upload in the network stack. Each class has a limit of its own as well.
+
+  A request is sent right away if there is room for it in its class and no
+  waiting request is about to take that room. Otherwise it waits, and its
+  priority can still be changed. A free slot goes to the waiting request of
+  the highest class, the oldest one first, and a request moves up one class
+  for every promotionInterval() it waits, so no class starves. A timer runs
+  until the next promotion, so a promoted request does not have to wait for
+  another reply to finish.
+*/
+class ENGINIOCLIENT_EXPORT EnginioRequestScheduler
+{
+public:
+    enum {
+        PriorityCount = Enginio::FileTransferPriority + 1,
+        DefaultMaximalConcurrency = 6,
+        DefaultPromotionInterval = 2000 // ms
+    };
+
+    struct Statistics
+    {
+        quint64 started[PriorityCount]; // by the class the request asked for
+        quint64 queued; // requests that could not be sent right away
+        quint64 promoted; // requests sent in a higher class than they asked for
+        int maximalRunning;
+    };
+
+    explicit EnginioRequestScheduler(EnginioClientConnectionPrivate *client);
+    ~EnginioRequestScheduler();
+
+    QNetworkReply *get(const QNetworkRequest &request, Enginio::RequestPriority priority);
+    QNetworkReply *post(const QNetworkRequest &request, const QByteArray &data, Enginio::RequestPriority priority);
+    QNetworkReply *post(const QNetworkRequest &request, QHttpMultiPart *multiPart, Enginio::RequestPriority priority);
+    QNetworkReply *put(const QNetworkRequest &request, const QByteArray &data, Enginio::RequestPriority priority);
+    QNetworkReply *put(const QNetworkRequest &request, QIODevice *device, Enginio::RequestPriority priority);
+    QNetworkReply *deleteResource(const QNetworkRequest &request, Enginio::RequestPriority priority);
+    QNetworkReply *sendCustomRequest(const QNetworkRequest &request, const QByteArray &verb, QIODevice *device, Enginio::RequestPriority priority);
+
+    Enginio::RequestPriority priority(QNetworkReply *reply) const Q_REQUIRED_RESULT;
+    void setPriority(QNetworkReply *reply, Enginio::RequestPriority priority);
+
+    int maximalConcurrency() const Q_REQUIRED_RESULT { return _maximalConcurrency; }
+    void setMaximalConcurrency(int requests);
+    int concurrencyLimit(Enginio::RequestPriority priority) const Q_REQUIRED_RESULT { return _limits[priority]; }
+    void setConcurrencyLimit(Enginio::RequestPriority priority, int requests);
+    int promotionInterval() const Q_REQUIRED_RESULT { return _promotionInterval; }
+    void setPromotionInterval(int msecs);
+
+    int runningCount() const Q_REQUIRED_RESULT { return _running.count(); }
+    int queuedCount() const Q_REQUIRED_RESULT { return _queue.count(); }
+    bool isQueued(QNetworkReply *reply) const Q_REQUIRED_RESULT;
+    Statistics statistics() const Q_REQUIRED_RESULT { return _statistics; }
+
+private:
+    struct Request
+    {
+        QPointer<QNetworkReply> placeholder; // gone if the reply was deleted while waiting
+        QNetworkRequest request;
+        QNetworkAccessManager::Operation operation;
+        QByteArray verb;
+        QByteArray data;
+        QPointer<QIODevice> device; // a child of the placeholder until sent
+        QPointer<QHttpMultiPart> multiPart; // likewise
+        Enginio::RequestPriority priority;
+        qint64 queuedAt;
+    };
+
+    struct ReplyGone
+    {
+        EnginioRequestScheduler *scheduler;
+        QNetworkReply *reply;
+        bool destroyed;
+        void operator ()()
+        {
+            scheduler->replyGone(reply, destroyed);
+        }
+    };
+
+    struct Pump
+    {
+        EnginioRequestScheduler *scheduler;
+        void operator ()()
+        {
+            scheduler->pump();
+        }
+    };
+
+    EnginioClientConnectionPrivate *_client;
+    QList<Request> _queue; // in the order the requests were made
+    QHash<QNetworkReply*, int> _running; // -> the class it was sent in
+    QHash<QNetworkReply*, Enginio::RequestPriority> _priorities;
+    int _runningInClass[PriorityCount];
+    int _limits[PriorityCount];
+    int _maximalConcurrency;
+    int _promotionInterval;
+    QElapsedTimer _clock;
+    QTimer _pumpTimer; // also the context of all connections
+    QTimer _promotionTimer;
+    Statistics _statistics;
+
+    QNetworkReply *schedule(Request &request);
+    bool canStart(int priority) const Q_REQUIRED_RESULT;
+    int effectivePriority(const Request &request, qint64 now) const Q_REQUIRED_RESULT;
+    QNetworkReply *start(const Request &request, int priority);
+    void track(QNetworkReply *reply, Enginio::RequestPriority priority);
+    void replyGone(QNetworkReply *reply, bool destroyed);
+    void schedulePump();
+    void schedulePromotion(qint64 now);
+    void pump();
+
+    Q_DISABLE_COPY(EnginioRequestScheduler)
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOREQUESTSCHEDULER_P_H
@@ -0,0 +1,289 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginioresponsecache_p.h>
+#include <Enginio/private/enginiostring_p.h>
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qsavefile.h>
+#include <QtNetwork/qnetworkreply.h>
+#include <QtNetwork/qnetworkrequest.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+const quint32 CacheFileMagic = 0x45524331; // "ERC1"
+
+} // namespace
+
+EnginioResponseCache::EnginioResponseCache(qint64 maximumSize)
+    : _maximumSize(maximumSize)
+    , _memoryUsed(0)
+{
+    _statistics.hits = 0;
+    _statistics.misses = 0;
+    _statistics.bytesSaved = 0;
+}
+
+EnginioResponseCache::~EnginioResponseCache()
+{
+    // Keep what is in memory for the next run.
+    if (!_directory.isEmpty()) {
+        for (QHash<QByteArray, Entry>::const_iterator i = _entries.constBegin(); i != _entries.constEnd(); ++i)
+            spill(i.key(), i.value());
+    }
+}
+
+void EnginioResponseCache::setMaximumSize(qint64 size)
+{
+    _maximumSize = size;
+    evict();
+}
+
+void EnginioResponseCache::setDirectory(const QString &path)
+{
+    if (_directory == path)
+        return;
+    _diskEntries.clear();
+    _directory = path;
+    if (!_directory.isEmpty()) {
+        QDir().mkpath(_directory);
+        readDirectory();
+    }
+}
+
+void EnginioResponseCache::clear()
+{
+    _entries.clear();
+    _lru.clear();
+    _memoryUsed = 0;
+    foreach (const QByteArray &key, _diskEntries.keys())
+        removeFromDisk(key);
+}
+
+EnginioResponseCache::Statistics EnginioResponseCache::statistics() const
+{
+    Statistics statistics = _statistics;
+    statistics.memoryEntries = _entries.count();
+    statistics.diskEntries = _diskEntries.count();
+    statistics.memoryUsed = _memoryUsed;
+    return statistics;
+}
+
+QByteArray EnginioResponseCache::key(const QNetworkRequest &request)
+{
+    // The X-Request-Id header differs for every request, so only the headers
+    // selecting the backend and the identity are part of the key.
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(request.rawHeader(QByteArrayLiteral("Enginio-Backend-Id")));
+    hash.addData("\n", 1);
+    hash.addData(request.rawHeader(EnginioString::Authorization));
+    hash.addData("\n", 1);
+    hash.addData(request.rawHeader(EnginioString::Enginio_Backend_Session));
+    hash.addData("\n", 1);
+    hash.addData(request.url().toEncoded());
+    return hash.result();
+}
+
+QString EnginioResponseCache::fileName(const QByteArray &key) const
+{
+    return _directory + QLatin1Char('/') + QString::fromLatin1(key.toHex());
+}
+
+void EnginioResponseCache::prepareRequest(QNetworkRequest *request) const
+{
+    request->setAttribute(CacheableAttribute, true);
+
+    const QByteArray k = key(*request);
+    Validators validators;
+    if (_entries.contains(k))
+        validators = _entries.value(k).validators;
+    else if (_diskEntries.contains(k))
+        validators = _diskEntries.value(k);
+    else
+        return;
+
+    if (!validators.eTag.isEmpty())
+        request->setRawHeader(QByteArrayLiteral("If-None-Match"), validators.eTag);
+    if (!validators.lastModified.isEmpty())
+        request->setRawHeader(QByteArrayLiteral("If-Modified-Since"), validators.lastModified);
+}
+
+bool EnginioResponseCache::notModified(const QNetworkRequest &request, QByteArray *body)
+{
+    const QByteArray k = key(request);
+    QHash<QByteArray, Entry>::iterator i = _entries.find(k);
+    if (i != _entries.end()) {
+        _lru.erase(i->position);
+        _lru.prepend(k);
+        i->position = _lru.begin();
+        *body = i->body;
+    } else if (_diskEntries.contains(k) && load(k, body)) {
+        insert(k, _diskEntries.value(k), *body);
+    } else {
+        // The entry was evicted while the request was in flight.
+        ++_statistics.misses;
+        return false;
+    }
+
+    ++_statistics.hits;
+    _statistics.bytesSaved += body->size();
+    return true;
+}
+
+void EnginioResponseCache::store(const QNetworkRequest &request, const QNetworkReply *reply, const QByteArray &body)
+{
+    ++_statistics.misses;
+
+    const QByteArray k = key(request);
+    Validators validators;
+    validators.eTag = reply->rawHeader(QByteArrayLiteral("ETag"));
+    validators.lastModified = reply->rawHeader(QByteArrayLiteral("Last-Modified"));
+    if (validators.eTag.isEmpty() && validators.lastModified.isEmpty()) {
+        remove(request);
+        return;
+    }
+
+    if (body.size() > _maximumSize) {
+        // Too big for the memory, but it still may be worth to keep it on disk.
+        remove(request);
+        Entry entry;
+        entry.validators = validators;
+        entry.body = body;
+        spill(k, entry);
+        return;
+    }
+    insert(k, validators, body);
+}
+
+void EnginioResponseCache::remove(const QNetworkRequest &request)
+{
+    const QByteArray k = key(request);
+    QHash<QByteArray, Entry>::iterator i = _entries.find(k);
+    if (i != _entries.end()) {
+        _memoryUsed -= i->body.size();
+        _lru.erase(i->position);
+        _entries.erase(i);
+    }
+    if (_diskEntries.contains(k))
+        removeFromDisk(k);
+}
+
+void EnginioResponseCache::insert(const QByteArray &key, const Validators &validators, const QByteArray &body)
+{
+    QHash<QByteArray, Entry>::iterator i = _entries.find(key);
+    if (i != _entries.end()) {
+        _memoryUsed -= i->body.size();
+        _lru.erase(i->position);
+    } else {
+        i = _entries.insert(key, Entry());
+    }
+
+    _lru.prepend(key);
+    i->position = _lru.begin();
+    i->validators = validators;
+    i->body = body;
+    _memoryUsed += body.size();
+    evict();
+}
+
+void EnginioResponseCache::evict()
+{
+    while (_memoryUsed > _maximumSize && !_lru.isEmpty()) {
+        const QByteArray key = _lru.takeLast();
+        const Entry entry = _entries.take(key);
+        _memoryUsed -= entry.body.size();
+        spill(key, entry);
+    }
+}
+
+void EnginioResponseCache::spill(const QByteArray &key, const Entry &entry)
+{
+    if (_directory.isEmpty())
+        return;
+
+    QSaveFile file(fileName(key));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    QDataStream stream(&file);
+    stream << CacheFileMagic << entry.validators.eTag << entry.validators.lastModified << entry.body;
+    if (file.commit())
+        _diskEntries.insert(key, entry.validators);
+}
+
+bool EnginioResponseCache::load(const QByteArray &key, QByteArray *body)
+{
+    QFile file(fileName(key));
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+        quint32 magic;
+        Validators validators;
+        stream >> magic >> validators.eTag >> validators.lastModified >> *body;
+        if (magic == CacheFileMagic && stream.status() == QDataStream::Ok)
+            return true;
+    }
+    removeFromDisk(key);
+    return false;
+}
+
+void EnginioResponseCache::removeFromDisk(const QByteArray &key)
+{
+    QFile::remove(fileName(key));
+    _diskEntries.remove(key);
+}
+
+void EnginioResponseCache::readDirectory()
+{
+    // Only the validators are read, bodies are loaded on demand.
+    const QStringList files = QDir(_directory).entryList(QDir::Files);
+    foreach (const QString &name, files) {
+        const QByteArray key = QByteArray::fromHex(name.toLatin1());
+        if (key.size() != 20)
+            continue;
+        QFile file(fileName(key));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        QDataStream stream(&file);
+        quint32 magic;
+        Validators validators;
+        stream >> magic >> validators.eTag >> validators.lastModified;
+        if (magic == CacheFileMagic && stream.status() == QDataStream::Ok)
+            _diskEntries.insert(key, validators);
+    }
+}
+
+QT_END_NAMESPACE
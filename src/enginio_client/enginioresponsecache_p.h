@@ -0,0 +1,134 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIORESPONSECACHE_P_H
+#define ENGINIORESPONSECACHE_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlinkedlist.h>
+#include <QtCore/qstring.h>
+#include <QtNetwork/qnetworkrequest.h>
+
+QT_BEGIN_NAMESPACE
+
+class QNetworkReply;
+
+/*!
+  \internal
+  Cache of GET responses which can be revalidated with the server.
+
+  Only responses carrying an ETag or a Last-Modified header are stored. Every
+  request for a cached url is still sent, but as a conditional request, so the
+  server decides whether the cached body is up to date; a 304 answer is then
+  served from the cache. Entries are keyed by the backend id, the identity
+  headers and the full url, and kept in a LRU list bounded by the size of the
+  bodies. If a directory is set, entries evicted from memory are written there
+  and remain usable until they are replaced.
+*/
+class ENGINIOCLIENT_EXPORT EnginioResponseCache
+{
+public:
+    struct Statistics
+    {
+        quint64 hits;
+        quint64 misses;
+        quint64 bytesSaved;
+        int memoryEntries;
+        int diskEntries;
+        qint64 memoryUsed;
+    };
+
+    enum { DefaultMaximumSize = 2 * 1024 * 1024 };
+
+    // Set by prepareRequest(), only marked requests are cached. Applications
+    // count their own attributes up from QNetworkRequest::User, this one is
+    // taken from the top of the user range to stay clear of them.
+    static const QNetworkRequest::Attribute CacheableAttribute = QNetworkRequest::Attribute(QNetworkRequest::UserMax - 1);
+
+    explicit EnginioResponseCache(qint64 maximumSize = DefaultMaximumSize);
+    ~EnginioResponseCache();
+
+    qint64 maximumSize() const Q_REQUIRED_RESULT { return _maximumSize; }
+    void setMaximumSize(qint64 size);
+
+    QString directory() const Q_REQUIRED_RESULT { return _directory; }
+    void setDirectory(const QString &path);
+
+    void clear();
+    Statistics statistics() const Q_REQUIRED_RESULT;
+
+    void prepareRequest(QNetworkRequest *request) const;
+    bool notModified(const QNetworkRequest &request, QByteArray *body);
+    void store(const QNetworkRequest &request, const QNetworkReply *reply, const QByteArray &body);
+    void remove(const QNetworkRequest &request);
+
+private:
+    struct Validators
+    {
+        QByteArray eTag;
+        QByteArray lastModified;
+    };
+
+    struct Entry
+    {
+        Validators validators;
+        QByteArray body;
+        QLinkedList<QByteArray>::iterator position;
+    };
+
+    qint64 _maximumSize;
+    qint64 _memoryUsed;
+    QString _directory;
+    QHash<QByteArray, Entry> _entries;
+    QLinkedList<QByteArray> _lru; // most recently used first
+    QHash<QByteArray, Validators> _diskEntries;
+    Statistics _statistics;
+
+    static QByteArray key(const QNetworkRequest &request);
+    QString fileName(const QByteArray &key) const;
+    void insert(const QByteArray &key, const Validators &validators, const QByteArray &body);
+    void evict();
+    void spill(const QByteArray &key, const Entry &entry);
+    bool load(const QByteArray &key, QByteArray *body);
+    void removeFromDisk(const QByteArray &key);
+    void readDirectory();
+
+    Q_DISABLE_COPY(EnginioResponseCache)
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIORESPONSECACHE_P_H
@@ -0,0 +1,240 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiosharedqueries_p.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginioreply_p.h>
+#include <Enginio/private/enginioresponsecache_p.h>
+
+#include <QtNetwork/qnetworkaccessmanager.h>
+
+QT_BEGIN_NAMESPACE
+
+EnginioSharedReply::EnginioSharedReply(const QNetworkRequest &request)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    open(QIODevice::ReadOnly);
+}
+
+struct EnginioSharedReplyFinished
+{
+    QNetworkAccessManager *_qnam;
+    EnginioSharedReply *_reply;
+    void operator ()()
+    {
+        _qnam->finished(_reply);
+    }
+};
+
+/*!
+  \internal
+  Finishes like \a source did, the body is given to the EnginioReply
+  directly. The finished signals are queued, just like the ones of
+  a QNetworkReply.
+*/
+void EnginioSharedReply::finish(QNetworkAccessManager *manager, const QNetworkReply *source, int status)
+{
+    QNetworkRequest sharedRequest = request();
+    sharedRequest.setAttribute(EnginioResponseCache::CacheableAttribute, false); // source updated the cache already
+    setRequest(sharedRequest);
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, status);
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, source->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    foreach (const RawHeaderPair &header, source->rawHeaderPairs())
+        setRawHeader(header.first, header.second);
+    if (source->error() != NoError)
+        setError(source->error(), source->errorString());
+    setFinished(true);
+
+    EnginioSharedReplyFinished finished = { manager, this };
+    QObject::connect(this, &EnginioSharedReply::finished, finished);
+    QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+EnginioSharedQueries::EnginioSharedQueries(EnginioClientConnectionPrivate *client)
+    : _client(client)
+{
+    Q_ASSERT(client);
+    _statistics.sent = 0;
+    _statistics.deduplicated = 0;
+}
+
+/*!
+  \internal
+  Two requests with the same key get the same answer. The key is the URL
+  together with every header except the request id, which covers the
+  backend, the session and the revalidation of a cached response.
+*/
+QByteArray EnginioSharedQueries::key(const QNetworkRequest &request)
+{
+    QByteArray key = request.url().toEncoded();
+    foreach (const QByteArray &name, request.rawHeaderList()) {
+        if (name == EnginioString::X_Request_Id)
+            continue;
+        key += '\n';
+        key += name;
+        key += ':';
+        key += request.rawHeader(name);
+    }
+    return key;
+}
+
+/*!
+  \internal
+  Returns a reply that waits for the query with \a key which is in flight,
+  or 0 if there is none and the request has to be sent.
+*/
+QNetworkReply *EnginioSharedQueries::join(const QByteArray &key, const QNetworkRequest &request, Enginio::RequestPriority priority)
+{
+    QNetworkReply *leader = _leaders.value(key).data();
+    if (!leader)
+        return 0;
+    QHash<QNetworkReply*, Flight>::iterator flight = _flights.find(leader);
+    if (flight == _flights.end())
+        return 0;
+
+    EnginioSharedReply *reply = new EnginioSharedReply(request);
+    Follower follower = { reply, priority };
+    flight->followers.append(follower);
+    // the query is as urgent as the most urgent request waiting for it
+    if (priority < _client->_scheduler->priority(leader))
+        _client->_scheduler->setPriority(leader, priority);
+    ++_statistics.deduplicated;
+    return reply;
+}
+
+void EnginioSharedQueries::add(const QByteArray &key, QNetworkReply *reply)
+{
+    Flight flight;
+    flight.key = key;
+    _flights.insert(reply, flight);
+    _leaders.insert(key, reply);
+    ++_statistics.sent;
+}
+
+/*!
+  \internal
+  Lets the requests which wait for \a reply wait for \a replacement, that
+  happens if the query was queued or had to be sent again.
+*/
+void EnginioSharedQueries::replace(QNetworkReply *reply, QNetworkReply *replacement)
+{
+    QHash<QNetworkReply*, Flight>::iterator i = _flights.find(reply);
+    if (i == _flights.end())
+        return;
+    const Flight flight = i.value();
+    _flights.erase(i);
+    _flights.insert(replacement, flight);
+    if (_leaders.value(flight.key) == reply)
+        _leaders.insert(flight.key, replacement);
+}
+
+/*!
+  \internal
+  Shares the answer of \a reply with the requests which waited for it. If
+  nobody waits for \a reply any more, \a ereply is 0, the requests are sent
+  after all.
+*/
+void EnginioSharedQueries::finish(QNetworkReply *reply, EnginioReplyState *ereply)
+{
+    QHash<QNetworkReply*, Flight>::iterator i = _flights.find(reply);
+    if (i == _flights.end())
+        return;
+    const Flight flight = i.value();
+    _flights.erase(i);
+    if (_leaders.value(flight.key) == reply)
+        _leaders.remove(flight.key);
+
+    if (!ereply) {
+        resend(flight);
+        return;
+    }
+
+    EnginioReplyStatePrivate *source = EnginioReplyStatePrivate::get(ereply);
+    bool parsed = false;
+    QJsonObject data;
+    foreach (const Follower &follower, flight.followers) {
+        EnginioSharedReply *shared = follower.reply.data();
+        EnginioRequestContext *context = shared ? _client->findRequestContext(shared) : 0;
+        if (!context || !context->reply)
+            continue;
+        if (!parsed) {
+            data = source->data(); // once for all of them
+            parsed = true;
+        }
+        EnginioReplyStatePrivate *target = EnginioReplyStatePrivate::get(context->reply);
+        target->_data = source->pData();
+        target->_dataComplete = true;
+        target->_parsedData = data;
+        target->_parsed = true;
+        shared->finish(_client->networkManager(), reply, source->backendStatus());
+    }
+}
+
+/*!
+  \internal
+  The queries in flight still answer the requests which wait for them, but
+  no new request joins them.
+*/
+void EnginioSharedQueries::invalidate()
+{
+    _leaders.clear();
+}
+
+void EnginioSharedQueries::resend(const Flight &flight)
+{
+    Flight next;
+    next.key = flight.key;
+    QNetworkReply *leader = 0;
+    foreach (const Follower &follower, flight.followers) {
+        EnginioSharedReply *shared = follower.reply.data();
+        EnginioRequestContext *context = shared ? _client->findRequestContext(shared) : 0;
+        if (!context || !context->reply)
+            continue;
+        if (leader) {
+            next.followers.append(follower);
+            continue;
+        }
+        leader = _client->_scheduler->get(shared->request(), follower.priority);
+        context->reply->setNetworkReply(leader); // aborts shared
+        --_statistics.deduplicated;
+    }
+    if (leader) {
+        _flights.insert(leader, next);
+        _leaders.insert(next.key, leader);
+        ++_statistics.sent;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOSHAREDQUERIES_P_H
+#define ENGINIOSHAREDQUERIES_P_H
+
+#include <Enginio/enginio.h>
+#include <Enginio/private/enginiodummyreply_p.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qpointer.h>
+#include <QtNetwork/qnetworkrequest.h>
+
+QT_BEGIN_NAMESPACE
+
+class EnginioClientConnectionPrivate;
+class QNetworkAccessManager;
+class EnginioReplyState;
+
+/*!
+  \internal
+  Stands in for a query that waits for the answer of an identical query
+  which is in flight already. It keeps its own request, and so its own
+  request id, and takes over the status, the headers and the error of the
+  other reply when that one finishes.
+*/
+class ENGINIOCLIENT_EXPORT EnginioSharedReply : public EnginioDummyReply
+{
+public:
+    explicit EnginioSharedReply(const QNetworkRequest &request);
+
+    void finish(QNetworkAccessManager *manager, const QNetworkReply *source, int status);
+};
+
+/*!
+  \internal
+  Single-flight for queries of one client.
+
+  A GET that is identical to one in flight, the same URL with the same
+  identity and backend, is not sent again. The caller gets an
+  EnginioSharedReply instead, and when the first reply finishes its body,
+  and the JSON parsed from it, is shared with every reply that waited for
+  it. If the first reply is deleted before it finished, the requests that
+  waited for it are sent after all, as one shared query again.
+
+  A write made through the same client ends the sharing, a query made after
+  it is sent again, as the answer in flight may not contain the write.
+*/
+class ENGINIOCLIENT_EXPORT EnginioSharedQueries
+{
+public:
+    struct Statistics
+    {
+        quint64 sent; // queries which went to the backend
+        quint64 deduplicated; // queries answered by one of those
+    };
+
+    explicit EnginioSharedQueries(EnginioClientConnectionPrivate *client);
+
+    static QByteArray key(const QNetworkRequest &request) Q_REQUIRED_RESULT;
+
+    QNetworkReply *join(const QByteArray &key, const QNetworkRequest &request, Enginio::RequestPriority priority);
+    void add(const QByteArray &key, QNetworkReply *reply);
+    void replace(QNetworkReply *reply, QNetworkReply *replacement);
+    void finish(QNetworkReply *reply, EnginioReplyState *ereply);
+    void invalidate();
+
+    int inFlightCount() const Q_REQUIRED_RESULT { return _flights.count(); }
+    Statistics statistics() const Q_REQUIRED_RESULT { return _statistics; }
+
+private:
+    struct Follower
+    {
+        QPointer<EnginioSharedReply> reply; // gone if nobody waits for it any more
+        Enginio::RequestPriority priority;
+    };
+
+    struct Flight
+    {
+        QByteArray key;
+        QList<Follower> followers;
+    };
+
+    EnginioClientConnectionPrivate *_client;
+    QHash<QByteArray, QPointer<QNetworkReply> > _leaders;
+    QHash<QNetworkReply*, Flight> _flights;
+    Statistics _statistics;
+
+    void resend(const Flight &flight);
+
+    Q_DISABLE_COPY(EnginioSharedQueries)
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOSHAREDQUERIES_P_H
@@ -50,8 +50,10 @@
     F(createdAt, "createdAt")\
     F(data, "data")\
     F(empty, "empty")\
+    F(errors, "errors")\
     F(event, "event")\
     F(expiringUrl, "expiringUrl")\
+    F(fields, "fields")\
     F(file, "file")\
     F(fileName, "fileName")\
     F(files, "files")\
@@ -60,12 +62,14 @@
     F(id, "id")\
     F(include, "include")\
     F(incomplete, "incomplete")\
+    F(index, "index")\
     F(length, "length")\
     F(limit, "limit")\
     F(member, "member")\
     F(members, "members")\
     F(message, "message")\
     F(messageType, "messageType")\
+    F(method, "method")\
     F(object, "object")\
     F(objectType, "objectType")\
     F(objectTypes, "objectTypes")\
@@ -73,9 +77,11 @@
     F(origin, "origin")\
     F(pageSize, "pageSize")\
     F(password, "password")\
+    F(path, "path")\
     F(payload, "payload")\
     F(propertyName, "propertyName")\
     F(query, "query")\
+    F(requests, "requests")\
     F(results, "results")\
     F(search, "search")\
     F(session, "session")\
@@ -93,6 +99,7 @@
     F(variant, "variant")\
     F(v1_auth_oauth2_token, "/v1/auth/oauth2/token")\
     F(v1_auth_identity, "/v1/auth/identity")\
+    F(v1_batch, "/v1/batch")\
 
 #define FOR_EACH_ENGINIO_BYTEARRAY(F)\
     F(X_Request_Id, "X-Request-Id")\
@@ -124,6 +131,8 @@
     F(Content_Range, "Content-Range")\
     F(Content_Type, "Content-Type")\
     F(Get, "GET")\
+    F(Post, "POST")\
+    F(Put, "PUT")\
     F(Accept, "Accept")\
     F(Bearer_, "Bearer ")\
     F(Authorization, "Authorization")\
@@ -0,0 +1,163 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiouploadjournal_p.h>
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qsavefile.h>
+
+QT_BEGIN_NAMESPACE
+
+EnginioUploadJournal::EnginioUploadJournal(const QString &fileName)
+    : _fileName(fileName)
+{
+    Q_ASSERT(!fileName.isEmpty());
+    read();
+}
+
+/*!
+  \internal
+  Adds \a entry to the journal, or replaces the one of the same file id.
+  Returns false if the journal could not be written.
+*/
+bool EnginioUploadJournal::record(const Entry &entry)
+{
+    Q_ASSERT(!entry.fileId.isEmpty());
+    _entries.insert(entry.fileId, entry);
+    return write();
+}
+
+bool EnginioUploadJournal::setConfirmed(const QString &fileId, qint64 confirmed)
+{
+    QMap<QString, Entry>::iterator i = _entries.find(fileId);
+    if (i == _entries.end() || i->confirmed == confirmed)
+        return true;
+    i->confirmed = confirmed;
+    return write();
+}
+
+bool EnginioUploadJournal::remove(const QString &fileId)
+{
+    if (!_entries.remove(fileId))
+        return true;
+    return write();
+}
+
+/*!
+  \internal
+  Fills in the path, size and modification time of the local file at \a path.
+  Returns false if there is no such file.
+*/
+bool EnginioUploadJournal::describe(const QString &path, Entry *entry)
+{
+    Q_ASSERT(entry);
+    const QFileInfo info(path);
+    if (!info.isFile())
+        return false;
+    entry->path = info.absoluteFilePath();
+    entry->size = info.size();
+    entry->modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+/*!
+  \internal
+  Returns true if the local file of \a entry is still the one whose upload
+  was recorded.
+*/
+bool EnginioUploadJournal::matches(const Entry &entry)
+{
+    Entry current;
+    return describe(entry.path, &current)
+            && current.size == entry.size
+            && current.modified == entry.modified
+            && entry.confirmed >= 0 && entry.confirmed < entry.size;
+}
+
+void EnginioUploadJournal::read()
+{
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QJsonObject journal = QJsonDocument::fromJson(file.readAll()).object();
+    if (journal[QStringLiteral("version")].toInt() != Version)
+        return;
+
+    foreach (const QJsonValue &value, journal[QStringLiteral("uploads")].toArray()) {
+        const QJsonObject upload = value.toObject();
+        Entry entry;
+        entry.backendId = upload[QStringLiteral("backendId")].toString().toUtf8();
+        entry.fileId = upload[QStringLiteral("fileId")].toString();
+        entry.path = upload[QStringLiteral("path")].toString();
+        entry.size = qint64(upload[QStringLiteral("size")].toDouble(-1));
+        entry.modified = qint64(upload[QStringLiteral("modified")].toDouble());
+        entry.confirmed = qint64(upload[QStringLiteral("confirmed")].toDouble(-1));
+        if (!entry.fileId.isEmpty() && !entry.path.isEmpty())
+            _entries.insert(entry.fileId, entry);
+    }
+}
+
+bool EnginioUploadJournal::write() const
+{
+    QJsonArray uploads;
+    foreach (const Entry &entry, _entries) {
+        QJsonObject upload;
+        upload[QStringLiteral("backendId")] = QString::fromUtf8(entry.backendId);
+        upload[QStringLiteral("fileId")] = entry.fileId;
+        upload[QStringLiteral("path")] = entry.path;
+        upload[QStringLiteral("size")] = double(entry.size);
+        upload[QStringLiteral("modified")] = double(entry.modified);
+        upload[QStringLiteral("confirmed")] = double(entry.confirmed);
+        uploads.append(upload);
+    }
+    QJsonObject journal;
+    journal[QStringLiteral("version")] = Version;
+    journal[QStringLiteral("uploads")] = uploads;
+
+    const QFileInfo info(_fileName);
+    if (!QDir().mkpath(info.absolutePath()))
+        return false;
+    QSaveFile file(_fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(journal).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOUPLOADJOURNAL_P_H
+#define ENGINIOUPLOADJOURNAL_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  On disk record of the chunked uploads that did not finish yet.
+
+  Every entry names the file object on the backend, the local file its
+  content comes from and how far the backend acknowledged it, the end of
+  the contiguous prefix of acknowledged chunks. The size and the time of
+  the last modification of the local file are recorded as well, an upload
+  is resumed only if the file did not change since.
+
+  The journal is a small JSON document, it is read once and replaced
+  atomically on every change. A journal file belongs to one client.
+*/
+class ENGINIOCLIENT_EXPORT EnginioUploadJournal
+{
+public:
+    enum { Version = 1 };
+
+    struct Entry
+    {
+        QByteArray backendId;
+        QString fileId;
+        QString path; // absolute
+        qint64 size;
+        qint64 modified; // ms since the epoch
+        qint64 confirmed; // bytes acknowledged from the start of the file
+    };
+
+    explicit EnginioUploadJournal(const QString &fileName);
+
+    QString fileName() const Q_REQUIRED_RESULT { return _fileName; }
+    QList<Entry> entries() const Q_REQUIRED_RESULT { return _entries.values(); }
+    bool contains(const QString &fileId) const Q_REQUIRED_RESULT { return _entries.contains(fileId); }
+
+    bool record(const Entry &entry);
+    bool setConfirmed(const QString &fileId, qint64 confirmed);
+    bool remove(const QString &fileId);
+
+    static bool describe(const QString &path, Entry *entry);
+    static bool matches(const Entry &entry) Q_REQUIRED_RESULT;
+
+private:
+    QString _fileName;
+    QMap<QString, Entry> _entries; // by file id
+
+    void read();
+    bool write() const;
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOUPLOADJOURNAL_P_H
@@ -0,0 +1,258 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiowebsocketdecoder_p.h>
+
+#include <QtCore/qendian.h>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+const uchar FIN = 0x80;
+const uchar RSV = 0x70;
+const uchar RSV1 = 0x40; // permessage-deflate, http://tools.ietf.org/html/rfc7692#section-6
+const uchar OPC = 0x0F;
+const uchar MSK = 0x80;
+const uchar LEN = 0x7F;
+
+const int DefaultHeaderLength = 2;
+const int NormalPayloadMarker = 126;
+const int LargePayloadMarker = 127;
+const int MaximumControlPayloadLength = 125;
+
+} // namespace
+
+EnginioWebSocketDecoder::EnginioWebSocketDecoder()
+    : _head()
+    , _tail()
+    , _parsed()
+    , _messageStart()
+    , _messageEnd()
+    , _messageOpcode()
+    , _inMessage(false)
+    , _messageCompressed(false)
+    , _compressionEnabled(false)
+    , _handshakeScanned()
+{}
+
+/*!
+  \internal
+  Returns a pointer to at least \a size writable bytes at the end of the
+  buffered data. The bytes actually written have to be passed to commit().
+*/
+char *EnginioWebSocketDecoder::reserve(int size)
+{
+    if (_buffer.size() - _tail < size) {
+        if (_head) {
+            // drop what was consumed, only the pending bytes move
+            const int pending = _tail - _head;
+            char *data = _buffer.data();
+            memmove(data, data + _head, pending);
+            _tail -= _head;
+            _parsed -= _head;
+            _messageStart -= _head;
+            _messageEnd -= _head;
+            _handshakeScanned = qMax(0, _handshakeScanned - _head);
+            _head = 0;
+        }
+        if (_buffer.size() - _tail < size)
+            _buffer.resize(qMax(_tail + size, 2 * _buffer.size()));
+    }
+    return _buffer.data() + _tail;
+}
+
+void EnginioWebSocketDecoder::commit(int size)
+{
+    Q_ASSERT(size >= 0 && _tail + size <= _buffer.size());
+    _tail += size;
+}
+
+void EnginioWebSocketDecoder::append(const char *data, int size)
+{
+    memcpy(reserve(size), data, size);
+    commit(size);
+}
+
+void EnginioWebSocketDecoder::clear()
+{
+    _head = _tail = _parsed = 0;
+    _messageStart = _messageEnd = 0;
+    _inMessage = false;
+    _messageCompressed = false;
+    _handshakeScanned = 0;
+}
+
+/*!
+  \internal
+  Takes the HTTP response to the opening handshake, including the empty
+  line closing it, into \a response. Returns false if the response is not
+  complete yet. Each received byte is scanned only once.
+*/
+bool EnginioWebSocketDecoder::takeHandshake(QByteArray *response)
+{
+    static const char Terminator[] = "\r\n\r\n";
+    const int terminatorLength = sizeof(Terminator) - 1;
+    const char *data = _buffer.constData();
+    for (int i = qMax(_head, _handshakeScanned); i + terminatorLength <= _tail; ++i) {
+        if (data[i] == '\r' && !memcmp(data + i, Terminator, terminatorLength)) {
+            const int end = i + terminatorLength;
+            *response = QByteArray(data + _head, end - _head);
+            _head = _parsed = _handshakeScanned = end;
+            return true;
+        }
+    }
+    _handshakeScanned = qMax(_head, _tail - terminatorLength + 1);
+    return false;
+}
+
+/*!
+  \internal
+  Decodes the next complete message or control frame into \a frame.
+*/
+EnginioWebSocketDecoder::Status EnginioWebSocketDecoder::next(Frame *frame)
+{
+    //     WebSocket Protocol (RFC6455)
+    //     Base Framing Protocol
+    //     http://tools.ietf.org/html/rfc6455#section-5.2
+    //
+    //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    //     +-+-+-+-+-------+-+-------------+-------------------------------+
+    //     |F|R|R|R| opcode|M| Payload len |    Extended payload length    |
+    //     |I|S|S|S|  (4)  |A|     (7)     |             (16/64)           |
+    //     |N|V|V|V|       |S|             |   (if payload len==126/127)   |
+    //     | |1|2|3|       |K|             |                               |
+    //     +-+-+-+-+-------+-+-------------+ - - - - - - - - - - - - - - - +
+    //     |     Extended payload length continued, if payload len == 127  |
+    //     + - - - - - - - - - - - - - - - +-------------------------------+
+    //     |                               |Masking-key, if MASK set to 1  |
+    //     +-------------------------------+-------------------------------+
+    //     | Masking-key (continued)       |          Payload Data         |
+    //     +-------------------------------- - - - - - - - - - - - - - - - +
+    //     :                     Payload Data continued ...                :
+    //     + - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - +
+    //     |                     Payload Data continued ...                |
+    //     +---------------------------------------------------------------+
+
+    // the frame returned last time is not needed anymore
+    _head = _inMessage ? _messageStart : _parsed;
+
+    for (;;) {
+        char *data = _buffer.data();
+        const uchar *header = reinterpret_cast<const uchar*>(data + _parsed);
+        const int available = _tail - _parsed;
+        if (available < DefaultHeaderLength)
+            return NeedMoreData;
+
+        const bool isFinalFragment = header[0] & FIN;
+        const int opcode = header[0] & OPC;
+        const bool isCompressed = header[0] & RSV1;
+        if (header[0] & (_compressionEnabled ? RSV & ~RSV1 : RSV))
+            return ProtocolError; // no extension was negotiated that uses it
+        if (header[1] & MSK)
+            return ProtocolError; // a server must not mask frames
+
+        int headerLength = DefaultHeaderLength;
+        quint64 payloadLength = header[1] & LEN;
+        if (payloadLength == quint64(NormalPayloadMarker)) {
+            headerLength += 2;
+            if (available < headerLength)
+                return NeedMoreData;
+            payloadLength = qFromBigEndian<quint16>(header + DefaultHeaderLength);
+        } else if (payloadLength == quint64(LargePayloadMarker)) {
+            headerLength += 8;
+            if (available < headerLength)
+                return NeedMoreData;
+            payloadLength = qFromBigEndian<quint64>(header + DefaultHeaderLength);
+        }
+
+        const quint64 messageLength = payloadLength + (_inMessage && opcode == ContinuationFrameOp ? _messageEnd - _messageStart : 0);
+        if (messageLength > quint64(MaximumMessageSize))
+            return MessageTooBig;
+        const int length = int(payloadLength);
+        if (available - headerLength < length)
+            return NeedMoreData;
+
+        const int payloadStart = _parsed + headerLength;
+        _parsed = payloadStart + length;
+
+        if (opcode & 0x8) {
+            // control frames may come in between the fragments of a message
+            if (!isFinalFragment || isCompressed || length > MaximumControlPayloadLength)
+                return ProtocolError;
+            frame->opcode = opcode;
+            frame->payload = data + payloadStart;
+            frame->size = length;
+            frame->compressed = false;
+            return FrameDecoded;
+        }
+
+        if (opcode == ContinuationFrameOp) {
+            if (!_inMessage || isCompressed)
+                return ProtocolError; // RSV1 is only set on the first frame of a message
+            // join the payload with the previous fragments, over the header
+            memmove(data + _messageEnd, data + payloadStart, length);
+            _messageEnd += length;
+            if (!isFinalFragment)
+                continue;
+            _inMessage = false;
+            frame->opcode = _messageOpcode;
+            frame->payload = data + _messageStart;
+            frame->size = _messageEnd - _messageStart;
+            frame->compressed = _messageCompressed;
+            return FrameDecoded;
+        }
+
+        if (_inMessage)
+            return ProtocolError; // a new message before the last one was finished
+
+        if (!isFinalFragment) {
+            _inMessage = true;
+            _messageOpcode = opcode;
+            _messageCompressed = isCompressed;
+            _messageStart = payloadStart;
+            _messageEnd = _parsed;
+            continue;
+        }
+
+        frame->opcode = opcode;
+        frame->payload = data + payloadStart;
+        frame->size = length;
+        frame->compressed = isCompressed;
+        return FrameDecoded;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,124 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOWEBSOCKETDECODER_P_H
+#define ENGINIOWEBSOCKETDECODER_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  Decoder for the frames a WebSocket server sends (RFC 6455).
+
+  Everything the socket has is written straight into one buffer (reserve()
+  and commit()), headers are parsed in place and payloads are handed out as
+  views into that buffer. Fragments of a message are joined in the buffer
+  itself by moving each continuation payload over the header in front of it,
+  so a message is always contiguous and is not collected in a second buffer.
+  Control frames in between fragments are handed out as they arrive.
+  If permessage-deflate was negotiated (setCompressionEnabled()) messages
+  with the RSV1 bit are accepted and marked as compressed, inflating them is
+  left to EnginioWebSocketInflater.
+
+  Consumed bytes are dropped lazily: the buffer is only compacted when there
+  is not enough room left at its end, so in the steady state at most a partial
+  frame is moved. A Frame stays valid until the next call to next(),
+  reserve(), append() or clear().
+*/
+class ENGINIOCLIENT_EXPORT EnginioWebSocketDecoder
+{
+public:
+    enum Opcode {
+        ContinuationFrameOp = 0x0,
+        TextFrameOp = 0x1,
+        BinaryFrameOp = 0x2,
+        // %x3-7 are reserved for further non-control frames
+        ConnectionCloseOp = 0x8,
+        PingOp = 0x9,
+        PongOp = 0xA
+        // %xB-F are reserved for further control frames
+    };
+
+    enum Status {
+        NeedMoreData,
+        FrameDecoded,
+        ProtocolError,
+        MessageTooBig
+    };
+
+    struct Frame
+    {
+        int opcode;
+        const char *payload;
+        int size;
+        bool compressed;
+
+        QByteArray data() const { return QByteArray::fromRawData(payload, size); }
+    };
+
+    enum { MaximumMessageSize = 64 * 1024 * 1024 };
+
+    EnginioWebSocketDecoder();
+
+    char *reserve(int size);
+    void commit(int size);
+    void append(const char *data, int size);
+    void clear();
+    void setCompressionEnabled(bool enabled) { _compressionEnabled = enabled; }
+
+    bool takeHandshake(QByteArray *response);
+    Status next(Frame *frame);
+
+    int bufferedBytes() const Q_REQUIRED_RESULT { return _tail - _head; }
+
+private:
+    QByteArray _buffer;
+    int _head; // everything before can be dropped
+    int _tail; // end of the received data
+    int _parsed; // end of the last parsed frame
+    int _messageStart; // payload of a fragmented message, only while _inMessage
+    int _messageEnd;
+    int _messageOpcode;
+    bool _inMessage;
+    bool _messageCompressed;
+    bool _compressionEnabled;
+    int _handshakeScanned;
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOWEBSOCKETDECODER_P_H
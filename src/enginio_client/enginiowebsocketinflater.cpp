@@ -0,0 +1,136 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiowebsocketinflater_p.h>
+#include <Enginio/private/enginiowebsocketdecoder_p.h>
+
+#include <zlib.h>
+
+QT_BEGIN_NAMESPACE
+
+struct EnginioWebSocketInflater::Stream : public z_stream
+{
+};
+
+namespace {
+
+// Every message ends with an empty deflate block whose last four octets
+// are removed by the sender, http://tools.ietf.org/html/rfc7692#section-7.2.2
+const char MessageTail[] = { '\x00', '\x00', '\xff', '\xff' };
+
+const int MinimumOutputSpace = 4096;
+
+} // namespace
+
+EnginioWebSocketInflater::EnginioWebSocketInflater()
+    : _stream(0)
+    , _contextTakeover(true)
+{}
+
+EnginioWebSocketInflater::~EnginioWebSocketInflater()
+{
+    if (_stream) {
+        inflateEnd(_stream);
+        delete _stream;
+    }
+}
+
+/*!
+  \internal
+  Drops the compression context, the next message starts from scratch.
+*/
+void EnginioWebSocketInflater::reset()
+{
+    if (_stream)
+        inflateReset(_stream);
+}
+
+/*!
+  \internal
+  Inflates the payload of one compressed message, \a result is set to a
+  view into the internal output buffer. Returns false if the data is not a
+  valid deflate stream or would inflate beyond the maximum message size.
+*/
+bool EnginioWebSocketInflater::inflate(const char *data, int size, QByteArray *result)
+{
+    if (!_stream) {
+        _stream = new Stream;
+        _stream->zalloc = Z_NULL;
+        _stream->zfree = Z_NULL;
+        _stream->opaque = Z_NULL;
+        _stream->next_in = Z_NULL;
+        _stream->avail_in = 0;
+        // raw deflate data, the server may use any window size up to 15 bits
+        if (inflateInit2(_stream, -MAX_WBITS) != Z_OK) {
+            delete _stream;
+            _stream = 0;
+            return false;
+        }
+    }
+
+    int produced = 0;
+    const char *input[] = { data, MessageTail };
+    const int inputSize[] = { size, int(sizeof(MessageTail)) };
+    bool ok = true;
+    for (int i = 0; ok && i < 2; ++i) {
+        _stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input[i]));
+        _stream->avail_in = inputSize[i];
+        do {
+            if (_output.size() - produced < MinimumOutputSpace)
+                _output.resize(qMax(2 * _output.size(), produced + 4 * MinimumOutputSpace));
+            _stream->next_out = reinterpret_cast<Bytef*>(_output.data() + produced);
+            _stream->avail_out = _output.size() - produced;
+            const int status = ::inflate(_stream, Z_SYNC_FLUSH);
+            produced = _output.size() - _stream->avail_out;
+            if (status == Z_STREAM_END) {
+                // the server closed the deflate stream (BFINAL), the rest is ignored
+                inflateReset(_stream);
+                i = 2;
+                break;
+            }
+            if ((status != Z_OK && status != Z_BUF_ERROR) || produced > EnginioWebSocketDecoder::MaximumMessageSize) {
+                ok = false;
+                break;
+            }
+        } while (_stream->avail_in || !_stream->avail_out);
+    }
+
+    if (!ok || !_contextTakeover)
+        inflateReset(_stream);
+    if (!ok)
+        return false;
+    *result = QByteArray::fromRawData(_output.constData(), produced);
+    return true;
+}
+
+QT_END_NAMESPACE
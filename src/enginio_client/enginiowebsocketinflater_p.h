@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOWEBSOCKETINFLATER_P_H
+#define ENGINIOWEBSOCKETINFLATER_P_H
+
+#include <Enginio/enginioclient_global.h>
+
+#include <QtCore/qbytearray.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+  \internal
+  Inflates messages compressed with the permessage-deflate extension
+  (RFC 7692). One zlib stream is kept for the whole connection, so with
+  context takeover the server can refer back to earlier messages, which is
+  where most of the gain on notifications repeating the same keys comes
+  from. The output buffer is reused as well, a result stays valid until the
+  next call to inflate() or reset().
+*/
+class ENGINIOCLIENT_EXPORT EnginioWebSocketInflater
+{
+    Q_DISABLE_COPY(EnginioWebSocketInflater)
+
+public:
+    EnginioWebSocketInflater();
+    ~EnginioWebSocketInflater();
+
+    void setContextTakeover(bool takeover) { _contextTakeover = takeover; }
+    bool inflate(const char *data, int size, QByteArray *result);
+    void reset();
+
+private:
+    struct Stream;
+    Stream *_stream;
+    QByteArray _output;
+    bool _contextTakeover;
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINIOWEBSOCKETINFLATER_P_H
@@ -0,0 +1,145 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the QtEnginio module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <Enginio/private/enginiowebsocketmask_p.h>
+
+#include <QtCore/private/qsimd_p.h>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+// The key repeats every four bytes, so as long as whole words are processed
+// the same word (or vector of words) masks every position.
+
+inline void maskTail(uchar *destination, const uchar *source, int size, const uchar *maskingKey)
+{
+    for (int i = 0; i < size; ++i)
+        destination[i] = source[i] ^ maskingKey[i & 3];
+}
+
+int maskWords(uchar *destination, const uchar *source, int size, quint32 key)
+{
+    const quint64 key64 = quint64(key) << 32 | key;
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        memcpy(&word, source + i, 8);
+        word ^= key64;
+        memcpy(destination + i, &word, 8);
+    }
+    return i;
+}
+
+#if defined(__SSE2__)
+int maskSse2(uchar *destination, const uchar *source, int size, quint32 key)
+{
+    const __m128i mask = _mm_set1_epi32(int(key));
+    int i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i + 32));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_xor_si128(a, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i + 16), _mm_xor_si128(b, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i + 32), _mm_xor_si128(c, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i + 48), _mm_xor_si128(d, mask));
+    }
+    for (; i + 16 <= size; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_xor_si128(a, mask));
+    }
+    return i;
+}
+#endif
+
+#if defined(__AVX2__)
+#  define ENGINIO_MASK_AVX2 inline
+#elif defined(QT_COMPILER_SUPPORTS_HERE) && defined(QT_FUNCTION_TARGET)
+#  if QT_COMPILER_SUPPORTS_HERE(AVX2)
+     // compiled in, chosen at run time
+#    define ENGINIO_MASK_AVX2 QT_FUNCTION_TARGET(AVX2)
+#    define ENGINIO_MASK_AVX2_RUNTIME
+#  endif
+#endif
+
+#if defined(ENGINIO_MASK_AVX2)
+ENGINIO_MASK_AVX2 int maskAvx2(uchar *destination, const uchar *source, int size, quint32 key)
+{
+    const __m256i mask = _mm256_set1_epi32(int(key));
+    int i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i), _mm256_xor_si256(a, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i + 32), _mm256_xor_si256(b, mask));
+    }
+    for (; i + 32 <= size; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i), _mm256_xor_si256(a, mask));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+void enginioMaskWebSocketData(char *destination, const char *source, int size, const uchar *maskingKey)
+{
+    uchar *out = reinterpret_cast<uchar *>(destination);
+    const uchar *in = reinterpret_cast<const uchar *>(source);
+    // the key bytes in memory order, whatever the endianness
+    quint32 key;
+    memcpy(&key, maskingKey, 4);
+
+    int done = 0;
+#if defined(ENGINIO_MASK_AVX2_RUNTIME)
+    if (qCpuHasFeature(AVX2))
+        done = maskAvx2(out, in, size, key);
+#  if defined(__SSE2__)
+    else
+        done = maskSse2(out, in, size, key);
+#  endif
+#elif defined(ENGINIO_MASK_AVX2)
+    done = maskAvx2(out, in, size, key);
+#elif defined(__SSE2__)
+    done = maskSse2(out, in, size, key);
+#endif
+    done += maskWords(out + done, in + done, size - done, key);
+    maskTail(out + done, in + done, size - done, maskingKey);
+}
+
+QT_END_NAMESPACE
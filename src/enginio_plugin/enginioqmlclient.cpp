@@ -285,7 +285,7 @@ EnginioQmlReply *EnginioQmlClient::fullTextSearch(const QJSValue &query)
     Q_D(EnginioQmlClient);
 
     ObjectAdaptor<QJSValue> o(query, d);
-    QNetworkReply *nreply = d->query<QJSValue>(o, Enginio::SearchOperation);
+    QNetworkReply *nreply = d->query<QJSValue>(o, Enginio::SearchOperation, d->_queryPriority);
     EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
     return ereply;
 }
@@ -295,7 +295,7 @@ EnginioQmlReply *EnginioQmlClient::query(const QJSValue &query, const Enginio::O
     Q_D(EnginioQmlClient);
 
     ObjectAdaptor<QJSValue> o(query, d);
-    QNetworkReply *nreply = d->query<QJSValue>(o, operation);
+    QNetworkReply *nreply = d->query<QJSValue>(o, operation, d->_queryPriority);
     EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
     return ereply;
 }
@@ -308,7 +308,7 @@ EnginioQmlReply *EnginioQmlClient::create(const QJSValue &object, const Enginio:
         return 0;
 
     ObjectAdaptor<QJSValue> o(object, d);
-    QNetworkReply *nreply = d->create<QJSValue>(o, operation);
+    QNetworkReply *nreply = d->create<QJSValue>(o, operation, d->_writePriority);
     EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
 
     return ereply;
@@ -322,7 +322,7 @@ EnginioQmlReply *EnginioQmlClient::update(const QJSValue &object, const Enginio:
         return 0;
 
     ObjectAdaptor<QJSValue> o(object, d);
-    QNetworkReply *nreply = d->update<QJSValue>(o, operation);
+    QNetworkReply *nreply = d->update<QJSValue>(o, operation, d->_writePriority);
     EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
 
     return ereply;
@@ -336,7 +336,7 @@ EnginioQmlReply *EnginioQmlClient::remove(const QJSValue &object, const Enginio:
         return 0;
 
     ObjectAdaptor<QJSValue> o(object, d);
-    QNetworkReply *nreply = d->remove<QJSValue>(o, operation);
+    QNetworkReply *nreply = d->remove<QJSValue>(o, operation, d->_writePriority);
     EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
 
     return ereply;
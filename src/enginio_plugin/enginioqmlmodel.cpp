@@ -89,6 +89,66 @@ QT_BEGIN_NAMESPACE
   The operation used for the \l query.
 */
 
+/*!
+  \qmlproperty string EnginioModel::snapshotDirectory
+  The directory where the model keeps a snapshot of its rows.
+
+  When set, the rows of the last successful query are shown right away the
+  next time the same query is executed, until the backend answers.
+  \sa {EnginioModel::snapshotDirectory}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty bool EnginioModel::columnStorage
+  Whether the model keeps the value of every role in a separate column.
+
+  This makes reading roles from delegates cheaper, at the cost of memory.
+  \sa {EnginioModel::columnStorage}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty int EnginioModel::notificationInterval
+  How long, in milliseconds, backend notifications are collected and merged
+  before they are applied to the model.
+
+  The default 0 collects the notifications of one event loop pass, a negative
+  value applies each notification immediately.
+  \sa {EnginioModel::notificationInterval}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty bool EnginioModel::deltaSync
+  Whether executing the same query again only fetches the objects that
+  changed, instead of reloading all rows.
+  \sa {EnginioModel::deltaSync}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty real EnginioModel::resetThreshold
+  The share of the rows a new query result may remove, insert or move
+  before the model is reset, instead of being updated row by row.
+
+  The default is 0.25.
+  \sa {EnginioModel::resetThreshold}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty int EnginioModel::prefetchPages
+  The number of requests for further rows the model keeps on their way
+  when a view scrolls towards the end of the rows. 0, the default, loads
+  the whole result of the query at once.
+  \sa {EnginioModel::prefetchPages}{EnginioModel C++}
+*/
+
+/*!
+  \qmlproperty int EnginioModel::maximalLoadedPages
+  The number of pages a model with a \c pageSize in its query keeps
+  loaded, the pages farthest from the rows in view are dropped first.
+
+  The default is 8, the minimum 3.
+  \sa {EnginioModel::maximalLoadedPages}{EnginioModel C++}
+*/
+
 /*!
   \qmlmethod EnginioReply EnginioModel::append(QJSValue object)
   \include model-append.qdocinc
@@ -156,8 +216,8 @@ public:
 
     virtual QJsonObject replyData(const EnginioReplyState *reply) const Q_DECL_OVERRIDE
     {
-        QJSValue data = static_cast<const EnginioQmlReply*>(reply)->data();
-        return convert(data);
+        // use the parsed reply directly, without a round trip through the JS engine
+        return reply->data();
     }
 
     virtual QJsonValue queryData(const QString &name) Q_DECL_OVERRIDE
@@ -297,4 +357,109 @@ void EnginioQmlModel::setOperation(Enginio::Operation operation)
     emit operationChanged(operation);
 }
 
+QString EnginioQmlModel::snapshotDirectory() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->snapshotDirectory();
+}
+
+void EnginioQmlModel::setSnapshotDirectory(const QString &directory)
+{
+    Q_D(EnginioQmlModel);
+    if (directory == d->snapshotDirectory())
+        return;
+    d->setSnapshotDirectory(directory);
+    emit snapshotDirectoryChanged(directory);
+}
+
+bool EnginioQmlModel::columnStorage() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->columnStorage();
+}
+
+void EnginioQmlModel::setColumnStorage(bool enabled)
+{
+    Q_D(EnginioQmlModel);
+    if (enabled == d->columnStorage())
+        return;
+    d->setColumnStorage(enabled);
+    emit columnStorageChanged(enabled);
+}
+
+int EnginioQmlModel::notificationInterval() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->notificationInterval();
+}
+
+void EnginioQmlModel::setNotificationInterval(int interval)
+{
+    Q_D(EnginioQmlModel);
+    if (interval == d->notificationInterval())
+        return;
+    d->setNotificationInterval(interval);
+    emit notificationIntervalChanged(interval);
+}
+
+bool EnginioQmlModel::deltaSync() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->deltaSync();
+}
+
+void EnginioQmlModel::setDeltaSync(bool enabled)
+{
+    Q_D(EnginioQmlModel);
+    if (enabled == d->deltaSync())
+        return;
+    d->setDeltaSync(enabled);
+    emit deltaSyncChanged(enabled);
+}
+
+qreal EnginioQmlModel::resetThreshold() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->resetThreshold();
+}
+
+void EnginioQmlModel::setResetThreshold(qreal threshold)
+{
+    Q_D(EnginioQmlModel);
+    if (threshold == d->resetThreshold())
+        return;
+    d->setResetThreshold(threshold);
+    emit resetThresholdChanged(threshold);
+}
+
+int EnginioQmlModel::prefetchPages() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->prefetchPages();
+}
+
+void EnginioQmlModel::setPrefetchPages(int pages)
+{
+    Q_D(EnginioQmlModel);
+    if (pages == d->prefetchPages())
+        return;
+    d->setPrefetchPages(pages);
+    emit prefetchPagesChanged(pages);
+}
+
+int EnginioQmlModel::maximalLoadedPages() const
+{
+    Q_D(const EnginioQmlModel);
+    return d->maximalLoadedPages();
+}
+
+void EnginioQmlModel::setMaximalLoadedPages(int pages)
+{
+    Q_D(EnginioQmlModel);
+    const int previous = d->maximalLoadedPages();
+    d->setMaximalLoadedPages(pages);
+    if (d->maximalLoadedPages() != previous)
+        emit maximalLoadedPagesChanged(d->maximalLoadedPages());
+}
+
 QT_END_NAMESPACE
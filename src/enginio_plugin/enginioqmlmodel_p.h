@@ -58,6 +58,13 @@ public:
     Q_PROPERTY(QJSValue query READ query WRITE setQuery NOTIFY queryChanged)
     Q_PROPERTY(Enginio::Operation operation READ operation WRITE setOperation NOTIFY operationChanged)
     Q_PROPERTY(int rowCount READ rowCount NOTIFY rowCountChanged)
+    Q_PROPERTY(QString snapshotDirectory READ snapshotDirectory WRITE setSnapshotDirectory NOTIFY snapshotDirectoryChanged)
+    Q_PROPERTY(bool columnStorage READ columnStorage WRITE setColumnStorage NOTIFY columnStorageChanged)
+    Q_PROPERTY(int notificationInterval READ notificationInterval WRITE setNotificationInterval NOTIFY notificationIntervalChanged)
+    Q_PROPERTY(bool deltaSync READ deltaSync WRITE setDeltaSync NOTIFY deltaSyncChanged)
+    Q_PROPERTY(qreal resetThreshold READ resetThreshold WRITE setResetThreshold NOTIFY resetThresholdChanged)
+    Q_PROPERTY(int prefetchPages READ prefetchPages WRITE setPrefetchPages NOTIFY prefetchPagesChanged)
+    Q_PROPERTY(int maximalLoadedPages READ maximalLoadedPages WRITE setMaximalLoadedPages NOTIFY maximalLoadedPagesChanged)
 
     EnginioQmlClient *client() const Q_REQUIRED_RESULT;
     void setClient(const EnginioQmlClient *client);
@@ -68,6 +75,27 @@ public:
     Enginio::Operation operation() const Q_REQUIRED_RESULT;
     void setOperation(Enginio::Operation operation);
 
+    QString snapshotDirectory() const Q_REQUIRED_RESULT;
+    void setSnapshotDirectory(const QString &directory);
+
+    bool columnStorage() const Q_REQUIRED_RESULT;
+    void setColumnStorage(bool enabled);
+
+    int notificationInterval() const Q_REQUIRED_RESULT;
+    void setNotificationInterval(int interval);
+
+    bool deltaSync() const Q_REQUIRED_RESULT;
+    void setDeltaSync(bool enabled);
+
+    qreal resetThreshold() const Q_REQUIRED_RESULT;
+    void setResetThreshold(qreal threshold);
+
+    int prefetchPages() const Q_REQUIRED_RESULT;
+    void setPrefetchPages(int pages);
+
+    int maximalLoadedPages() const Q_REQUIRED_RESULT;
+    void setMaximalLoadedPages(int pages);
+
     Q_INVOKABLE EnginioQmlReply *append(const QJSValue &value);
     Q_INVOKABLE EnginioQmlReply *remove(int row);
     Q_INVOKABLE EnginioQmlReply *setProperty(int row, const QString &role, const QVariant &value);
@@ -78,6 +106,13 @@ Q_SIGNALS:
     void clientChanged(EnginioQmlClient *client);
     void operationChanged(Enginio::Operation operation);
     void rowCountChanged();
+    void snapshotDirectoryChanged(const QString &directory);
+    void columnStorageChanged(bool enabled);
+    void notificationIntervalChanged(int interval);
+    void deltaSyncChanged(bool enabled);
+    void resetThresholdChanged(qreal threshold);
+    void prefetchPagesChanged(int pages);
+    void maximalLoadedPagesChanged(int pages);
 
 private:
     Q_DECLARE_PRIVATE(EnginioQmlModel)
@@ -118,10 +118,7 @@ public:
 
     QJSValue data() const
     {
-        if (_data.isEmpty() && _nreply->isFinished())
-            _data = _nreply->readAll();
-
-        return static_cast<EnginioQmlClientPrivate*>(_client)->fromJson(_data);
+        return static_cast<EnginioQmlClientPrivate*>(_client)->fromJson(pData());
     }
 };
 
@@ -0,0 +1,300 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+
+#include <Enginio/private/enginiobasemodel_p.h>
+
+class tst_AttachedDataContainer: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initFromArray();
+    void removeRows();
+    void removeAndAppend_data();
+    void removeAndAppend();
+    void refAfterRemoval();
+    void requestIdFollowsRow();
+    void insertRows();
+    void moveRow();
+    void permuteRows();
+    void refFollowsMovedRow();
+
+private:
+    static QJsonArray objects(int count, int firstId = 0);
+    static void verify(const AttachedDataContainer &container, const QStringList &rows, const QStringList &removed);
+};
+
+QJsonArray tst_AttachedDataContainer::objects(int count, int firstId)
+{
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject object;
+        object[EnginioString::id] = QString::number(firstId + i);
+        array.append(object);
+    }
+    return array;
+}
+
+void tst_AttachedDataContainer::verify(const AttachedDataContainer &container, const QStringList &rows, const QStringList &removed)
+{
+    QCOMPARE(container.rowCount(), rows.count());
+    for (int row = 0; row < rows.count(); ++row) {
+        QVERIFY(container.contains(rows[row]));
+        QCOMPARE(container.rowFromObjectId(rows[row]), row);
+    }
+    foreach (const QString &id, removed) {
+        QVERIFY(container.contains(id));
+        QCOMPARE(container.rowFromObjectId(id), int(DeletedRow));
+    }
+}
+
+void tst_AttachedDataContainer::initFromArray()
+{
+    AttachedDataContainer container;
+    QCOMPARE(container.rowCount(), 0);
+
+    container.initFromArray(objects(100));
+    QStringList rows;
+    for (int i = 0; i < 100; ++i)
+        rows.append(QString::number(i));
+    verify(container, rows, QStringList());
+    QVERIFY(container.isSynced(42));
+
+    container.initFromArray(objects(3, 1000));
+    verify(container, QStringList() << "1000" << "1001" << "1002", QStringList());
+    QVERIFY(!container.contains("0"));
+}
+
+void tst_AttachedDataContainer::removeRows()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(10));
+    QStringList rows;
+    for (int i = 0; i < 10; ++i)
+        rows.append(QString::number(i));
+    QStringList removed;
+
+    container.removeRow(0);
+    removed << rows.takeAt(0);
+    verify(container, rows, removed);
+
+    container.removeRows(2, 3);
+    removed << rows.takeAt(2) << rows.takeAt(2) << rows.takeAt(2);
+    verify(container, rows, removed);
+
+    container.removeRow(rows.count() - 1);
+    removed << rows.takeLast();
+    verify(container, rows, removed);
+
+    container.removeRows(0, rows.count());
+    removed << rows;
+    rows.clear();
+    verify(container, rows, removed);
+}
+
+void tst_AttachedDataContainer::removeAndAppend_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("operations");
+    QTest::newRow("small") << 50 << 200;
+    // enough removals to compact the removed rows away
+    QTest::newRow("compacting") << 5000 << 6000;
+}
+
+void tst_AttachedDataContainer::removeAndAppend()
+{
+    QFETCH(int, count);
+    QFETCH(int, operations);
+
+    AttachedDataContainer container;
+    container.initFromArray(objects(count));
+    QStringList rows;
+    for (int i = 0; i < count; ++i)
+        rows.append(QString::number(i));
+    QStringList removed;
+    int nextId = count;
+
+    qsrand(count);
+    for (int i = 0; i < operations; ++i) {
+        if (rows.isEmpty() || qrand() % 4 == 0) {
+            const QString id = QString::number(nextId++);
+            container.insert(EnginioModelPrivateAttachedData(rows.count(), id));
+            rows.append(id);
+        } else {
+            const int first = qrand() % rows.count();
+            const int removedCount = 1 + qrand() % qMin(3, rows.count() - first);
+            container.removeRows(first, removedCount);
+            for (int j = 0; j < removedCount; ++j)
+                removed.append(rows.takeAt(first));
+        }
+        if (count < 100 || i % 500 == 0)
+            verify(container, rows, removed);
+    }
+    verify(container, rows, removed);
+}
+
+void tst_AttachedDataContainer::refAfterRemoval()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(5));
+
+    EnginioModelPrivateAttachedData &data = container.ref(QStringLiteral("3"), 3);
+    QCOMPARE(data.ref, 1u);
+    QVERIFY(!container.isSynced(3));
+
+    container.removeRow(1);
+    QVERIFY(!container.isSynced(2));
+    QCOMPARE(container.deref(QStringLiteral("3")).row, 2);
+    QVERIFY(container.isSynced(2));
+
+    container.ref(QStringLiteral("4"), 3);
+    container.removeRow(3);
+    QCOMPARE(container.deref(QStringLiteral("4")).row, int(DeletedRow));
+}
+
+void tst_AttachedDataContainer::requestIdFollowsRow()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(5));
+
+    container.insertRequestId(QStringLiteral("request"), 4);
+    container.removeRows(0, 2);
+    QCOMPARE(container.rowFromRequestId(QStringLiteral("request")), 2);
+    QCOMPARE(container.rowFromRequestId(QStringLiteral("unknown")), int(InvalidRow));
+
+    // a dummy row which got its real id keeps both ids on the same row
+    container.insert(EnginioModelPrivateAttachedData(3, QStringLiteral("tmp")));
+    container.insert(EnginioModelPrivateAttachedData(3, QStringLiteral("real")));
+    QCOMPARE(container.rowCount(), 4);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("tmp")), 3);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("real")), 3);
+    container.removeRow(0);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("tmp")), 2);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("real")), 2);
+}
+
+void tst_AttachedDataContainer::insertRows()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(5));
+    container.removeRow(1);
+    QStringList rows = QStringList() << "0" << "2" << "3" << "4";
+
+    container.insertRows(1, QVector<QString>() << "10" << "11");
+    rows.insert(1, "10");
+    rows.insert(2, "11");
+    verify(container, rows, QStringList() << "1");
+
+    container.insertRows(0, QVector<QString>() << "12");
+    rows.prepend("12");
+    container.insertRows(rows.count(), QVector<QString>() << "13");
+    rows.append("13");
+    verify(container, rows, QStringList() << "1");
+
+    // appending and removing still work on top of it
+    container.insert(EnginioModelPrivateAttachedData(rows.count(), "14"));
+    rows.append("14");
+    container.removeRows(2, 2);
+    QStringList removed = QStringList() << "1" << rows.takeAt(2) << rows.takeAt(2);
+    verify(container, rows, removed);
+}
+
+void tst_AttachedDataContainer::moveRow()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(6));
+    QStringList rows;
+    for (int i = 0; i < 6; ++i)
+        rows.append(QString::number(i));
+
+    container.moveRow(0, 4);
+    rows.move(0, 4);
+    verify(container, rows, QStringList());
+
+    container.moveRow(5, 1);
+    rows.move(5, 1);
+    verify(container, rows, QStringList());
+
+    container.removeRow(2);
+    const QString removed = rows.takeAt(2);
+    container.moveRow(3, 0);
+    rows.move(3, 0);
+    verify(container, rows, QStringList() << removed);
+}
+
+void tst_AttachedDataContainer::permuteRows()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(6));
+    container.removeRow(1);
+    QStringList rows = QStringList() << "0" << "2" << "3" << "4" << "5";
+    container.ref(QStringLiteral("4"), 3);
+    container.insertRequestId(QStringLiteral("request"), 3);
+
+    container.permuteRows(QVector<int>() << 3 << 0 << 4 << 2 << 1);
+    rows = QStringList() << "4" << "0" << "5" << "3" << "2";
+    verify(container, rows, QStringList() << "1");
+    QVERIFY(!container.isSynced(0));
+    QCOMPARE(container.rowFromRequestId(QStringLiteral("request")), 0);
+}
+
+void tst_AttachedDataContainer::refFollowsMovedRow()
+{
+    AttachedDataContainer container;
+    container.initFromArray(objects(5));
+
+    container.ref(QStringLiteral("3"), 3);
+    container.insertRequestId(QStringLiteral("request"), 3);
+
+    container.moveRow(3, 0);
+    QVERIFY(!container.isSynced(0));
+    QCOMPARE(container.rowFromRequestId(QStringLiteral("request")), 0);
+
+    container.insertRows(0, QVector<QString>() << "10");
+    QVERIFY(!container.isSynced(1));
+    QCOMPARE(container.deref(QStringLiteral("3")).row, 1);
+    QVERIFY(container.isSynced(1));
+
+    // both ids of a dummy row which got its real id move together
+    container.insert(EnginioModelPrivateAttachedData(1, QStringLiteral("alias")));
+    container.moveRow(1, 4);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("3")), 4);
+    QCOMPARE(container.rowFromObjectId(QStringLiteral("alias")), 4);
+}
+
+QTEST_MAIN(tst_AttachedDataContainer)
+#include "tst_attacheddatacontainer.moc"
@@ -2,9 +2,23 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
 #     cmake \
+    attacheddatacontainer \
+    chunkedupload \
+    deltasync \
     enginioclient \
+    enginioreply \
     notifications \
+    notificationhub \
     identity \
+    jsonstreamreader \
+    modeldiff \
+    modelnotifications \
+    prefetch \
+    requestscheduler \
+    responsecache \
+    sharedqueries \
+    websocketdecoder \
+    windowedpaging \
 
 qtHaveModule(gui) {
     SUBDIRS += files
@@ -0,0 +1,460 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+#include <QtCore/qtemporarydir.h>
+#include <QtCore/qtemporaryfile.h>
+#include <QtNetwork/qnetworkaccessmanager.h>
+#include <QtNetwork/qnetworkreply.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginioclient_p.h>
+
+#include "enginiolocalserver.h"
+
+struct UploadProgress
+{
+    qint64 *_progress;
+    qint64 _size;
+    void operator ()(qint64 progress, qint64 total)
+    {
+        QCOMPARE(total, _size);
+        QVERIFY(progress > *_progress);
+        *_progress = progress;
+    }
+};
+
+// Makes all chunks after the first ones fail, like a network that goes down
+struct FailChunksAfter
+{
+    EnginioTests::EnginioLocalServer *_server;
+    int *_chunks;
+    int _count;
+    void operator ()(const QByteArray &method, const QString &path)
+    {
+        Q_UNUSED(path);
+        if (method == "PUT" && ++*_chunks == _count + 1)
+            _server->failChunks(1000);
+    }
+};
+
+class tst_ChunkedUpload: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+    QTemporaryFile _file;
+    QByteArray _content;
+
+private slots:
+    void initTestCase();
+    void init();
+    void parallelChunks();
+    void windowOfOne();
+    void uploadWindow();
+    void failedChunkRetried();
+    void failedChunkGivesUp();
+    void replyDeleted();
+    void statistics();
+    void adaptiveChunkSize();
+    void multiPartBelowChunkSize();
+    void tuner();
+    void resumeFromJournal();
+    void resumeChangedFile();
+
+private:
+    static const int ChunkSize = 64 * 1024;
+    static const int ChunkCount = 11;
+
+    EnginioClientConnectionPrivate *prepareClient(EnginioClient *client, int window)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("chunkedupload"));
+        EnginioClientConnectionPrivate *clientPrivate = EnginioClientConnectionPrivate::get(client);
+        clientPrivate->_uploadTuner.setChunkSizeLimits(ChunkSize, ChunkSize);
+        client->setUploadWindow(window);
+        return clientPrivate;
+    }
+    EnginioReply *upload(EnginioClient *client, QString fileName = QString())
+    {
+        if (fileName.isEmpty())
+            fileName = _file.fileName();
+        QJsonObject fileObject;
+        fileObject["fileName"] = QStringLiteral("chunked.bin");
+        QJsonObject object;
+        object["file"] = fileObject;
+        return client->uploadFile(object, QUrl::fromLocalFile(fileName));
+    }
+    // an upload that gives up after the first chunks, it stays in the journal
+    QString interruptedUpload(const QString &journal, const QString &fileName, int chunks)
+    {
+        EnginioClient client;
+        prepareClient(&client, 1);
+        client.setUploadJournal(journal);
+        int sent = 0;
+        FailChunksAfter failChunks = { &_server, &sent, chunks };
+        QMetaObject::Connection connection = QObject::connect(&_server, &EnginioTests::EnginioLocalServer::requestReceived, failChunks);
+
+        EnginioReply *reply = upload(&client, fileName);
+        const bool finished = finishes(reply);
+        QObject::disconnect(connection);
+        _server.failChunks(0);
+        if (!finished || !reply->isError())
+            return QString();
+
+        const QList<EnginioUploadJournal::Entry> entries = EnginioUploadJournal(journal).entries();
+        if (entries.count() != 1 || entries.first().confirmed != chunks * ChunkSize)
+            return QString();
+        return entries.first().fileId;
+    }
+    QByteArray download(EnginioClient *client, const QString &fileId)
+    {
+        QJsonObject object;
+        object["id"] = fileId;
+        QScopedPointer<EnginioReply> reply(client->downloadUrl(object));
+        if (!finishes(reply.data()))
+            return QByteArray();
+        QNetworkAccessManager manager;
+        QScopedPointer<QNetworkReply> download(manager.get(QNetworkRequest(QUrl(reply->data()["expiringUrl"].toString()))));
+        if (!finishes(download.data()))
+            return QByteArray();
+        return download->readAll();
+    }
+    // QTRY_VERIFY can not be used in the helpers which return a value
+    template<class Reply>
+    static bool finishes(Reply *reply)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (!reply->isFinished() && timer.elapsed() < 10000)
+            QTest::qWait(10);
+        return reply->isFinished();
+    }
+    static int chunks(const QSignalSpy &requests)
+    {
+        int chunks = 0;
+        foreach (const QList<QVariant> &request, requests)
+            chunks += request.at(0).toByteArray() == QByteArrayLiteral("PUT");
+        return chunks;
+    }
+};
+
+void tst_ChunkedUpload::initTestCase()
+{
+    QVERIFY(_server.listen());
+    // not a multiple of the chunk size, the last chunk is a short one
+    _content.resize((ChunkCount - 1) * ChunkSize + 123);
+    for (int i = 0; i < _content.size(); ++i)
+        _content[i] = char(i * 7 + i / 251);
+    QVERIFY(_file.open());
+    QCOMPARE(_file.write(_content), qint64(_content.size()));
+    QVERIFY(_file.flush());
+}
+
+void tst_ChunkedUpload::init()
+{
+    _server.clear();
+    _server.failChunks(0);
+}
+
+void tst_ChunkedUpload::parallelChunks()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 4);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *reply = upload(&client);
+    qint64 progress = 0;
+    UploadProgress progressFunctor = { &progress, _content.size() };
+    QObject::connect(reply, &EnginioReply::progress, progressFunctor);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(reply->data()["status"].toString(), QStringLiteral("complete"));
+    QCOMPARE(progress, qint64(_content.size()));
+    QCOMPARE(chunks(requests), ChunkCount);
+    QCOMPARE(clientPrivate->_scheduler->statistics().maximalRunning, 4);
+    QVERIFY(clientPrivate->_chunkedUploads.isEmpty());
+
+    QCOMPARE(download(&client, reply->data()["id"].toString()), _content);
+}
+
+void tst_ChunkedUpload::windowOfOne()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 1);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(chunks(requests), ChunkCount);
+    QCOMPARE(clientPrivate->_scheduler->statistics().maximalRunning, 1);
+    QCOMPARE(download(&client, reply->data()["id"].toString()), _content);
+}
+
+void tst_ChunkedUpload::uploadWindow()
+{
+    EnginioClient client;
+    QCOMPARE(client.uploadWindow(), int(EnginioChunkedUpload::DefaultWindow));
+    QSignalSpy changed(&client, SIGNAL(uploadWindowChanged(int)));
+    client.setUploadWindow(2);
+    client.setUploadWindow(2);
+    client.setUploadWindow(0);
+    QCOMPARE(client.uploadWindow(), 1);
+    QCOMPARE(changed.count(), 2);
+    QCOMPARE(changed.at(1).at(0).toInt(), 1);
+
+    // a wider window than the default is not capped by the scheduler
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 6);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(chunks(requests), ChunkCount);
+    QCOMPARE(clientPrivate->_scheduler->statistics().maximalRunning, 6);
+}
+
+void tst_ChunkedUpload::failedChunkRetried()
+{
+    EnginioClient client;
+    prepareClient(&client, 4);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    QSignalSpy errors(&client, SIGNAL(error(EnginioReply*)));
+    _server.failChunks(2);
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(errors.count(), 0);
+    QCOMPARE(reply->data()["status"].toString(), QStringLiteral("complete"));
+    QCOMPARE(chunks(requests), ChunkCount + 2);
+    QCOMPARE(download(&client, reply->data()["id"].toString()), _content);
+}
+
+void tst_ChunkedUpload::failedChunkGivesUp()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 1);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    QSignalSpy errors(&client, SIGNAL(error(EnginioReply*)));
+    _server.failChunks(1000);
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(reply->isError());
+    QCOMPARE(reply->backendStatus(), 503);
+    QCOMPARE(errors.count(), 1);
+    QCOMPARE(chunks(requests), int(EnginioChunkedUpload::MaximalAttempts));
+    QVERIFY(clientPrivate->_chunkedUploads.isEmpty());
+}
+
+void tst_ChunkedUpload::replyDeleted()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 2);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(chunks(requests) > 0, 10000);
+    QCOMPARE(clientPrivate->_chunkedUploads.count(), 1);
+    delete reply;
+    QTRY_VERIFY(clientPrivate->_chunkedUploads.isEmpty());
+
+    const int sent = chunks(requests);
+    QTest::qWait(200);
+    QVERIFY(chunks(requests) <= sent + 2); // at most the ones in flight
+    QVERIFY(chunks(requests) < ChunkCount);
+}
+
+void tst_ChunkedUpload::statistics()
+{
+    EnginioClient client;
+    prepareClient(&client, 2);
+    _server.failChunks(1);
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    const QJsonObject statistics = reply->uploadStatistics();
+    QCOMPARE(statistics["chunks"].toInt(), ChunkCount);
+    QCOMPARE(statistics["retries"].toInt(), 1);
+    QCOMPARE(statistics["chunkSize"].toInt(), ChunkSize);
+    QCOMPARE(statistics["smallestChunkSize"].toInt(), ChunkSize);
+    QCOMPARE(statistics["largestChunkSize"].toInt(), ChunkSize);
+}
+
+void tst_ChunkedUpload::adaptiveChunkSize()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 1);
+    // a local link is fast, the chunks grow from the floor
+    clientPrivate->_uploadTuner.setChunkSizeLimits(16 * 1024, 16 * 1024);
+    clientPrivate->_uploadTuner.setChunkSizeLimits(16 * 1024, 256 * 1024);
+    QCOMPARE(clientPrivate->_uploadTuner.chunkSize(), qint64(16 * 1024));
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    const QJsonObject statistics = reply->uploadStatistics();
+    QCOMPARE(statistics["smallestChunkSize"].toInt(), 16 * 1024);
+    QVERIFY(statistics["largestChunkSize"].toInt() > statistics["smallestChunkSize"].toInt());
+    QVERIFY(statistics["largestChunkSize"].toInt() <= 256 * 1024);
+    QCOMPARE(chunks(requests), statistics["chunks"].toInt());
+    QVERIFY(statistics["chunks"].toInt() < _content.size() / (16 * 1024));
+    QVERIFY(clientPrivate->_uploadTuner.throughput() > 0);
+    QCOMPARE(download(&client, reply->data()["id"].toString()), _content);
+}
+
+void tst_ChunkedUpload::multiPartBelowChunkSize()
+{
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 4);
+    clientPrivate->_uploadTuner.setChunkSizeLimits(2 * _content.size(), 2 * _content.size());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    // the file is smaller than a chunk now
+    EnginioReply *reply = upload(&client);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(chunks(requests), 0);
+    QCOMPARE(requests.count(), 1);
+    QCOMPARE(reply->uploadStatistics()["chunks"].toInt(), 0);
+    QCOMPARE(download(&client, reply->data()["id"].toString()), _content);
+}
+
+void tst_ChunkedUpload::tuner()
+{
+    EnginioUploadTuner tuner;
+    QCOMPARE(tuner.chunkSize(), qint64(EnginioUploadTuner::DefaultChunkSize));
+    QCOMPARE(tuner.throughput(), qint64(0));
+
+    // 10 MB/s, the size doubles per chunk up to the ceiling
+    tuner.chunkSent(tuner.chunkSize(), tuner.chunkSize() / 10000 + 20, 20);
+    QCOMPARE(tuner.chunkSize(), qint64(2 * EnginioUploadTuner::DefaultChunkSize));
+    for (int i = 0; i < 10; ++i)
+        tuner.chunkSent(tuner.chunkSize(), tuner.chunkSize() / 10000 + 20, 20);
+    QCOMPARE(tuner.chunkSize(), qint64(EnginioUploadTuner::MaximalChunkSize));
+    QCOMPARE(tuner.roundTripTime(), qint64(20));
+
+    // a failure halves it
+    tuner.chunkFailed();
+    QCOMPARE(tuner.chunkSize(), qint64(EnginioUploadTuner::MaximalChunkSize / 2));
+
+    // 16 kB/s, two seconds of it are below the floor
+    EnginioUploadTuner slow;
+    for (int i = 0; i < 20; ++i)
+        slow.chunkSent(slow.chunkSize(), slow.chunkSize() * 1000 / 16000 + 100, 100);
+    QCOMPARE(slow.chunkSize(), qint64(EnginioUploadTuner::MinimalChunkSize));
+
+    // with a long round trip time a chunk takes eight of them from request
+    // to response, seven of them are spent sending at 100 kB/s
+    EnginioUploadTuner distant;
+    for (int i = 0; i < 20; ++i)
+        distant.chunkSent(distant.chunkSize(), distant.chunkSize() * 1000 / 100000 + 1000, 1000);
+    QCOMPARE(distant.roundTripTime(), qint64(1000));
+    QVERIFY(qAbs(distant.chunkSize() - 700000) < 1000);
+
+    distant.setChunkSizeLimits(1024, 4096);
+    QCOMPARE(distant.chunkSize(), qint64(4096));
+}
+
+void tst_ChunkedUpload::resumeFromJournal()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const QString journal = directory.path() + QStringLiteral("/uploads.journal");
+    const QString fileId = interruptedUpload(journal, _file.fileName(), 3);
+    QVERIFY(!fileId.isEmpty());
+
+    // the next start of the application
+    EnginioClient client;
+    EnginioClientConnectionPrivate *clientPrivate = prepareClient(&client, 2);
+    client.setUploadJournal(journal);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    const QList<EnginioReply *> replies = client.resumeUploads();
+    QCOMPARE(replies.count(), 1);
+    QVERIFY(client.resumeUploads().isEmpty()); // it is running already
+    EnginioReply *reply = replies.first();
+    qint64 progress = 3 * ChunkSize;
+    UploadProgress progressFunctor = { &progress, _content.size() };
+    QObject::connect(reply, &EnginioReply::progress, progressFunctor);
+    QTRY_VERIFY_WITH_TIMEOUT(reply->isFinished(), 10000);
+    QVERIFY(!reply->isError());
+    QCOMPARE(reply->data()["id"].toString(), fileId);
+    QCOMPARE(reply->data()["status"].toString(), QStringLiteral("complete"));
+    QCOMPARE(progress, qint64(_content.size()));
+    QCOMPARE(chunks(requests), ChunkCount - 3);
+    QVERIFY(clientPrivate->_chunkedUploads.isEmpty());
+    QVERIFY(EnginioUploadJournal(journal).entries().isEmpty());
+    QCOMPARE(download(&client, fileId), _content);
+}
+
+void tst_ChunkedUpload::resumeChangedFile()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const QString journal = directory.path() + QStringLiteral("/uploads.journal");
+    const QString fileName = directory.path() + QStringLiteral("/changed.bin");
+    QVERIFY(QFile::copy(_file.fileName(), fileName));
+    QVERIFY(!interruptedUpload(journal, fileName, 2).isEmpty());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::Append));
+    QVERIFY(file.write("changed") > 0);
+    file.close();
+
+    EnginioClient client;
+    prepareClient(&client, 2);
+    client.setUploadJournal(journal);
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    QVERIFY(client.resumeUploads().isEmpty());
+    QVERIFY(EnginioUploadJournal(journal).entries().isEmpty());
+
+    QCOMPARE(chunks(requests), 0);
+
+    // an other backend does not see the uploads of this one
+    QVERIFY(!interruptedUpload(journal, _file.fileName(), 1).isEmpty());
+    EnginioClient otherClient;
+    prepareClient(&otherClient, 2);
+    otherClient.setBackendId(QByteArrayLiteral("otherbackend"));
+    otherClient.setUploadJournal(journal);
+    QVERIFY(otherClient.resumeUploads().isEmpty());
+    QCOMPARE(EnginioUploadJournal(journal).entries().count(), 1);
+}
+
+QTEST_MAIN(tst_ChunkedUpload)
+#include "tst_chunkedupload.moc"
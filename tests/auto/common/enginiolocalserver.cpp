@@ -0,0 +1,1216 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "enginiolocalserver.h"
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtendian.h>
+#include <QtCore/qvector.h>
+#include <QtNetwork/qtcpsocket.h>
+
+#include <algorithm>
+#include <string.h>
+
+#include <zlib.h>
+
+namespace EnginioTests
+{
+
+namespace {
+
+const QByteArray WebSocketMagicString(QByteArrayLiteral("258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+
+enum {
+    ContinuationFrameOp = 0x0,
+    TextFrameOp = 0x1,
+    BinaryFrameOp = 0x2,
+    ConnectionCloseOp = 0x8,
+    PingOp = 0x9,
+    PongOp = 0xA
+};
+
+const char DeflateMessageTail[] = { '\x00', '\x00', '\xff', '\xff' };
+
+QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 101: return QByteArrayLiteral("Switching Protocols");
+    case 200: return QByteArrayLiteral("OK");
+    case 201: return QByteArrayLiteral("Created");
+    case 304: return QByteArrayLiteral("Not Modified");
+    case 400: return QByteArrayLiteral("Bad Request");
+    case 401: return QByteArrayLiteral("Unauthorized");
+    case 404: return QByteArrayLiteral("Not Found");
+    case 405: return QByteArrayLiteral("Method Not Allowed");
+    default: break;
+    }
+    return QByteArrayLiteral("Unknown");
+}
+
+QJsonValue valueAt(const QJsonObject &object, const QString &path)
+{
+    // Allows "creator.id" style property paths in queries and sort options.
+    const QStringList keys = path.split(QLatin1Char('.'));
+    QJsonValue value = object;
+    foreach (const QString &key, keys)
+        value = value.toObject().value(key);
+    return value;
+}
+
+int compareValues(const QJsonValue &a, const QJsonValue &b)
+{
+    if (a.isDouble() && b.isDouble()) {
+        const double left = a.toDouble();
+        const double right = b.toDouble();
+        return left < right ? -1 : (left > right ? 1 : 0);
+    }
+    if (a.isBool() && b.isBool())
+        return int(a.toBool()) - int(b.toBool());
+    // ISO 8601 time stamps produced by timestamp() are ordered lexicographically.
+    return QString::compare(a.toVariant().toString(), b.toVariant().toString());
+}
+
+bool matchesOperator(const QJsonValue &value, const QString &op, const QJsonValue &argument)
+{
+    if (op == QStringLiteral("$gt"))
+        return !value.isUndefined() && compareValues(value, argument) > 0;
+    if (op == QStringLiteral("$gte"))
+        return !value.isUndefined() && compareValues(value, argument) >= 0;
+    if (op == QStringLiteral("$lt"))
+        return !value.isUndefined() && compareValues(value, argument) < 0;
+    if (op == QStringLiteral("$lte"))
+        return !value.isUndefined() && compareValues(value, argument) <= 0;
+    if (op == QStringLiteral("$ne"))
+        return value != argument;
+    if (op == QStringLiteral("$in"))
+        return argument.toArray().contains(value);
+    if (op == QStringLiteral("$nin"))
+        return !argument.toArray().contains(value);
+    if (op == QStringLiteral("$exists"))
+        return argument.toBool() != value.isUndefined();
+    qWarning("EnginioLocalServer: unsupported query operator %s", qPrintable(op));
+    return false;
+}
+
+struct SortComparator
+{
+    QJsonArray sort;
+
+    bool operator ()(const QJsonObject &left, const QJsonObject &right) const
+    {
+        foreach (const QJsonValue &option, sort) {
+            const QJsonObject o = option.toObject();
+            const QString sortBy = o[QStringLiteral("sortBy")].toString();
+            const int result = compareValues(valueAt(left, sortBy), valueAt(right, sortBy));
+            if (result)
+                return o[QStringLiteral("direction")].toString() == QStringLiteral("desc") ? result > 0 : result < 0;
+        }
+        return false;
+    }
+};
+
+QJsonObject parseJson(const QString &value)
+{
+    return QJsonDocument::fromJson(value.toUtf8()).object();
+}
+
+} // namespace
+
+QJsonObject EnginioLocalServer::HttpRequest::json() const
+{
+    return QJsonDocument::fromJson(body).object();
+}
+
+EnginioLocalServer::EnginioLocalServer(QObject *parent)
+    : QObject(parent)
+    , _idCounter(0)
+    , _compressionEnabled(true)
+    , _failingChunks(0)
+    , _resultLimit(0)
+    , _fieldsSupported(true)
+{
+    resetStatistics();
+    QObject::connect(&_server, &QTcpServer::newConnection, this, &EnginioLocalServer::onNewConnection);
+}
+
+EnginioLocalServer::~EnginioLocalServer()
+{
+    close();
+}
+
+bool EnginioLocalServer::listen(const QHostAddress &address, quint16 port)
+{
+    return _server.listen(address, port);
+}
+
+void EnginioLocalServer::close()
+{
+    _server.close();
+    foreach (QTcpSocket *socket, _peers.keys()) {
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+    }
+    _peers.clear();
+}
+
+/*!
+  \internal
+  Aborts the notification streams without a close frame, like a lost
+  network connection would.
+*/
+void EnginioLocalServer::dropWebSockets()
+{
+    foreach (QTcpSocket *socket, _peers.keys()) {
+        if (!_peers.value(socket).webSocket)
+            continue;
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+        _peers.remove(socket);
+    }
+}
+
+bool EnginioLocalServer::isListening() const
+{
+    return _server.isListening();
+}
+
+QUrl EnginioLocalServer::url() const
+{
+    QUrl url;
+    url.setScheme(QStringLiteral("http"));
+    url.setHost(_server.serverAddress().toString());
+    url.setPort(_server.serverPort());
+    return url;
+}
+
+void EnginioLocalServer::clear()
+{
+    _collections.clear();
+    _members.clear();
+    _access.clear();
+    _files.clear();
+    _passwords.clear();
+}
+
+void EnginioLocalServer::setCompressionEnabled(bool enabled)
+{
+    _compressionEnabled = enabled;
+}
+
+bool EnginioLocalServer::isCompressionEnabled() const
+{
+    return _compressionEnabled;
+}
+
+void EnginioLocalServer::failChunks(int count)
+{
+    _failingChunks = count;
+}
+
+/*!
+  Answers every query with at most \a limit objects, like a backend with a
+  maximal page size. The count still covers all matches. 0 means no limit.
+*/
+void EnginioLocalServer::setResultLimit(int limit)
+{
+    _resultLimit = limit;
+}
+
+/*!
+  With \a supported false the "fields" parameter of queries is ignored and
+  whole objects are returned.
+*/
+void EnginioLocalServer::setFieldsSupported(bool supported)
+{
+    _fieldsSupported = supported;
+}
+
+EnginioLocalServer::Statistics EnginioLocalServer::statistics() const
+{
+    return _statistics;
+}
+
+void EnginioLocalServer::resetStatistics()
+{
+    _statistics.requests = 0;
+    _statistics.bytesReceived = 0;
+    _statistics.bytesSent = 0;
+    _statistics.notificationsSent = 0;
+    _statistics.notificationBytes = 0;
+    _statistics.notificationFrameBytes = 0;
+    _statistics.notModified = 0;
+}
+
+int EnginioLocalServer::objectCount(const QString &objectType) const
+{
+    return _collections.value(objectType).count();
+}
+
+QJsonObject EnginioLocalServer::insertObject(const QString &objectType, const QJsonObject &object)
+{
+    return store(objectType, object, QByteArray());
+}
+
+void EnginioLocalServer::onNewConnection()
+{
+    while (QTcpSocket *socket = _server.nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        _peers.insert(socket, Peer());
+        QObject::connect(socket, &QTcpSocket::readyRead, this, &EnginioLocalServer::onReadyRead);
+        QObject::connect(socket, &QTcpSocket::disconnected, this, &EnginioLocalServer::onDisconnected);
+    }
+}
+
+void EnginioLocalServer::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    Q_ASSERT(socket);
+    _peers.remove(socket);
+    socket->deleteLater();
+}
+
+void EnginioLocalServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    Q_ASSERT(socket);
+    if (!_peers.contains(socket))
+        return;
+
+    Peer &peer = _peers[socket];
+    const QByteArray data = socket->readAll();
+    _statistics.bytesReceived += data.size();
+    peer.buffer.append(data);
+
+    HttpRequest request;
+    while (!peer.webSocket && readHttpRequest(socket, peer, &request)) {
+        ++_statistics.requests;
+        emit requestReceived(request.method, request.path);
+        if (request.header("upgrade").toLower() == "websocket") {
+            upgradeToWebSocket(socket, peer, request);
+            break;
+        }
+        HttpResponse response = dispatch(request);
+        applyConditions(request, &response);
+        sendResponse(socket, request, response);
+        request = HttpRequest();
+    }
+
+    if (peer.webSocket)
+        readWebSocketFrames(socket, peer);
+}
+
+bool EnginioLocalServer::readHttpRequest(QTcpSocket *socket, Peer &peer, HttpRequest *request)
+{
+    const int headerEnd = peer.buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return false;
+
+    const QList<QByteArray> lines = peer.buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.count() < 3) {
+        qWarning("EnginioLocalServer: malformed request line, closing connection");
+        peer.buffer.clear();
+        QMetaObject::invokeMethod(socket, "disconnectFromHost", Qt::QueuedConnection);
+        return false;
+    }
+
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.count(); ++i) {
+        const QByteArray &line = lines.at(i);
+        const int colon = line.indexOf(':');
+        if (colon <= 0)
+            continue;
+        headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+    }
+
+    const int bodyStart = headerEnd + 4;
+    const int contentLength = headers.value("content-length").toInt();
+    if (peer.buffer.size() < bodyStart + contentLength)
+        return false;
+
+    const QUrl url(QString::fromLatin1(requestLine.at(1)));
+    request->method = requestLine.at(0);
+    request->path = url.path();
+    request->query = QUrlQuery(url);
+    request->headers = headers;
+    request->body = peer.buffer.mid(bodyStart, contentLength);
+    peer.buffer.remove(0, bodyStart + contentLength);
+    return true;
+}
+
+void EnginioLocalServer::sendResponse(QTcpSocket *socket, const HttpRequest &request, const HttpResponse &response)
+{
+    const bool hasBody = response.status != 304 && request.method != "HEAD";
+
+    QByteArray message;
+    message.reserve(256 + response.body.size());
+    message += "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    if (hasBody)
+        message += "Content-Type: " + response.contentType + "\r\n";
+    message += "Content-Length: " + QByteArray::number(hasBody ? response.body.size() : 0) + "\r\n";
+    for (int i = 0; i < response.headers.count(); ++i)
+        message += response.headers.at(i).first + ": " + response.headers.at(i).second + "\r\n";
+    message += "Connection: keep-alive\r\n\r\n";
+    if (hasBody)
+        message += response.body;
+
+    _statistics.bytesSent += message.size();
+    socket->write(message);
+}
+
+void EnginioLocalServer::applyConditions(const HttpRequest &request, HttpResponse *response)
+{
+    if (request.method != "GET" || response->status != 200)
+        return;
+
+    const QByteArray eTag = '"' + QCryptographicHash::hash(response->body, QCryptographicHash::Sha1).toHex() + '"';
+    response->headers.append(qMakePair(QByteArrayLiteral("ETag"), eTag));
+    if (request.header("if-none-match") == eTag) {
+        response->status = 304;
+        response->body.clear();
+        ++_statistics.notModified;
+    }
+}
+
+/*!
+  \internal
+  One deflate stream per WebSocket peer, kept for the whole connection
+  (context takeover).
+*/
+struct EnginioLocalServer::Deflater
+{
+    z_stream stream;
+
+    Deflater()
+    {
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        const int status = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        Q_ASSERT(status == Z_OK);
+        Q_UNUSED(status);
+    }
+
+    ~Deflater()
+    {
+        deflateEnd(&stream);
+    }
+
+    QByteArray deflate(const QByteArray &message)
+    {
+        // http://tools.ietf.org/html/rfc7692#section-7.2.1
+        QByteArray result(int(deflateBound(&stream, message.size())) + 16, Qt::Uninitialized);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(message.constData()));
+        stream.avail_in = message.size();
+        int produced = 0;
+        do {
+            if (result.size() - produced < 64)
+                result.resize(2 * result.size());
+            stream.next_out = reinterpret_cast<Bytef*>(result.data() + produced);
+            stream.avail_out = result.size() - produced;
+            ::deflate(&stream, Z_SYNC_FLUSH);
+            produced = result.size() - stream.avail_out;
+        } while (stream.avail_in || !stream.avail_out);
+        // the empty block closing the flush is left out
+        Q_ASSERT(produced >= 4 && !memcmp(result.constData() + produced - 4, DeflateMessageTail, sizeof(DeflateMessageTail)));
+        result.resize(produced - 4);
+        return result;
+    }
+
+private:
+    Q_DISABLE_COPY(Deflater)
+};
+
+void EnginioLocalServer::upgradeToWebSocket(QTcpSocket *socket, Peer &peer, const HttpRequest &request)
+{
+    // http://tools.ietf.org/html/rfc6455#section-4.2.2
+    const QByteArray key = request.header("sec-websocket-key");
+    const QByteArray accept = QCryptographicHash::hash(key + WebSocketMagicString, QCryptographicHash::Sha1).toBase64();
+
+    QByteArray message;
+    message += "HTTP/1.1 101 Switching Protocols\r\n";
+    message += "Upgrade: websocket\r\n";
+    message += "Connection: Upgrade\r\n";
+    message += "Sec-WebSocket-Accept: " + accept + "\r\n";
+    // http://tools.ietf.org/html/rfc7692#section-7.1, the offered parameters
+    // are not needed, context takeover and the full window are the defaults.
+    if (_compressionEnabled && request.header("sec-websocket-extensions").contains("permessage-deflate")) {
+        message += "Sec-WebSocket-Extensions: permessage-deflate\r\n";
+        peer.deflater = QSharedPointer<Deflater>(new Deflater);
+    }
+    message += "\r\n";
+    _statistics.bytesSent += message.size();
+    socket->write(message);
+
+    peer.webSocket = true;
+    peer.filter = parseJson(request.query.queryItemValue(QStringLiteral("filter"), QUrl::FullyDecoded));
+}
+
+void EnginioLocalServer::readWebSocketFrames(QTcpSocket *socket, Peer &peer)
+{
+    forever {
+        const int available = peer.buffer.size();
+        if (available < 2)
+            return;
+
+        const uchar *data = reinterpret_cast<const uchar*>(peer.buffer.constData());
+        const bool isFinalFragment = data[0] & 0x80;
+        const int opcode = data[0] & 0x0F;
+        const bool isMasked = data[1] & 0x80;
+        quint64 length = data[1] & 0x7F;
+        int offset = 2;
+        if (length == 126) {
+            if (available < 4)
+                return;
+            length = qFromBigEndian<quint16>(data + 2);
+            offset = 4;
+        } else if (length == 127) {
+            if (available < 10)
+                return;
+            length = qFromBigEndian<quint64>(data + 2);
+            offset = 10;
+        }
+        const int maskOffset = offset;
+        if (isMasked)
+            offset += 4;
+        if (quint64(available) < offset + length)
+            return;
+
+        QByteArray payload = peer.buffer.mid(offset, length);
+        if (isMasked) {
+            const uchar *mask = data + maskOffset;
+            for (int i = 0; i < payload.size(); ++i)
+                payload[i] = payload.at(i) ^ mask[i % 4];
+        }
+        peer.buffer.remove(0, offset + length);
+
+        switch (opcode) {
+        case ContinuationFrameOp:
+        case TextFrameOp:
+        case BinaryFrameOp:
+            peer.message.append(payload);
+            if (isFinalFragment) {
+                // Clients may replace the filter of an established stream.
+                const QJsonObject message = QJsonDocument::fromJson(peer.message).object();
+                if (message.contains(QStringLiteral("filter")))
+                    peer.filter = message[QStringLiteral("filter")].toObject();
+                peer.message.clear();
+            }
+            break;
+        case ConnectionCloseOp:
+            sendFrame(socket, ConnectionCloseOp, payload.left(2));
+            QMetaObject::invokeMethod(socket, "disconnectFromHost", Qt::QueuedConnection);
+            return;
+        case PingOp:
+            sendFrame(socket, PongOp, payload);
+            break;
+        case PongOp:
+            break;
+        default:
+            qWarning("EnginioLocalServer: unsupported WebSocket opcode %d", opcode);
+            QMetaObject::invokeMethod(socket, "disconnectFromHost", Qt::QueuedConnection);
+            return;
+        }
+    }
+}
+
+int EnginioLocalServer::sendFrame(QTcpSocket *socket, int opcode, const QByteArray &payload, bool compressed)
+{
+    // Server-to-client frames are never masked.
+    QByteArray frame;
+    frame.reserve(payload.size() + 10);
+    frame.append(char(0x80 | (compressed ? 0x40 : 0) | opcode));
+    if (payload.size() < 126) {
+        frame.append(char(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.append(char(126));
+        uchar length[2];
+        qToBigEndian<quint16>(payload.size(), length);
+        frame.append(reinterpret_cast<char*>(length), 2);
+    } else {
+        frame.append(char(127));
+        uchar length[8];
+        qToBigEndian<quint64>(payload.size(), length);
+        frame.append(reinterpret_cast<char*>(length), 8);
+    }
+    frame.append(payload);
+    _statistics.bytesSent += frame.size();
+    socket->write(frame);
+    return frame.size();
+}
+
+void EnginioLocalServer::notify(const QString &event, const QJsonObject &object, const QByteArray &requestId)
+{
+    QJsonObject origin;
+    origin[QStringLiteral("apiRequestId")] = QString::fromUtf8(requestId);
+
+    QJsonObject message;
+    message[QStringLiteral("event")] = event;
+    message[QStringLiteral("data")] = object;
+    message[QStringLiteral("origin")] = origin;
+    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    for (QHash<QTcpSocket*, Peer>::const_iterator i = _peers.constBegin(); i != _peers.constEnd(); ++i) {
+        const Peer &peer = i.value();
+        if (!peer.webSocket)
+            continue;
+        const QString filterEvent = peer.filter[QStringLiteral("event")].toString();
+        if (!filterEvent.isEmpty() && filterEvent != event)
+            continue;
+        if (!matches(object, peer.filter[QStringLiteral("data")].toObject()))
+            continue;
+        if (peer.deflater)
+            _statistics.notificationFrameBytes += sendFrame(i.key(), TextFrameOp, peer.deflater->deflate(payload), /* compressed */ true);
+        else
+            _statistics.notificationFrameBytes += sendFrame(i.key(), TextFrameOp, payload);
+        _statistics.notificationBytes += payload.size();
+        ++_statistics.notificationsSent;
+    }
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::dispatch(const HttpRequest &request)
+{
+    const QStringList segments = request.path.split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if (segments.value(0) != QStringLiteral("v1"))
+        return error(404, QStringLiteral("Unknown path"));
+
+    const QString resource = segments.value(1);
+    if (resource == QStringLiteral("objects")) {
+        if (segments.count() < 3)
+            return error(400, QStringLiteral("Missing object type"));
+        return handleCollection(request, QStringLiteral("objects.") + segments.at(2), segments, 3);
+    }
+    if (resource == QStringLiteral("users"))
+        return handleCollection(request, resource, segments, 2);
+    if (resource == QStringLiteral("usergroups")) {
+        if (segments.value(3) == QStringLiteral("members"))
+            return handleUsergroupMembers(request, segments.at(2));
+        return handleCollection(request, resource, segments, 2);
+    }
+    if (resource == QStringLiteral("files"))
+        return handleFiles(request, segments);
+    if (resource == QStringLiteral("search"))
+        return handleSearch(request);
+    if (resource == QStringLiteral("batch"))
+        return handleBatch(request);
+    if (resource == QStringLiteral("stream_url")) {
+        QUrl streamUrl = url();
+        streamUrl.setScheme(QStringLiteral("ws"));
+        streamUrl.setPath(QStringLiteral("/v1/stream"));
+        QUrlQuery query;
+        query.addQueryItem(QStringLiteral("filter"), request.query.queryItemValue(QStringLiteral("filter"), QUrl::FullyDecoded));
+        streamUrl.setQuery(query);
+        QJsonObject result;
+        result[QStringLiteral("expiringUrl")] = streamUrl.toString(QUrl::FullyEncoded);
+        result[QStringLiteral("expiresAt")] = QDateTime::currentDateTimeUtc().addSecs(60).toString(Qt::ISODate);
+        return json(200, result);
+    }
+    if (resource == QStringLiteral("download")) {
+        const QString fileId = segments.value(2);
+        if (!_files.contains(fileId))
+            return error(404, QStringLiteral("File not found"));
+        HttpResponse response(200);
+        response.contentType = QByteArrayLiteral("application/octet-stream");
+        response.body = _files.value(fileId).data;
+        return response;
+    }
+    if (resource == QStringLiteral("auth") && segments.value(3) == QStringLiteral("token"))
+        return handleToken(request);
+    if (resource == QStringLiteral("account"))
+        return handleAccount(request, segments);
+    if (resource == QStringLiteral("object_types")) {
+        // Object types are schemaless here, so just acknowledge the definition.
+        return json(201, request.json());
+    }
+    return error(404, QStringLiteral("Unknown resource: ") + resource);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleCollection(const HttpRequest &request, const QString &objectType, const QStringList &segments, int first)
+{
+    const QByteArray requestId = request.header("x-request-id");
+    const QString id = segments.value(first);
+    Collection &collection = _collections[objectType];
+
+    if (segments.value(first + 1) == QStringLiteral("access")) {
+        if (!collection.contains(id))
+            return error(404, QStringLiteral("Object not found"));
+        const QString key = objectType + QLatin1Char('/') + id;
+        if (request.method == "GET")
+            return json(200, _access.value(key));
+        QJsonObject access = _access.value(key);
+        const QJsonObject change = request.json();
+        for (QJsonObject::const_iterator i = change.constBegin(); i != change.constEnd(); ++i) {
+            if (request.method == "DELETE")
+                access.remove(i.key());
+            else
+                access[i.key()] = i.value();
+        }
+        _access.insert(key, access);
+        return json(200, access);
+    }
+
+    if (request.method == "GET") {
+        if (!id.isEmpty()) {
+            if (!collection.contains(id))
+                return error(404, QStringLiteral("Object not found"));
+            return json(200, collection.value(id));
+        }
+        QJsonArray objects;
+        foreach (const QJsonObject &object, collection)
+            objects.append(object);
+        return handleQuery(request, objectType, objects);
+    }
+
+    if (request.method == "POST") {
+        if (!id.isEmpty())
+            return error(405, QStringLiteral("Can not create an object with a given id"));
+        QJsonObject object = request.json();
+        if (objectType == QStringLiteral("users")) {
+            const QString username = object[QStringLiteral("username")].toString();
+            if (username.isEmpty())
+                return error(400, QStringLiteral("Users require an username"));
+            _passwords.insert(username, object.take(QStringLiteral("password")).toString());
+        }
+        return json(201, store(objectType, object, requestId));
+    }
+
+    if (request.method == "PUT") {
+        if (!collection.contains(id))
+            return error(404, QStringLiteral("Object not found"));
+        QJsonObject object = collection.value(id);
+        const QJsonObject change = request.json();
+        for (QJsonObject::const_iterator i = change.constBegin(); i != change.constEnd(); ++i) {
+            if (i.key() == QStringLiteral("id") || i.key() == QStringLiteral("objectType") || i.key() == QStringLiteral("createdAt"))
+                continue;
+            object[i.key()] = i.value();
+        }
+        object[QStringLiteral("updatedAt")] = timestamp();
+        collection.insert(id, object);
+        notify(QStringLiteral("update"), object, requestId);
+        return json(200, object);
+    }
+
+    if (request.method == "DELETE") {
+        if (!collection.contains(id))
+            return error(404, QStringLiteral("Object not found"));
+        const QJsonObject object = collection.take(id);
+        _access.remove(objectType + QLatin1Char('/') + id);
+        notify(QStringLiteral("delete"), object, requestId);
+        return json(200, object);
+    }
+
+    return error(405, QStringLiteral("Unsupported method"));
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleQuery(const HttpRequest &request, const QString &objectType, const QJsonArray &source)
+{
+    const QJsonObject query = parseJson(request.query.queryItemValue(QStringLiteral("q"), QUrl::FullyDecoded));
+    const QJsonObject include = parseJson(request.query.queryItemValue(QStringLiteral("include"), QUrl::FullyDecoded));
+    const QJsonArray sort = QJsonDocument::fromJson(request.query.queryItemValue(QStringLiteral("sort"), QUrl::FullyDecoded).toUtf8()).array();
+    const QJsonArray fields = QJsonDocument::fromJson(request.query.queryItemValue(QStringLiteral("fields"), QUrl::FullyDecoded).toUtf8()).array();
+    int limit = request.query.queryItemValue(QStringLiteral("limit")).toInt();
+    if (_resultLimit && (!limit || limit > _resultLimit))
+        limit = _resultLimit;
+    const int offset = request.query.queryItemValue(QStringLiteral("offset")).toInt();
+
+    QVector<QJsonObject> objects;
+    objects.reserve(source.count());
+    foreach (const QJsonValue &value, source) {
+        const QJsonObject object = value.toObject();
+        if (matches(object, query))
+            objects.append(object);
+    }
+    if (!sort.isEmpty()) {
+        SortComparator comparator = { sort };
+        std::stable_sort(objects.begin(), objects.end(), comparator);
+    }
+
+    const int end = limit ? qMin(offset + limit, objects.count()) : objects.count();
+    QJsonArray results;
+    for (int i = offset; i < end; ++i) {
+        QJsonObject object = objects.at(i);
+        for (QJsonObject::const_iterator j = include.constBegin(); j != include.constEnd(); ++j) {
+            // Expand references, for example file attachments, into full objects.
+            const QJsonObject reference = object[j.key()].toObject();
+            const QString id = reference[QStringLiteral("id")].toString();
+            const QString type = reference[QStringLiteral("objectType")].toString();
+            if (type == QStringLiteral("files") && _files.contains(id))
+                object[j.key()] = _files.value(id).object;
+            else if (_collections.value(type).contains(id))
+                object[j.key()] = _collections.value(type).value(id);
+        }
+        if (!fields.isEmpty() && _fieldsSupported) {
+            QJsonObject projection;
+            foreach (const QJsonValue &field, fields) {
+                const QString name = field.toString();
+                if (object.contains(name))
+                    projection[name] = object[name];
+            }
+            object = projection;
+        }
+        results.append(object);
+    }
+
+    QJsonObject echo;
+    echo[QStringLiteral("objectType")] = objectType;
+    echo[QStringLiteral("query")] = query;
+    if (limit)
+        echo[QStringLiteral("limit")] = limit;
+    if (offset)
+        echo[QStringLiteral("offset")] = offset;
+
+    QJsonObject response;
+    response[QStringLiteral("results")] = results;
+    response[QStringLiteral("query")] = echo;
+    if (request.query.hasQueryItem(QStringLiteral("count")))
+        response[QStringLiteral("count")] = objects.count();
+    return json(200, response);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleUsergroupMembers(const HttpRequest &request, const QString &groupId)
+{
+    if (!_collections.value(QStringLiteral("usergroups")).contains(groupId))
+        return error(404, QStringLiteral("Usergroup not found"));
+
+    QStringList &members = _members[groupId];
+    if (request.method == "GET") {
+        const Collection &users = _collections[QStringLiteral("users")];
+        QJsonArray objects;
+        foreach (const QString &member, members) {
+            if (users.contains(member))
+                objects.append(users.value(member));
+        }
+        return handleQuery(request, QStringLiteral("users"), objects);
+    }
+
+    const QJsonObject member = request.json();
+    const QString memberId = member[QStringLiteral("id")].toString();
+    if (request.method == "POST") {
+        if (!_collections.value(QStringLiteral("users")).contains(memberId))
+            return error(400, QStringLiteral("Unknown user"));
+        if (!members.contains(memberId))
+            members.append(memberId);
+        return json(200, member);
+    }
+    if (request.method == "DELETE") {
+        members.removeAll(memberId);
+        return json(200, member);
+    }
+    return error(405, QStringLiteral("Unsupported method"));
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleFiles(const HttpRequest &request, const QStringList &segments)
+{
+    const QByteArray requestId = request.header("x-request-id");
+    const QString id = segments.value(2);
+
+    if (id.isEmpty()) {
+        if (request.method == "GET") {
+            QJsonArray objects;
+            foreach (const File &file, _files)
+                objects.append(file.object);
+            return handleQuery(request, QStringLiteral("files"), objects);
+        }
+        if (request.method != "POST")
+            return error(405, QStringLiteral("Unsupported method"));
+        if (request.header("content-type").startsWith("multipart/form-data"))
+            return handleMultiPartUpload(request);
+
+        // First step of a chunked upload, the content arrives through ".../chunk".
+        const QJsonObject upload = request.json();
+        File file;
+        file.size = -1;
+        file.object[QStringLiteral("id")] = nextId();
+        file.object[QStringLiteral("objectType")] = QStringLiteral("files");
+        file.object[QStringLiteral("fileName")] = upload[QStringLiteral("file")].toObject()[QStringLiteral("fileName")];
+        file.object[QStringLiteral("status")] = QStringLiteral("empty");
+        file.object[QStringLiteral("createdAt")] = file.object[QStringLiteral("updatedAt")] = timestamp();
+        const QString fileId = file.object[QStringLiteral("id")].toString();
+        _files.insert(fileId, file);
+        attachFile(upload, fileId, requestId);
+        return json(201, file.object);
+    }
+
+    if (!_files.contains(id))
+        return error(404, QStringLiteral("File not found"));
+    File &file = _files[id];
+    const QString action = segments.value(3);
+
+    if (action == QStringLiteral("chunk") && request.method == "PUT") {
+        if (_failingChunks > 0) {
+            --_failingChunks;
+            return error(503, QStringLiteral("Service unavailable"));
+        }
+        // Content-Range: {chunkStart}-{chunkEnd}/{totalFileSize}, the end is exclusive.
+        QByteArray range = request.header("content-range");
+        if (range.startsWith("bytes "))
+            range.remove(0, 6);
+        const int minus = range.indexOf('-');
+        const int div = range.indexOf('/');
+        if (minus <= 0 || div <= minus)
+            return error(400, QStringLiteral("Invalid Content-Range"));
+        const qint64 start = range.left(minus).toLongLong();
+        const qint64 end = range.mid(minus + 1, div - minus - 1).toLongLong();
+        const qint64 total = range.mid(div + 1).toLongLong();
+        if (start < 0 || end > total || end - start != request.body.size())
+            return error(400, QStringLiteral("Content-Range does not match the chunk"));
+
+        file.size = total;
+        if (file.data.size() != total)
+            file.data.resize(total);
+        memcpy(file.data.data() + start, request.body.constData(), request.body.size());
+
+        // Chunks may arrive in any order, merge the received ranges.
+        file.ranges.insert(start, qMax(end, file.ranges.value(start)));
+        QMap<qint64, qint64> merged;
+        for (QMap<qint64, qint64>::const_iterator i = file.ranges.constBegin(); i != file.ranges.constEnd(); ++i) {
+            if (!merged.isEmpty() && (merged.end() - 1).value() >= i.key()) {
+                QMap<qint64, qint64>::iterator last = merged.end() - 1;
+                last.value() = qMax(last.value(), i.value());
+            } else {
+                merged.insert(i.key(), i.value());
+            }
+        }
+        file.ranges = merged;
+
+        const bool complete = file.ranges.count() == 1 && file.ranges.firstKey() == 0 && file.ranges.first() == total;
+        file.object[QStringLiteral("status")] = complete ? QStringLiteral("complete") : QStringLiteral("incomplete");
+        file.object[QStringLiteral("fileSize")] = double(total);
+        file.object[QStringLiteral("updatedAt")] = timestamp();
+        return json(200, file.object);
+    }
+
+    if (action == QStringLiteral("download_url") && request.method == "GET") {
+        QUrl downloadUrl = url();
+        downloadUrl.setPath(QStringLiteral("/v1/download/") + id);
+        QJsonObject result;
+        result[QStringLiteral("expiringUrl")] = downloadUrl.toString();
+        result[QStringLiteral("expiresAt")] = QDateTime::currentDateTimeUtc().addSecs(3600).toString(Qt::ISODate);
+        return json(200, result);
+    }
+
+    if (action.isEmpty() && request.method == "GET")
+        return json(200, file.object);
+    if (action.isEmpty() && request.method == "DELETE") {
+        const QJsonObject object = file.object;
+        _files.remove(id);
+        return json(200, object);
+    }
+    return error(405, QStringLiteral("Unsupported method"));
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleMultiPartUpload(const HttpRequest &request)
+{
+    const QByteArray contentType = request.header("content-type");
+    const int boundaryIndex = contentType.indexOf("boundary=");
+    if (boundaryIndex < 0)
+        return error(400, QStringLiteral("Missing multipart boundary"));
+    QByteArray boundary = contentType.mid(boundaryIndex + 9);
+    if (boundary.startsWith('"'))
+        boundary = boundary.mid(1, boundary.size() - 2);
+    const QByteArray delimiter = "--" + boundary;
+
+    QJsonObject upload;
+    QByteArray content;
+    int position = request.body.indexOf(delimiter);
+    while (position >= 0) {
+        const int partStart = position + delimiter.size() + 2; // skip CRLF
+        const int next = request.body.indexOf(delimiter, partStart);
+        if (next < 0)
+            break;
+        const QByteArray part = request.body.mid(partStart, next - partStart - 2); // strip CRLF
+        const int headerEnd = part.indexOf("\r\n\r\n");
+        if (headerEnd >= 0) {
+            const QByteArray headers = part.left(headerEnd).toLower();
+            const QByteArray body = part.mid(headerEnd + 4);
+            if (headers.contains("name=\"object\""))
+                upload = QJsonDocument::fromJson(body).object();
+            else if (headers.contains("name=\"file\""))
+                content = body;
+        }
+        position = next;
+    }
+
+    File file;
+    file.size = content.size();
+    file.data = content;
+    file.ranges.insert(0, content.size());
+    file.object[QStringLiteral("id")] = nextId();
+    file.object[QStringLiteral("objectType")] = QStringLiteral("files");
+    file.object[QStringLiteral("fileName")] = upload[QStringLiteral("file")].toObject()[QStringLiteral("fileName")];
+    file.object[QStringLiteral("fileSize")] = double(content.size());
+    file.object[QStringLiteral("status")] = QStringLiteral("complete");
+    file.object[QStringLiteral("createdAt")] = file.object[QStringLiteral("updatedAt")] = timestamp();
+    const QString fileId = file.object[QStringLiteral("id")].toString();
+    _files.insert(fileId, file);
+    attachFile(upload, fileId, request.header("x-request-id"));
+    return json(201, file.object);
+}
+
+void EnginioLocalServer::attachFile(const QJsonObject &upload, const QString &fileId, const QByteArray &requestId)
+{
+    const QJsonObject target = upload[QStringLiteral("targetFileProperty")].toObject();
+    const QString objectType = target[QStringLiteral("objectType")].toString();
+    const QString id = target[QStringLiteral("id")].toString();
+    const QString propertyName = target[QStringLiteral("propertyName")].toString();
+    if (propertyName.isEmpty() || !_collections.value(objectType).contains(id))
+        return;
+
+    QJsonObject reference;
+    reference[QStringLiteral("id")] = fileId;
+    reference[QStringLiteral("objectType")] = QStringLiteral("files");
+
+    QJsonObject object = _collections[objectType].value(id);
+    object[propertyName] = reference;
+    object[QStringLiteral("updatedAt")] = timestamp();
+    _collections[objectType].insert(id, object);
+    notify(QStringLiteral("update"), object, requestId);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleSearch(const HttpRequest &request)
+{
+    const QStringList objectTypes = request.query.allQueryItemValues(QStringLiteral("objectTypes[]"), QUrl::FullyDecoded);
+    const QJsonObject search = parseJson(request.query.queryItemValue(QStringLiteral("search"), QUrl::FullyDecoded));
+    QString phrase = search[QStringLiteral("phrase")].toString();
+    phrase.remove(QLatin1Char('*'));
+    const QJsonArray properties = search[QStringLiteral("properties")].toArray();
+
+    QJsonArray objects;
+    foreach (const QString &objectType, objectTypes) {
+        foreach (const QJsonObject &object, _collections.value(objectType)) {
+            bool found = false;
+            for (QJsonObject::const_iterator i = object.constBegin(); !found && i != object.constEnd(); ++i) {
+                if (!properties.isEmpty() && !properties.contains(i.key()))
+                    continue;
+                found = i.value().isString() && i.value().toString().contains(phrase, Qt::CaseInsensitive);
+            }
+            if (found)
+                objects.append(object);
+        }
+    }
+    return handleQuery(request, QString(), objects);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleBatch(const HttpRequest &request)
+{
+    if (request.method != "POST")
+        return error(405, QStringLiteral("Unsupported method"));
+
+    // Every operation is dispatched as if it was a separate request with the same headers,
+    // results are returned in the order of the operations.
+    QJsonArray results;
+    foreach (const QJsonValue &value, request.json()[QStringLiteral("requests")].toArray()) {
+        const QJsonObject operation = value.toObject();
+        HttpRequest single;
+        single.method = operation[QStringLiteral("method")].toString().toLatin1();
+        single.path = operation[QStringLiteral("path")].toString();
+        single.headers = request.headers;
+        if (operation.contains(QStringLiteral("data")))
+            single.body = QJsonDocument(operation[QStringLiteral("data")].toObject()).toJson(QJsonDocument::Compact);
+
+        const HttpResponse response = single.path.startsWith(QStringLiteral("/v1/batch"))
+                ? error(400, QStringLiteral("Batches can not be nested"))
+                : dispatch(single);
+        QJsonObject result;
+        result[QStringLiteral("status")] = response.status;
+        result[QStringLiteral("data")] = QJsonDocument::fromJson(response.body).object();
+        results.append(result);
+    }
+
+    QJsonObject response;
+    response[QStringLiteral("results")] = results;
+    return json(200, response);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleToken(const HttpRequest &request)
+{
+    const QUrlQuery form(QString::fromUtf8(request.body));
+    const QString username = form.queryItemValue(QStringLiteral("username"), QUrl::FullyDecoded);
+    const QString password = form.queryItemValue(QStringLiteral("password"), QUrl::FullyDecoded);
+
+    QJsonObject user;
+    foreach (const QJsonObject &object, _collections.value(QStringLiteral("users"))) {
+        if (object[QStringLiteral("username")].toString() == username) {
+            user = object;
+            break;
+        }
+    }
+    if (user.isEmpty() || _passwords.value(username) != password)
+        return error(401, QStringLiteral("Invalid credentials"));
+
+    QJsonObject data;
+    data[QStringLiteral("user")] = user;
+    data[QStringLiteral("usergroups")] = QJsonArray();
+
+    QJsonObject token;
+    token[QStringLiteral("access_token")] = QString::fromLatin1(QCryptographicHash::hash(username.toUtf8() + nextId().toUtf8(), QCryptographicHash::Sha1).toHex());
+    token[QStringLiteral("refresh_token")] = nextId();
+    token[QStringLiteral("token_type")] = QStringLiteral("bearer");
+    token[QStringLiteral("expires_in")] = 28799;
+    token[QStringLiteral("enginio_data")] = data;
+    return json(200, token);
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::handleAccount(const HttpRequest &request, const QStringList &segments)
+{
+    // Just enough of the account API for EnginioBackendManager: every app has a single
+    // "development" environment whose id is used as the backend id.
+    if (segments.value(2) == QStringLiteral("auth")) {
+        QJsonObject token;
+        token[QStringLiteral("access_token")] = nextId();
+        token[QStringLiteral("token_type")] = QStringLiteral("bearer");
+        return json(200, token);
+    }
+    if (segments.value(2) != QStringLiteral("apps"))
+        return error(404, QStringLiteral("Unknown account resource"));
+
+    const QString appId = segments.value(3);
+    if (appId.isEmpty()) {
+        if (request.method == "GET") {
+            QJsonArray apps;
+            foreach (const QJsonObject &app, _apps)
+                apps.append(app);
+            QJsonObject response;
+            response[QStringLiteral("results")] = apps;
+            return json(200, response);
+        }
+        if (request.method != "POST")
+            return error(405, QStringLiteral("Unsupported method"));
+
+        QJsonObject masterKey;
+        masterKey[QStringLiteral("key")] = nextId();
+        QJsonObject environment;
+        environment[QStringLiteral("id")] = nextId();
+        environment[QStringLiteral("name")] = QStringLiteral("development");
+        environment[QStringLiteral("masterKeys")] = QJsonArray() << masterKey;
+        environment[QStringLiteral("apiKeys")] = QJsonArray() << masterKey;
+
+        QJsonObject app;
+        app[QStringLiteral("id")] = nextId();
+        app[QStringLiteral("name")] = request.json()[QStringLiteral("name")];
+        app[QStringLiteral("environments")] = QJsonArray() << environment;
+        _apps.insert(app[QStringLiteral("id")].toString(), app);
+        return json(201, app);
+    }
+
+    if (!_apps.contains(appId))
+        return error(404, QStringLiteral("App not found"));
+    if (request.method == "GET")
+        return json(200, _apps.value(appId));
+    if (request.method == "DELETE")
+        return json(200, _apps.take(appId));
+    return error(405, QStringLiteral("Unsupported method"));
+}
+
+QString EnginioLocalServer::nextId()
+{
+    // Zero padded, so that the ids are ordered like the creation time.
+    return QString::number(++_idCounter, 16).rightJustified(24, QLatin1Char('0'));
+}
+
+QJsonObject EnginioLocalServer::store(const QString &objectType, QJsonObject object, const QByteArray &requestId)
+{
+    const QString now = timestamp();
+    object[QStringLiteral("id")] = nextId();
+    object[QStringLiteral("objectType")] = objectType;
+    object[QStringLiteral("createdAt")] = now;
+    object[QStringLiteral("updatedAt")] = now;
+    _collections[objectType].insert(object[QStringLiteral("id")].toString(), object);
+    notify(QStringLiteral("create"), object, requestId);
+    return object;
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::json(int status, const QJsonObject &object)
+{
+    HttpResponse response(status);
+    response.body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+EnginioLocalServer::HttpResponse EnginioLocalServer::error(int status, const QString &message)
+{
+    QJsonObject error;
+    error[QStringLiteral("message")] = message;
+    error[QStringLiteral("reason")] = QString::fromLatin1(reasonPhrase(status));
+    QJsonObject object;
+    object[QStringLiteral("errors")] = QJsonArray() << error;
+    return json(status, object);
+}
+
+QString EnginioLocalServer::timestamp()
+{
+    return QDateTime::currentDateTimeUtc().toString(QStringLiteral("yyyy-MM-ddTHH:mm:ss.zzzZ"));
+}
+
+bool EnginioLocalServer::matches(const QJsonObject &object, const QJsonObject &query)
+{
+    for (QJsonObject::const_iterator i = query.constBegin(); i != query.constEnd(); ++i) {
+        const QString key = i.key();
+        if (key == QStringLiteral("$and")) {
+            foreach (const QJsonValue &term, i.value().toArray()) {
+                if (!matches(object, term.toObject()))
+                    return false;
+            }
+            continue;
+        }
+        if (key == QStringLiteral("$or")) {
+            bool found = false;
+            foreach (const QJsonValue &term, i.value().toArray()) {
+                if ((found = matches(object, term.toObject())))
+                    break;
+            }
+            if (!found)
+                return false;
+            continue;
+        }
+
+        const QJsonValue value = valueAt(object, key);
+        const QJsonObject condition = i.value().toObject();
+        if (i.value().isObject() && !condition.isEmpty() && condition.constBegin().key().startsWith(QLatin1Char('$'))) {
+            for (QJsonObject::const_iterator op = condition.constBegin(); op != condition.constEnd(); ++op) {
+                if (!matchesOperator(value, op.key(), op.value()))
+                    return false;
+            }
+        } else if (value != i.value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace EnginioTests
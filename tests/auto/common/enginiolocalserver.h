@@ -0,0 +1,224 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ENGINIOLOCALSERVER_H
+#define ENGINIOLOCALSERVER_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qurlquery.h>
+#include <QtNetwork/qhostaddress.h>
+#include <QtNetwork/qtcpserver.h>
+
+QT_BEGIN_NAMESPACE
+class QTcpSocket;
+QT_END_NAMESPACE
+
+namespace EnginioTests
+{
+
+/*!
+  \internal
+  A minimal in-process stand-in for the Enginio REST service.
+
+  The server understands the subset of the REST API that is produced by
+  EnginioClientConnectionPrivate::getPath (objects, access control, users,
+  usergroups and their members, files with chunked and multipart uploads,
+  full text search, sessions and the notification stream), together with
+  the account calls used by EnginioBackendManager and the "/v1/batch"
+  endpoint used by EnginioBatch. All data lives in memory,
+  so every instance starts with an empty backend.
+
+  Successful GET responses carry an ETag, so conditional requests using
+  If-None-Match are answered with 304. A "fields" array in a query limits
+  the returned objects to the listed properties.
+
+  The notification stream is a plain (non TLS) WebSocket that is announced
+  through "/v1/stream_url", exactly like the real service does it. If the
+  client offers permessage-deflate the notifications are compressed, with
+  context takeover, unless setCompressionEnabled(false) was called.
+  notificationBytes and notificationFrameBytes in the statistics give the
+  size of the notifications before and after compression.
+
+  failChunks() makes the next chunks of uploads fail with 503, to test how
+  the client retries them.
+*/
+class EnginioLocalServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics
+    {
+        quint64 requests;
+        quint64 bytesReceived;
+        quint64 bytesSent;
+        quint64 notificationsSent;
+        quint64 notificationBytes; // JSON payloads
+        quint64 notificationFrameBytes; // what went over the wire for them
+        quint64 notModified;
+    };
+
+    explicit EnginioLocalServer(QObject *parent = 0);
+    ~EnginioLocalServer();
+
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    void close();
+    void dropWebSockets();
+    bool isListening() const;
+    QUrl url() const;
+
+    void setCompressionEnabled(bool enabled);
+    bool isCompressionEnabled() const;
+    void failChunks(int count);
+    void setResultLimit(int limit);
+    void setFieldsSupported(bool supported);
+
+    void clear();
+    Statistics statistics() const;
+    void resetStatistics();
+
+    int objectCount(const QString &objectType) const;
+    QJsonObject insertObject(const QString &objectType, const QJsonObject &object);
+
+Q_SIGNALS:
+    void requestReceived(const QByteArray &method, const QString &path);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    struct HttpRequest
+    {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers; // lower case names
+        QByteArray body;
+
+        QByteArray header(const QByteArray &name) const { return headers.value(name); }
+        QJsonObject json() const;
+    };
+
+    struct HttpResponse
+    {
+        int status;
+        QByteArray body;
+        QByteArray contentType;
+        QList<QPair<QByteArray, QByteArray> > headers;
+
+        HttpResponse(int code = 200)
+            : status(code)
+            , contentType(QByteArrayLiteral("application/json"))
+        {}
+    };
+
+    struct Deflater;
+
+    struct Peer
+    {
+        QByteArray buffer;
+        bool webSocket;
+        QJsonObject filter;
+        QByteArray message;
+        QSharedPointer<Deflater> deflater; // set if permessage-deflate was negotiated
+        Peer() : webSocket(false) {}
+    };
+
+    struct File
+    {
+        QJsonObject object;
+        QByteArray data;
+        QMap<qint64, qint64> ranges; // start -> end (exclusive)
+        qint64 size;
+    };
+
+    typedef QMap<QString, QJsonObject> Collection;
+
+    QTcpServer _server;
+    QHash<QTcpSocket*, Peer> _peers;
+    QHash<QString, Collection> _collections;
+    QHash<QString, QStringList> _members;
+    QHash<QString, QJsonObject> _access;
+    QHash<QString, File> _files;
+    QHash<QString, QJsonObject> _apps;
+    QHash<QString, QString> _passwords; // never part of a returned user object
+    quint64 _idCounter;
+    bool _compressionEnabled;
+    int _failingChunks;
+    int _resultLimit; // applied to every query, 0 for none
+    bool _fieldsSupported;
+    Statistics _statistics;
+
+    bool readHttpRequest(QTcpSocket *socket, Peer &peer, HttpRequest *request);
+    void readWebSocketFrames(QTcpSocket *socket, Peer &peer);
+    void upgradeToWebSocket(QTcpSocket *socket, Peer &peer, const HttpRequest &request);
+    void sendResponse(QTcpSocket *socket, const HttpRequest &request, const HttpResponse &response);
+    void applyConditions(const HttpRequest &request, HttpResponse *response);
+    int sendFrame(QTcpSocket *socket, int opcode, const QByteArray &payload, bool compressed = false);
+
+    HttpResponse dispatch(const HttpRequest &request);
+    HttpResponse handleCollection(const HttpRequest &request, const QString &objectType, const QStringList &segments, int first);
+    HttpResponse handleQuery(const HttpRequest &request, const QString &objectType, const QJsonArray &source);
+    HttpResponse handleUsergroupMembers(const HttpRequest &request, const QString &groupId);
+    HttpResponse handleFiles(const HttpRequest &request, const QStringList &segments);
+    HttpResponse handleMultiPartUpload(const HttpRequest &request);
+    HttpResponse handleSearch(const HttpRequest &request);
+    HttpResponse handleBatch(const HttpRequest &request);
+    HttpResponse handleAccount(const HttpRequest &request, const QStringList &segments);
+    HttpResponse handleToken(const HttpRequest &request);
+
+    QString nextId();
+    QJsonObject store(const QString &objectType, QJsonObject object, const QByteArray &requestId);
+    void attachFile(const QJsonObject &upload, const QString &fileId, const QByteArray &requestId);
+    void notify(const QString &event, const QJsonObject &object, const QByteArray &requestId);
+
+    static HttpResponse json(int status, const QJsonObject &object);
+    static HttpResponse error(int status, const QString &message);
+    static QString timestamp();
+    static bool matches(const QJsonObject &object, const QJsonObject &query);
+};
+
+} // namespace EnginioTests
+
+#endif // ENGINIOLOCALSERVER_H
@@ -0,0 +1,12 @@
+QT += network
+SOURCES += $$PWD/enginiolocalserver.cpp
+HEADERS += $$PWD/enginiolocalserver.h
+INCLUDEPATH += $$PWD
+
+# permessage-deflate for the notification stream
+contains(QT_CONFIG, system-zlib) {
+    if(unix|mingw): LIBS += -lz
+    else: LIBS += zdll.lib
+} else {
+    INCLUDEPATH += $$[QT_INSTALL_HEADERS/get]/QtZlib
+}
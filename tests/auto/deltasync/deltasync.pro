@@ -0,0 +1,12 @@
+QT       += testlib enginio enginio-private core-private
+QT       -= gui
+
+TARGET = tst_deltasync
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include(../common/localserver.pri)
+
+SOURCES += tst_deltasync.cpp
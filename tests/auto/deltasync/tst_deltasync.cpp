@@ -0,0 +1,337 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_DeltaSync: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void refreshFetchesOnlyChanges();
+    void removedObjectsDisappear();
+    void unknownObjectsFetched();
+    void disabledByDefault();
+    void pagedQueryReloaded();
+    void changedQueryReloaded();
+    void incompleteListingReloaded();
+    void ignoredFieldsDisableDelta();
+
+private:
+    void prepareClient(EnginioClient *client)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("deltasync"));
+    }
+    void populate(const QString &objectType, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            if (i == count - 1)
+                QTest::qWait(5); // the newest updatedAt is not shared
+            QJsonObject object;
+            object["title"] = QString::fromLatin1("object %1").arg(i);
+            _server.insertObject(objectType, object);
+        }
+    }
+    EnginioBaseModelPrivate *prepareModel(EnginioModel *model, EnginioClient *client, const QJsonObject &query)
+    {
+        model->setDeltaSync(true);
+        model->setQuery(query);
+        model->setClient(client);
+        return static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(model));
+    }
+    static QJsonObject row(const EnginioModel &model, int row)
+    {
+        return model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject();
+    }
+    static void changeFirstRow(EnginioClient *client, const EnginioModel &model)
+    {
+        // without the model noticing
+        QJsonObject changed = row(model, 0);
+        changed["title"] = QStringLiteral("changed");
+        EnginioReply *reply = client->update(changed);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+        QCOMPARE(row(model, 0)["title"].toString(), QStringLiteral("object 0"));
+    }
+};
+
+void tst_DeltaSync::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_DeltaSync::init()
+{
+    _server.clear();
+    _server.setResultLimit(0);
+    _server.setFieldsSupported(true);
+}
+
+void tst_DeltaSync::refreshFetchesOnlyChanges()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 200);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 200);
+    const quint64 fullQueryBytes = _server.statistics().bytesSent;
+
+    QJsonObject changed = row(model, 10);
+    changed["title"] = QStringLiteral("changed");
+    QTest::qWait(5); // a later updatedAt
+    EnginioReply *reply = client.update(changed);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->isError());
+    QJsonObject created;
+    created["title"] = QStringLiteral("created");
+    _server.insertObject(objectType, created);
+
+    _server.resetStatistics();
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    QSignalSpy dataChanged(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    d->execute();
+    QTRY_COMPARE(model.rowCount(), 201);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(dataChanged.count(), 1);
+    QCOMPARE(row(model, 10)["title"].toString(), QStringLiteral("changed"));
+    QCOMPARE(row(model, 200)["title"].toString(), QStringLiteral("created"));
+
+    const EnginioTests::EnginioLocalServer::Statistics statistics = _server.statistics();
+    QCOMPARE(statistics.requests, quint64(2)); // the changes and the ids
+    QVERIFY2(statistics.bytesSent * 2 < fullQueryBytes,
+             QByteArray::number(statistics.bytesSent) + " >= " + QByteArray::number(fullQueryBytes / 2));
+}
+
+void tst_DeltaSync::removedObjectsDisappear()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 10);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 10);
+
+    const QString removedIds[] = { row(model, 2)["id"].toString(), row(model, 7)["id"].toString() };
+    for (int i = 0; i < 2; ++i) {
+        // removed behind the back of the model
+        EnginioClient other;
+        prepareClient(&other);
+        QJsonObject object;
+        object["objectType"] = objectType;
+        object["id"] = removedIds[i];
+        EnginioReply *reply = other.remove(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+    QCOMPARE(model.rowCount(), 10);
+
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    d->execute();
+    QTRY_COMPARE(model.rowCount(), 8);
+    QCOMPARE(reset.count(), 0);
+    for (int i = 0; i < model.rowCount(); ++i) {
+        const QString id = row(model, i)["id"].toString();
+        QVERIFY(id != removedIds[0]);
+        QVERIFY(id != removedIds[1]);
+    }
+}
+
+void tst_DeltaSync::unknownObjectsFetched()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 5);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 5);
+
+    // the model lost an object that did not change since, as if it was hidden before a login
+    const QJsonObject lost = row(model, 0);
+    d->receivedRemoveNotification(lost);
+    QCOMPARE(model.rowCount(), 4);
+
+    _server.resetStatistics();
+    d->execute();
+    QTRY_COMPARE(model.rowCount(), 5);
+    QCOMPARE(row(model, 4)["id"].toString(), lost["id"].toString());
+    QCOMPARE(_server.statistics().requests, quint64(3));
+}
+
+void tst_DeltaSync::disabledByDefault()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 5);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QVERIFY(!model.deltaSync());
+    QJsonObject query;
+    query["objectType"] = objectType;
+    model.setQuery(query);
+    model.setClient(&client);
+    QTRY_COMPARE(model.rowCount(), 5);
+    changeFirstRow(&client, model);
+
+    _server.resetStatistics();
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    d->execute();
+    QTRY_COMPARE(row(model, 0)["title"].toString(), QStringLiteral("changed"));
+    QCOMPARE(_server.statistics().requests, quint64(1));
+}
+
+void tst_DeltaSync::pagedQueryReloaded()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 10);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    query["limit"] = 5;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 5);
+    changeFirstRow(&client, model);
+
+    _server.resetStatistics();
+    d->execute();
+    QTRY_COMPARE(row(model, 0)["title"].toString(), QStringLiteral("changed"));
+    QCOMPARE(_server.statistics().requests, quint64(1));
+}
+
+void tst_DeltaSync::changedQueryReloaded()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 3);
+    QJsonObject object;
+    object["title"] = QStringLiteral("special");
+    _server.insertObject(objectType, object);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 4);
+
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    QJsonObject filter;
+    filter["title"] = QStringLiteral("special");
+    query["query"] = filter;
+    model.setQuery(query);
+    QTRY_COMPARE(model.rowCount(), 1);
+    QCOMPARE(reset.count(), 1);
+}
+
+void tst_DeltaSync::incompleteListingReloaded()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 10);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 10);
+    changeFirstRow(&client, model);
+
+    // the ids listing misses objects that still exist, they must not be removed
+    _server.setResultLimit(6);
+    _server.resetStatistics();
+    d->execute();
+    QTRY_COMPARE(_server.statistics().requests, quint64(3)); // the changes, the ids and the full query
+    QTRY_COMPARE(row(model, 0)["title"].toString(), QStringLiteral("changed"));
+    QVERIFY(d->canRefreshDelta());
+}
+
+void tst_DeltaSync::ignoredFieldsDisableDelta()
+{
+    const QString objectType = QStringLiteral("objects.delta");
+    populate(objectType, 5);
+    _server.setFieldsSupported(false);
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    QJsonObject query;
+    query["objectType"] = objectType;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, query);
+    QTRY_COMPARE(model.rowCount(), 5);
+    QVERIFY(d->canRefreshDelta());
+
+    _server.resetStatistics();
+    d->execute();
+    QTRY_COMPARE(_server.statistics().requests, quint64(3)); // the changes, the ids and the full query
+    QTRY_VERIFY(!d->canRefreshDelta());
+
+    // later refreshes do not try again
+    changeFirstRow(&client, model);
+    _server.resetStatistics();
+    d->execute();
+    QTRY_COMPARE(row(model, 0)["title"].toString(), QStringLiteral("changed"));
+    QCOMPARE(_server.statistics().requests, quint64(1));
+}
+
+QTEST_MAIN(tst_DeltaSync)
+#include "tst_deltasync.moc"
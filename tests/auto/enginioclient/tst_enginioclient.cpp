@@ -36,6 +36,7 @@
 #include <QtCore/qthread.h>
 
 #include <Enginio/enginioclient.h>
+#include <Enginio/enginiobatch.h>
 #include <Enginio/enginioreply.h>
 #include <Enginio/enginioidentity.h>
 #include <Enginio/enginiooauth2authentication.h>
@@ -71,6 +72,7 @@ private slots:
     void query_todos_count();
     void query_todos_sort();
     void remove_todos();
+    void batch_todos();
     void update_todos_invalidId();
     void users_crud();
     void query_users();
@@ -1177,6 +1179,95 @@ void tst_EnginioClient::remove_todos()
     QVERIFY(response->data()["results"].toArray().isEmpty());
 }
 
+void tst_EnginioClient::batch_todos()
+{
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    const int count = 20;
+    QStringList ids;
+    {
+        EnginioBatch batch(&client);
+        for (int i = 0; i < count; ++i) {
+            QJsonObject todo;
+            todo["objectType"] = QString::fromUtf8("objects.todos");
+            todo["title"] = QString::fromUtf8("Batch todo ") + QString::number(i);
+            todo["completed"] = false;
+            QCOMPARE(batch.create(todo), i);
+        }
+        QJsonObject invalid; // objectType is missing
+        invalid["title"] = QString::fromUtf8("Invalid batch todo");
+        QCOMPARE(batch.create(invalid), count);
+        QCOMPARE(batch.count(), count + 1);
+
+        const EnginioReply *response = batch.send();
+        QVERIFY(response);
+        QVERIFY(batch.isEmpty());
+        CHECK_NO_ERROR(response);
+
+        QJsonArray results = response->data()["results"].toArray();
+        QCOMPARE(results.count(), count + 1);
+        for (int i = 0; i < count; ++i) {
+            QJsonObject result = results[i].toObject();
+            QCOMPARE(result["index"].toInt(), i);
+            QVERIFY(result["status"].toInt() >= 200 && result["status"].toInt() < 300);
+            QJsonObject todo = result["data"].toObject();
+            QCOMPARE(todo["title"].toString(), QString::fromUtf8("Batch todo ") + QString::number(i));
+            ids.append(todo["id"].toString());
+            QVERIFY(!ids.last().isEmpty());
+        }
+        QCOMPARE(results[count].toObject()["index"].toInt(), count);
+        QCOMPARE(results[count].toObject()["status"].toInt(), 400);
+        QVERIFY(!results[count].toObject()["data"].toObject()["errors"].toArray().isEmpty());
+    }
+
+    {
+        // Update the first half and remove the second half in one go.
+        EnginioBatch batch(&client);
+        for (int i = 0; i < count; ++i) {
+            QJsonObject todo;
+            todo["objectType"] = QString::fromUtf8("objects.todos");
+            todo["id"] = ids[i];
+            if (i < count / 2) {
+                todo["completed"] = true;
+                batch.update(todo);
+            } else {
+                batch.remove(todo);
+            }
+        }
+
+        const EnginioReply *response = batch.send();
+        QVERIFY(response);
+        CHECK_NO_ERROR(response);
+
+        QJsonArray results = response->data()["results"].toArray();
+        QCOMPARE(results.count(), count);
+        for (int i = 0; i < count; ++i) {
+            QJsonObject result = results[i].toObject();
+            QVERIFY(result["status"].toInt() >= 200 && result["status"].toInt() < 300);
+            if (i < count / 2)
+                QCOMPARE(result["data"].toObject()["completed"].toBool(), true);
+        }
+    }
+
+    QJsonObject query;
+    query["objectType"] = QString::fromUtf8("objects.todos");
+    QJsonArray removedIds;
+    for (int i = count / 2; i < count; ++i)
+        removedIds.append(ids[i]);
+    QJsonObject in;
+    in["$in"] = removedIds;
+    QJsonObject filter;
+    filter["id"] = in;
+    query["query"] = filter;
+    const EnginioReply *response = client.query(query);
+    QVERIFY(response);
+    CHECK_NO_ERROR(response);
+    QVERIFY(response->data()["results"].toArray().isEmpty());
+}
+
 void tst_EnginioClient::backendFakeReply()
 {
     EnginioClient client;
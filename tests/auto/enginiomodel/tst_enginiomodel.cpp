@@ -33,6 +33,7 @@
 
 #include <QtTest/QtTest>
 #include <QtCore/qobject.h>
+#include <QtCore/qtemporarydir.h>
 #include <QtCore/qthread.h>
 
 #include <QtWidgets/qlistview.h>
@@ -84,6 +85,7 @@ private slots:
     void setPropertyOnExternallyRemovedObject();
     void createAndModify();
     void externalNotification();
+    void createUpdateRemoveWithNotification_data();
     void createUpdateRemoveWithNotification();
     void appendBeforeInitialModelReset();
     void delayedRequestBeforeInitialModelReset();
@@ -96,6 +98,8 @@ private slots:
     void setInvalidJsonData();
     void reload();
     void identityChange();
+    void snapshot();
+    void snapshotPerSession();
 private:
     template<class T>
     void externallyRemovedImpl();
@@ -134,6 +138,12 @@ void tst_EnginioModel::initTestCase()
     reload2["name"] = QStringLiteral("reload2");
     reload2["properties"] = properties;
     QVERIFY(_backendManager.createObjectType(_backendName, EnginioTests::TESTAPP_ENV, reload2));
+
+    // Object type for the snapshot test
+    QJsonObject snapshot1;
+    snapshot1["name"] = QStringLiteral("snapshot1");
+    snapshot1["properties"] = properties;
+    QVERIFY(_backendManager.createObjectType(_backendName, EnginioTests::TESTAPP_ENV, snapshot1));
 }
 
 void tst_EnginioModel::cleanupTestCase()
@@ -1148,8 +1158,33 @@ void tst_EnginioModel::externalNotification()
     }
 }
 
+static bool rolesMatchObjects(const EnginioModel &model)
+{
+    // every role has to return the same as the property of the row object
+    const QHash<int, QByteArray> roles = model.roleNames();
+    for (int i = 0; i < model.rowCount(); ++i) {
+        const QModelIndex index = model.index(i);
+        const QJsonObject object = model.data(index, Enginio::JsonObjectRole).toJsonValue().toObject();
+        for (QHash<int, QByteArray>::const_iterator role = roles.constBegin(); role != roles.constEnd(); ++role) {
+            if (role.key() < Enginio::CreatedAtRole)
+                continue;
+            if (model.data(index, role.key()).toJsonValue() != object[QString::fromUtf8(role.value())])
+                return false;
+        }
+    }
+    return true;
+}
+
+void tst_EnginioModel::createUpdateRemoveWithNotification_data()
+{
+    QTest::addColumn<bool>("columnStorage");
+    QTest::newRow("json rows") << false;
+    QTest::newRow("column storage") << true;
+}
+
 void tst_EnginioModel::createUpdateRemoveWithNotification()
 {
+    QFETCH(bool, columnStorage);
     EnginioClient client;
     client.setBackendId(_backendId);
     client.setServiceUrl(EnginioTests::TESTAPP_URL);
@@ -1160,12 +1195,14 @@ void tst_EnginioModel::createUpdateRemoveWithNotification()
     query.insert("objectType", objectType);
 
     EnginioModel model;
+    model.setColumnStorage(columnStorage);
     model.setQuery(query);
     {   // init the model
         QSignalSpy spy(&model, SIGNAL(modelReset()));
         model.setClient(&client);
         QTRY_VERIFY(spy.count() > 0);
     }
+    QVERIFY(rolesMatchObjects(model));
 
     const int repliesCount = 12;
     const int initialCount = model.rowCount();
@@ -1186,7 +1223,7 @@ void tst_EnginioModel::createUpdateRemoveWithNotification()
         CHECK_NO_ERROR(reply);
     }
     QTRY_COMPARE(model.rowCount(), initialCount + repliesCount);
-
+    QVERIFY(rolesMatchObjects(model));
 
     // lets try to update our objects
     replies.resize(0);
@@ -1212,6 +1249,7 @@ void tst_EnginioModel::createUpdateRemoveWithNotification()
         }
     }
     QCOMPARE(counter, repliesCount);
+    QVERIFY(rolesMatchObjects(model));
 
     // lets remove our objects
     replies.resize(0);
@@ -1228,6 +1266,7 @@ void tst_EnginioModel::createUpdateRemoveWithNotification()
         CHECK_NO_ERROR(reply);
     }
     QTRY_COMPARE(model.rowCount(), initialCount);
+    QVERIFY(rolesMatchObjects(model));
 }
 
 void tst_EnginioModel::appendBeforeInitialModelReset()
@@ -1872,5 +1911,134 @@ void tst_EnginioModel::identityChange()
     QTRY_COMPARE(model.rowCount(), 1);
 }
 
+void tst_EnginioModel::snapshot()
+{
+    QString objectType = "objects.snapshot1";
+    QTemporaryDir snapshotDirectory;
+    QVERIFY(snapshotDirectory.isValid());
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    for (int i = 0; i < 3; ++i) {
+        EnginioReply *reply = client.create(createTestObject(QString::fromLatin1("s") + QString::number(i), objectType));
+        QTRY_VERIFY(reply->isFinished());
+        CHECK_NO_ERROR(reply);
+    }
+
+    QJsonObject query;
+    query.insert("objectType", objectType);
+
+    QStringList ids;
+    {
+        EnginioModel model;
+        model.disableNotifications();
+        model.setSnapshotDirectory(snapshotDirectory.path());
+        model.setQuery(query);
+        model.setClient(&client);
+
+        // nothing was stored yet
+        QCOMPARE(model.rowCount(), 0);
+        QTRY_COMPARE(model.rowCount(), 3);
+        for (int i = 0; i < model.rowCount(); ++i)
+            ids.append(model.data(model.index(i), Enginio::IdRole).value<QJsonValue>().toString());
+    }
+    QCOMPARE(QDir(snapshotDirectory.path()).entryList(QDir::Files).count(), 1);
+
+    // remove an object behind the back of the snapshot
+    QJsonObject removed;
+    removed.insert("objectType", objectType);
+    removed.insert("id", ids.first());
+    EnginioReply *removeReply = client.remove(removed);
+    QTRY_VERIFY(removeReply->isFinished());
+    CHECK_NO_ERROR(removeReply);
+
+    EnginioModel model;
+    model.disableNotifications();
+    model.setSnapshotDirectory(snapshotDirectory.path());
+    model.setQuery(query);
+    model.setClient(&client);
+
+    // the rows are there before the backend answered
+    QCOMPARE(model.rowCount(), 3);
+    for (int i = 0; i < model.rowCount(); ++i)
+        QCOMPARE(model.data(model.index(i), Enginio::IdRole).value<QJsonValue>().toString(), ids[i]);
+
+    // and they are replaced by the live data
+    QTRY_COMPARE(model.rowCount(), 2);
+
+    // an other query does not use the snapshot
+    EnginioModel otherModel;
+    otherModel.disableNotifications();
+    otherModel.setSnapshotDirectory(snapshotDirectory.path());
+    query.insert("limit", 1);
+    otherModel.setQuery(query);
+    otherModel.setClient(&client);
+    QCOMPARE(otherModel.rowCount(), 0);
+    QTRY_COMPARE(otherModel.rowCount(), 1);
+}
+
+void tst_EnginioModel::snapshotPerSession()
+{
+    QString objectType = "objects.snapshot1";
+    QTemporaryDir snapshotDirectory;
+    QVERIFY(snapshotDirectory.isValid());
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    for (int i = 0; i < 2; ++i) {
+        EnginioReply *reply = client.create(createTestObject(QString::fromLatin1("p") + QString::number(i), objectType));
+        QTRY_VERIFY(reply->isFinished());
+        CHECK_NO_ERROR(reply);
+    }
+
+    QJsonObject query;
+    query.insert("objectType", objectType);
+    query.insert("limit", 2);
+
+    {
+        EnginioModel model;
+        model.disableNotifications();
+        model.setSnapshotDirectory(snapshotDirectory.path());
+        model.setQuery(query);
+        model.setClient(&client);
+        QTRY_COMPARE(model.rowCount(), 2);
+    }
+    QCOMPARE(QDir(snapshotDirectory.path()).entryList(QDir::Files).count(), 1);
+
+    EnginioOAuth2Authentication identity;
+    identity.setUser("logintest");
+    identity.setPassword("logintest");
+    client.setIdentity(&identity);
+    QTRY_COMPARE(client.authenticationState(), Enginio::Authenticated);
+
+    // the rows of the anonymous session are not shown to the user
+    {
+        EnginioModel model;
+        model.disableNotifications();
+        model.setSnapshotDirectory(snapshotDirectory.path());
+        model.setQuery(query);
+        model.setClient(&client);
+        QCOMPARE(model.rowCount(), 0);
+        // its own rows are kept apart
+        QTRY_COMPARE(QDir(snapshotDirectory.path()).entryList(QDir::Files).count(), 2);
+    }
+
+    // and after logging out the anonymous snapshot is used again
+    client.setIdentity(0);
+    QTRY_COMPARE(client.authenticationState(), Enginio::NotAuthenticated);
+    EnginioModel model;
+    model.disableNotifications();
+    model.setSnapshotDirectory(snapshotDirectory.path());
+    model.setQuery(query);
+    model.setClient(&client);
+    QCOMPARE(model.rowCount(), 2);
+}
+
 QTEST_MAIN(tst_EnginioModel)
 #include "tst_enginiomodel.moc"
@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginioreply_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_EnginioReply: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+    EnginioClient _client;
+
+private slots:
+    void initTestCase();
+    void init();
+    void dataParsedOnce();
+    void dataBeforeFinished();
+    void dataAfterSetNetworkReply();
+    void dataServedFromCache();
+
+private:
+    EnginioReply *query();
+    static int parseCount(EnginioReply *reply)
+    {
+        return EnginioReplyStatePrivate::get(reply)->_parseCount;
+    }
+};
+
+void tst_EnginioReply::initTestCase()
+{
+    QVERIFY(_server.listen());
+    _client.setServiceUrl(_server.url());
+    _client.setBackendId(QByteArrayLiteral("enginioreply"));
+    _client.setResponseCacheSize(EnginioResponseCache::DefaultMaximumSize);
+}
+
+void tst_EnginioReply::init()
+{
+    _server.clear();
+    for (int i = 0; i < 5; ++i) {
+        QJsonObject object;
+        object["title"] = QString::fromUtf8("Reply ") + QString::number(i);
+        _server.insertObject(QStringLiteral("objects.replies"), object);
+    }
+}
+
+EnginioReply *tst_EnginioReply::query()
+{
+    QJsonObject query;
+    query["objectType"] = QString::fromUtf8("objects.replies");
+    EnginioReply *reply = _client.query(query);
+    reply->setParent(this);
+    return reply;
+}
+
+void tst_EnginioReply::dataParsedOnce()
+{
+    EnginioReply *reply = query();
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->isError());
+
+    const int afterFinished = parseCount(reply);
+    QVERIFY(afterFinished <= 1);
+
+    const QJsonObject first = reply->data();
+    QCOMPARE(first["results"].toArray().count(), 5);
+    for (int i = 0; i < 10; ++i)
+        QCOMPARE(reply->data(), first);
+    QCOMPARE(parseCount(reply), 1);
+}
+
+void tst_EnginioReply::dataBeforeFinished()
+{
+    EnginioReply *reply = query();
+    QVERIFY(!reply->isFinished());
+    QVERIFY(reply->data().isEmpty());
+    QCOMPARE(parseCount(reply), 0);
+
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(reply->data()["results"].toArray().count(), 5);
+    QCOMPARE(parseCount(reply), 1);
+}
+
+void tst_EnginioReply::dataAfterSetNetworkReply()
+{
+    EnginioReply *reply = query();
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(reply->data()["results"].toArray().count(), 5);
+
+    QJsonObject object;
+    object["title"] = QString::fromUtf8("Reply 5");
+    _server.insertObject(QStringLiteral("objects.replies"), object);
+
+    // the new network reply has its own body, the old parsed data must not be reused
+    EnginioReply *other = query();
+    QTRY_VERIFY(other->isFinished());
+    reply->swapNetworkReply(other);
+    QCOMPARE(reply->data()["results"].toArray().count(), 6);
+    QCOMPARE(parseCount(reply), 2);
+}
+
+void tst_EnginioReply::dataServedFromCache()
+{
+    EnginioReply *first = query();
+    QTRY_VERIFY(first->isFinished());
+    EnginioReply *second = query();
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+
+    // the 304 answer has no body, the cached one is parsed instead
+    QCOMPARE(second->data(), first->data());
+    QCOMPARE(second->data()["results"].toArray().count(), 5);
+    QCOMPARE(parseCount(second), 1);
+}
+
+QTEST_MAIN(tst_EnginioReply)
+#include "tst_enginioreply.moc"
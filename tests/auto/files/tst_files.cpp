@@ -116,7 +116,7 @@ void tst_Files::fileUploadDownload()
 
     if (chunkSize > 0) {
         EnginioClientConnectionPrivate *clientPrivate = EnginioClientConnectionPrivate::get(&_client);
-        clientPrivate->_uploadChunkSize = chunkSize;
+        clientPrivate->_uploadTuner.setChunkSizeLimits(chunkSize, chunkSize);
     }
 
     QSignalSpy spyError(&_client, SIGNAL(error(EnginioReply*)));
@@ -0,0 +1,187 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qjsonobject.h>
+
+#include <Enginio/private/enginiojsonstreamreader_p.h>
+
+class tst_JsonStreamReader: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void wholeDocument_data();
+    void wholeDocument();
+    void everySplit();
+    void byteByByte();
+    void stopsAfterArray();
+    void invalid_data();
+    void invalid();
+    void largeResult();
+
+private:
+    static QJsonArray readAll(const QByteArray &document, int chunkSize, bool *atEnd);
+};
+
+QJsonArray tst_JsonStreamReader::readAll(const QByteArray &document, int chunkSize, bool *atEnd)
+{
+    EnginioJsonStreamReader reader(QStringLiteral("results"));
+    QJsonArray objects;
+    for (int i = 0; i < document.size(); i += chunkSize) {
+        reader.addData(document.mid(i, chunkSize));
+        foreach (const QJsonValue &object, reader.takeObjects())
+            objects.append(object);
+    }
+    *atEnd = reader.atEnd();
+    return objects;
+}
+
+void tst_JsonStreamReader::wholeDocument_data()
+{
+    QTest::addColumn<QByteArray>("document");
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("empty") << QByteArray("{\"results\":[]}") << 0;
+    QTest::newRow("one") << QByteArray("{\"results\":[{\"id\":\"1\"}]}") << 1;
+    QTest::newRow("whitespace") << QByteArray(" {\n \"results\" :\t[ {\"id\":\"1\"} ,\r\n{ \"id\" : \"2\" } ] }\n") << 2;
+    QTest::newRow("nested") << QByteArray("{\"results\":[{\"id\":\"1\",\"a\":{\"b\":[1,{\"c\":[]}]}},{\"id\":\"2\"}]}") << 2;
+    QTest::newRow("brackets in strings") << QByteArray("{\"results\":[{\"id\":\"}]{[\",\"t\":\"\\\"]\\\\\"}]}") << 1;
+    QTest::newRow("other keys first") << QByteArray("{\"count\":2,\"result\":[{\"x\":1}],\"nested\":{\"results\":[{\"x\":2}]},\"results\":[{\"id\":\"1\"},{\"id\":\"2\"}]}") << 2;
+    QTest::newRow("string value named like the key") << QByteArray("{\"a\":\"results\",\"b\":[{\"x\":1}],\"results\":[{\"id\":\"1\"}]}") << 1;
+    QTest::newRow("unicode") << QByteArray("{\"results\":[{\"id\":\"\xc3\xa6\\u00f8\"}]}") << 1;
+}
+
+void tst_JsonStreamReader::wholeDocument()
+{
+    QFETCH(QByteArray, document);
+    QFETCH(int, count);
+
+    bool atEnd;
+    const QJsonArray objects = readAll(document, document.size(), &atEnd);
+    QVERIFY(atEnd);
+    QCOMPARE(objects.count(), count);
+    QCOMPARE(objects, QJsonDocument::fromJson(document).object()["results"].toArray());
+}
+
+void tst_JsonStreamReader::everySplit()
+{
+    const QByteArray document("{\"count\":3,\"results\":[{\"id\":\"1\",\"title\":\"a \\\"quoted\\\" {title}\"},"
+                              "{\"id\":\"2\",\"list\":[1,2,[3]]},{\"id\":\"3\",\"o\":{\"p\":{}}}],\"tail\":true}");
+    const QJsonArray expected = QJsonDocument::fromJson(document).object()["results"].toArray();
+    QCOMPARE(expected.count(), 3);
+
+    for (int split = 1; split < document.size(); ++split) {
+        EnginioJsonStreamReader reader(QStringLiteral("results"));
+        reader.addData(document.left(split));
+        QJsonArray objects = reader.takeObjects();
+        reader.addData(document.mid(split));
+        foreach (const QJsonValue &object, reader.takeObjects())
+            objects.append(object);
+        QVERIFY2(reader.atEnd(), QByteArray::number(split).constData());
+        QCOMPARE(objects, expected);
+    }
+}
+
+void tst_JsonStreamReader::byteByByte()
+{
+    const QByteArray document("{\"results\":[{\"id\":\"1\"},{\"id\":\"2\",\"s\":\"\\\\\"},{\"id\":\"3\"}]}");
+    bool atEnd;
+    const QJsonArray objects = readAll(document, 1, &atEnd);
+    QVERIFY(atEnd);
+    QCOMPARE(objects, QJsonDocument::fromJson(document).object()["results"].toArray());
+}
+
+void tst_JsonStreamReader::stopsAfterArray()
+{
+    EnginioJsonStreamReader reader(QStringLiteral("results"));
+    reader.addData("{\"results\":[{\"id\":\"1\"}");
+    QCOMPARE(reader.takeObjects().count(), 1);
+    QVERIFY(!reader.atEnd());
+    QCOMPARE(reader.objectCount(), 1);
+
+    // anything after the array is ignored, even if it is broken
+    reader.addData("], \"x\": ]]]");
+    QVERIFY(reader.atEnd());
+    QVERIFY(!reader.hasError());
+    QVERIFY(reader.takeObjects().isEmpty());
+}
+
+void tst_JsonStreamReader::invalid_data()
+{
+    QTest::addColumn<QByteArray>("document");
+
+    QTest::newRow("array document") << QByteArray("[{\"results\":[]}]");
+    QTest::newRow("string document") << QByteArray("\"results\"");
+    QTest::newRow("broken element") << QByteArray("{\"results\":[{\"id\":1,}]}");
+    QTest::newRow("unbalanced") << QByteArray("}{\"results\":[{\"id\":1}]}");
+}
+
+void tst_JsonStreamReader::invalid()
+{
+    QFETCH(QByteArray, document);
+
+    EnginioJsonStreamReader reader(QStringLiteral("results"));
+    reader.addData(document);
+    QVERIFY(reader.hasError());
+    QVERIFY(!reader.atEnd());
+    QVERIFY(reader.takeObjects().isEmpty());
+}
+
+void tst_JsonStreamReader::largeResult()
+{
+    QJsonArray results;
+    for (int i = 0; i < 10000; ++i) {
+        QJsonObject object;
+        object["id"] = QString::number(i);
+        object["title"] = QString::fromLatin1("Object %1").arg(i);
+        object["index"] = i;
+        results.append(object);
+    }
+    QJsonObject result;
+    result["results"] = results;
+    const QByteArray document = QJsonDocument(result).toJson(QJsonDocument::Compact);
+
+    bool atEnd;
+    QJsonArray objects;
+    QBENCHMARK {
+        objects = readAll(document, 16 * 1024, &atEnd);
+    }
+    QVERIFY(atEnd);
+    QCOMPARE(objects, results);
+}
+
+QTEST_MAIN(tst_JsonStreamReader)
+#include "tst_jsonstreamreader.moc"
@@ -0,0 +1,10 @@
+QT       += testlib enginio enginio-private core-private
+QT       -= gui
+
+TARGET = tst_modeldiff
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += tst_modeldiff.cpp
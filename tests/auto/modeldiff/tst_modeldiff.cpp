@@ -0,0 +1,276 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+
+#include <Enginio/enginiomodel.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+
+class tst_ModelDiff: public QObject
+{
+    Q_OBJECT
+
+    EnginioModel *_model;
+    EnginioBaseModelPrivate *_d;
+
+private slots:
+    void init();
+    void cleanup();
+    void unchanged();
+    void changedRows();
+    void insertedAndRemoved();
+    void moved();
+    void persistentIndexesFollow();
+    void random_data();
+    void random();
+    void resetAboveThreshold();
+    void resetForNewRoles();
+    void columnStorage();
+
+private:
+    static QJsonObject object(const QString &id, const QString &title = QStringLiteral("row"));
+    static QJsonArray objects(const QStringList &ids);
+    void verifyRows(const QJsonArray &rows) const;
+};
+
+QJsonObject tst_ModelDiff::object(const QString &id, const QString &title)
+{
+    QJsonObject object;
+    object[EnginioString::id] = id;
+    object[EnginioString::objectType] = QStringLiteral("objects.diff");
+    object[QStringLiteral("title")] = title;
+    return object;
+}
+
+QJsonArray tst_ModelDiff::objects(const QStringList &ids)
+{
+    QJsonArray rows;
+    foreach (const QString &id, ids)
+        rows.append(object(id));
+    return rows;
+}
+
+void tst_ModelDiff::verifyRows(const QJsonArray &rows) const
+{
+    QCOMPARE(_model->rowCount(), rows.count());
+    for (int row = 0; row < rows.count(); ++row) {
+        const QJsonObject expected = rows.at(row).toObject();
+        QCOMPARE(_model->data(_model->index(row), Enginio::JsonObjectRole).toJsonValue().toObject(), expected);
+        QCOMPARE(_model->data(_model->index(row), Enginio::IdRole).toString(), expected[EnginioString::id].toString());
+        QCOMPARE(_d->existingRow(expected[EnginioString::id].toString()), row);
+    }
+}
+
+void tst_ModelDiff::init()
+{
+    _model = new EnginioModel;
+    _d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(_model));
+    QJsonArray rows;
+    for (int i = 0; i < 10; ++i)
+        rows.append(object(QString::number(i)));
+    _d->resetData(rows);
+    QCOMPARE(_model->rowCount(), 10);
+    _model->setResetThreshold(0.5);
+}
+
+void tst_ModelDiff::cleanup()
+{
+    delete _model;
+}
+
+void tst_ModelDiff::unchanged()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QJsonArray rows;
+    for (int i = 0; i < 10; ++i)
+        rows.append(object(QString::number(i)));
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(dataChanged.count(), 0);
+    verifyRows(rows);
+}
+
+void tst_ModelDiff::changedRows()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QJsonArray rows;
+    for (int i = 0; i < 10; ++i)
+        rows.append(object(QString::number(i), i == 3 || i == 4 || i == 8 ? QStringLiteral("changed") : QStringLiteral("row")));
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(dataChanged.count(), 2);
+    QCOMPARE(dataChanged[0][0].value<QModelIndex>().row(), 3);
+    QCOMPARE(dataChanged[0][1].value<QModelIndex>().row(), 4);
+    QCOMPARE(dataChanged[1][0].value<QModelIndex>().row(), 8);
+    verifyRows(rows);
+}
+
+void tst_ModelDiff::insertedAndRemoved()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    QSignalSpy removed(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy inserted(_model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    const QJsonArray rows = objects(QStringList() << "0" << "new1" << "new2" << "1" << "4" << "5" << "6" << "7" << "8" << "9");
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(removed[0][1].toInt(), 2);
+    QCOMPARE(removed[0][2].toInt(), 3);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted[0][1].toInt(), 1);
+    QCOMPARE(inserted[0][2].toInt(), 2);
+    verifyRows(rows);
+}
+
+void tst_ModelDiff::moved()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    QSignalSpy moved(_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy layoutChanged(_model, SIGNAL(layoutChanged()));
+    // one row moved up, one moved down, both in a single layout change
+    const QJsonArray rows = objects(QStringList() << "0" << "8" << "1" << "2" << "4" << "5" << "3" << "6" << "7" << "9");
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(moved.count(), 0);
+    QCOMPARE(layoutChanged.count(), 1);
+    verifyRows(rows);
+}
+
+void tst_ModelDiff::persistentIndexesFollow()
+{
+    QPersistentModelIndex five(_model->index(5));
+    QPersistentModelIndex two(_model->index(2));
+    const QJsonArray rows = objects(QStringList() << "new" << "5" << "0" << "1" << "3" << "4" << "6" << "7" << "8" << "9");
+    _d->fullQueryReset(rows);
+    QVERIFY(five.isValid());
+    QCOMPARE(five.row(), 1);
+    QVERIFY(!two.isValid());
+    verifyRows(rows);
+
+    // moved rows keep their persistent indexes as well
+    QPersistentModelIndex zero(_model->index(2));
+    const QJsonArray moved = objects(QStringList() << "new" << "1" << "3" << "4" << "5" << "0" << "6" << "7" << "8" << "9");
+    _d->fullQueryReset(moved);
+    QCOMPARE(zero.row(), 5);
+    QCOMPARE(five.row(), 4);
+    verifyRows(moved);
+}
+
+void tst_ModelDiff::random_data()
+{
+    QTest::addColumn<int>("seed");
+    for (int seed = 1; seed <= 20; ++seed)
+        QTest::newRow(QByteArray::number(seed).constData()) << seed;
+}
+
+void tst_ModelDiff::random()
+{
+    QFETCH(int, seed);
+    _model->setResetThreshold(2);
+    qsrand(seed);
+    QStringList ids;
+    for (int i = 0; i < 10; ++i)
+        ids.append(QString::number(i));
+    int nextId = 10;
+
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    for (int round = 0; round < 20; ++round) {
+        const int changes = 1 + qrand() % 4;
+        for (int i = 0; i < changes; ++i) {
+            switch (ids.isEmpty() ? 0 : qrand() % 3) {
+            case 0:
+                ids.insert(qrand() % (ids.count() + 1), QString::number(nextId++));
+                break;
+            case 1:
+                if (ids.count() > 1)
+                    ids.removeAt(qrand() % ids.count());
+                break;
+            default:
+                ids.move(qrand() % ids.count(), qrand() % ids.count());
+            }
+        }
+        const QJsonArray rows = objects(ids);
+        _d->fullQueryReset(rows);
+        verifyRows(rows);
+    }
+    QCOMPARE(reset.count(), 0);
+}
+
+void tst_ModelDiff::resetAboveThreshold()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    _model->setResetThreshold(0.25);
+    const QJsonArray rows = objects(QStringList() << "0" << "1" << "2" << "3" << "4" << "5" << "8" << "9" << "a" << "b");
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 1);
+    verifyRows(rows);
+
+    _model->setResetThreshold(0.5);
+    const QJsonArray other = objects(QStringList() << "0" << "1" << "2" << "3" << "4" << "5" << "a" << "b" << "c" << "d");
+    _d->fullQueryReset(other);
+    QCOMPARE(reset.count(), 1);
+    verifyRows(other);
+}
+
+void tst_ModelDiff::resetForNewRoles()
+{
+    QSignalSpy reset(_model, SIGNAL(modelReset()));
+    QJsonArray rows = objects(QStringList() << "0" << "1" << "2" << "3" << "4" << "5" << "6" << "7" << "8" << "9");
+    QJsonObject first = rows.at(0).toObject();
+    first[QStringLiteral("rating")] = 5;
+    rows.replace(0, first);
+    _d->fullQueryReset(rows);
+    QCOMPARE(reset.count(), 1);
+    QVERIFY(_model->roleNames().values().contains("rating"));
+    verifyRows(rows);
+}
+
+void tst_ModelDiff::columnStorage()
+{
+    _model->setColumnStorage(true);
+    const int titleRole = _model->roleNames().key("title");
+    QVERIFY(titleRole);
+    QJsonArray rows = objects(QStringList() << "9" << "0" << "1" << "new" << "2" << "4" << "5" << "6" << "7" << "8");
+    rows.replace(4, object("2", "changed"));
+    _d->fullQueryReset(rows);
+    verifyRows(rows);
+    for (int row = 0; row < rows.count(); ++row)
+        QCOMPARE(_model->data(_model->index(row), titleRole).toString(), rows.at(row).toObject()[QStringLiteral("title")].toString());
+}
+
+QTEST_MAIN(tst_ModelDiff)
+#include "tst_modeldiff.moc"
@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+
+#include <Enginio/enginiomodel.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+
+class tst_ModelNotifications: public QObject
+{
+    Q_OBJECT
+
+    EnginioModel *_model;
+    EnginioBaseModelPrivate *_d;
+
+private slots:
+    void init();
+    void cleanup();
+    void updatesCoalesced();
+    void removalsCoalesced();
+    void createsCoalesced();
+    void createdAndRemoved();
+    void updatedAndRemoved();
+    void interval();
+    void immediate();
+
+private:
+    static QJsonObject object(const QString &id, const QString &title);
+    void notify(const QString &event, const QJsonObject &object);
+    QString title(int row) const;
+};
+
+QJsonObject tst_ModelNotifications::object(const QString &id, const QString &title)
+{
+    QJsonObject object;
+    object[EnginioString::id] = id;
+    object[EnginioString::objectType] = QStringLiteral("objects.notifications");
+    object[QStringLiteral("title")] = title;
+    return object;
+}
+
+void tst_ModelNotifications::notify(const QString &event, const QJsonObject &object)
+{
+    QJsonObject notification;
+    notification[EnginioString::event] = event;
+    notification[EnginioString::data] = object;
+    notification[EnginioString::origin] = QJsonObject();
+    _d->queueNotification(notification);
+}
+
+QString tst_ModelNotifications::title(int row) const
+{
+    return _model->data(_model->index(row), Enginio::JsonObjectRole).toJsonValue().toObject()[QStringLiteral("title")].toString();
+}
+
+void tst_ModelNotifications::init()
+{
+    _model = new EnginioModel;
+    _d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(_model));
+    QJsonArray rows;
+    for (int i = 0; i < 10; ++i)
+        rows.append(object(QString::number(i), QStringLiteral("row")));
+    _d->resetData(rows);
+    QCOMPARE(_model->rowCount(), 10);
+}
+
+void tst_ModelNotifications::cleanup()
+{
+    delete _model;
+}
+
+void tst_ModelNotifications::updatesCoalesced()
+{
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    notify(EnginioString::update, object("3", "first"));
+    notify(EnginioString::update, object("2", "changed"));
+    notify(EnginioString::update, object("7", "changed"));
+    notify(EnginioString::update, object("4", "changed"));
+    notify(EnginioString::update, object("3", "second"));
+    QCOMPARE(dataChanged.count(), 0);
+
+    QTRY_COMPARE(dataChanged.count(), 2);
+    QCOMPARE(dataChanged[0][0].value<QModelIndex>().row(), 2);
+    QCOMPARE(dataChanged[0][1].value<QModelIndex>().row(), 4);
+    QCOMPARE(dataChanged[1][0].value<QModelIndex>().row(), 7);
+    QCOMPARE(dataChanged[1][1].value<QModelIndex>().row(), 7);
+    QCOMPARE(title(3), QStringLiteral("second"));
+    QCOMPARE(title(7), QStringLiteral("changed"));
+}
+
+void tst_ModelNotifications::removalsCoalesced()
+{
+    QSignalSpy rowsRemoved(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    notify(EnginioString::_delete, object("2", "row"));
+    notify(EnginioString::_delete, object("8", "row"));
+    notify(EnginioString::_delete, object("1", "row"));
+    notify(EnginioString::_delete, object("3", "row"));
+    notify(EnginioString::_delete, object("unknown", "row"));
+
+    QTRY_COMPARE(rowsRemoved.count(), 2);
+    // from the bottom
+    QCOMPARE(rowsRemoved[0][1].toInt(), 8);
+    QCOMPARE(rowsRemoved[0][2].toInt(), 8);
+    QCOMPARE(rowsRemoved[1][1].toInt(), 1);
+    QCOMPARE(rowsRemoved[1][2].toInt(), 3);
+    QCOMPARE(_model->rowCount(), 6);
+    QCOMPARE(_model->data(_model->index(1), Enginio::IdRole).toJsonValue().toString(), QStringLiteral("4"));
+}
+
+void tst_ModelNotifications::createsCoalesced()
+{
+    QSignalSpy rowsInserted(_model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    notify(EnginioString::create, object("new1", "created"));
+    notify(EnginioString::create, object("new2", "created"));
+    notify(EnginioString::update, object("new1", "updated"));
+
+    QTRY_COMPARE(rowsInserted.count(), 1);
+    QCOMPARE(rowsInserted[0][1].toInt(), 10);
+    QCOMPARE(rowsInserted[0][2].toInt(), 11);
+    QCOMPARE(title(10), QStringLiteral("updated"));
+    QCOMPARE(title(11), QStringLiteral("created"));
+}
+
+void tst_ModelNotifications::createdAndRemoved()
+{
+    QSignalSpy rowsInserted(_model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy rowsRemoved(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    notify(EnginioString::create, object("new", "created"));
+    notify(EnginioString::update, object("new", "updated"));
+    notify(EnginioString::_delete, object("new", "updated"));
+    notify(EnginioString::update, object("5", "changed"));
+
+    QTRY_COMPARE(title(5), QStringLiteral("changed"));
+    QCOMPARE(rowsInserted.count(), 0);
+    QCOMPARE(rowsRemoved.count(), 0);
+    QCOMPARE(_model->rowCount(), 10);
+}
+
+void tst_ModelNotifications::updatedAndRemoved()
+{
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QSignalSpy rowsRemoved(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    notify(EnginioString::update, object("5", "changed"));
+    notify(EnginioString::_delete, object("5", "changed"));
+
+    QTRY_COMPARE(rowsRemoved.count(), 1);
+    QCOMPARE(dataChanged.count(), 0);
+    QCOMPARE(_model->rowCount(), 9);
+}
+
+void tst_ModelNotifications::interval()
+{
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    _model->setNotificationInterval(100);
+    QElapsedTimer timer;
+    timer.start();
+    notify(EnginioString::update, object("1", "changed"));
+    QTest::qWait(10);
+    notify(EnginioString::update, object("2", "changed"));
+
+    QTRY_COMPARE(dataChanged.count(), 1);
+    QVERIFY(timer.elapsed() >= 100);
+    QCOMPARE(dataChanged[0][0].value<QModelIndex>().row(), 1);
+    QCOMPARE(dataChanged[0][1].value<QModelIndex>().row(), 2);
+}
+
+void tst_ModelNotifications::immediate()
+{
+    QSignalSpy dataChanged(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    _model->setNotificationInterval(-1);
+    notify(EnginioString::update, object("1", "changed"));
+    QCOMPARE(dataChanged.count(), 1);
+    notify(EnginioString::update, object("2", "changed"));
+    QCOMPARE(dataChanged.count(), 2);
+}
+
+QTEST_MAIN(tst_ModelNotifications)
+#include "tst_modelnotifications.moc"
@@ -0,0 +1,494 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/enginiooauth2authentication.h>
+#include <Enginio/private/enginiobackendconnection_p.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginionotificationhub_p.h>
+
+#include "enginiolocalserver.h"
+
+namespace {
+
+struct Subscriber : public EnginioNotificationSubscriber
+{
+    QList<QJsonObject> messages;
+    int reconnects;
+
+    Subscriber()
+        : reconnects(0)
+    {}
+
+    virtual void notificationReceived(const QJsonObject &data) Q_DECL_OVERRIDE
+    {
+        messages.append(data);
+    }
+
+    virtual void streamReconnected() Q_DECL_OVERRIDE
+    {
+        ++reconnects;
+    }
+};
+
+struct QueryCounter
+{
+    int *queries;
+    void operator ()(const QByteArray &method, const QString &path)
+    {
+        if (method == "GET" && path.startsWith(QStringLiteral("/v1/objects/")))
+            ++*queries;
+    }
+};
+
+}
+
+class tst_NotificationHub: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+    int _streamRequests;
+
+public slots:
+    void requestReceived(const QByteArray &, const QString &path)
+    {
+        if (path == QStringLiteral("/v1/stream_url"))
+            ++_streamRequests;
+    }
+
+private slots:
+    void initTestCase();
+    void init();
+    void oneConnectionForAllSubscribers();
+    void reconnectOnlyForNewTypes();
+    void lastUnsubscribeCloses();
+    void concurrentHandshakes();
+    void reconnect();
+    void noReconnectAfterClose();
+    void subscribersToldAboutGaps();
+    void modelCatchUp();
+    void modelCatchUpWithLimit();
+    void modelCatchUpCappedListing();
+    void sessionChangeReconnects();
+
+private:
+    void prepareClient(EnginioClient *client)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("notificationhub"));
+    }
+    EnginioNotificationHub *hub(EnginioClient *client)
+    {
+        return EnginioClientConnectionPrivate::get(client)->notificationHub();
+    }
+};
+
+void tst_NotificationHub::initTestCase()
+{
+    QVERIFY(_server.listen());
+    QObject::connect(&_server, &EnginioTests::EnginioLocalServer::requestReceived, this, &tst_NotificationHub::requestReceived);
+}
+
+void tst_NotificationHub::init()
+{
+    _server.clear();
+    _server.setResultLimit(0);
+    _streamRequests = 0;
+}
+
+void tst_NotificationHub::oneConnectionForAllSubscribers()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioNotificationHub *notifications = hub(&client);
+
+    Subscriber todos1, todos2, users;
+    notifications->subscribe(&todos1, QStringLiteral("objects.todos"));
+    notifications->subscribe(&todos2, QStringLiteral("objects.todos"));
+    notifications->subscribe(&users, QStringLiteral("objects.users"));
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    QCOMPARE(_streamRequests, 1);
+
+    QJsonObject types = notifications->filter()["data"].toObject()["objectType"].toObject();
+    QCOMPARE(types["$in"].toArray().count(), 2);
+
+    QJsonObject object;
+    object["title"] = QStringLiteral("routed");
+    _server.insertObject(QStringLiteral("objects.todos"), object);
+    _server.insertObject(QStringLiteral("objects.users"), object);
+    _server.insertObject(QStringLiteral("objects.other"), object);
+
+    QTRY_COMPARE(users.messages.count(), 1);
+    QTRY_COMPARE(todos1.messages.count(), 1);
+    QCOMPARE(todos2.messages.count(), 1);
+    QCOMPARE(todos1.messages.first()["data"].toObject()["objectType"].toString(), QStringLiteral("objects.todos"));
+    QCOMPARE(users.messages.first()["data"].toObject()["objectType"].toString(), QStringLiteral("objects.users"));
+    QCOMPARE(_server.statistics().notificationsSent, quint64(2));
+
+    notifications->unsubscribe(&todos1);
+    notifications->unsubscribe(&todos2);
+    notifications->unsubscribe(&users);
+}
+
+void tst_NotificationHub::reconnectOnlyForNewTypes()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioNotificationHub *notifications = hub(&client);
+
+    Subscriber todos, users;
+    notifications->subscribe(&todos, QStringLiteral("objects.todos"));
+    notifications->subscribe(&users, QStringLiteral("objects.users"));
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    EnginioBackendConnection *connection = notifications->connection();
+
+    // fewer types, the old filter still covers them
+    notifications->unsubscribe(&users);
+    QTest::qWait(50);
+    QCOMPARE(notifications->connection(), connection);
+    notifications->subscribe(&users, QStringLiteral("objects.todos"));
+    QTest::qWait(50);
+    QCOMPARE(notifications->connection(), connection);
+    QCOMPARE(_streamRequests, 1);
+
+    // a new type needs a new filter
+    notifications->subscribe(&users, QStringLiteral("objects.users"));
+    QTRY_VERIFY(notifications->connection() != connection);
+    QTRY_VERIFY(notifications->connection()->isConnected());
+    QCOMPARE(_streamRequests, 2);
+
+    QJsonObject object;
+    object["title"] = QStringLiteral("after reconnect");
+    _server.insertObject(QStringLiteral("objects.users"), object);
+    QTRY_COMPARE(users.messages.count(), 1);
+    QCOMPARE(todos.messages.count(), 0);
+
+    notifications->unsubscribe(&todos);
+    notifications->unsubscribe(&users);
+}
+
+void tst_NotificationHub::lastUnsubscribeCloses()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioNotificationHub *notifications = hub(&client);
+
+    Subscriber todos;
+    notifications->subscribe(&todos, QStringLiteral("objects.todos"));
+    QTRY_VERIFY(notifications->connection());
+    notifications->unsubscribe(&todos);
+    QTRY_VERIFY(!notifications->connection());
+}
+
+void tst_NotificationHub::concurrentHandshakes()
+{
+    // every connection verifies the accept key of its own handshake
+    EnginioClient client;
+    prepareClient(&client);
+    QJsonObject filter;
+    EnginioBackendConnection first, second;
+    first.connectToBackend(&client, filter);
+    second.connectToBackend(&client, filter);
+    QTRY_VERIFY(first.isConnected());
+    QTRY_VERIFY(second.isConnected());
+}
+
+void tst_NotificationHub::reconnect()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioBackendConnection connection;
+    connection.setInitialReconnectDelay(20);
+    QSignalSpy reconnected(&connection, SIGNAL(reconnected()));
+    QSignalSpy received(&connection, SIGNAL(dataReceived(QJsonObject)));
+    connection.connectToBackend(&client, QJsonObject());
+    QTRY_VERIFY(connection.isConnected());
+    QCOMPARE(connection.reconnectCount(), 0);
+
+    _server.dropWebSockets();
+    QTRY_COMPARE(reconnected.count(), 1);
+    QVERIFY(connection.isConnected());
+    QCOMPARE(connection.reconnectCount(), 1);
+    QCOMPARE(_streamRequests, 2); // the stream url expires, a fresh one is used
+
+    _server.insertObject(QStringLiteral("objects.todos"), QJsonObject());
+    QTRY_COMPARE(received.count(), 1);
+
+    _server.dropWebSockets();
+    QTRY_COMPARE(connection.reconnectCount(), 2);
+}
+
+void tst_NotificationHub::noReconnectAfterClose()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioBackendConnection connection;
+    connection.setInitialReconnectDelay(20);
+    connection.connectToBackend(&client, QJsonObject());
+    QTRY_VERIFY(connection.isConnected());
+
+    connection.close();
+    QTRY_VERIFY(!connection.isConnected());
+    QTest::qWait(200);
+    QVERIFY(!connection.isConnected());
+    QCOMPARE(connection.reconnectCount(), 0);
+    QCOMPARE(_streamRequests, 1);
+}
+
+void tst_NotificationHub::subscribersToldAboutGaps()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioNotificationHub *notifications = hub(&client);
+
+    Subscriber todos, users;
+    notifications->subscribe(&todos, QStringLiteral("objects.todos"));
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    notifications->connection()->setInitialReconnectDelay(20);
+
+    // replaced by a connection with a wider filter
+    notifications->subscribe(&users, QStringLiteral("objects.users"));
+    QTRY_COMPARE(todos.reconnects, 1);
+    QCOMPARE(users.reconnects, 0);
+    notifications->connection()->setInitialReconnectDelay(20);
+
+    _server.dropWebSockets();
+    QTRY_COMPARE(todos.reconnects, 2);
+    QCOMPARE(users.reconnects, 1);
+
+    notifications->unsubscribe(&todos);
+    notifications->unsubscribe(&users);
+}
+
+void tst_NotificationHub::modelCatchUp()
+{
+    const QString objectType = QStringLiteral("objects.gap");
+    for (int i = 0; i < 3; ++i) {
+        QJsonObject object;
+        object["title"] = QStringLiteral("before");
+        _server.insertObject(objectType, object);
+    }
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    QJsonObject query;
+    query["objectType"] = objectType;
+    model.setQuery(query);
+    model.setClient(&client);
+    QTRY_COMPARE(model.rowCount(), 3);
+
+    // changes the model does not hear about
+    QJsonObject changed = model.data(model.index(1), Enginio::JsonObjectRole).toJsonValue().toObject();
+    changed["title"] = QStringLiteral("while away");
+    QTest::qWait(5); // a later updatedAt
+    EnginioReply *reply = client.update(changed);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->isError());
+    QJsonObject created;
+    created["title"] = QStringLiteral("created while away");
+    _server.insertObject(objectType, created);
+
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    d->catchUp();
+    QTRY_COMPARE(model.rowCount(), 4);
+    QCOMPARE(model.data(model.index(1), Enginio::JsonObjectRole).toJsonValue().toObject()["title"].toString(), QStringLiteral("while away"));
+    QCOMPARE(model.data(model.index(3), Enginio::JsonObjectRole).toJsonValue().toObject()["title"].toString(), QStringLiteral("created while away"));
+    QCOMPARE(reset.count(), 0); // not a full reload
+
+    EnginioBaseModelPrivate::GapStatistics statistics = d->gapStatistics();
+    QCOMPARE(statistics.reconnects, 1);
+    QCOMPARE(statistics.filledGaps, 1);
+    QVERIFY(statistics.lastGap >= 2);
+    QCOMPARE(statistics.filledObjects, statistics.lastGap);
+}
+
+void tst_NotificationHub::modelCatchUpWithLimit()
+{
+    const QString objectType = QStringLiteral("objects.gaplimit");
+    QList<QJsonObject> objects;
+    for (int i = 0; i < 5; ++i) {
+        QJsonObject object;
+        object["title"] = QStringLiteral("before");
+        objects.append(_server.insertObject(objectType, object));
+        QTest::qWait(2); // distinct createdAt
+    }
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    QJsonObject query;
+    query["objectType"] = objectType;
+    query["limit"] = 3;
+    QJsonObject newestFirst;
+    newestFirst["sortBy"] = QStringLiteral("createdAt");
+    newestFirst["direction"] = QStringLiteral("desc");
+    QJsonArray sort;
+    sort.append(newestFirst);
+    query["sort"] = sort;
+    model.setQuery(query);
+    model.setClient(&client);
+    QTRY_COMPARE(model.rowCount(), 3);
+
+    // changed while away, but older than the rows of the model
+    QJsonObject changed = objects.first();
+    changed["title"] = QStringLiteral("while away");
+    QTest::qWait(5); // a later updatedAt
+    EnginioReply *reply = client.update(changed);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->isError());
+
+    int queries = 0;
+    QueryCounter counter = { &queries };
+    QMetaObject::Connection connection = QObject::connect(&_server, &EnginioTests::EnginioLocalServer::requestReceived, counter);
+    d->catchUp();
+    QTRY_COMPARE(d->gapStatistics().filledGaps, 1);
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(queries, 1);
+    for (int row = 0; row < model.rowCount(); ++row)
+        QVERIFY(model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject()["id"] != changed["id"]);
+
+    // a new object may belong anywhere, the model asks the backend again
+    QJsonObject created;
+    created["title"] = QStringLiteral("created while away");
+    _server.insertObject(objectType, created);
+    d->catchUp();
+    QTRY_COMPARE(queries, 3); // the catch up and the full query
+    QTest::qWait(50);
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(d->gapStatistics().filledGaps, 1);
+    QObject::disconnect(connection);
+}
+
+void tst_NotificationHub::modelCatchUpCappedListing()
+{
+    const QString objectType = QStringLiteral("objects.gapcapped");
+    for (int i = 0; i < 3; ++i) {
+        QJsonObject object;
+        object["title"] = QStringLiteral("before");
+        _server.insertObject(objectType, object);
+    }
+
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    QJsonObject query;
+    query["objectType"] = objectType;
+    model.setQuery(query);
+    model.setClient(&client);
+    QTRY_COMPARE(model.rowCount(), 3);
+
+    // more changes than the backend sends in one listing
+    QTest::qWait(5); // a later updatedAt
+    for (int row = 0; row < 3; ++row) {
+        QJsonObject changed = model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject();
+        changed["title"] = QStringLiteral("while away");
+        EnginioReply *reply = client.update(changed);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+    _server.setResultLimit(2);
+
+    int queries = 0;
+    QueryCounter counter = { &queries };
+    QMetaObject::Connection connection = QObject::connect(&_server, &EnginioTests::EnginioLocalServer::requestReceived, counter);
+    d->catchUp();
+    QTRY_COMPARE(d->gapStatistics().reloadedGaps, 1);
+    QCOMPARE(d->gapStatistics().filledGaps, 0);
+    QTRY_COMPARE(queries, 2); // the catch up and the full query
+    QObject::disconnect(connection);
+
+    // the model shows what the capped backend lists, none of it from before the gap
+    QTRY_COMPARE(model.rowCount(), 2);
+    for (int row = 0; row < model.rowCount(); ++row)
+        QCOMPARE(model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject()["title"].toString(), QStringLiteral("while away"));
+}
+
+void tst_NotificationHub::sessionChangeReconnects()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    QJsonObject user;
+    user["username"] = QStringLiteral("hubuser");
+    user["password"] = QStringLiteral("hubpassword");
+    EnginioReply *created = client.create(user, Enginio::UserOperation);
+    QTRY_VERIFY(created->isFinished());
+    QVERIFY(!created->isError());
+
+    EnginioNotificationHub *notifications = hub(&client);
+    Subscriber todos;
+    notifications->subscribe(&todos, QStringLiteral("objects.todos"));
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    QCOMPARE(_streamRequests, 1);
+
+    // the stream of the anonymous session must not be kept after a login
+    EnginioOAuth2Authentication identity;
+    identity.setUser(QStringLiteral("hubuser"));
+    identity.setPassword(QStringLiteral("hubpassword"));
+    client.setIdentity(&identity);
+    QTRY_COMPARE(client.authenticationState(), Enginio::Authenticated);
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    const int afterLogin = _streamRequests;
+    QVERIFY(afterLogin > 1);
+
+    client.setIdentity(0);
+    QTRY_VERIFY(_streamRequests > afterLogin);
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+    const int afterLogout = _streamRequests;
+
+    client.setBackendId(QByteArrayLiteral("notificationhub2"));
+    QTRY_VERIFY(_streamRequests > afterLogout);
+    QTRY_VERIFY(notifications->connection() && notifications->connection()->isConnected());
+
+    // nothing to do without subscribers
+    notifications->unsubscribe(&todos);
+    QTRY_VERIFY(!notifications->connection());
+    const int unsubscribed = _streamRequests;
+    client.setBackendId(QByteArrayLiteral("notificationhub"));
+    QTest::qWait(50);
+    QVERIFY(!notifications->connection());
+    QCOMPARE(_streamRequests, unsubscribed);
+}
+
+QTEST_MAIN(tst_NotificationHub)
+#include "tst_notificationhub.moc"
@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_Prefetch: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void disabledByDefault();
+    void pagesInFlight();
+    void loadsUntilTheEnd();
+    void firstPageWithoutLimit();
+    void outOfOrderPages();
+    void duplicatesSkipped();
+
+private:
+    static const int ObjectCount = 200;
+    static const int FirstPage = 20;
+
+    EnginioBaseModelPrivate *prepareModel(EnginioModel *model, EnginioClient *client, int prefetchPages)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("prefetch"));
+        QJsonObject sort;
+        sort["sortBy"] = QStringLiteral("title");
+        sort["direction"] = QStringLiteral("asc");
+        QJsonObject query;
+        query["objectType"] = QStringLiteral("objects.prefetch");
+        query["sort"] = QJsonArray() << sort;
+        query["limit"] = FirstPage;
+        model->setPrefetchPages(prefetchPages);
+        model->setQuery(query);
+        model->setClient(client);
+        return static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(model));
+    }
+    static QJsonObject object(int i)
+    {
+        QJsonObject object;
+        object["id"] = QString::number(i);
+        object["title"] = title(i);
+        return object;
+    }
+    static QJsonArray objects(int first, int count)
+    {
+        QJsonArray objects;
+        for (int i = first; i < first + count; ++i)
+            objects.append(object(i));
+        return objects;
+    }
+    static QString title(int i)
+    {
+        return QString::fromLatin1("object %1").arg(i, 4, 10, QLatin1Char('0'));
+    }
+    static void verifyOrder(const EnginioModel &model)
+    {
+        for (int row = 0; row < model.rowCount(); ++row) {
+            const QJsonObject object = model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject();
+            QCOMPARE(object["title"].toString(), title(row));
+        }
+    }
+};
+
+void tst_Prefetch::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_Prefetch::init()
+{
+    _server.clear();
+    for (int i = 0; i < ObjectCount; ++i) {
+        QJsonObject object;
+        object["title"] = title(i);
+        _server.insertObject(QStringLiteral("objects.prefetch"), object);
+    }
+}
+
+void tst_Prefetch::disabledByDefault()
+{
+    EnginioClient client;
+    EnginioModel model;
+    QCOMPARE(model.prefetchPages(), 0);
+    prepareModel(&model, &client, 0);
+    QTRY_COMPARE(model.rowCount(), FirstPage);
+    QVERIFY(!model.canFetchMore(QModelIndex()));
+}
+
+void tst_Prefetch::pagesInFlight()
+{
+    EnginioClient client;
+    EnginioModel model;
+    prepareModel(&model, &client, 3);
+    QTRY_COMPARE(model.rowCount(), FirstPage);
+    QVERIFY(model.canFetchMore(QModelIndex()));
+
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    model.fetchMore(QModelIndex());
+    model.fetchMore(QModelIndex()); // nothing more while three are on their way
+    QTRY_COMPARE(model.rowCount(), 4 * FirstPage);
+    QCOMPARE(requests.count(), 3);
+    verifyOrder(model);
+    QVERIFY(model.canFetchMore(QModelIndex()));
+}
+
+void tst_Prefetch::loadsUntilTheEnd()
+{
+    EnginioClient client;
+    EnginioModel model;
+    prepareModel(&model, &client, 2);
+    QTRY_COMPARE(model.rowCount(), FirstPage);
+
+    QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    while (model.canFetchMore(QModelIndex())) {
+        const int rows = model.rowCount();
+        model.fetchMore(QModelIndex());
+        QTRY_VERIFY(model.rowCount() > rows || !model.canFetchMore(QModelIndex()));
+    }
+    QCOMPARE(model.rowCount(), ObjectCount);
+    verifyOrder(model);
+    for (int i = 0; i < inserted.count(); ++i)
+        QCOMPARE(inserted[i][1].toInt(), i ? inserted[i - 1][2].toInt() + 1 : FirstPage);
+}
+
+void tst_Prefetch::firstPageWithoutLimit()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client, 2);
+    QTRY_COMPARE(model.rowCount(), FirstPage);
+
+    QJsonObject query = model.query();
+    query.remove("limit");
+    model.setQuery(query);
+    QTRY_COMPARE(model.rowCount(), int(InitialPrefetchPageSize));
+    QCOMPARE(d->prefetchPageSize(), int(InitialPrefetchPageSize));
+    QVERIFY(model.canFetchMore(QModelIndex()));
+}
+
+void tst_Prefetch::outOfOrderPages()
+{
+    EnginioModel model;
+    model.setPrefetchPages(3);
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    d->resetPrefetch(FirstPage);
+    d->resetData(objects(0, FirstPage));
+
+    QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    d->receivedPage(3 * FirstPage, FirstPage, objects(3 * FirstPage, FirstPage));
+    d->receivedPage(2 * FirstPage, FirstPage, objects(2 * FirstPage, FirstPage));
+    QCOMPARE(model.rowCount(), FirstPage);
+    QCOMPARE(inserted.count(), 0);
+
+    d->receivedPage(FirstPage, FirstPage, objects(FirstPage, FirstPage));
+    QCOMPARE(model.rowCount(), 4 * FirstPage);
+    QCOMPARE(inserted.count(), 3);
+    verifyOrder(model);
+    QVERIFY(model.canFetchMore(QModelIndex()));
+
+    // a short page is the last one
+    d->receivedPage(4 * FirstPage, FirstPage, objects(4 * FirstPage, 5));
+    QCOMPARE(model.rowCount(), 4 * FirstPage + 5);
+    QVERIFY(!model.canFetchMore(QModelIndex()));
+    QCOMPARE(d->existingRow(QStringLiteral("82")), 82);
+}
+
+void tst_Prefetch::duplicatesSkipped()
+{
+    EnginioModel model;
+    model.setPrefetchPages(1);
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    d->resetPrefetch(FirstPage);
+    QJsonArray rows = objects(0, FirstPage);
+    rows.append(object(FirstPage)); // announced by a notification before its page arrived
+    d->resetData(rows);
+
+    d->receivedPage(FirstPage, FirstPage, objects(FirstPage, FirstPage));
+    QCOMPARE(model.rowCount(), 2 * FirstPage);
+    verifyOrder(model);
+}
+
+QTEST_MAIN(tst_Prefetch)
+#include "tst_prefetch.moc"
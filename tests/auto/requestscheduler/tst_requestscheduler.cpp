@@ -0,0 +1,329 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginiobatch.h>
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginiorequestscheduler_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_RequestScheduler: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void sentRightAwayWithRoom();
+    void clientPriorities();
+    void order();
+    void setPriorityWhileQueued();
+    void promotion();
+    void promotionWithoutFinishedReply();
+    void deletedWhileQueued();
+    void concurrencyLimit();
+    void batchWaitsForModelWrites();
+
+private:
+    EnginioRequestScheduler *prepareClient(EnginioClient *client)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("requestscheduler"));
+        EnginioRequestScheduler *scheduler = EnginioClientConnectionPrivate::get(client)->_scheduler.data();
+        scheduler->setPromotionInterval(0);
+        return scheduler;
+    }
+    static QJsonObject query(const QString &objectType)
+    {
+        QJsonObject query;
+        query["objectType"] = objectType;
+        return query;
+    }
+    static QStringList paths(const QSignalSpy &requests)
+    {
+        QStringList paths;
+        foreach (const QList<QVariant> &request, requests)
+            paths.append(request.at(1).toString());
+        return paths;
+    }
+};
+
+void tst_RequestScheduler::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_RequestScheduler::init()
+{
+    _server.clear();
+}
+
+void tst_RequestScheduler::sentRightAwayWithRoom()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    EnginioReply *reply = client.query(query(QStringLiteral("objects.interactive")));
+    QCOMPARE(reply->priority(), Enginio::InteractivePriority);
+    QCOMPARE(scheduler->queuedCount(), 0);
+    QCOMPARE(scheduler->runningCount(), 1);
+
+    EnginioReply *write = client.create(query(QStringLiteral("objects.write")));
+    QCOMPARE(write->priority(), Enginio::ModelWritePriority);
+    QCOMPARE(scheduler->queuedCount(), 0);
+    QCOMPARE(scheduler->runningCount(), 2);
+    const QString requestId = write->requestId();
+    QVERIFY(!requestId.isEmpty());
+
+    QTRY_VERIFY(reply->isFinished() && write->isFinished());
+    QVERIFY(!reply->isError());
+    QVERIFY(!write->isError());
+    QCOMPARE(write->requestId(), requestId);
+    QCOMPARE(write->data()["objectType"].toString(), QStringLiteral("objects.write"));
+    QCOMPARE(scheduler->runningCount(), 0);
+
+    const EnginioRequestScheduler::Statistics statistics = scheduler->statistics();
+    QCOMPARE(statistics.started[Enginio::InteractivePriority], quint64(1));
+    QCOMPARE(statistics.started[Enginio::ModelWritePriority], quint64(1));
+    QCOMPARE(statistics.queued, quint64(0));
+    QCOMPARE(statistics.promoted, quint64(0));
+}
+
+void tst_RequestScheduler::clientPriorities()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    QCOMPARE(client.queryPriority(), Enginio::InteractivePriority);
+    QCOMPARE(client.writePriority(), Enginio::ModelWritePriority);
+
+    QSignalSpy queryPriorityChanged(&client, SIGNAL(queryPriorityChanged(Enginio::RequestPriority)));
+    QSignalSpy writePriorityChanged(&client, SIGNAL(writePriorityChanged(Enginio::RequestPriority)));
+    client.setQueryPriority(Enginio::BackgroundPriority);
+    client.setWritePriority(Enginio::BackgroundPriority);
+    client.setWritePriority(Enginio::BackgroundPriority);
+    QCOMPARE(queryPriorityChanged.count(), 1);
+    QCOMPARE(writePriorityChanged.count(), 1);
+
+    scheduler->setConcurrencyLimit(Enginio::BackgroundPriority, 0);
+    EnginioReply *background = client.query(query(QStringLiteral("objects.background")));
+    EnginioReply *write = client.create(query(QStringLiteral("objects.write")));
+    QCOMPARE(background->priority(), Enginio::BackgroundPriority);
+    QCOMPARE(write->priority(), Enginio::BackgroundPriority);
+    QCOMPARE(scheduler->queuedCount(), 2);
+
+    QSignalSpy priorityChanged(write, SIGNAL(priorityChanged(Enginio::RequestPriority)));
+    write->setPriority(Enginio::ModelWritePriority);
+    write->setPriority(Enginio::ModelWritePriority);
+    QCOMPARE(priorityChanged.count(), 1);
+    QCOMPARE(priorityChanged.at(0).at(0).value<Enginio::RequestPriority>(), Enginio::ModelWritePriority);
+    QTRY_VERIFY(write->isFinished());
+    QVERIFY(!write->isError());
+    QVERIFY(!background->isFinished());
+    QCOMPARE(scheduler->queuedCount(), 1);
+}
+
+void tst_RequestScheduler::order()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setMaximalConcurrency(0);
+
+    QList<EnginioReply*> replies;
+    replies << client.query(query(QStringLiteral("objects.background")));
+    replies.last()->setPriority(Enginio::BackgroundPriority);
+    replies << client.create(query(QStringLiteral("objects.write")));
+    replies << client.query(query(QStringLiteral("objects.interactive")));
+    QCOMPARE(scheduler->queuedCount(), 3);
+
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    QTest::qWait(50);
+    QCOMPARE(requests.count(), 0);
+
+    scheduler->setMaximalConcurrency(1);
+    foreach (EnginioReply *reply, replies)
+        QTRY_VERIFY(reply->isFinished());
+    foreach (EnginioReply *reply, replies)
+        QVERIFY(!reply->isError());
+
+    QCOMPARE(paths(requests), QStringList()
+             << QStringLiteral("/v1/objects/interactive")
+             << QStringLiteral("/v1/objects/write")
+             << QStringLiteral("/v1/objects/background"));
+    QCOMPARE(scheduler->statistics().maximalRunning, 1);
+}
+
+void tst_RequestScheduler::setPriorityWhileQueued()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setMaximalConcurrency(0);
+
+    EnginioReply *first = client.query(query(QStringLiteral("objects.first")));
+    EnginioReply *second = client.query(query(QStringLiteral("objects.second")));
+    first->setPriority(Enginio::FileTransferPriority);
+    QCOMPARE(first->priority(), Enginio::FileTransferPriority);
+
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    scheduler->setMaximalConcurrency(1);
+    QTRY_VERIFY(first->isFinished() && second->isFinished());
+    QCOMPARE(paths(requests), QStringList()
+             << QStringLiteral("/v1/objects/second")
+             << QStringLiteral("/v1/objects/first"));
+
+    // a sent request keeps its slot, the new class is only remembered
+    second->setPriority(Enginio::BackgroundPriority);
+    QCOMPARE(second->priority(), Enginio::BackgroundPriority);
+}
+
+void tst_RequestScheduler::promotion()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setMaximalConcurrency(0);
+    scheduler->setPromotionInterval(20);
+
+    EnginioReply *background = client.query(query(QStringLiteral("objects.background")));
+    background->setPriority(Enginio::BackgroundPriority);
+    QTest::qWait(100); // long enough to be promoted twice
+    EnginioReply *interactive = client.query(query(QStringLiteral("objects.interactive")));
+
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    scheduler->setMaximalConcurrency(1);
+    QTRY_VERIFY(background->isFinished() && interactive->isFinished());
+    QCOMPARE(paths(requests), QStringList()
+             << QStringLiteral("/v1/objects/background")
+             << QStringLiteral("/v1/objects/interactive"));
+    QCOMPARE(scheduler->statistics().promoted, quint64(1));
+}
+
+void tst_RequestScheduler::promotionWithoutFinishedReply()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setConcurrencyLimit(Enginio::BackgroundPriority, 0);
+    scheduler->setPromotionInterval(20);
+    client.setQueryPriority(Enginio::BackgroundPriority);
+
+    EnginioReply *background = client.query(query(QStringLiteral("objects.background")));
+    QCOMPARE(scheduler->queuedCount(), 1);
+
+    // no other reply finishes, the request is sent once it was promoted
+    QTRY_VERIFY(background->isFinished());
+    QVERIFY(!background->isError());
+    QCOMPARE(scheduler->statistics().promoted, quint64(1));
+}
+
+void tst_RequestScheduler::deletedWhileQueued()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setMaximalConcurrency(0);
+
+    EnginioReply *dropped = client.query(query(QStringLiteral("objects.dropped")));
+    EnginioReply *kept = client.query(query(QStringLiteral("objects.kept")));
+    delete dropped;
+
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    scheduler->setMaximalConcurrency(1);
+    QTRY_VERIFY(kept->isFinished());
+    QVERIFY(!kept->isError());
+    QCOMPARE(scheduler->queuedCount(), 0);
+    QTest::qWait(50);
+    QCOMPARE(paths(requests), QStringList() << QStringLiteral("/v1/objects/kept"));
+}
+
+void tst_RequestScheduler::concurrencyLimit()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setConcurrencyLimit(Enginio::ModelWritePriority, 2);
+
+    QList<EnginioReply*> replies;
+    for (int i = 0; i < 10; ++i) {
+        QJsonObject object = query(QStringLiteral("objects.write"));
+        object["index"] = i;
+        replies << client.create(object);
+    }
+    foreach (EnginioReply *reply, replies)
+        QTRY_VERIFY(reply->isFinished());
+    foreach (EnginioReply *reply, replies)
+        QVERIFY(!reply->isError());
+    QCOMPARE(_server.objectCount(QStringLiteral("objects.write")), 10);
+
+    const EnginioRequestScheduler::Statistics statistics = scheduler->statistics();
+    QCOMPARE(statistics.started[Enginio::ModelWritePriority], quint64(10));
+    QCOMPARE(statistics.queued, quint64(8)); // the first two had room
+    QCOMPARE(statistics.maximalRunning, 2);
+}
+
+void tst_RequestScheduler::batchWaitsForModelWrites()
+{
+    EnginioClient client;
+    EnginioRequestScheduler *scheduler = prepareClient(&client);
+    scheduler->setConcurrencyLimit(Enginio::ModelWritePriority, 0);
+
+    EnginioBatch batch(&client);
+    for (int i = 0; i < 3; ++i) {
+        QJsonObject object = query(QStringLiteral("objects.batch"));
+        object["index"] = i;
+        batch.create(object);
+    }
+    EnginioReply *batchReply = batch.send();
+    EnginioReply *interactive = client.query(query(QStringLiteral("objects.interactive")));
+
+    // The query passes the batch that has to wait for room in its class.
+    QTRY_VERIFY(interactive->isFinished());
+    QVERIFY(!interactive->isError());
+    QVERIFY(!batchReply->isFinished());
+    QCOMPARE(scheduler->queuedCount(), 1);
+    QCOMPARE(_server.objectCount(QStringLiteral("objects.batch")), 0);
+
+    scheduler->setConcurrencyLimit(Enginio::ModelWritePriority, 1);
+    QTRY_VERIFY(batchReply->isFinished());
+    QVERIFY(!batchReply->isError());
+    QCOMPARE(_server.objectCount(QStringLiteral("objects.batch")), 3);
+
+    const EnginioRequestScheduler::Statistics statistics = scheduler->statistics();
+    QCOMPARE(statistics.started[Enginio::ModelWritePriority], quint64(1));
+    QCOMPARE(statistics.started[Enginio::InteractivePriority], quint64(1));
+    QCOMPARE(scheduler->queuedCount(), 0);
+}
+
+QTEST_MAIN(tst_RequestScheduler)
+#include "tst_requestscheduler.moc"
@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+#include <QtCore/qtemporarydir.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginioresponsecache_p.h>
+#include <Enginio/private/enginiorequestscheduler_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_ResponseCache: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void disabledByDefault();
+    void notModified();
+    void modified();
+    void identity();
+    void eviction();
+    void evictedBeforeNotModified();
+    void diskSpill();
+
+private:
+    EnginioReply *query(EnginioClient *client, int limit = 0);
+    EnginioResponseCache *cache(EnginioClient *client)
+    {
+        return EnginioClientConnectionPrivate::get(client)->_responseCache.data();
+    }
+    void prepareClient(EnginioClient *client)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("responsecache"));
+        client->setResponseCacheSize(EnginioResponseCache::DefaultMaximumSize);
+    }
+};
+
+void tst_ResponseCache::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_ResponseCache::init()
+{
+    _server.clear();
+    _server.resetStatistics();
+    for (int i = 0; i < 10; ++i) {
+        QJsonObject object;
+        object["title"] = QString::fromUtf8("Cached ") + QString::number(i);
+        _server.insertObject(QStringLiteral("objects.cached"), object);
+    }
+}
+
+EnginioReply *tst_ResponseCache::query(EnginioClient *client, int limit)
+{
+    QJsonObject query;
+    query["objectType"] = QString::fromUtf8("objects.cached");
+    if (limit)
+        query["limit"] = limit;
+    EnginioReply *reply = client->query(query);
+    reply->setParent(this);
+    return reply;
+}
+
+void tst_ResponseCache::disabledByDefault()
+{
+    EnginioClient client;
+    client.setServiceUrl(_server.url());
+    client.setBackendId(QByteArrayLiteral("responsecache"));
+    QCOMPARE(client.responseCacheSize(), qint64(0));
+    QVERIFY(!cache(&client));
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+    EnginioReply *second = query(&client);
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+    QCOMPARE(_server.statistics().notModified, quint64(0));
+
+    QSignalSpy sizeChanged(&client, SIGNAL(responseCacheSizeChanged(qint64)));
+    client.setResponseCacheSize(1024);
+    QCOMPARE(sizeChanged.count(), 1);
+    QVERIFY(cache(&client));
+    QCOMPARE(cache(&client)->maximumSize(), qint64(1024));
+    client.setResponseCacheSize(0);
+    QCOMPARE(sizeChanged.count(), 2);
+    QVERIFY(!cache(&client));
+}
+
+void tst_ResponseCache::notModified()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    QVERIFY(cache(&client));
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+    QVERIFY(!first->isError());
+    QCOMPARE(cache(&client)->statistics().misses, quint64(1));
+    QCOMPARE(cache(&client)->statistics().hits, quint64(0));
+
+    EnginioReply *second = query(&client);
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+    QCOMPARE(second->backendStatus(), 200);
+    QCOMPARE(second->data(), first->data());
+    QCOMPARE(second->data()["results"].toArray().count(), 10);
+    QCOMPARE(_server.statistics().notModified, quint64(1));
+
+    EnginioResponseCache::Statistics statistics = cache(&client)->statistics();
+    QCOMPARE(statistics.hits, quint64(1));
+    QCOMPARE(statistics.misses, quint64(1));
+    QVERIFY(statistics.bytesSaved > 0);
+    QCOMPARE(statistics.memoryEntries, 1);
+}
+
+void tst_ResponseCache::modified()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+
+    QJsonObject object;
+    object["title"] = QString::fromUtf8("New one");
+    _server.insertObject(QStringLiteral("objects.cached"), object);
+
+    EnginioReply *second = query(&client);
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+    QCOMPARE(second->data()["results"].toArray().count(), 11);
+    QCOMPARE(cache(&client)->statistics().hits, quint64(0));
+    QCOMPARE(cache(&client)->statistics().misses, quint64(2));
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 1);
+
+    // A different url is a different entry.
+    EnginioReply *third = query(&client, 5);
+    QTRY_VERIFY(third->isFinished());
+    QCOMPARE(third->data()["results"].toArray().count(), 5);
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 2);
+}
+
+void tst_ResponseCache::identity()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+
+    // The backend id is a part of the key.
+    client.setBackendId(QByteArrayLiteral("responsecache2"));
+    EnginioReply *second = query(&client);
+    QTRY_VERIFY(second->isFinished());
+    QCOMPARE(cache(&client)->statistics().hits, quint64(0));
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 2);
+}
+
+void tst_ResponseCache::eviction()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+    const qint64 size = cache(&client)->statistics().memoryUsed;
+    QVERIFY(size > 0);
+
+    // Room for one response only, the least recently used one goes away.
+    cache(&client)->setMaximumSize(size);
+    EnginioReply *second = query(&client, 5);
+    QTRY_VERIFY(second->isFinished());
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 1);
+
+    EnginioReply *third = query(&client);
+    QTRY_VERIFY(third->isFinished());
+    QVERIFY(!third->isError());
+    QCOMPARE(third->data()["results"].toArray().count(), 10);
+    QCOMPARE(cache(&client)->statistics().hits, quint64(0));
+}
+
+void tst_ResponseCache::evictedBeforeNotModified()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    client.setQueryPriority(Enginio::BackgroundPriority);
+    EnginioRequestScheduler *scheduler = EnginioClientConnectionPrivate::get(&client)->_scheduler.data();
+
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+
+    // the conditional request is on its way when the entry goes away
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+    EnginioReply *second = query(&client);
+    cache(&client)->clear();
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+    QCOMPARE(second->backendStatus(), 200);
+    QCOMPARE(second->data()["results"].toArray().count(), 10);
+    QCOMPARE(_server.statistics().notModified, quint64(1));
+    QCOMPARE(requests.count(), 2);
+
+    // the request was sent again through the scheduler, in its class
+    const EnginioRequestScheduler::Statistics statistics = scheduler->statistics();
+    QCOMPARE(statistics.started[Enginio::BackgroundPriority], quint64(3));
+    QCOMPARE(statistics.started[Enginio::InteractivePriority], quint64(0));
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 1);
+}
+
+void tst_ResponseCache::diskSpill()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    EnginioClient client;
+    client.setResponseCacheDirectory(directory.path());
+    prepareClient(&client);
+    QCOMPARE(cache(&client)->directory(), directory.path());
+    client.setResponseCacheSize(1);
+
+    // Nothing fits into the memory, so everything is served from the disk.
+    EnginioReply *first = query(&client);
+    QTRY_VERIFY(first->isFinished());
+    QCOMPARE(cache(&client)->statistics().memoryEntries, 0);
+    QCOMPARE(cache(&client)->statistics().diskEntries, 1);
+
+    EnginioReply *second = query(&client);
+    QTRY_VERIFY(second->isFinished());
+    QVERIFY(!second->isError());
+    QCOMPARE(second->data(), first->data());
+    QCOMPARE(cache(&client)->statistics().hits, quint64(1));
+
+    // A new cache picks up the entries left on the disk.
+    EnginioResponseCache other;
+    other.setDirectory(directory.path());
+    QCOMPARE(other.statistics().diskEntries, 1);
+    other.clear();
+    QCOMPARE(other.statistics().diskEntries, 0);
+    QVERIFY(QDir(directory.path()).entryList(QDir::Files).isEmpty());
+}
+
+QTEST_MAIN(tst_ResponseCache)
+#include "tst_responsecache.moc"
@@ -0,0 +1,265 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginioreply_p.h>
+#include <Enginio/private/enginiosharedqueries_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_SharedQueries: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void identicalQueries();
+    void differentQueries();
+    void finishedQueryNotShared();
+    void writeEndsSharing();
+    void firstReplyDeleted();
+    void waitingReplyDeleted();
+    void models();
+
+private:
+    static const int ObjectCount = 5;
+
+    static EnginioSharedQueries *prepareClient(EnginioClient *client, const QUrl &url)
+    {
+        client->setServiceUrl(url);
+        client->setBackendId(QByteArrayLiteral("sharedqueries"));
+        return EnginioClientConnectionPrivate::get(client)->_sharedQueries.data();
+    }
+    static QJsonObject query(int limit = 0)
+    {
+        QJsonObject query;
+        query["objectType"] = QStringLiteral("objects.shared");
+        if (limit)
+            query["limit"] = limit;
+        return query;
+    }
+    static int parseCount(EnginioReply *reply)
+    {
+        return EnginioReplyStatePrivate::get(reply)->_parseCount;
+    }
+    static int gets(const QSignalSpy &requests)
+    {
+        int gets = 0;
+        foreach (const QList<QVariant> &request, requests)
+            gets += request.at(0).toByteArray() == QByteArrayLiteral("GET")
+                    && request.at(1).toString() == QStringLiteral("/v1/objects/shared");
+        return gets;
+    }
+};
+
+void tst_SharedQueries::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_SharedQueries::init()
+{
+    _server.clear();
+    for (int i = 0; i < ObjectCount; ++i) {
+        QJsonObject object;
+        object["index"] = i;
+        _server.insertObject(QStringLiteral("objects.shared"), object);
+    }
+}
+
+void tst_SharedQueries::identicalQueries()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    QList<EnginioReply*> replies;
+    for (int i = 0; i < 3; ++i)
+        replies << client.query(query());
+    QCOMPARE(sharedQueries->statistics().deduplicated, quint64(2));
+
+    QSet<QString> requestIds;
+    foreach (EnginioReply *reply, replies)
+        requestIds.insert(reply->requestId());
+    QCOMPARE(requestIds.count(), 3);
+
+    foreach (EnginioReply *reply, replies)
+        QTRY_VERIFY(reply->isFinished());
+    QTest::qWait(50);
+    QCOMPARE(gets(requests), 1);
+
+    int parsed = 0;
+    foreach (EnginioReply *reply, replies) {
+        QVERIFY(!reply->isError());
+        QCOMPARE(reply->backendStatus(), 200);
+        QCOMPARE(reply->data()["results"].toArray().count(), ObjectCount);
+        QCOMPARE(reply->data(), replies.first()->data());
+        parsed += parseCount(reply);
+    }
+    QCOMPARE(parsed, 1); // the JSON is shared as well
+
+    const EnginioSharedQueries::Statistics statistics = sharedQueries->statistics();
+    QCOMPARE(statistics.sent, quint64(1));
+    QCOMPARE(statistics.deduplicated, quint64(2));
+    QCOMPARE(sharedQueries->inFlightCount(), 0);
+}
+
+void tst_SharedQueries::differentQueries()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *all = client.query(query());
+    EnginioReply *limited = client.query(query(2));
+    QTRY_VERIFY(all->isFinished() && limited->isFinished());
+    QCOMPARE(gets(requests), 2);
+    QCOMPARE(all->data()["results"].toArray().count(), ObjectCount);
+    QCOMPARE(limited->data()["results"].toArray().count(), 2);
+    QCOMPARE(sharedQueries->statistics().deduplicated, quint64(0));
+
+    // another client is another identity
+    EnginioClient otherClient;
+    prepareClient(&otherClient, _server.url());
+    EnginioReply *first = client.query(query());
+    EnginioReply *second = otherClient.query(query());
+    QTRY_VERIFY(first->isFinished() && second->isFinished());
+    QCOMPARE(gets(requests), 4);
+}
+
+void tst_SharedQueries::finishedQueryNotShared()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *first = client.query(query());
+    QTRY_VERIFY(first->isFinished());
+    _server.insertObject(QStringLiteral("objects.shared"), QJsonObject());
+    EnginioReply *second = client.query(query());
+    QTRY_VERIFY(second->isFinished());
+    QCOMPARE(gets(requests), 2);
+    QCOMPARE(second->data()["results"].toArray().count(), ObjectCount + 1);
+    QCOMPARE(sharedQueries->statistics().deduplicated, quint64(0));
+}
+
+void tst_SharedQueries::writeEndsSharing()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioReply *before = client.query(query());
+    EnginioReply *created = client.create(query());
+    EnginioReply *after = client.query(query());
+    EnginioReply *shared = client.query(query());
+    QTRY_VERIFY(before->isFinished() && created->isFinished() && after->isFinished() && shared->isFinished());
+    QCOMPARE(gets(requests), 2);
+    QCOMPARE(sharedQueries->statistics().deduplicated, quint64(1));
+    QCOMPARE(shared->data(), after->data());
+}
+
+void tst_SharedQueries::firstReplyDeleted()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+
+    QList<EnginioReply*> replies;
+    for (int i = 0; i < 3; ++i)
+        replies << client.query(query());
+    const QString requestId = replies.at(1)->requestId();
+    delete replies.takeFirst();
+
+    // the others are sent after all, still sharing one request
+    foreach (EnginioReply *reply, replies)
+        QTRY_VERIFY(reply->isFinished());
+    foreach (EnginioReply *reply, replies) {
+        QVERIFY(!reply->isError());
+        QCOMPARE(reply->data()["results"].toArray().count(), ObjectCount);
+    }
+    QCOMPARE(replies.first()->requestId(), requestId);
+
+    const EnginioSharedQueries::Statistics statistics = sharedQueries->statistics();
+    QCOMPARE(statistics.sent, quint64(2));
+    QCOMPARE(statistics.deduplicated, quint64(1));
+    QCOMPARE(sharedQueries->inFlightCount(), 0);
+}
+
+void tst_SharedQueries::waitingReplyDeleted()
+{
+    EnginioClient client;
+    prepareClient(&client, _server.url());
+    QSignalSpy finished(&client, SIGNAL(finished(EnginioReply*)));
+
+    EnginioReply *first = client.query(query());
+    EnginioReply *waiting = client.query(query());
+    EnginioReply *last = client.query(query());
+    delete waiting;
+
+    QTRY_VERIFY(first->isFinished() && last->isFinished());
+    QTest::qWait(50);
+    QCOMPARE(finished.count(), 2);
+    QVERIFY(!last->isError());
+    QCOMPARE(last->data(), first->data());
+}
+
+void tst_SharedQueries::models()
+{
+    EnginioClient client;
+    EnginioSharedQueries *sharedQueries = prepareClient(&client, _server.url());
+    QSignalSpy requests(&_server, SIGNAL(requestReceived(QByteArray,QString)));
+
+    EnginioModel first;
+    EnginioModel second;
+    first.setQuery(query());
+    second.setQuery(query());
+    first.setClient(&client);
+    second.setClient(&client);
+
+    QTRY_COMPARE(first.rowCount(), ObjectCount);
+    QTRY_COMPARE(second.rowCount(), ObjectCount);
+    QCOMPARE(gets(requests), 1);
+    QCOMPARE(sharedQueries->statistics().deduplicated, quint64(1));
+}
+
+QTEST_MAIN(tst_SharedQueries)
+#include "tst_sharedqueries.moc"
@@ -0,0 +1,391 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qendian.h>
+
+#include <Enginio/private/enginiowebsocketdecoder_p.h>
+#include <Enginio/private/enginiowebsocketinflater_p.h>
+#include <Enginio/private/enginiowebsocketmask_p.h>
+
+typedef EnginioWebSocketDecoder Decoder;
+
+class tst_WebSocketDecoder: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void payloadLengths_data();
+    void payloadLengths();
+    void byteByByte();
+    void manyFramesAtOnce();
+    void fragmented();
+    void controlFrameBetweenFragments();
+    void handshake();
+    void handshakeSplit();
+    void invalid_data();
+    void invalid();
+    void tooBig();
+    void compressedFrames();
+    void inflate();
+    void inflateWithoutContextTakeover();
+    void inflateInvalid();
+    void mask();
+
+private:
+    static QByteArray frame(int opcode, const QByteArray &payload, bool final = true);
+    static QList<QPair<int, QByteArray> > decodeAll(Decoder &decoder, Decoder::Status *last = 0);
+};
+
+Q_DECLARE_METATYPE(Decoder::Status)
+
+QByteArray tst_WebSocketDecoder::frame(int opcode, const QByteArray &payload, bool final)
+{
+    QByteArray result;
+    result.append(char((final ? 0x80 : 0) | opcode));
+    if (payload.size() < 126) {
+        result.append(char(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        result.append(char(126));
+        uchar length[2];
+        qToBigEndian<quint16>(payload.size(), length);
+        result.append(reinterpret_cast<char*>(length), 2);
+    } else {
+        result.append(char(127));
+        uchar length[8];
+        qToBigEndian<quint64>(payload.size(), length);
+        result.append(reinterpret_cast<char*>(length), 8);
+    }
+    result.append(payload);
+    return result;
+}
+
+QList<QPair<int, QByteArray> > tst_WebSocketDecoder::decodeAll(Decoder &decoder, Decoder::Status *last)
+{
+    QList<QPair<int, QByteArray> > frames;
+    Decoder::Frame frame;
+    Decoder::Status status;
+    while ((status = decoder.next(&frame)) == Decoder::FrameDecoded)
+        frames.append(qMakePair(frame.opcode, QByteArray(frame.payload, frame.size)));
+    if (last)
+        *last = status;
+    return frames;
+}
+
+void tst_WebSocketDecoder::payloadLengths_data()
+{
+    QTest::addColumn<int>("length");
+    QTest::newRow("empty") << 0;
+    QTest::newRow("small") << 125;
+    QTest::newRow("16 bit length") << 126;
+    QTest::newRow("16 bit maximum") << 0xFFFF;
+    QTest::newRow("64 bit length") << 0x10000;
+}
+
+void tst_WebSocketDecoder::payloadLengths()
+{
+    QFETCH(int, length);
+    QByteArray payload(length, 'x');
+    if (length)
+        payload[length - 1] = 'y';
+
+    Decoder decoder;
+    const QByteArray data = frame(Decoder::TextFrameOp, payload);
+    decoder.append(data.constData(), data.size());
+    Decoder::Status status;
+    QList<QPair<int, QByteArray> > frames = decodeAll(decoder, &status);
+    QCOMPARE(status, Decoder::NeedMoreData);
+    QCOMPARE(frames.count(), 1);
+    QCOMPARE(frames[0].first, int(Decoder::TextFrameOp));
+    QCOMPARE(frames[0].second, payload);
+    QCOMPARE(decoder.bufferedBytes(), 0);
+}
+
+void tst_WebSocketDecoder::byteByByte()
+{
+    const QByteArray data = frame(Decoder::TextFrameOp, "{\"a\":1}")
+            + frame(Decoder::TextFrameOp, QByteArray(300, 'b'))
+            + frame(Decoder::PingOp, "ping");
+
+    Decoder decoder;
+    QList<QPair<int, QByteArray> > frames;
+    for (int i = 0; i < data.size(); ++i) {
+        decoder.append(data.constData() + i, 1);
+        frames += decodeAll(decoder);
+    }
+    QCOMPARE(frames.count(), 3);
+    QCOMPARE(frames[0].second, QByteArray("{\"a\":1}"));
+    QCOMPARE(frames[1].second, QByteArray(300, 'b'));
+    QCOMPARE(frames[2].first, int(Decoder::PingOp));
+    QCOMPARE(frames[2].second, QByteArray("ping"));
+}
+
+void tst_WebSocketDecoder::manyFramesAtOnce()
+{
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i)
+        data += frame(Decoder::TextFrameOp, QByteArray::number(i));
+
+    // pieces that do not match frame boundaries
+    Decoder decoder;
+    QList<QPair<int, QByteArray> > frames;
+    for (int i = 0; i < data.size(); i += 777) {
+        decoder.append(data.constData() + i, qMin(777, data.size() - i));
+        frames += decodeAll(decoder);
+    }
+    QCOMPARE(frames.count(), 1000);
+    for (int i = 0; i < frames.count(); ++i)
+        QCOMPARE(frames[i].second, QByteArray::number(i));
+}
+
+void tst_WebSocketDecoder::fragmented()
+{
+    const QByteArray data = frame(Decoder::TextFrameOp, "Hel", false)
+            + frame(Decoder::ContinuationFrameOp, "lo ", false)
+            + frame(Decoder::ContinuationFrameOp, QByteArray(200, 'w'), false)
+            + frame(Decoder::ContinuationFrameOp, "!")
+            + frame(Decoder::TextFrameOp, "next");
+
+    for (int split = 1; split < data.size(); ++split) {
+        Decoder decoder;
+        decoder.append(data.constData(), split);
+        QList<QPair<int, QByteArray> > frames = decodeAll(decoder);
+        decoder.append(data.constData() + split, data.size() - split);
+        frames += decodeAll(decoder);
+
+        QCOMPARE(frames.count(), 2);
+        QCOMPARE(frames[0].first, int(Decoder::TextFrameOp));
+        QCOMPARE(frames[0].second, QByteArray("Hello ") + QByteArray(200, 'w') + '!');
+        QCOMPARE(frames[1].second, QByteArray("next"));
+    }
+}
+
+void tst_WebSocketDecoder::controlFrameBetweenFragments()
+{
+    const QByteArray data = frame(Decoder::BinaryFrameOp, "first ", false)
+            + frame(Decoder::PingOp, "ping")
+            + frame(Decoder::ContinuationFrameOp, "second ", false)
+            + frame(Decoder::PongOp, QByteArray())
+            + frame(Decoder::ContinuationFrameOp, "third");
+
+    Decoder decoder;
+    decoder.append(data.constData(), data.size());
+    QList<QPair<int, QByteArray> > frames = decodeAll(decoder);
+    QCOMPARE(frames.count(), 3);
+    QCOMPARE(frames[0].first, int(Decoder::PingOp));
+    QCOMPARE(frames[0].second, QByteArray("ping"));
+    QCOMPARE(frames[1].first, int(Decoder::PongOp));
+    QCOMPARE(frames[2].first, int(Decoder::BinaryFrameOp));
+    QCOMPARE(frames[2].second, QByteArray("first second third"));
+}
+
+void tst_WebSocketDecoder::handshake()
+{
+    const QByteArray response("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n");
+    const QByteArray data = response + frame(Decoder::TextFrameOp, "after");
+
+    Decoder decoder;
+    decoder.append(data.constData(), data.size());
+    QByteArray handshake;
+    QVERIFY(decoder.takeHandshake(&handshake));
+    QCOMPARE(handshake, response);
+    QList<QPair<int, QByteArray> > frames = decodeAll(decoder);
+    QCOMPARE(frames.count(), 1);
+    QCOMPARE(frames[0].second, QByteArray("after"));
+}
+
+void tst_WebSocketDecoder::handshakeSplit()
+{
+    const QByteArray response("HTTP/1.1 101 Switching Protocols\r\nConnection: upgrade\r\n\r\n");
+    for (int split = 1; split < response.size(); ++split) {
+        Decoder decoder;
+        QByteArray handshake;
+        decoder.append(response.constData(), split);
+        QVERIFY(!decoder.takeHandshake(&handshake));
+        decoder.append(response.constData() + split, response.size() - split);
+        QVERIFY(decoder.takeHandshake(&handshake));
+        QCOMPARE(handshake, response);
+    }
+}
+
+void tst_WebSocketDecoder::invalid_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QByteArray masked = frame(Decoder::TextFrameOp, "abc");
+    masked[1] = masked[1] | 0x80;
+    QTest::newRow("masked") << masked;
+
+    QByteArray reserved = frame(Decoder::TextFrameOp, "abc");
+    reserved[0] = reserved[0] | 0x40;
+    QTest::newRow("reserved bit") << reserved;
+
+    QTest::newRow("lonely continuation") << frame(Decoder::ContinuationFrameOp, "abc");
+    QTest::newRow("fragmented control") << frame(Decoder::PingOp, "abc", false);
+    QTest::newRow("long control") << frame(Decoder::PingOp, QByteArray(126, 'p'));
+    QTest::newRow("message in message") << frame(Decoder::TextFrameOp, "abc", false) + frame(Decoder::TextFrameOp, "def");
+}
+
+void tst_WebSocketDecoder::invalid()
+{
+    QFETCH(QByteArray, data);
+    Decoder decoder;
+    decoder.append(data.constData(), data.size());
+    Decoder::Status status;
+    decodeAll(decoder, &status);
+    QCOMPARE(status, Decoder::ProtocolError);
+}
+
+void tst_WebSocketDecoder::tooBig()
+{
+    // only the header, the payload is never buffered
+    QByteArray header;
+    header.append(char(0x80 | Decoder::BinaryFrameOp));
+    header.append(char(127));
+    uchar length[8];
+    qToBigEndian<quint64>(quint64(Decoder::MaximumMessageSize) + 1, length);
+    header.append(reinterpret_cast<char*>(length), 8);
+
+    Decoder decoder;
+    decoder.append(header.constData(), header.size());
+    Decoder::Frame frame;
+    QCOMPARE(decoder.next(&frame), Decoder::MessageTooBig);
+}
+
+void tst_WebSocketDecoder::compressedFrames()
+{
+    QByteArray compressed = frame(Decoder::TextFrameOp, "abc", false) + frame(Decoder::ContinuationFrameOp, "def");
+    compressed[0] = compressed[0] | 0x40;
+    const QByteArray data = compressed + frame(Decoder::TextFrameOp, "plain");
+
+    Decoder decoder;
+    decoder.setCompressionEnabled(true);
+    decoder.append(data.constData(), data.size());
+    Decoder::Frame frame;
+    QCOMPARE(decoder.next(&frame), Decoder::FrameDecoded);
+    QVERIFY(frame.compressed);
+    QCOMPARE(frame.data(), QByteArray("abcdef"));
+    QCOMPARE(decoder.next(&frame), Decoder::FrameDecoded);
+    QVERIFY(!frame.compressed);
+    QCOMPARE(frame.data(), QByteArray("plain"));
+
+    // RSV1 is not allowed on continuation and control frames
+    QByteArray continuation = tst_WebSocketDecoder::frame(Decoder::TextFrameOp, "abc", false)
+            + tst_WebSocketDecoder::frame(Decoder::ContinuationFrameOp, "def");
+    continuation[5] = continuation[5] | 0x40;
+    decoder.clear();
+    decoder.append(continuation.constData(), continuation.size());
+    QCOMPARE(decoder.next(&frame), Decoder::ProtocolError);
+
+    QByteArray ping = tst_WebSocketDecoder::frame(Decoder::PingOp, "abc");
+    ping[0] = ping[0] | 0x40;
+    decoder.clear();
+    decoder.append(ping.constData(), ping.size());
+    QCOMPARE(decoder.next(&frame), Decoder::ProtocolError);
+}
+
+void tst_WebSocketDecoder::inflate()
+{
+    // http://tools.ietf.org/html/rfc7692#section-7.2.3.2
+    const QByteArray first = QByteArray::fromHex("f248cdc9c90700");
+    const QByteArray second = QByteArray::fromHex("f200110000");
+    // http://tools.ietf.org/html/rfc7692#section-7.2.3.3
+    const QByteArray stored = QByteArray::fromHex("0005 00faff 48656c6c6f 00");
+
+    EnginioWebSocketInflater inflater;
+    QByteArray result;
+    QVERIFY(inflater.inflate(first.constData(), first.size(), &result));
+    QCOMPARE(result, QByteArray("Hello"));
+    // refers back to the first message
+    QVERIFY(inflater.inflate(second.constData(), second.size(), &result));
+    QCOMPARE(result, QByteArray("Hello"));
+    QVERIFY(inflater.inflate(stored.constData(), stored.size(), &result));
+    QCOMPARE(result, QByteArray("Hello"));
+}
+
+void tst_WebSocketDecoder::inflateWithoutContextTakeover()
+{
+    const QByteArray message = QByteArray::fromHex("f248cdc9c90700");
+    EnginioWebSocketInflater inflater;
+    inflater.setContextTakeover(false);
+    QByteArray result;
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(inflater.inflate(message.constData(), message.size(), &result));
+        QCOMPARE(result, QByteArray("Hello"));
+    }
+}
+
+void tst_WebSocketDecoder::inflateInvalid()
+{
+    const QByteArray garbage = QByteArray::fromHex("ffffffff");
+    const QByteArray message = QByteArray::fromHex("f248cdc9c90700");
+    EnginioWebSocketInflater inflater;
+    QByteArray result;
+    QVERIFY(!inflater.inflate(garbage.constData(), garbage.size(), &result));
+    // the stream is usable again afterwards
+    QVERIFY(inflater.inflate(message.constData(), message.size(), &result));
+    QCOMPARE(result, QByteArray("Hello"));
+}
+
+void tst_WebSocketDecoder::mask()
+{
+    const uchar key[] = { 0x37, 0xfa, 0x21, 0x3d };
+    // http://tools.ietf.org/html/rfc6455#section-5.7
+    char hello[] = "Hello";
+    enginioMaskWebSocketData(hello, hello, 5, key);
+    QCOMPARE(QByteArray(hello, 5), QByteArray::fromHex("7f9f4d5158"));
+
+    // every length around the vector widths, with unaligned buffers
+    QByteArray source(300, Qt::Uninitialized);
+    for (int i = 0; i < source.size(); ++i)
+        source[i] = char(i * 7 + 3);
+    for (int offset = 0; offset < 4; ++offset) {
+        for (int size = 0; size <= 260; ++size) {
+            const char *data = source.constData() + offset;
+            QByteArray expected(size, Qt::Uninitialized);
+            for (int i = 0; i < size; ++i)
+                expected[i] = data[i] ^ key[i % 4];
+
+            QByteArray copied(size + 1, Qt::Uninitialized);
+            enginioMaskWebSocketData(copied.data() + 1, data, size, key);
+            QCOMPARE(copied.mid(1), expected);
+
+            QByteArray inPlace(data, size);
+            enginioMaskWebSocketData(inPlace.data(), inPlace.constData(), size, key);
+            QCOMPARE(inPlace, expected);
+        }
+    }
+}
+
+QTEST_MAIN(tst_WebSocketDecoder)
+#include "tst_websocketdecoder.moc"
@@ -0,0 +1,257 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+
+#include "enginiolocalserver.h"
+
+class tst_WindowedPaging: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+
+private slots:
+    void initTestCase();
+    void init();
+    void rowCountIsTotal();
+    void pagesLoadedOnAccess();
+    void windowStaysBounded();
+    void evictedRowsKeepTheirIds();
+    void viewportSpansTouchedRows();
+    void reloadStartsOver();
+
+private:
+    static const int ObjectCount = 1000;
+    static const int PageSize = 50;
+
+    EnginioBaseModelPrivate *prepareModel(EnginioModel *model, EnginioClient *client)
+    {
+        client->setServiceUrl(_server.url());
+        client->setBackendId(QByteArrayLiteral("windowedpaging"));
+        QJsonObject sort;
+        sort["sortBy"] = QStringLiteral("title");
+        sort["direction"] = QStringLiteral("asc");
+        QJsonObject query;
+        query["objectType"] = QStringLiteral("objects.paging");
+        query["sort"] = QJsonArray() << sort;
+        query["pageSize"] = PageSize;
+        model->setQuery(query);
+        model->setClient(client);
+        return static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(model));
+    }
+    static QVariant title(const EnginioModel &model, int row)
+    {
+        const QJsonObject object = model.data(model.index(row), Enginio::JsonObjectRole).toJsonValue().toObject();
+        return object.isEmpty() ? QVariant() : object["title"].toVariant();
+    }
+    static void nextEventLoopPass()
+    {
+        // the rows touched so far are handled together
+        QCoreApplication::processEvents();
+    }
+    static QString expectedTitle(int row)
+    {
+        return QString::fromLatin1("object %1").arg(row, 4, 10, QLatin1Char('0'));
+    }
+};
+
+void tst_WindowedPaging::initTestCase()
+{
+    QVERIFY(_server.listen());
+}
+
+void tst_WindowedPaging::init()
+{
+    _server.clear();
+    for (int i = 0; i < ObjectCount; ++i) {
+        QJsonObject object;
+        object["title"] = expectedTitle(i);
+        _server.insertObject(QStringLiteral("objects.paging"), object);
+    }
+    _server.resetStatistics();
+}
+
+void tst_WindowedPaging::rowCountIsTotal()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    QCOMPARE(_server.statistics().requests, quint64(1));
+    QCOMPARE(d->loadedPages(), QSet<int>() << 0);
+
+    // the placeholders are added in one go
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted[0][1].toInt(), PageSize);
+    QCOMPARE(inserted[0][2].toInt(), ObjectCount - 1);
+}
+
+void tst_WindowedPaging::pagesLoadedOnAccess()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    QCOMPARE(title(model, 0).toString(), expectedTitle(0));
+    QTRY_COMPARE(d->loadedPages(), QSet<int>() << 0 << 1);
+
+    const int row = 10 * PageSize + 7;
+    QSignalSpy dataChanged(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    QVERIFY(!title(model, row).isValid());
+    QVERIFY(model.data(model.index(row), Enginio::SyncedRole).toBool());
+    QTRY_COMPARE(title(model, row).toString(), expectedTitle(row));
+
+    // the neighbours are there already when the view scrolls on
+    QTRY_COMPARE(d->loadedPages().count(), 5);
+    QVERIFY(d->loadedPages().contains(9));
+    QVERIFY(d->loadedPages().contains(11));
+    QCOMPARE(title(model, 11 * PageSize).toString(), expectedTitle(11 * PageSize));
+    QCOMPARE(title(model, 9 * PageSize).toString(), expectedTitle(9 * PageSize));
+    QVERIFY(!title(model, 12 * PageSize + 1).isValid());
+    QCOMPARE(dataChanged.count(), 3);
+
+    const QString id = model.data(model.index(row), Enginio::IdRole).toString();
+    QVERIFY(!id.isEmpty());
+    QCOMPARE(d->existingRow(id), row);
+}
+
+void tst_WindowedPaging::windowStaysBounded()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    QSignalSpy maximalLoadedPagesChanged(&model, SIGNAL(maximalLoadedPagesChanged(int)));
+    model.setMaximalLoadedPages(4);
+    QCOMPARE(model.maximalLoadedPages(), 4);
+    QCOMPARE(maximalLoadedPagesChanged.count(), 1);
+    model.setMaximalLoadedPages(1);
+    QCOMPARE(model.maximalLoadedPages(), 3);
+    model.setMaximalLoadedPages(4);
+    QCOMPARE(maximalLoadedPagesChanged.count(), 3);
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    const QString firstId = model.data(model.index(0), Enginio::IdRole).toString();
+    QCOMPARE(d->existingRow(firstId), 0);
+
+    const int pages = ObjectCount / PageSize;
+    for (int page = 0; page < pages; ++page) {
+        const int row = page * PageSize;
+        QTRY_COMPARE(title(model, row).toString(), expectedTitle(row));
+        QVERIFY(d->loadedPages().count() <= 4);
+    }
+    QVERIFY(!d->loadedPages().contains(0));
+    QCOMPARE(d->existingRow(firstId), 0);
+    QCOMPARE(model.rowCount(), ObjectCount);
+
+    // scrolling back loads the page again
+    nextEventLoopPass();
+    QVERIFY(!title(model, 0).isValid());
+    QTRY_COMPARE(title(model, 0).toString(), expectedTitle(0));
+    QCOMPARE(d->existingRow(firstId), 0);
+    QVERIFY(d->loadedPages().count() <= 4);
+}
+
+void tst_WindowedPaging::evictedRowsKeepTheirIds()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    model.setMaximalLoadedPages(3);
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    const QJsonObject first = model.data(model.index(0), Enginio::JsonObjectRole).toJsonValue().toObject();
+    const QJsonObject second = model.data(model.index(1), Enginio::JsonObjectRole).toJsonValue().toObject();
+    nextEventLoopPass();
+
+    const int row = 10 * PageSize;
+    QTRY_COMPARE(title(model, row).toString(), expectedTitle(row));
+    QTRY_VERIFY(!d->loadedPages().contains(0));
+    QCOMPARE(d->existingRow(first["id"].toString()), 0);
+
+    // an update is left to the next load of the page
+    QJsonObject updated = second;
+    updated["title"] = QStringLiteral("updated");
+    d->receivedUpdateNotification(updated);
+    QVERIFY(!title(model, 1).isValid());
+
+    // a removal still finds the row
+    d->receivedRemoveNotification(first);
+    QCOMPARE(model.rowCount(), ObjectCount - 1);
+    QCOMPARE(d->existingRow(second["id"].toString()), 0);
+}
+
+void tst_WindowedPaging::viewportSpansTouchedRows()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    nextEventLoopPass();
+
+    // a view showing rows of two pages in one pass
+    _server.resetStatistics();
+    for (int row = 5 * PageSize - 3; row < 5 * PageSize + 3; ++row)
+        QVERIFY(!title(model, row).isValid());
+    QCOMPARE(_server.statistics().requests, quint64(0));
+    QTRY_COMPARE(d->loadedPages(), QSet<int>() << 0 << 3 << 4 << 5 << 6);
+    QCOMPARE(_server.statistics().requests, quint64(4));
+}
+
+void tst_WindowedPaging::reloadStartsOver()
+{
+    EnginioClient client;
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = prepareModel(&model, &client);
+    QTRY_COMPARE(model.rowCount(), ObjectCount);
+    const int row = 5 * PageSize;
+    QTRY_COMPARE(title(model, row).toString(), expectedTitle(row));
+
+    QJsonObject object;
+    object["title"] = QStringLiteral("object 9999");
+    _server.insertObject(QStringLiteral("objects.paging"), object);
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    model.reload();
+    QTRY_COMPARE(reset.count(), 1);
+    QTRY_COMPARE(model.rowCount(), ObjectCount + 1);
+    QCOMPARE(d->loadedPages(), QSet<int>() << 0);
+    QVERIFY(!title(model, row).isValid());
+    QTRY_COMPARE(title(model, ObjectCount).toString(), QStringLiteral("object 9999"));
+}
+
+QTEST_MAIN(tst_WindowedPaging)
+#include "tst_windowedpaging.moc"
@@ -0,0 +1,12 @@
+QT       += testlib enginio enginio-private core-private
+QT       -= gui
+
+TARGET = tst_bench_enginioclient
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include(../../auto/common/localserver.pri)
+
+SOURCES += tst_bench_enginioclient.cpp
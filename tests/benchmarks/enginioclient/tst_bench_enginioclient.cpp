@@ -0,0 +1,795 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qtemporarydir.h>
+#include <QtCore/qtemporaryfile.h>
+
+#include <Enginio/enginiobatch.h>
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/private/enginiobackendconnection_p.h>
+#include <Enginio/private/enginiobasemodel_p.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginioresponsecache_p.h>
+
+#include "enginiolocalserver.h"
+
+#include <algorithm>
+
+namespace {
+
+const QString BenchmarkObjectType = QStringLiteral("objects.BenchmarkObject");
+
+/*!
+  \internal
+  Collects the latency of every reply issued through issue() and prints
+  requests/s, p50 and p99 once the measured run is finished.
+*/
+class LatencyRecorder
+{
+    QElapsedTimer _total;
+    QHash<const EnginioReply*, qint64> _started;
+    QVector<qint64> _latencies; // nanoseconds
+
+public:
+    void start()
+    {
+        _started.clear();
+        _latencies.clear();
+        _total.start();
+    }
+
+    void issue(const EnginioReply *reply)
+    {
+        _started.insert(reply, _total.nsecsElapsed());
+    }
+
+    bool finish(const EnginioReply *reply)
+    {
+        if (!_started.contains(reply))
+            return false;
+        _latencies.append(_total.nsecsElapsed() - _started.take(reply));
+        return true;
+    }
+
+    int finishedCount() const { return _latencies.count(); }
+
+    void report(const char *name)
+    {
+        const qint64 total = _total.nsecsElapsed();
+        std::sort(_latencies.begin(), _latencies.end());
+        const qreal p50 = percentile(0.50) / 1000000.;
+        const qreal p99 = percentile(0.99) / 1000000.;
+        const qreal rate = _latencies.count() / (total / 1000000000.);
+        qDebug("%s: %d requests, %.1f requests/s, p50 %.3f ms, p99 %.3f ms",
+               name, _latencies.count(), rate, p50, p99);
+        QTest::setBenchmarkResult(p50, QTest::WalltimeMilliseconds);
+    }
+
+private:
+    qint64 percentile(qreal p) const
+    {
+        if (_latencies.isEmpty())
+            return 0;
+        const int index = qMin(_latencies.count() - 1, int(p * _latencies.count()));
+        return _latencies.at(index);
+    }
+};
+
+struct ModelResetFunctor
+{
+    QElapsedTimer *timer;
+    qint64 *timestamp;
+
+    void operator ()() const
+    {
+        *timestamp = timer->nsecsElapsed();
+    }
+};
+
+struct ModelUpdateFunctor
+{
+    QElapsedTimer *timer;
+    QVector<qint64> *timestamps;
+
+    void operator ()() const
+    {
+        timestamps->append(timer->nsecsElapsed());
+    }
+};
+
+} // namespace
+
+class tst_Bench_EnginioClient: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioLocalServer _server;
+    EnginioClient _client;
+    LatencyRecorder _recorder;
+    QList<QString> _ids;
+    int _issued;
+    int _failed;
+
+    typedef EnginioReply *(tst_Bench_EnginioClient::*Operation)(int i);
+
+public slots:
+    void finished(EnginioReply *reply);
+
+private slots:
+    void initTestCase();
+    void init();
+    void query_data();
+    void query();
+    void create_data();
+    void create();
+    void createBatch_data();
+    void createBatch();
+    void update_data();
+    void update();
+    void remove_data();
+    void remove();
+    void upload_data();
+    void upload();
+    void modelApply_data();
+    void modelApply();
+    void modelSnapshot_data();
+    void modelSnapshot();
+    void modelRefresh_data();
+    void modelRefresh();
+    void modelData_data();
+    void modelData();
+    void modelNotifications_data();
+    void modelNotifications();
+    void notificationStream_data();
+    void notificationStream();
+    void requestContexts_data();
+    void requestContexts();
+    void attachedDataRemoval_data();
+    void attachedDataRemoval();
+
+private:
+    void populate(int count);
+    void run(Operation operation, int count, int window);
+    void addWindowColumns();
+
+    EnginioReply *queryOperation(int);
+    EnginioReply *createOperation(int i);
+    EnginioReply *updateOperation(int i);
+    EnginioReply *removeOperation(int i);
+    EnginioReply *uploadOperation(int i);
+
+    int _queryLimit;
+    QString _uploadPath;
+};
+
+void tst_Bench_EnginioClient::initTestCase()
+{
+    QVERIFY(_server.listen());
+    _client.setServiceUrl(_server.url());
+    _client.setBackendId(QByteArrayLiteral("benchmark"));
+    _client.setResponseCacheSize(EnginioResponseCache::DefaultMaximumSize);
+    QObject::connect(&_client, &EnginioClient::finished, this, &tst_Bench_EnginioClient::finished);
+}
+
+void tst_Bench_EnginioClient::init()
+{
+    _server.clear();
+    _ids.clear();
+    _issued = 0;
+    _failed = 0;
+}
+
+void tst_Bench_EnginioClient::finished(EnginioReply *reply)
+{
+    if (!_recorder.finish(reply))
+        return;
+    if (reply->isError())
+        ++_failed;
+    reply->deleteLater();
+}
+
+void tst_Bench_EnginioClient::populate(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        QJsonObject object;
+        object[QStringLiteral("title")] = QStringLiteral("Object ") + QString::number(i);
+        object[QStringLiteral("index")] = i;
+        object[QStringLiteral("completed")] = bool(i % 2);
+        _ids.append(_server.insertObject(BenchmarkObjectType, object)[QStringLiteral("id")].toString());
+    }
+}
+
+void tst_Bench_EnginioClient::run(Operation operation, int count, int window)
+{
+    // Keeps up to "window" requests in flight, QNetworkAccessManager itself opens
+    // at most six connections per host.
+    _recorder.start();
+    _issued = 0;
+    while (_recorder.finishedCount() < count) {
+        while (_issued < count && _issued - _recorder.finishedCount() < window) {
+            EnginioReply *reply = (this->*operation)(_issued++);
+            _recorder.issue(reply);
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    QCOMPARE(_failed, 0);
+}
+
+void tst_Bench_EnginioClient::addWindowColumns()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("window");
+}
+
+EnginioReply *tst_Bench_EnginioClient::queryOperation(int)
+{
+    QJsonObject query;
+    query[QStringLiteral("objectType")] = BenchmarkObjectType;
+    query[QStringLiteral("limit")] = _queryLimit;
+    return _client.query(query);
+}
+
+EnginioReply *tst_Bench_EnginioClient::createOperation(int i)
+{
+    QJsonObject object;
+    object[QStringLiteral("objectType")] = BenchmarkObjectType;
+    object[QStringLiteral("title")] = QStringLiteral("Created ") + QString::number(i);
+    object[QStringLiteral("index")] = i;
+    return _client.create(object);
+}
+
+EnginioReply *tst_Bench_EnginioClient::updateOperation(int i)
+{
+    QJsonObject object;
+    object[QStringLiteral("objectType")] = BenchmarkObjectType;
+    object[QStringLiteral("id")] = _ids.at(i % _ids.count());
+    object[QStringLiteral("completed")] = bool(i % 2);
+    return _client.update(object);
+}
+
+EnginioReply *tst_Bench_EnginioClient::removeOperation(int i)
+{
+    QJsonObject object;
+    object[QStringLiteral("objectType")] = BenchmarkObjectType;
+    object[QStringLiteral("id")] = _ids.at(i);
+    return _client.remove(object);
+}
+
+EnginioReply *tst_Bench_EnginioClient::uploadOperation(int i)
+{
+    QJsonObject target;
+    target[QStringLiteral("id")] = _ids.at(i % _ids.count());
+    target[QStringLiteral("objectType")] = BenchmarkObjectType;
+    target[QStringLiteral("propertyName")] = QStringLiteral("attachment");
+
+    QJsonObject file;
+    file[QStringLiteral("fileName")] = QStringLiteral("benchmark.bin");
+
+    QJsonObject upload;
+    upload[QStringLiteral("targetFileProperty")] = target;
+    upload[QStringLiteral("file")] = file;
+    return _client.uploadFile(upload, QUrl::fromLocalFile(_uploadPath));
+}
+
+void tst_Bench_EnginioClient::query_data()
+{
+    addWindowColumns();
+    QTest::addColumn<int>("rows");
+
+    QTest::newRow("10 rows, sequential") << 200 << 1 << 10;
+    QTest::newRow("10 rows, window 6") << 200 << 6 << 10;
+    QTest::newRow("1000 rows, sequential") << 50 << 1 << 1000;
+    QTest::newRow("1000 rows, window 6") << 50 << 6 << 1000;
+    QTest::newRow("10 rows, 10000 in flight") << 10000 << 10000 << 10;
+}
+
+void tst_Bench_EnginioClient::query()
+{
+    QFETCH(int, count);
+    QFETCH(int, window);
+    QFETCH(int, rows);
+
+    populate(rows);
+    _queryLimit = rows;
+    EnginioResponseCache *cache = EnginioClientConnectionPrivate::get(&_client)->_responseCache.data();
+    if (cache)
+        cache->clear();
+    const EnginioResponseCache::Statistics before = cache ? cache->statistics() : EnginioResponseCache::Statistics();
+
+    run(&tst_Bench_EnginioClient::queryOperation, count, window);
+    _recorder.report(QTest::currentDataTag());
+    if (cache) {
+        const EnginioResponseCache::Statistics after = cache->statistics();
+        qDebug("response cache: %llu hits, %llu misses, %llu bytes saved",
+               after.hits - before.hits, after.misses - before.misses, after.bytesSaved - before.bytesSaved);
+    }
+}
+
+void tst_Bench_EnginioClient::create_data()
+{
+    addWindowColumns();
+    QTest::newRow("sequential") << 500 << 1;
+    QTest::newRow("window 6") << 500 << 6;
+}
+
+void tst_Bench_EnginioClient::create()
+{
+    QFETCH(int, count);
+    QFETCH(int, window);
+
+    run(&tst_Bench_EnginioClient::createOperation, count, window);
+    _recorder.report(QTest::currentDataTag());
+    QCOMPARE(_server.objectCount(BenchmarkObjectType), count);
+}
+
+void tst_Bench_EnginioClient::createBatch_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("500") << 500;
+    QTest::newRow("5000") << 5000;
+}
+
+void tst_Bench_EnginioClient::createBatch()
+{
+    QFETCH(int, count);
+
+    EnginioBatch batch(&_client);
+    for (int i = 0; i < count; ++i) {
+        QJsonObject object;
+        object[QStringLiteral("objectType")] = BenchmarkObjectType;
+        object[QStringLiteral("title")] = QStringLiteral("Created ") + QString::number(i);
+        object[QStringLiteral("index")] = i;
+        batch.create(object);
+    }
+
+    _recorder.start();
+    EnginioReply *reply = batch.send();
+    _recorder.issue(reply);
+    QTRY_COMPARE_WITH_TIMEOUT(_recorder.finishedCount(), 1, 60000);
+    QCOMPARE(_failed, 0);
+    _recorder.report(QTest::currentDataTag());
+    QCOMPARE(_server.objectCount(BenchmarkObjectType), count);
+}
+
+void tst_Bench_EnginioClient::update_data()
+{
+    create_data();
+}
+
+void tst_Bench_EnginioClient::update()
+{
+    QFETCH(int, count);
+    QFETCH(int, window);
+
+    populate(100);
+    run(&tst_Bench_EnginioClient::updateOperation, count, window);
+    _recorder.report(QTest::currentDataTag());
+}
+
+void tst_Bench_EnginioClient::remove_data()
+{
+    create_data();
+}
+
+void tst_Bench_EnginioClient::remove()
+{
+    QFETCH(int, count);
+    QFETCH(int, window);
+
+    populate(count);
+    run(&tst_Bench_EnginioClient::removeOperation, count, window);
+    _recorder.report(QTest::currentDataTag());
+    QCOMPARE(_server.objectCount(BenchmarkObjectType), 0);
+}
+
+void tst_Bench_EnginioClient::upload_data()
+{
+    addWindowColumns();
+    QTest::addColumn<int>("size");
+
+    // Files bigger than the chunk size go through the chunked upload path.
+    QTest::newRow("64 KiB multipart") << 50 << 1 << 64 * 1024;
+    QTest::newRow("4 MiB chunked") << 10 << 1 << 4 * 1024 * 1024;
+    QTest::newRow("4 MiB chunked, window 6") << 10 << 6 << 4 * 1024 * 1024;
+}
+
+void tst_Bench_EnginioClient::upload()
+{
+    QFETCH(int, count);
+    QFETCH(int, window);
+    QFETCH(int, size);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i)
+        data[i] = char(i * 31);
+    QCOMPARE(file.write(data), qint64(size));
+    file.close();
+    _uploadPath = file.fileName();
+
+    populate(count);
+    run(&tst_Bench_EnginioClient::uploadOperation, count, window);
+    _recorder.report(QTest::currentDataTag());
+}
+
+void tst_Bench_EnginioClient::modelApply_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::newRow("100") << 100;
+    QTest::newRow("10000") << 10000;
+    QTest::newRow("100000") << 100000;
+}
+
+void tst_Bench_EnginioClient::modelApply()
+{
+    QFETCH(int, rows);
+    populate(rows);
+
+    QJsonObject query;
+    query[QStringLiteral("objectType")] = BenchmarkObjectType;
+
+    EnginioModel model;
+    QElapsedTimer timer;
+    // the rows arrive with a reset followed by insertions while the result is streamed
+    QVector<qint64> updates;
+    ModelUpdateFunctor update = { &timer, &updates };
+    QObject::connect(&model, &EnginioModel::modelReset, update);
+    QObject::connect(&model, &EnginioModel::rowsInserted, update);
+
+    timer.start();
+    model.setQuery(query);
+    model.setClient(&_client);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), rows, 60000);
+    const qint64 total = timer.nsecsElapsed();
+    QVERIFY(!updates.isEmpty());
+
+    // the longest time the model had to wait for new rows
+    qint64 longestGap = updates.first();
+    for (int i = 1; i < updates.count(); ++i)
+        longestGap = qMax(longestGap, updates.at(i) - updates.at(i - 1));
+
+    const qreal firstRow = updates.first() / 1000000.;
+    qDebug("%d rows: first rows %.3f ms, all rows %.3f ms, %d model updates, longest gap %.3f ms",
+           rows, firstRow, total / 1000000., updates.count(), longestGap / 1000000.);
+    QTest::setBenchmarkResult(firstRow, QTest::WalltimeMilliseconds);
+}
+
+void tst_Bench_EnginioClient::modelSnapshot_data()
+{
+    modelApply_data();
+}
+
+void tst_Bench_EnginioClient::modelSnapshot()
+{
+    QFETCH(int, rows);
+    populate(rows);
+
+    QTemporaryDir snapshotDirectory;
+    QVERIFY(snapshotDirectory.isValid());
+    QJsonObject query;
+    query[QStringLiteral("objectType")] = BenchmarkObjectType;
+
+    {
+        // the first run stores the snapshot
+        EnginioModel model;
+        model.setSnapshotDirectory(snapshotDirectory.path());
+        model.setQuery(query);
+        model.setClient(&_client);
+        QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), rows, 60000);
+    }
+
+    EnginioModel model;
+    QElapsedTimer timer;
+    qint64 liveReset = -1;
+    ModelResetFunctor reset = { &timer, &liveReset };
+
+    timer.start();
+    model.setSnapshotDirectory(snapshotDirectory.path());
+    model.setQuery(query);
+    model.setClient(&_client);
+    const qint64 firstRow = timer.nsecsElapsed();
+    QCOMPARE(model.rowCount(), rows);
+
+    QObject::connect(&model, &EnginioModel::modelReset, reset);
+    QTRY_VERIFY_WITH_TIMEOUT(liveReset != -1, 60000);
+    QCOMPARE(model.rowCount(), rows);
+
+    qDebug("%d rows: first row from snapshot %.3f ms, live data %.3f ms",
+           rows, firstRow / 1000000., liveReset / 1000000.);
+    QTest::setBenchmarkResult(firstRow / 1000000., QTest::WalltimeMilliseconds);
+}
+
+void tst_Bench_EnginioClient::modelRefresh_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<bool>("deltaSync");
+    QTest::newRow("10000 full") << 10000 << false;
+    QTest::newRow("10000 delta") << 10000 << true;
+    QTest::newRow("100000 full") << 100000 << false;
+    QTest::newRow("100000 delta") << 100000 << true;
+}
+
+void tst_Bench_EnginioClient::modelRefresh()
+{
+    // Executes the query of a loaded model again, as after a login, with one
+    // object changed and one created in the meantime.
+    QFETCH(int, rows);
+    QFETCH(bool, deltaSync);
+    populate(rows);
+
+    EnginioModel model;
+    model.setDeltaSync(deltaSync);
+    QJsonObject query;
+    query[QStringLiteral("objectType")] = BenchmarkObjectType;
+    model.setQuery(query);
+    model.setClient(&_client);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), rows, 60000);
+
+    QTest::qWait(5); // a later updatedAt
+    QJsonObject changed = model.data(model.index(rows / 2), Enginio::JsonObjectRole).toJsonValue().toObject();
+    changed[QStringLiteral("title")] = QStringLiteral("changed");
+    EnginioReply *reply = _client.update(changed);
+    QTRY_VERIFY(reply->isFinished());
+    populate(1);
+
+    QElapsedTimer timer;
+    qint64 refreshed = -1;
+    ModelResetFunctor done = { &timer, &refreshed };
+    QObject::connect(&model, &EnginioModel::modelReset, done);
+    QObject::connect(&model, &EnginioModel::rowsInserted, done);
+
+    _server.resetStatistics();
+    timer.start();
+    static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model))->execute();
+    QTRY_VERIFY_WITH_TIMEOUT(refreshed != -1, 60000);
+    QCOMPARE(model.rowCount(), rows + 1);
+
+    qDebug("%d rows, %s: refreshed in %.3f ms, %llu bytes received",
+           rows, deltaSync ? "delta" : "full", refreshed / 1000000., _server.statistics().bytesSent);
+    QTest::setBenchmarkResult(refreshed / 1000000., QTest::WalltimeMilliseconds);
+}
+
+void tst_Bench_EnginioClient::modelData_data()
+{
+    QTest::addColumn<bool>("columnStorage");
+    QTest::newRow("json rows") << false;
+    QTest::newRow("column storage") << true;
+}
+
+void tst_Bench_EnginioClient::modelData()
+{
+    // What a view does while scrolling: every role of every row.
+    QFETCH(bool, columnStorage);
+    const int rows = 1000;
+    populate(rows);
+
+    QJsonObject query;
+    query[QStringLiteral("objectType")] = BenchmarkObjectType;
+    EnginioModel model;
+    model.disableNotifications();
+    model.setColumnStorage(columnStorage);
+    model.setQuery(query);
+    model.setClient(&_client);
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), rows, 60000);
+
+    QList<int> roles = model.roleNames().keys();
+    roles.removeAll(Enginio::JsonObjectRole);
+    QBENCHMARK {
+        for (int row = 0; row < rows; ++row) {
+            const QModelIndex index = model.index(row);
+            foreach (int role, roles)
+                model.data(index, role);
+        }
+    }
+}
+
+void tst_Bench_EnginioClient::modelNotifications_data()
+{
+    QTest::addColumn<int>("interval");
+    QTest::newRow("one by one") << -1;
+    QTest::newRow("coalesced") << 0;
+}
+
+void tst_Bench_EnginioClient::modelNotifications()
+{
+    // A batch job updating and then removing every other object of 10000 rows.
+    QFETCH(int, interval);
+    const int rows = 10000;
+
+    QJsonArray data;
+    QVector<QJsonObject> notifications;
+    for (int i = 0; i < rows; ++i) {
+        QJsonObject object;
+        object[EnginioString::id] = QString::number(i);
+        object[QStringLiteral("title")] = QStringLiteral("Object ") + QString::number(i);
+        data.append(object);
+        object[QStringLiteral("title")] = QStringLiteral("Changed");
+        QJsonObject notification;
+        notification[EnginioString::event] = EnginioString::update;
+        notification[EnginioString::data] = object;
+        notifications.append(notification);
+    }
+    for (int i = 0; i < rows; i += 2) {
+        QJsonObject notification;
+        notification[EnginioString::event] = EnginioString::_delete;
+        notification[EnginioString::data] = data.at(i);
+        notifications.append(notification);
+    }
+
+    EnginioModel model;
+    EnginioBaseModelPrivate *d = static_cast<EnginioBaseModelPrivate*>(QObjectPrivate::get(&model));
+    model.setNotificationInterval(interval);
+    QSignalSpy dataChanged(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QSignalSpy rowsRemoved(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+
+    QBENCHMARK {
+        d->resetData(data);
+        dataChanged.clear();
+        rowsRemoved.clear();
+        foreach (const QJsonObject &notification, notifications)
+            d->queueNotification(notification);
+        d->applyPendingNotifications();
+    }
+    QCOMPARE(model.rowCount(), rows / 2);
+    qDebug("%d dataChanged and %d rowsRemoved signals", dataChanged.count(), rowsRemoved.count());
+}
+
+void tst_Bench_EnginioClient::notificationStream_data()
+{
+    QTest::addColumn<bool>("compressed");
+    QTest::newRow("plain") << false;
+    QTest::newRow("permessage-deflate") << true;
+}
+
+void tst_Bench_EnginioClient::notificationStream()
+{
+    // Server and client live in this process, so the time includes
+    // compressing as well as inflating every notification.
+    QFETCH(bool, compressed);
+    const int notifications = 5000;
+
+    EnginioBackendConnection connection;
+    connection.setCompressionEnabled(compressed);
+    QSignalSpy received(&connection, SIGNAL(dataReceived(QJsonObject)));
+    connection.connectToBackend(&_client);
+    QTRY_VERIFY_WITH_TIMEOUT(connection.isConnected(), 60000);
+    QCOMPARE(connection.isCompressed(), compressed);
+
+    QJsonObject object;
+    object[QStringLiteral("title")] = QStringLiteral("Notification");
+    object[QStringLiteral("completed")] = false;
+
+    QBENCHMARK {
+        received.clear();
+        _server.resetStatistics();
+        for (int i = 0; i < notifications; ++i) {
+            object[QStringLiteral("index")] = i;
+            _server.insertObject(BenchmarkObjectType, object);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(received.count(), notifications, 60000);
+    }
+
+    const EnginioTests::EnginioLocalServer::Statistics statistics = _server.statistics();
+    qDebug("%llu bytes of notifications sent in %llu bytes (%.1f%%)",
+           statistics.notificationBytes, statistics.notificationFrameBytes,
+           100.0 * statistics.notificationFrameBytes / statistics.notificationBytes);
+    connection.close();
+}
+
+void tst_Bench_EnginioClient::requestContexts_data()
+{
+    QTest::addColumn<int>("inFlight");
+    QTest::newRow("100") << 100;
+    QTest::newRow("10000") << 10000;
+}
+
+void tst_Bench_EnginioClient::requestContexts()
+{
+    // Only the bookkeeping done for every request: registration, a few upload
+    // progress events and a finished signal while "inFlight" requests are pending.
+    QFETCH(int, inFlight);
+    EnginioClientConnectionPrivate *client = EnginioClientConnectionPrivate::get(&_client);
+    EnginioReply *ereply = _client.query(QJsonObject());
+
+    // the replies are used as keys only and never dereferenced
+    QScopedArrayPointer<char> storage(new char[inFlight]);
+    QVector<QNetworkReply*> replies(inFlight);
+    for (int i = 0; i < inFlight; ++i)
+        replies[i] = reinterpret_cast<QNetworkReply*>(storage.data() + i);
+
+    QBENCHMARK {
+        foreach (QNetworkReply *nreply, replies)
+            client->requestContext(nreply)->reply = ereply;
+        for (int event = 0; event < 4; ++event) {
+            foreach (QNetworkReply *nreply, replies)
+                QVERIFY(client->findRequestContext(nreply)->reply == ereply);
+        }
+        foreach (QNetworkReply *nreply, replies)
+            client->releaseRequestContext(nreply);
+    }
+    QTRY_VERIFY(ereply->isFinished());
+}
+
+void tst_Bench_EnginioClient::attachedDataRemoval_data()
+{
+    QTest::addColumn<int>("percent");
+    QTest::addColumn<bool>("bulk");
+    const int percents[] = { 10, 50, 100 };
+    for (uint i = 0; i < sizeof(percents) / sizeof(*percents); ++i) {
+        const QByteArray name = QByteArray::number(percents[i]) + "% of 100k rows";
+        QTest::newRow(name + ", one by one") << percents[i] << false;
+        QTest::newRow(name + ", bulk") << percents[i] << true;
+    }
+}
+
+void tst_Bench_EnginioClient::attachedDataRemoval()
+{
+    // The row bookkeeping of EnginioModel while delete notifications arrive,
+    // either one row at a time at random positions or as runs of 100 rows.
+    QFETCH(int, percent);
+    QFETCH(bool, bulk);
+    const int rowCount = 100000;
+    const int removed = rowCount / 100 * percent;
+
+    QJsonArray rows;
+    for (int i = 0; i < rowCount; ++i) {
+        QJsonObject object;
+        object[EnginioString::id] = QString::number(i);
+        rows.append(object);
+    }
+    AttachedDataContainer container;
+    container.initFromArray(rows);
+
+    qsrand(percent);
+    QBENCHMARK_ONCE {
+        if (bulk) {
+            for (int left = removed; left > 0; left -= 100) {
+                const int count = qMin(100, left);
+                container.removeRows(qrand() % (container.rowCount() - count + 1), count);
+            }
+        } else {
+            for (int i = 0; i < removed; ++i)
+                container.removeRow(qrand() % container.rowCount());
+        }
+    }
+    QCOMPARE(container.rowCount(), rowCount - removed);
+}
+
+QTEST_MAIN(tst_Bench_EnginioClient)
+#include "tst_bench_enginioclient.moc"
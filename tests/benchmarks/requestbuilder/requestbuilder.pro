@@ -0,0 +1,10 @@
+QT       += testlib enginio enginio-private core-private network
+QT       -= gui
+
+TARGET = tst_bench_requestbuilder
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += tst_bench_requestbuilder.cpp
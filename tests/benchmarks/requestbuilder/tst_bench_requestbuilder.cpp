@@ -0,0 +1,197 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qatomic.h>
+
+#include <Enginio/enginio.h>
+#include <Enginio/enginioclient.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginiorequestbuilder_p.h>
+
+#include <stdlib.h>
+
+#if defined(__GLIBC__)
+// Counts every heap allocation made by the process while counting is enabled,
+// by interposing the glibc allocator entry points.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static QBasicAtomicInt gCountAllocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+static QBasicAtomicInt gAllocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+static inline void countAllocation()
+{
+    if (gCountAllocations.load())
+        gAllocations.ref();
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+# define ALLOCATION_COUNTING_AVAILABLE
+#endif
+
+namespace {
+
+/*!
+  \internal
+  Returns the number of heap allocations made while calling \a f \a iterations times.
+*/
+template<class F>
+int allocationsPerCall(F f, int iterations = 1000)
+{
+#ifdef ALLOCATION_COUNTING_AVAILABLE
+    f(); // warm up the per thread caches
+    gAllocations.store(0);
+    gCountAllocations.store(1);
+    for (int i = 0; i < iterations; ++i)
+        f();
+    gCountAllocations.store(0);
+    return (gAllocations.load() + iterations / 2) / iterations;
+#else
+    Q_UNUSED(f);
+    Q_UNUSED(iterations);
+    return -1;
+#endif
+}
+
+struct RequestId
+{
+    void operator ()() const { EnginioRequestBuilder::createRequestId(); }
+};
+
+struct ObjectTypePath
+{
+    void operator ()() const { EnginioRequestBuilder::objectTypePath(QStringLiteral("objects.BenchmarkObject")); }
+};
+
+struct PrepareRequest
+{
+    EnginioClientConnectionPrivate *client;
+    QUrl url;
+    void operator ()() const { client->prepareRequest(url); }
+};
+
+} // namespace
+
+class tst_Bench_RequestBuilder: public QObject
+{
+    Q_OBJECT
+
+    EnginioClient _client;
+
+private slots:
+    void requestId();
+    void objectTypePath();
+    void operationPath();
+    void prepareRequest();
+    void allocations();
+};
+
+void tst_Bench_RequestBuilder::requestId()
+{
+    QByteArray id = EnginioRequestBuilder::createRequestId();
+    QCOMPARE(id.size(), int(EnginioRequestBuilder::RequestIdSize));
+    QVERIFY(id != EnginioRequestBuilder::createRequestId());
+
+    QBENCHMARK {
+        EnginioRequestBuilder::createRequestId();
+    }
+}
+
+void tst_Bench_RequestBuilder::objectTypePath()
+{
+    const QString objectType = QStringLiteral("objects.BenchmarkObject");
+    QCOMPARE(EnginioRequestBuilder::objectTypePath(objectType), QStringLiteral("/v1/objects/BenchmarkObject"));
+
+    QBENCHMARK {
+        EnginioRequestBuilder::objectTypePath(objectType);
+    }
+}
+
+void tst_Bench_RequestBuilder::operationPath()
+{
+    QCOMPARE(EnginioRequestBuilder::operationPath(Enginio::FileOperation), QStringLiteral("/v1/files"));
+    QCOMPARE(EnginioRequestBuilder::operationPath(Enginio::UsergroupMembersOperation), QStringLiteral("/v1/usergroups"));
+    QCOMPARE(EnginioRequestBuilder::operationPath(Enginio::ObjectOperation), QStringLiteral("/v1/"));
+
+    QBENCHMARK {
+        EnginioRequestBuilder::operationPath(Enginio::UserOperation);
+    }
+}
+
+void tst_Bench_RequestBuilder::prepareRequest()
+{
+    EnginioClientConnectionPrivate *client = EnginioClientConnectionPrivate::get(&_client);
+    QUrl url(_client.serviceUrl());
+    url.setPath(EnginioRequestBuilder::objectTypePath(QStringLiteral("objects.BenchmarkObject")));
+
+    QBENCHMARK {
+        client->prepareRequest(url);
+    }
+}
+
+void tst_Bench_RequestBuilder::allocations()
+{
+#ifndef ALLOCATION_COUNTING_AVAILABLE
+    QSKIP("Counting allocations needs glibc");
+#endif
+    // A cached path is shared, a request id is a single byte array.
+    QCOMPARE(allocationsPerCall(ObjectTypePath()), 0);
+    QVERIFY(allocationsPerCall(RequestId()) <= 1);
+
+    // The request still detaches the shared QNetworkRequest, stores the
+    // url and the X-Request-Id header; only report those.
+    PrepareRequest prepare = { EnginioClientConnectionPrivate::get(&_client), _client.serviceUrl() };
+    qDebug() << "allocations per prepareRequest():" << allocationsPerCall(prepare);
+}
+
+QTEST_MAIN(tst_Bench_RequestBuilder)
+#include "tst_bench_requestbuilder.moc"
@@ -0,0 +1,179 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qendian.h>
+
+#include <Enginio/private/enginiowebsocketdecoder_p.h>
+#include <Enginio/private/enginiowebsocketmask_p.h>
+
+typedef EnginioWebSocketDecoder Decoder;
+
+class tst_bench_WebSocketDecoder: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decode_data();
+    void decode();
+    void mask_data();
+    void mask();
+
+private:
+    static QByteArray frameStream(int frameSize, int fragments, int totalSize);
+};
+
+static void appendFrame(QByteArray &stream, int opcode, bool final, const QByteArray &payload)
+{
+    stream.append(char((final ? 0x80 : 0) | opcode));
+    if (payload.size() < 126) {
+        stream.append(char(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        stream.append(char(126));
+        uchar length[2];
+        qToBigEndian<quint16>(payload.size(), length);
+        stream.append(reinterpret_cast<char*>(length), 2);
+    } else {
+        stream.append(char(127));
+        uchar length[8];
+        qToBigEndian<quint64>(payload.size(), length);
+        stream.append(reinterpret_cast<char*>(length), 8);
+    }
+    stream.append(payload);
+}
+
+// Builds roughly totalSize bytes of text messages of frameSize bytes each,
+// every message split into the given number of fragments.
+QByteArray tst_bench_WebSocketDecoder::frameStream(int frameSize, int fragments, int totalSize)
+{
+    const QByteArray fragment(frameSize / fragments, 'x');
+    QByteArray stream;
+    stream.reserve(totalSize + totalSize / 8 + 16);
+    while (stream.size() < totalSize) {
+        for (int i = 0; i < fragments; ++i) {
+            const int opcode = i ? Decoder::ContinuationFrameOp : Decoder::TextFrameOp;
+            appendFrame(stream, opcode, i == fragments - 1, fragment);
+        }
+    }
+    return stream;
+}
+
+void tst_bench_WebSocketDecoder::decode_data()
+{
+    QTest::addColumn<int>("frameSize");
+    QTest::addColumn<int>("fragments");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("16 B frames") << 16 << 1 << 4096;
+    QTest::newRow("1 KiB frames") << 1024 << 1 << 4096;
+    QTest::newRow("64 KiB frames") << 64 * 1024 << 1 << 4096;
+    QTest::newRow("64 KiB frames, 64 KiB reads") << 64 * 1024 << 1 << 64 * 1024;
+    QTest::newRow("64 KiB messages in 16 fragments") << 64 * 1024 << 16 << 4096;
+}
+
+void tst_bench_WebSocketDecoder::decode()
+{
+    QFETCH(int, frameSize);
+    QFETCH(int, fragments);
+    QFETCH(int, chunkSize);
+
+    const QByteArray stream = frameStream(frameSize, fragments, 8 * 1024 * 1024);
+    const char *data = stream.constData();
+    const int size = stream.size();
+
+    qint64 payloadBytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    int runs = 0;
+    QBENCHMARK {
+        Decoder decoder;
+        Decoder::Frame frame;
+        for (int offset = 0; offset < size; offset += chunkSize) {
+            // same pattern as the backend connection: read straight into the buffer
+            const int length = qMin(chunkSize, size - offset);
+            memcpy(decoder.reserve(length), data + offset, length);
+            decoder.commit(length);
+            while (decoder.next(&frame) == Decoder::FrameDecoded)
+                payloadBytes += frame.size;
+        }
+        ++runs;
+    }
+    const qint64 elapsed = timer.elapsed();
+    if (elapsed)
+        qDebug() << "throughput:" << (double(size) * runs / (1024 * 1024)) / (elapsed / 1000.0) << "MiB/s,"
+                 << payloadBytes / runs << "payload bytes per run";
+}
+
+// How EnginioBackendConnection masked outgoing frames before
+static void maskDataBytewise(QByteArray &data, const QByteArray &maskingKey)
+{
+    for (int octet = 0; octet < data.size(); ++octet)
+        data[octet] = data[octet] ^ maskingKey[octet % maskingKey.size()];
+}
+
+void tst_bench_WebSocketDecoder::mask_data()
+{
+    QTest::addColumn<bool>("bytewise");
+    QTest::addColumn<int>("size");
+
+    const int sizes[] = { 16, 125, 1024, 64 * 1024, 1024 * 1024 };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        const QByteArray size = QByteArray::number(sizes[i]);
+        QTest::newRow(("bytewise " + size).constData()) << true << sizes[i];
+        QTest::newRow(("vectorized " + size).constData()) << false << sizes[i];
+    }
+}
+
+void tst_bench_WebSocketDecoder::mask()
+{
+    QFETCH(bool, bytewise);
+    QFETCH(int, size);
+
+    const uchar key[] = { 0x37, 0xfa, 0x21, 0x3d };
+    const QByteArray maskingKey(reinterpret_cast<const char*>(key), 4);
+    QByteArray data(size, 'x');
+    QByteArray masked(size, Qt::Uninitialized);
+
+    if (bytewise) {
+        QBENCHMARK {
+            maskDataBytewise(data, maskingKey);
+        }
+    } else {
+        QBENCHMARK {
+            enginioMaskWebSocketData(masked.data(), data.constData(), size, key);
+        }
+    }
+}
+
+QTEST_MAIN(tst_bench_WebSocketDecoder)
+#include "tst_bench_websocketdecoder.moc"
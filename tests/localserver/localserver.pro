@@ -0,0 +1,12 @@
+QT       += network
+QT       -= gui
+
+TARGET = enginiolocalserver
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include(../auto/common/localserver.pri)
+
+SOURCES += main.cpp
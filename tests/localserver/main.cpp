@@ -0,0 +1,66 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qtextstream.h>
+
+#include "enginiolocalserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("enginiolocalserver"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("In-memory stand-in for the Enginio backend. "
+                                                    "Point ENGINIO_API_URL at the printed url to run the autotests offline."));
+    parser.addHelpOption();
+    QCommandLineOption portOption(QStringList() << QStringLiteral("p") << QStringLiteral("port"),
+                                  QStringLiteral("Port to listen on, 0 picks a free one."),
+                                  QStringLiteral("port"), QStringLiteral("0"));
+    QCommandLineOption anyOption(QStringLiteral("any"), QStringLiteral("Listen on all interfaces instead of localhost only."));
+    parser.addOption(portOption);
+    parser.addOption(anyOption);
+    parser.process(app);
+
+    EnginioTests::EnginioLocalServer server;
+    const QHostAddress address = parser.isSet(anyOption) ? QHostAddress(QHostAddress::Any) : QHostAddress(QHostAddress::LocalHost);
+    if (!server.listen(address, parser.value(portOption).toUShort())) {
+        qWarning("Could not listen on port %s", qPrintable(parser.value(portOption)));
+        return 1;
+    }
+
+    QTextStream(stdout) << server.url().toString() << endl;
+    return app.exec();
+}